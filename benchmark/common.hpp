@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QtCore/QSize>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+struct dvs_event {
+    uint64_t t;
+    uint16_t x;
+    uint16_t y;
+    bool is_increase;
+};
+
+struct flow_event {
+    uint64_t t;
+    uint16_t x;
+    uint16_t y;
+    float vx;
+    float vy;
+};
+
+struct grey_event {
+    uint16_t x;
+    uint16_t y;
+    float exposure;
+};
+
+struct color_event {
+    uint16_t x;
+    uint16_t y;
+    float r;
+    float g;
+    float b;
+};
+
+struct delta_t_event {
+    uint32_t delta_t;
+    uint16_t x;
+    uint16_t y;
+};
+
+/// result is a single measure, written as a JSON object.
+struct result {
+    std::string renderer;
+    std::string variant;
+    QSize canvas_size;
+    std::string operation;
+    std::size_t events_per_frame;
+    std::string metric;
+    double value;
+};
+
+/// seconds_since returns the time elapsed since the given time point, in seconds.
+inline double seconds_since(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - begin)
+        .count();
+}
+
+/// push_batches pushes the events to the renderer in batches of the given size.
+template <typename Renderer, typename Iterator>
+void push_batches(Renderer& renderer, Iterator begin, Iterator end, std::size_t batch_size) {
+    while (begin != end) {
+        const auto batch_end =
+            std::next(begin, std::min(static_cast<std::ptrdiff_t>(batch_size), std::distance(begin, end)));
+        renderer.push(begin, batch_end);
+        begin = batch_end;
+    }
+}
+
+/// write_json writes the results as a JSON document.
+inline void write_json(std::ostream& output, const std::vector<result>& results) {
+    output << "{\n    \"benchmark\": \"chameleon\",\n    \"results\": [";
+    for (std::size_t index = 0; index < results.size(); ++index) {
+        const auto& measure = results[index];
+        output << (index == 0 ? "\n" : ",\n") << "        {\"renderer\": \"" << measure.renderer
+               << "\", \"variant\": \"" << measure.variant << "\", \"width\": " << measure.canvas_size.width()
+               << ", \"height\": " << measure.canvas_size.height() << ", \"operation\": \"" << measure.operation
+               << "\", \"events_per_frame\": " << measure.events_per_frame << ", \"metric\": \"" << measure.metric
+               << "\", \"value\": " << std::setprecision(9) << measure.value << "}";
+    }
+    output << "\n    ]\n}\n";
+}
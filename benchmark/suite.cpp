@@ -0,0 +1,798 @@
+#include "../source/color_display.hpp"
+#include "../source/delta_t_display.hpp"
+#include "../source/dvs_display.hpp"
+#include "../source/event_surface.hpp"
+#include "../source/flow_display.hpp"
+#include "../source/grey_display.hpp"
+#include "common.hpp"
+#include <QtGui/QGuiApplication>
+#include <QtGui/QOffscreenSurface>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFramebufferObject>
+#include <QtGui/QOpenGLFunctions>
+#include <array>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <utility>
+
+/// pooled_renderer exposes the level of detail reduction of dvs_display_renderer, which otherwise runs during the
+/// upload.
+class pooled_renderer : public chameleon::dvs_display_renderer {
+    public:
+    pooled_renderer(QSize canvas_size, bool packed) :
+        chameleon::dvs_display_renderer(
+            canvas_size, 1e5, Qt::white, Qt::darkGray, Qt::black, Qt::black, false, packed, false, 1, true, 0) {}
+
+    /// pool reduces the whole canvas to a texture of the given size, and returns its texels.
+    std::vector<uint32_t> pool(std::size_t width, std::size_t height, uint32_t current_t) {
+        _level_of_detail.update(QRectF(), width, height, true);
+        std::vector<uint32_t> texels(_level_of_detail.pixels() * (_packed ? 1 : 2));
+        lock_shards();
+        reduce(texels.data(), 0, height, current_t);
+        unlock_shards();
+        return texels;
+    }
+};
+
+/// clamp converts a coordinate to a pixel index in the range [0, size - 1].
+uint16_t clamp(double value, int size) {
+    return static_cast<uint16_t>(std::min(std::max(value, 0.0), static_cast<double>(size - 1)));
+}
+
+/// driving generates the events of edges sweeping across the canvas, as seen from a moving car.
+/// Each edge is a slanted segment moving sideways, and its events are jittered by a pixel or two.
+std::vector<dvs_event> driving(QSize canvas_size, std::size_t number_of_events, std::mt19937& engine) {
+    const std::size_t edges = 8;
+    std::uniform_real_distribution<double> unit_distribution;
+    std::normal_distribution<double> jitter_distribution(0.0, 1.5);
+    std::vector<std::array<double, 4>> segments(edges);
+    for (auto& segment : segments) {
+        segment = {unit_distribution(engine) * canvas_size.width(),
+                   unit_distribution(engine) * canvas_size.height(),
+                   (unit_distribution(engine) - 0.5) * 1e-3,
+                   unit_distribution(engine) - 0.5};
+    }
+    std::vector<dvs_event> events;
+    events.reserve(number_of_events);
+    for (std::size_t index = 0; index < number_of_events; ++index) {
+        auto& segment = segments[index % edges];
+        segment[0] += segment[2];
+        if (segment[0] < 0 || segment[0] >= canvas_size.width()) {
+            segment[2] = -segment[2];
+        }
+        const auto position = (unit_distribution(engine) - 0.5) * canvas_size.height() / 4.0;
+        events.push_back(dvs_event{
+            index,
+            clamp(segment[0] + position * segment[3] + jitter_distribution(engine), canvas_size.width()),
+            clamp(segment[1] + position + jitter_distribution(engine), canvas_size.height()),
+            segment[2] > 0});
+    }
+    return events;
+}
+
+/// gesture generates the events of a hand moving in front of a static sensor.
+/// The events are normally distributed around a point following a Lissajous curve.
+std::vector<dvs_event> gesture(QSize canvas_size, std::size_t number_of_events, std::mt19937& engine) {
+    std::normal_distribution<double> spread_distribution(0.0, canvas_size.height() / 24.0);
+    std::uniform_real_distribution<double> unit_distribution;
+    std::vector<dvs_event> events;
+    events.reserve(number_of_events);
+    for (std::size_t index = 0; index < number_of_events; ++index) {
+        const auto phase = static_cast<double>(index) * 1e-6;
+        events.push_back(dvs_event{
+            index,
+            clamp(
+                canvas_size.width() * (0.5 + 0.35 * std::sin(phase * 3.0)) + spread_distribution(engine),
+                canvas_size.width()),
+            clamp(
+                canvas_size.height() * (0.5 + 0.35 * std::sin(phase * 2.0)) + spread_distribution(engine),
+                canvas_size.height()),
+            unit_distribution(engine) < 0.5});
+    }
+    return events;
+}
+
+/// convert builds events of another display at the positions of the given events.
+template <typename Event, typename Convert>
+std::vector<Event> convert(const std::vector<dvs_event>& events, Convert convert_event) {
+    std::vector<Event> converted_events;
+    converted_events.reserve(events.size());
+    for (const auto& event : events) {
+        converted_events.push_back(convert_event(event));
+    }
+    return converted_events;
+}
+
+/// layout_name describes the pixels state layout for the given tile size.
+std::string layout_name(std::size_t tile_size) {
+    if (tile_size == 0) {
+        return "row-major";
+    }
+    return std::to_string(tile_size) + " x " + std::to_string(tile_size) + " tiles";
+}
+
+/// suite runs the benchmarks of every renderer on a given canvas size.
+class suite {
+    public:
+    suite(QSize canvas_size, QOpenGLFunctions* functions, std::vector<result>& results) :
+        _canvas_size(canvas_size),
+        _functions(functions),
+        _results(results),
+        _engine(42),
+        _x_distribution(0, static_cast<uint16_t>(canvas_size.width() - 1)),
+        _y_distribution(0, static_cast<uint16_t>(canvas_size.height() - 1)) {}
+
+    /// run benchmarks push, assign and paint on the given renderer.
+    /// events are pushed for the push and paint benchmarks, frame is assigned for the assign benchmark.
+    template <typename Renderer, typename Event, typename Pixel>
+    void run(
+        const std::string& renderer_name,
+        const std::string& variant,
+        std::function<std::unique_ptr<Renderer>()> make_renderer,
+        const std::vector<Event>& events,
+        const std::vector<Pixel>& frame) {
+        push<Renderer>(renderer_name, variant, make_renderer, events);
+        assign<Renderer>(renderer_name, variant, make_renderer, frame);
+        for (const std::size_t events_per_frame : {0, 1000, 100000}) {
+            auto renderer = make_renderer();
+            const std::size_t number_of_frames = 100;
+
+            // the first frame compiles the program and uploads the whole canvas
+            renderer->paint();
+            _functions->glFinish();
+            renderer->sample_performance();
+            std::vector<double> paint_durations;
+            paint_durations.reserve(number_of_frames);
+            double copy_duration = 0;
+            double gpu_duration = 0;
+            double uploaded_bytes = 0;
+            auto event_begin = events.begin();
+            for (std::size_t index = 0; index < number_of_frames; ++index) {
+                for (std::size_t pushed = 0; pushed < events_per_frame;) {
+                    if (event_begin == events.end()) {
+                        event_begin = events.begin();
+                    }
+                    const auto event_end = std::next(
+                        event_begin,
+                        std::min(
+                            static_cast<std::ptrdiff_t>(events_per_frame - pushed),
+                            std::distance(event_begin, events.end())));
+                    renderer->push(event_begin, event_end);
+                    pushed += static_cast<std::size_t>(std::distance(event_begin, event_end));
+                    event_begin = event_end;
+                }
+                const auto begin = std::chrono::steady_clock::now();
+                renderer->paint();
+                paint_durations.push_back(seconds_since(begin) * 1e6);
+                _functions->glFinish();
+                const auto performance = renderer->sample_performance();
+                copy_duration += performance.copy_duration;
+                gpu_duration += performance.gpu_duration;
+                uploaded_bytes += static_cast<double>(performance.uploaded_bytes);
+            }
+            const auto median = std::next(paint_durations.begin(), paint_durations.size() / 2);
+            std::nth_element(paint_durations.begin(), median, paint_durations.end());
+            add(renderer_name, variant, "paint", events_per_frame, "median_paint_duration", *median);
+            add(renderer_name,
+                variant,
+                "paint",
+                events_per_frame,
+                "mean_copy_duration",
+                copy_duration / number_of_frames);
+            add(renderer_name,
+                variant,
+                "paint",
+                events_per_frame,
+                "mean_gpu_duration",
+                gpu_duration / number_of_frames);
+            add(renderer_name,
+                variant,
+                "paint",
+                events_per_frame,
+                "mean_uploaded_bytes",
+                uploaded_bytes / number_of_frames);
+        }
+    }
+
+    /// push compares single and batched pushes on the given renderer.
+    template <typename Renderer, typename Event>
+    void push(
+        const std::string& renderer_name,
+        const std::string& variant,
+        std::function<std::unique_ptr<Renderer>()> make_renderer,
+        const std::vector<Event>& events) {
+        log(renderer_name, variant);
+        {
+            auto renderer = make_renderer();
+            const auto begin = std::chrono::steady_clock::now();
+            for (auto event : events) {
+                renderer->push(event);
+            }
+            add(renderer_name, variant, "push", 1, "events_per_second", events.size() / seconds_since(begin));
+        }
+        for (const std::size_t batch_size : {16, 256, 4096}) {
+            auto renderer = make_renderer();
+            add(renderer_name,
+                variant,
+                "push",
+                batch_size,
+                "events_per_second",
+                events_per_second(*renderer, events, batch_size));
+        }
+    }
+
+    /// assign compares a contiguous frame (SIMD path) with the same frame stored in a deque (generic path).
+    template <typename Renderer, typename Pixel>
+    void assign(
+        const std::string& renderer_name,
+        const std::string& variant,
+        std::function<std::unique_ptr<Renderer>()> make_renderer,
+        const std::vector<Pixel>& frame) {
+        const std::deque<Pixel> generic_frame(frame.begin(), frame.end());
+        {
+            auto renderer = make_renderer();
+            add(renderer_name,
+                variant,
+                "assign",
+                frame.size(),
+                "frames_per_second",
+                frames_per_second(*renderer, frame));
+        }
+        {
+            auto renderer = make_renderer();
+            add(renderer_name,
+                variant,
+                "assign_generic",
+                frame.size(),
+                "frames_per_second",
+                frames_per_second(*renderer, generic_frame));
+        }
+    }
+
+    /// push_concurrently measures the sharded ingestion of dvs_display, with the events split between producer
+    /// threads pushing batches of 256 events.
+    void push_concurrently(const std::vector<dvs_event>& events) {
+        const std::size_t maximum_producers = std::max(2u, std::thread::hardware_concurrency());
+        for (const std::size_t shards : {1, 16, 64}) {
+            for (std::size_t producers = 1; producers <= maximum_producers; producers *= 2) {
+                const auto variant = std::to_string(shards) + (shards == 1 ? " shard, " : " shards, ")
+                                     + std::to_string(producers) + (producers == 1 ? " producer" : " producers");
+                log("dvs_display", variant);
+                std::vector<std::vector<dvs_event>> producers_events(producers);
+                for (std::size_t index = 0; index < events.size(); ++index) {
+                    producers_events[index % producers].push_back(events[index]);
+                }
+                chameleon::dvs_display_renderer renderer(
+                    _canvas_size,
+                    1e5,
+                    Qt::white,
+                    Qt::darkGray,
+                    Qt::black,
+                    Qt::black,
+                    false,
+                    false,
+                    false,
+                    shards,
+                    false,
+                    0);
+                const auto begin = std::chrono::steady_clock::now();
+                std::vector<std::thread> threads;
+                for (const auto& producer_events : producers_events) {
+                    threads.emplace_back([&]() {
+                        push_batches(renderer, producer_events.begin(), producer_events.end(), 256);
+                    });
+                }
+                for (auto& thread : threads) {
+                    thread.join();
+                }
+                add("dvs_display", variant, "push", 256, "events_per_second", events.size() / seconds_since(begin));
+            }
+        }
+    }
+
+    /// seek compares seeking in a one-minute recording by replaying it from the start, with restoring the latest
+    /// keyframe and replaying only the events that follow it.
+    void seek() {
+        const uint64_t duration = 60000000;
+        const std::size_t number_of_events = 30000000;
+        const uint64_t keyframe_interval = 1000000;
+        std::vector<dvs_event> events;
+        events.reserve(number_of_events);
+        for (std::size_t index = 0; index < number_of_events; ++index) {
+            events.push_back(dvs_event{index * duration / number_of_events,
+                                       _x_distribution(_engine),
+                                       _y_distribution(_engine),
+                                       value() < 0.5f});
+        }
+        std::uniform_int_distribution<uint64_t> t_distribution(0, duration - 1);
+        std::vector<uint64_t> seek_ts(16);
+        for (auto& seek_t : seek_ts) {
+            seek_t = t_distribution(_engine);
+        }
+        for (const auto keyframes : {false, true}) {
+            log("dvs_display", keyframes ? "keyframes" : "");
+            chameleon::dvs_display_renderer renderer(
+                _canvas_size, 1e5, Qt::white, Qt::darkGray, Qt::black, Qt::black, false, false, false, 1, false, 0);
+            if (keyframes) {
+                renderer.set_keyframes(keyframe_interval, static_cast<std::size_t>(duration / keyframe_interval));
+                push_batches(renderer, events.begin(), events.end(), 4096);
+            }
+            double total_duration = 0;
+            for (const auto seek_t : seek_ts) {
+                const auto begin = std::chrono::steady_clock::now();
+                const auto keyframe_t = keyframes ? renderer.restore(seek_t) : 0;
+                const auto replay_begin = std::lower_bound(
+                    events.begin(), events.end(), keyframe_t, [](const dvs_event& event, uint64_t t) {
+                        return event.t < t;
+                    });
+                const auto replay_end =
+                    std::upper_bound(replay_begin, events.end(), seek_t, [](uint64_t t, const dvs_event& event) {
+                        return t < event.t;
+                    });
+                push_batches(renderer, replay_begin, replay_end, 4096);
+                total_duration += seconds_since(begin) * 1e6;
+            }
+            add("dvs_display",
+                keyframes ? "keyframes" : "",
+                "seek",
+                4096,
+                "mean_seek_duration",
+                total_duration / seek_ts.size());
+            if (keyframes) {
+                add("dvs_display",
+                    "keyframes",
+                    "seek",
+                    4096,
+                    "keyframes_bytes",
+                    static_cast<double>(renderer.keyframes_bytes()));
+            }
+        }
+    }
+
+    /// reduce measures the lod max-time pooling of dvs_display on a stream crossing the timestamps wraparound (2^31
+    /// in packed mode, 2^32 otherwise), and returns false if a texel does not hold the newest pixel of its block.
+    bool reduce() {
+        const std::size_t block = 4;
+        const std::size_t width = _canvas_size.width() / block;
+        const std::size_t height = _canvas_size.height() / block;
+        const std::size_t number_of_events = 10000000;
+        const uint64_t duration = 10000000;
+        const std::size_t repetitions = 20;
+        auto success = true;
+        for (const auto packed : {false, true}) {
+            log("dvs_display", packed ? "lod, packed" : "lod");
+            const uint64_t wrap = packed ? (static_cast<uint64_t>(1) << 31) : (static_cast<uint64_t>(1) << 32);
+            std::vector<uint64_t> latest_ts(_canvas_size.width() * _canvas_size.height(), 0);
+            pooled_renderer renderer(_canvas_size, packed);
+            std::vector<dvs_event> events;
+            events.reserve(number_of_events);
+            for (std::size_t index = 0; index < number_of_events; ++index) {
+                events.push_back(dvs_event{wrap - duration / 2 + index * duration / number_of_events,
+                                           _x_distribution(_engine),
+                                           _y_distribution(_engine),
+                                           value() < 0.5f});
+                latest_ts[events.back().x + events.back().y * _canvas_size.width()] = events.back().t;
+            }
+            renderer.push(events.begin(), events.end());
+            const auto current_t = static_cast<uint32_t>(events.back().t);
+            std::vector<uint32_t> texels;
+            const auto begin = std::chrono::steady_clock::now();
+            for (std::size_t repetition = 0; repetition < repetitions; ++repetition) {
+                texels = renderer.pool(width, height, current_t);
+            }
+            const auto reduce_duration = seconds_since(begin) * 1e6 / repetitions;
+            std::size_t blocks = 0;
+            std::size_t newest = 0;
+            for (std::size_t y = 0; y < height; ++y) {
+                for (std::size_t x = 0; x < width; ++x) {
+                    uint64_t latest_t = 0;
+                    bool complete = true;
+                    for (auto pixel_y = y * block; pixel_y < (y + 1) * block; ++pixel_y) {
+                        for (auto pixel_x = x * block; pixel_x < (x + 1) * block; ++pixel_x) {
+                            const auto t = latest_ts[pixel_x + pixel_y * _canvas_size.width()];
+                            complete = complete && t > 0;
+                            latest_t = std::max(latest_t, t);
+                        }
+                    }
+                    if (complete) {
+                        ++blocks;
+                        const auto texel = texels[(x + y * width) * (packed ? 1 : 2)];
+                        if (packed ? (texel >> 1) == (static_cast<uint32_t>(latest_t) & 0x7fffffffu)
+                                   : texel == static_cast<uint32_t>(latest_t)) {
+                            ++newest;
+                        }
+                    }
+                }
+            }
+            add("dvs_display", packed ? "lod, packed" : "lod", "reduce", 0, "mean_reduce_duration", reduce_duration);
+            add("dvs_display",
+                packed ? "lod, packed" : "lod",
+                "reduce",
+                0,
+                "newest_texels_ratio",
+                blocks == 0 ? 1.0 : static_cast<double>(newest) / blocks);
+            if (newest != blocks) {
+                std::cerr << newest << " / " << blocks << " texels hold their block's newest pixel" << std::endl;
+                success = false;
+            }
+        }
+        return success;
+    }
+
+    /// push_tiled compares the row-major and tiled pixels states on the given event stream.
+    void push_tiled(const std::string& pattern, const std::vector<dvs_event>& events) {
+        for (const auto packed : {false, true}) {
+            for (const std::size_t tile_size : {0, 8, 16, 32}) {
+                const auto variant = pattern + ", " + layout_name(tile_size) + (packed ? ", packed" : "");
+                log("dvs_display", variant);
+                chameleon::dvs_display_renderer renderer(
+                    _canvas_size,
+                    1e5,
+                    Qt::white,
+                    Qt::darkGray,
+                    Qt::black,
+                    Qt::black,
+                    false,
+                    packed,
+                    false,
+                    1,
+                    false,
+                    tile_size);
+                add("dvs_display",
+                    variant,
+                    "push",
+                    4096,
+                    "events_per_second",
+                    events_per_second(renderer, events, 4096));
+            }
+        }
+        const auto delta_t_events = convert<delta_t_event>(events, [](const dvs_event& event) {
+            return delta_t_event{static_cast<uint32_t>(event.t % 100000 + 1), event.x, event.y};
+        });
+        const auto flow_events = convert<flow_event>(events, [](const dvs_event& event) {
+            return flow_event{event.t, event.x, event.y, 1e-4f, event.is_increase ? 1e-4f : -1e-4f};
+        });
+        const auto color_events = convert<color_event>(events, [](const dvs_event& event) {
+            return color_event{event.x, event.y, 1.0f, event.is_increase ? 1.0f : 0.0f, 0.0f};
+        });
+        for (const std::size_t tile_size : {0, 16}) {
+            const auto variant = pattern + ", " + layout_name(tile_size);
+            log("delta_t_display, flow_display and color_display", variant);
+            chameleon::delta_t_display_renderer delta_t_renderer(_canvas_size, 0.01f, 10, 0, false, false, tile_size);
+            chameleon::flow_display_renderer flow_renderer(_canvas_size, 1e6, 1e5, false, tile_size);
+            chameleon::color_display_renderer color_renderer(_canvas_size, 0, tile_size);
+            add("delta_t_display",
+                variant,
+                "push",
+                4096,
+                "events_per_second",
+                events_per_second(delta_t_renderer, delta_t_events, 4096));
+            add("flow_display",
+                variant,
+                "push",
+                4096,
+                "events_per_second",
+                events_per_second(flow_renderer, flow_events, 4096));
+            add("color_display",
+                variant,
+                "push",
+                4096,
+                "events_per_second",
+                events_per_second(color_renderer, color_events, 4096));
+        }
+    }
+
+    /// copy_tiled measures the de-tiling overhead of the upload, by copying the whole canvas to a row-major buffer.
+    void copy_tiled() {
+        const auto width = static_cast<std::size_t>(_canvas_size.width());
+        const std::size_t repetitions = 100;
+        for (const auto packed : {false, true}) {
+            for (const std::size_t tile_size : {0, 8, 16, 32}) {
+                const chameleon::tiled_layout layout(_canvas_size, tile_size);
+                const std::size_t channels = packed ? 1 : 2;
+                std::vector<uint32_t> state(layout.size() * channels, 1);
+                std::vector<uint32_t> buffer(width * _canvas_size.height() * channels);
+                const auto begin = std::chrono::steady_clock::now();
+                for (std::size_t repetition = 0; repetition < repetitions; ++repetition) {
+                    for (std::size_t y = 0; y < static_cast<std::size_t>(_canvas_size.height()); ++y) {
+                        layout.copy_row(state.data(), buffer.data() + y * width * channels, channels, y, 0, width);
+                    }
+                    state[repetition] = buffer[repetition];
+                }
+                add("dvs_display",
+                    layout_name(tile_size) + (packed ? ", packed" : ""),
+                    "copy",
+                    0,
+                    "mean_copy_duration",
+                    seconds_since(begin) * 1e6 / repetitions);
+            }
+        }
+    }
+
+    /// generate creates events with random coordinates.
+    template <typename Event, typename Generator>
+    std::vector<Event> generate(std::size_t number_of_events, Generator generator) {
+        std::vector<Event> events;
+        events.reserve(number_of_events);
+        for (std::size_t index = 0; index < number_of_events; ++index) {
+            events.push_back(generator(index, _x_distribution(_engine), _y_distribution(_engine)));
+        }
+        return events;
+    }
+
+    /// value returns a random number in [0, 1).
+    float value() {
+        return _value_distribution(_engine);
+    }
+
+    protected:
+    /// events_per_second pushes the events in batches, and returns the number of events pushed per second.
+    template <typename Renderer, typename Event>
+    static double events_per_second(Renderer& renderer, const std::vector<Event>& events, std::size_t batch_size) {
+        const auto begin = std::chrono::steady_clock::now();
+        push_batches(renderer, events.begin(), events.end(), batch_size);
+        return events.size() / seconds_since(begin);
+    }
+
+    /// frames_per_second assigns the given frame repeatedly, and returns the number of frames assigned per second.
+    template <typename Renderer, typename Frame>
+    static double frames_per_second(Renderer& renderer, const Frame& frame) {
+        const std::size_t number_of_frames = 50;
+        const auto begin = std::chrono::steady_clock::now();
+        for (std::size_t index = 0; index < number_of_frames; ++index) {
+            renderer.assign(frame.begin(), frame.end());
+        }
+        return number_of_frames / seconds_since(begin);
+    }
+
+    /// log writes the running benchmark's name to the standard error.
+    void log(const std::string& renderer_name, const std::string& variant) {
+        std::cerr << renderer_name << (variant.empty() ? "" : " (" + variant + ")") << " " << _canvas_size.width()
+                  << "x" << _canvas_size.height() << std::endl;
+    }
+
+    /// add stores a measure.
+    void add(
+        const std::string& renderer_name,
+        const std::string& variant,
+        const std::string& operation,
+        std::size_t events_per_frame,
+        const std::string& metric,
+        double value) {
+        _results.push_back(result{renderer_name, variant, _canvas_size, operation, events_per_frame, metric, value});
+    }
+
+    QSize _canvas_size;
+    QOpenGLFunctions* _functions;
+    std::vector<result>& _results;
+    std::mt19937 _engine;
+    std::uniform_int_distribution<uint16_t> _x_distribution;
+    std::uniform_int_distribution<uint16_t> _y_distribution;
+    std::uniform_real_distribution<float> _value_distribution;
+};
+
+int main(int argc, char* argv[]) {
+    if (argc > 2) {
+        std::cerr << "Syntax: ./benchmark_suite [output.json]" << std::endl;
+        return 1;
+    }
+    QGuiApplication app(argc, argv);
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!context.create()) {
+        std::cerr << "creating the OpenGL context failed" << std::endl;
+        return 1;
+    }
+    QOffscreenSurface surface;
+    surface.setFormat(context.format());
+    surface.create();
+    if (!context.makeCurrent(&surface)) {
+        std::cerr << "making the OpenGL context current failed" << std::endl;
+        return 1;
+    }
+    std::vector<result> results;
+    auto success = true;
+    for (const auto canvas_size : {QSize(304, 240), QSize(640, 480), QSize(1280, 720)}) {
+        QOpenGLFramebufferObject framebuffer(canvas_size, QOpenGLFramebufferObject::NoAttachment);
+        framebuffer.bind();
+        const QRectF area(0, 0, canvas_size.width(), canvas_size.height());
+
+        // lod variants are painted in a quarter of the canvas, like a thumbnail
+        const QRectF thumbnail_area(0, 0, canvas_size.width() / 4, canvas_size.height() / 4);
+        const auto pixels = static_cast<std::size_t>(canvas_size.width()) * canvas_size.height();
+        const std::size_t number_of_events = 2000000;
+        suite benchmarks(canvas_size, context.functions(), results);
+        {
+            const auto events =
+                benchmarks.generate<dvs_event>(number_of_events, [&](std::size_t index, uint16_t x, uint16_t y) {
+                    return dvs_event{index, x, y, benchmarks.value() < 0.5f};
+                });
+            std::vector<dvs_event> frame(pixels);
+            for (std::size_t index = 0; index < pixels; ++index) {
+                frame[index] = dvs_event{index, 0, 0, benchmarks.value() < 0.5f};
+            }
+            for (const auto& variant : std::vector<std::pair<std::string, std::array<bool, 4>>>{
+                     {"", {false, false, false, false}},
+                     {"double buffered", {true, false, false, false}},
+                     {"packed", {false, true, false, false}},
+                     {"gpu scatter", {false, false, true, false}},
+                     {"lod", {false, false, false, true}}}) {
+                benchmarks.run<chameleon::dvs_display_renderer>(
+                    "dvs_display",
+                    variant.first,
+                    [&]() {
+                        std::unique_ptr<chameleon::dvs_display_renderer> renderer(
+                            new chameleon::dvs_display_renderer(
+                                canvas_size,
+                                1e5,
+                                Qt::white,
+                                Qt::darkGray,
+                                Qt::black,
+                                Qt::black,
+                                std::get<0>(variant.second),
+                                std::get<1>(variant.second),
+                                std::get<2>(variant.second),
+                                1,
+                                std::get<3>(variant.second),
+                                0));
+                        renderer->set_rendering_area(
+                            std::get<3>(variant.second) ? thumbnail_area : area, canvas_size.height());
+                        return renderer;
+                    },
+                    events,
+                    frame);
+            }
+            benchmarks.push<chameleon::event_surface_renderer>(
+                "event_surface",
+                "",
+                [&]() {
+                    return std::unique_ptr<chameleon::event_surface_renderer>(
+                        new chameleon::event_surface_renderer(canvas_size));
+                },
+                events);
+            benchmarks.push_concurrently(events);
+        }
+        {
+            const auto events =
+                benchmarks.generate<flow_event>(number_of_events, [&](std::size_t index, uint16_t x, uint16_t y) {
+                    return flow_event{index, x, y, benchmarks.value(), benchmarks.value()};
+                });
+            std::vector<flow_event> frame(pixels);
+            for (std::size_t index = 0; index < pixels; ++index) {
+                frame[index] = flow_event{index, 0, 0, benchmarks.value(), benchmarks.value()};
+            }
+            for (const auto sparse : {false, true}) {
+                benchmarks.run<chameleon::flow_display_renderer>(
+                    "flow_display",
+                    sparse ? "sparse" : "",
+                    [&]() {
+                        std::unique_ptr<chameleon::flow_display_renderer> renderer(
+                            new chameleon::flow_display_renderer(canvas_size, 1e6, 1e5, sparse, 0));
+                        renderer->set_rendering_area(area, canvas_size.height());
+                        return renderer;
+                    },
+                    events,
+                    frame);
+            }
+        }
+        {
+            const auto events =
+                benchmarks.generate<grey_event>(number_of_events, [&](std::size_t, uint16_t x, uint16_t y) {
+                    return grey_event{x, y, benchmarks.value()};
+                });
+            std::vector<float> frame(pixels);
+            for (auto& exposure : frame) {
+                exposure = benchmarks.value();
+            }
+            for (const auto lod : {false, true}) {
+                benchmarks.run<chameleon::grey_display_renderer>(
+                    "grey_display",
+                    lod ? "lod" : "",
+                    [&]() {
+                        std::unique_ptr<chameleon::grey_display_renderer> renderer(
+                            new chameleon::grey_display_renderer(canvas_size, 0, lod));
+                        renderer->set_rendering_area(
+                            lod ? thumbnail_area : area, lod ? thumbnail_area : area, canvas_size.height());
+                        return renderer;
+                    },
+                    events,
+                    frame);
+            }
+            std::vector<uint8_t> uint8_frame(pixels);
+            for (auto& exposure : uint8_frame) {
+                exposure = static_cast<uint8_t>(benchmarks.value() * 255.0f);
+            }
+            for (const std::size_t uint8_format : {0, 1}) {
+                benchmarks.assign<chameleon::grey_display_renderer>(
+                    "grey_display",
+                    uint8_format == 0 ? "uint8 exposures" : "uint8 exposures, uint8 format",
+                    [&]() {
+                        return std::unique_ptr<chameleon::grey_display_renderer>(
+                            new chameleon::grey_display_renderer(canvas_size, uint8_format, false));
+                    },
+                    uint8_frame);
+            }
+        }
+        {
+            const auto events =
+                benchmarks.generate<color_event>(number_of_events, [&](std::size_t, uint16_t x, uint16_t y) {
+                    return color_event{x, y, benchmarks.value(), benchmarks.value(), benchmarks.value()};
+                });
+            std::vector<color_event> frame(pixels);
+            for (auto& pixel : frame) {
+                pixel = color_event{0, 0, benchmarks.value(), benchmarks.value(), benchmarks.value()};
+            }
+            benchmarks.run<chameleon::color_display_renderer>(
+                "color_display",
+                "",
+                [&]() {
+                    std::unique_ptr<chameleon::color_display_renderer> renderer(
+                        new chameleon::color_display_renderer(canvas_size, 0, 0));
+                    renderer->set_rendering_area(area, area, canvas_size.height());
+                    return renderer;
+                },
+                events,
+                frame);
+        }
+        {
+            const auto events =
+                benchmarks.generate<delta_t_event>(number_of_events, [&](std::size_t, uint16_t x, uint16_t y) {
+                    return delta_t_event{static_cast<uint32_t>(benchmarks.value() * 1e5f), x, y};
+                });
+            std::vector<uint32_t> frame(pixels);
+            for (auto& delta_t : frame) {
+                delta_t = static_cast<uint32_t>(benchmarks.value() * 1e5f);
+            }
+            for (const auto& variant : std::vector<std::pair<std::string, std::array<bool, 2>>>{
+                     {"", {false, false}}, {"gpu scatter", {true, false}}, {"lod", {false, true}}}) {
+                const auto lod = std::get<1>(variant.second);
+                benchmarks.run<chameleon::delta_t_display_renderer>(
+                    "delta_t_display",
+                    variant.first,
+                    [&]() {
+                        std::unique_ptr<chameleon::delta_t_display_renderer> renderer(
+                            new chameleon::delta_t_display_renderer(
+                                canvas_size, 0.01f, 10, 0, std::get<0>(variant.second), lod, 0));
+                        renderer->set_rendering_area(
+                            lod ? thumbnail_area : area, lod ? thumbnail_area : area, canvas_size.height());
+                        return renderer;
+                    },
+                    events,
+                    frame);
+            }
+        }
+        benchmarks.seek();
+        success = benchmarks.reduce() && success;
+        {
+            std::mt19937 engine(42);
+            benchmarks.push_tiled("driving", driving(canvas_size, number_of_events, engine));
+            benchmarks.push_tiled("gesture", gesture(canvas_size, number_of_events, engine));
+            benchmarks.push_tiled(
+                "uniform",
+                benchmarks.generate<dvs_event>(number_of_events, [&](std::size_t index, uint16_t x, uint16_t y) {
+                    return dvs_event{index, x, y, benchmarks.value() < 0.5f};
+                }));
+            benchmarks.copy_tiled();
+        }
+    }
+    context.doneCurrent();
+    if (argc == 2) {
+        std::ofstream output(argv[1]);
+        if (!output.good()) {
+            std::cerr << "opening '" << argv[1] << "' failed" << std::endl;
+            return 1;
+        }
+        write_json(output, results);
+    } else {
+        write_json(std::cout, results);
+    }
+    return success ? 0 : 1;
+}
@@ -1,16 +1,34 @@
 local qt = require 'qt'
 
 local dependencies = {
-    blob_display = {'background_cleaner'},
-    color_display = {'background_cleaner'},
-    delta_t_display = {'background_cleaner'},
-    dvs_display = {'background_cleaner'},
-    flow_display = {'background_cleaner'},
-    frame_generator = {'grey_display'},
-    grey_display = {'background_cleaner'},
+    blob_display = {'background_cleaner', 'render_scheduler'},
+    color_display = {'background_cleaner', 'render_scheduler'},
+    delta_t_display = {'background_cleaner', 'render_scheduler'},
+    dvs_display = {'background_cleaner', 'render_scheduler'},
+    dvs_display_group = {'dvs_display', 'render_scheduler'},
+    event_rate_display = {'background_cleaner', 'delta_t_display', 'render_scheduler'},
+    event_surface = {'background_cleaner', 'render_scheduler'},
+    flow_display = {'background_cleaner', 'render_scheduler'},
+    frame_generator = {'grey_display', 'render_scheduler'},
+    grey_display = {'background_cleaner', 'render_scheduler'},
+    headless_renderer = {'dvs_display', 'frame_generator', 'render_scheduler'},
+    performance_overlay = {'background_cleaner', 'dvs_display', 'render_scheduler'},
+    render_scheduler = {'background_cleaner', 'dvs_display'},
 }
 setmetatable(dependencies, {__index = function() return {} end})
 
+local benchmark_dependencies = {
+    suite = {
+        'color_display',
+        'delta_t_display',
+        'dvs_display',
+        'event_surface',
+        'flow_display',
+        'grey_display',
+        'render_scheduler'},
+}
+setmetatable(benchmark_dependencies, {__index = function() return {} end})
+
 solution 'chameleon'
     configurations {'release', 'debug'}
     location 'build'
@@ -48,3 +66,36 @@ solution 'chameleon'
             configuration 'windows'
                 files {'.clang-format'}
     end
+    for index, file in pairs(os.matchfiles('benchmark/*.cpp')) do
+        local name = path.getbasename(file)
+        project('benchmark_' .. name)
+            kind 'ConsoleApp'
+            language 'C++'
+            location 'build'
+            files {'benchmark/' .. name .. '.cpp'}
+            for index, dependency_name in pairs(benchmark_dependencies[name]) do
+                files(qt.moc({'source/' .. dependency_name .. '.hpp'}, 'build/moc'))
+            end
+            includedirs(qt.includedirs())
+            libdirs(qt.libdirs())
+            links(qt.links())
+            buildoptions(qt.buildoptions())
+            linkoptions(qt.linkoptions())
+            configuration 'release'
+                targetdir 'build/release'
+                defines {'NDEBUG'}
+                flags {'OptimizeSpeed'}
+            configuration 'debug'
+                targetdir 'build/debug'
+                defines {'DEBUG'}
+                flags {'Symbols'}
+            configuration 'linux'
+                links {'pthread'}
+                buildoptions {'-std=c++11'}
+                linkoptions {'-std=c++11'}
+            configuration 'macosx'
+                buildoptions {'-std=c++11'}
+                linkoptions {'-std=c++11'}
+            configuration 'windows'
+                files {'.clang-format'}
+    end
@@ -1,30 +1,501 @@
 #pragma once
 
-#include <QtQuick/QtQuick>
+#include "render_scheduler.hpp"
+#include <QQmlParserStatus>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFunctions_3_3_Core>
+#include <QtQuick/QQuickItem>
+#include <QtQuick/qquickwindow.h>
 #include <array>
 #include <atomic>
-#include <cmath>
-#include <unordered_map>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 
 /// chameleon provides Qt components for event stream display.
 namespace chameleon {
 
+    /// blob_change_type lists the operations supported by blob_display::apply.
+    enum class blob_change_type { insert, update, erase };
+
+    /// blob_display_renderer handles openGL calls for a blob_display.
+    class blob_display_renderer : public QObject, public QOpenGLFunctions_3_3_Core {
+        Q_OBJECT
+        public:
+        blob_display_renderer(QSize canvas_size) :
+            _canvas_size(canvas_size),
+            _stroke_thickness(1),
+            _confidence(1.96f),
+            _program_setup(false) {
+            _accessing_blobs.clear(std::memory_order_release);
+        }
+        blob_display_renderer(const blob_display_renderer&) = delete;
+        blob_display_renderer(blob_display_renderer&&) = delete;
+        blob_display_renderer& operator=(const blob_display_renderer&) = delete;
+        blob_display_renderer& operator=(blob_display_renderer&&) = delete;
+        virtual ~blob_display_renderer() {
+            if (_program_setup) {
+                glDeleteBuffers(static_cast<GLsizei>(_vertex_buffers_ids.size()), _vertex_buffers_ids.data());
+                glDeleteVertexArrays(1, &_vertex_array_id);
+                glDeleteProgram(_program_id);
+            }
+        }
+
+        /// set_rendering_area defines the rendering area.
+        virtual void set_rendering_area(QRectF paint_area, int window_height) {
+            _paint_area = paint_area;
+            _paint_area.moveTop(window_height - _paint_area.top() - _paint_area.height());
+        }
+
+        /// set_style defines the blobs' appearance.
+        /// It must be called by the render thread, typically during the item's sync.
+        virtual void set_style(QColor stroke_color, float stroke_thickness, QColor fill_color, float confidence) {
+            _stroke_color = stroke_color;
+            _stroke_thickness = stroke_thickness;
+            _fill_color = fill_color;
+            _confidence = confidence;
+        }
+
+        /// insert displays a blob, which can be updated later on using its id.
+        template <typename Blob>
+        void insert(std::size_t id, Blob blob) {
+            while (_accessing_blobs.test_and_set(std::memory_order_acquire)) {
+            }
+            if (!insert_blob(id, to_managed_blob(blob))) {
+                _accessing_blobs.clear(std::memory_order_release);
+                throw std::logic_error("the given blob id was already inserted");
+            }
+            _accessing_blobs.clear(std::memory_order_release);
+        }
+
+        /// update modifies the parameters of an existing blob.
+        template <typename Blob>
+        void update(std::size_t id, Blob blob) {
+            while (_accessing_blobs.test_and_set(std::memory_order_acquire)) {
+            }
+            if (!update_blob(id, to_managed_blob(blob))) {
+                _accessing_blobs.clear(std::memory_order_release);
+                throw std::logic_error("the given blob id was not registered with insert");
+            }
+            _accessing_blobs.clear(std::memory_order_release);
+        }
+
+        /// erase removes an existing blob.
+        virtual void erase(std::size_t id) {
+            while (_accessing_blobs.test_and_set(std::memory_order_acquire)) {
+            }
+            if (!erase_blob(id)) {
+                _accessing_blobs.clear(std::memory_order_release);
+                throw std::logic_error("the given blob id was not registered with insert");
+            }
+            _accessing_blobs.clear(std::memory_order_release);
+        }
+
+        /// update_all replaces the displayed blobs with the given ones, the id of each blob being its offset in the
+        /// range.
+        /// Missing blobs are inserted, and blobs whose id is beyond the range are erased.
+        /// The lock is acquired once per call rather than once per blob.
+        template <typename Iterator>
+        void update_all(Iterator begin, Iterator end) {
+            while (_accessing_blobs.test_and_set(std::memory_order_acquire)) {
+            }
+            std::size_t id = 0;
+            for (; begin != end; ++begin) {
+                if (!update_blob(id, to_managed_blob(*begin))) {
+                    insert_blob(id, to_managed_blob(*begin));
+                }
+                ++id;
+            }
+            for (std::size_t position = 0; position < _blobs.size();) {
+                if (_blobs_ids[position] >= id) {
+                    erase_blob(_blobs_ids[position]);
+                } else {
+                    ++position;
+                }
+            }
+            _accessing_blobs.clear(std::memory_order_release);
+        }
+
+        /// apply inserts, updates and erases blobs in order.
+        /// Each change must have an id, a type (a blob_change_type) and a blob, which is ignored by erasures.
+        /// The lock is acquired once per call rather than once per change. If a change is invalid, the previous ones
+        /// are kept and an exception is thrown.
+        template <typename Iterator>
+        void apply(Iterator begin, Iterator end) {
+            while (_accessing_blobs.test_and_set(std::memory_order_acquire)) {
+            }
+            for (; begin != end; ++begin) {
+                switch (begin->type) {
+                    case blob_change_type::insert:
+                        if (!insert_blob(begin->id, to_managed_blob(begin->blob))) {
+                            _accessing_blobs.clear(std::memory_order_release);
+                            throw std::logic_error("the given blob id was already inserted");
+                        }
+                        break;
+                    case blob_change_type::update:
+                        if (!update_blob(begin->id, to_managed_blob(begin->blob))) {
+                            _accessing_blobs.clear(std::memory_order_release);
+                            throw std::logic_error("the given blob id was not registered with insert");
+                        }
+                        break;
+                    case blob_change_type::erase:
+                        if (!erase_blob(begin->id)) {
+                            _accessing_blobs.clear(std::memory_order_release);
+                            throw std::logic_error("the given blob id was not registered with insert");
+                        }
+                        break;
+                }
+            }
+            _accessing_blobs.clear(std::memory_order_release);
+        }
+
+        public slots:
+
+        /// paint sends commands to the GPU.
+        void paint() {
+            if (!initializeOpenGLFunctions()) {
+                throw std::runtime_error("initializing the OpenGL context failed");
+            }
+            if (!_program_setup) {
+                _program_setup = true;
+
+                // compile the vertex shader
+                // each instance is a quad covering the blob's ellipse, whose axes are the eigenvectors of the
+                // covariance matrix
+                const auto vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
+                {
+                    const std::string vertex_shader(R""(
+                        #version 330 core
+                        in vec2 corner;
+                        in vec2 center;
+                        in vec3 covariance;
+                        out vec2 local;
+                        flat out vec2 radii;
+                        uniform float width;
+                        uniform float height;
+                        uniform float confidence;
+                        uniform float margin;
+                        void main() {
+                            float half_difference = (covariance.x - covariance.z) / 2.0;
+                            float mean = (covariance.x + covariance.z) / 2.0;
+                            float delta = sqrt(half_difference * half_difference + covariance.y * covariance.y);
+                            radii = confidence * sqrt(max(vec2(mean + delta, mean - delta), vec2(0.0)));
+                            float angle = delta == 0.0 ? 0.0 : atan(covariance.y, half_difference) / 2.0;
+                            local = corner * (radii + margin);
+                            vec2 direction = vec2(cos(angle), sin(angle));
+                            vec2 position = center + 0.5
+                                            + vec2(
+                                                direction.x * local.x - direction.y * local.y,
+                                                direction.y * local.x + direction.x * local.y);
+                            gl_Position =
+                                vec4(position.x / width * 2.0 - 1.0, position.y / height * 2.0 - 1.0, 0.0, 1.0);
+                        }
+                    )"");
+                    auto vertex_shader_content = vertex_shader.c_str();
+                    auto vertex_shader_size = vertex_shader.size();
+                    glShaderSource(
+                        vertex_shader_id,
+                        1,
+                        static_cast<const GLchar**>(&vertex_shader_content),
+                        reinterpret_cast<const GLint*>(&vertex_shader_size));
+                }
+                glCompileShader(vertex_shader_id);
+                check_shader_error(vertex_shader_id);
+
+                // compile the fragment shader
+                // the distance to the ellipse is approximated at first order, and antialiased over one screen pixel
+                const auto fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+                {
+                    const std::string fragment_shader(R""(
+                        #version 330 core
+                        in vec2 local;
+                        flat in vec2 radii;
+                        out vec4 color;
+                        uniform vec4 stroke_color;
+                        uniform vec4 fill_color;
+                        uniform float stroke_thickness;
+                        void main() {
+                            vec2 safe_radii = max(radii, vec2(1e-3));
+                            vec2 normalized = local / safe_radii;
+                            float radius = length(normalized);
+                            float gradient = length(normalized / safe_radii);
+                            float distance =
+                                gradient > 0.0 ? (radius - 1.0) * radius / gradient : -min(safe_radii.x, safe_radii.y);
+                            float smoothing = max(fwidth(distance), 1e-3);
+                            float stroke_alpha =
+                                stroke_color.a
+                                * clamp(0.5 + (stroke_thickness / 2.0 - abs(distance)) / smoothing, 0.0, 1.0);
+                            float fill_alpha =
+                                fill_color.a * clamp(0.5 - distance / smoothing, 0.0, 1.0) * (1.0 - stroke_alpha);
+                            float alpha = stroke_alpha + fill_alpha;
+                            if (alpha <= 0.0) {
+                                discard;
+                            }
+                            color = vec4(
+                                (stroke_color.rgb * stroke_alpha + fill_color.rgb * fill_alpha) / alpha, alpha);
+                        }
+                    )"");
+                    auto fragment_shader_content = fragment_shader.c_str();
+                    auto fragment_shader_size = fragment_shader.size();
+                    glShaderSource(
+                        fragment_shader_id,
+                        1,
+                        static_cast<const GLchar**>(&fragment_shader_content),
+                        reinterpret_cast<const GLint*>(&fragment_shader_size));
+                }
+                glCompileShader(fragment_shader_id);
+                check_shader_error(fragment_shader_id);
+
+                // create the shaders pipeline
+                _program_id = glCreateProgram();
+                glAttachShader(_program_id, vertex_shader_id);
+                glAttachShader(_program_id, fragment_shader_id);
+                glLinkProgram(_program_id);
+                glDeleteShader(vertex_shader_id);
+                glDeleteShader(fragment_shader_id);
+                glUseProgram(_program_id);
+                check_program_error(_program_id);
+
+                // create the vertex buffer and array objects
+                // the first buffer holds the quad corners, shared by all the instances
+                // the second buffer holds the blobs, one per instance
+                glGenBuffers(static_cast<GLsizei>(_vertex_buffers_ids.size()), _vertex_buffers_ids.data());
+                glGenVertexArrays(1, &_vertex_array_id);
+                glBindVertexArray(_vertex_array_id);
+                {
+                    const std::array<float, 8> corners{-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+                    glBindBuffer(GL_ARRAY_BUFFER, std::get<0>(_vertex_buffers_ids));
+                    glBufferData(
+                        GL_ARRAY_BUFFER,
+                        corners.size() * sizeof(decltype(corners)::value_type),
+                        corners.data(),
+                        GL_STATIC_DRAW);
+                    glEnableVertexAttribArray(glGetAttribLocation(_program_id, "corner"));
+                    glVertexAttribPointer(glGetAttribLocation(_program_id, "corner"), 2, GL_FLOAT, GL_FALSE, 0, 0);
+                }
+                glBindBuffer(GL_ARRAY_BUFFER, std::get<1>(_vertex_buffers_ids));
+                glEnableVertexAttribArray(glGetAttribLocation(_program_id, "center"));
+                glVertexAttribPointer(
+                    glGetAttribLocation(_program_id, "center"),
+                    2,
+                    GL_FLOAT,
+                    GL_FALSE,
+                    sizeof(managed_blob),
+                    reinterpret_cast<const GLvoid*>(offsetof(managed_blob, x)));
+                glVertexAttribDivisor(glGetAttribLocation(_program_id, "center"), 1);
+                glEnableVertexAttribArray(glGetAttribLocation(_program_id, "covariance"));
+                glVertexAttribPointer(
+                    glGetAttribLocation(_program_id, "covariance"),
+                    3,
+                    GL_FLOAT,
+                    GL_FALSE,
+                    sizeof(managed_blob),
+                    reinterpret_cast<const GLvoid*>(offsetof(managed_blob, sigma_x_squared)));
+                glVertexAttribDivisor(glGetAttribLocation(_program_id, "covariance"), 1);
+                glBindVertexArray(0);
+
+                // set uniform values
+                glUniform1f(glGetUniformLocation(_program_id, "width"), static_cast<GLfloat>(_canvas_size.width()));
+                glUniform1f(glGetUniformLocation(_program_id, "height"), static_cast<GLfloat>(_canvas_size.height()));
+                _confidence_location = glGetUniformLocation(_program_id, "confidence");
+                _margin_location = glGetUniformLocation(_program_id, "margin");
+                _stroke_color_location = glGetUniformLocation(_program_id, "stroke_color");
+                _fill_color_location = glGetUniformLocation(_program_id, "fill_color");
+                _stroke_thickness_location = glGetUniformLocation(_program_id, "stroke_thickness");
+            }
+
+            // send data to the GPU
+            while (_accessing_blobs.test_and_set(std::memory_order_acquire)) {
+            }
+            _painted_blobs.assign(_blobs.begin(), _blobs.end());
+            _accessing_blobs.clear(std::memory_order_release);
+            if (_painted_blobs.empty()) {
+                return;
+            }
+            glUseProgram(_program_id);
+            glViewport(
+                static_cast<GLint>(_paint_area.left()),
+                static_cast<GLint>(_paint_area.top()),
+                static_cast<GLsizei>(_paint_area.width()),
+                static_cast<GLsizei>(_paint_area.height()));
+            glDisable(GL_DEPTH_TEST);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glUniform1f(_confidence_location, static_cast<GLfloat>(_confidence));
+            glUniform1f(_margin_location, static_cast<GLfloat>(_stroke_thickness / 2 + 2));
+            glUniform4f(
+                _stroke_color_location,
+                static_cast<GLfloat>(_stroke_color.redF()),
+                static_cast<GLfloat>(_stroke_color.greenF()),
+                static_cast<GLfloat>(_stroke_color.blueF()),
+                static_cast<GLfloat>(_stroke_color.alphaF()));
+            glUniform4f(
+                _fill_color_location,
+                static_cast<GLfloat>(_fill_color.redF()),
+                static_cast<GLfloat>(_fill_color.greenF()),
+                static_cast<GLfloat>(_fill_color.blueF()),
+                static_cast<GLfloat>(_fill_color.alphaF()));
+            glUniform1f(_stroke_thickness_location, static_cast<GLfloat>(_stroke_thickness));
+            glBindBuffer(GL_ARRAY_BUFFER, std::get<1>(_vertex_buffers_ids));
+            glBufferData(
+                GL_ARRAY_BUFFER,
+                _painted_blobs.size() * sizeof(decltype(_painted_blobs)::value_type),
+                _painted_blobs.data(),
+                GL_STREAM_DRAW);
+            glBindVertexArray(_vertex_array_id);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(_painted_blobs.size()));
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glUseProgram(0);
+            check_opengl_error();
+        }
+
+        protected:
+        /// managed_blob represents a gaussian blob.
+        /// It is also the layout of the per-instance vertex attributes.
+        struct managed_blob {
+            float x;
+            float y;
+            float sigma_x_squared;
+            float sigma_xy;
+            float sigma_y_squared;
+        };
+
+        /// to_managed_blob converts a user blob.
+        template <typename Blob>
+        static managed_blob to_managed_blob(const Blob& blob) {
+            return managed_blob{blob.x, blob.y, blob.sigma_x_squared, blob.sigma_xy, blob.sigma_y_squared};
+        }
+
+        /// insert_blob appends a blob to the packed storage, and returns false if the id is already used.
+        /// _accessing_blobs must be locked by the caller.
+        bool insert_blob(std::size_t id, managed_blob blob) {
+            if (id >= _ids_to_positions.size()) {
+                _ids_to_positions.resize(id + 1, 0);
+            } else if (_ids_to_positions[id] > 0) {
+                return false;
+            }
+            _blobs.push_back(blob);
+            _blobs_ids.push_back(id);
+            _ids_to_positions[id] = _blobs.size();
+            return true;
+        }
+
+        /// update_blob overwrites a stored blob, and returns false if the id is not used.
+        /// _accessing_blobs must be locked by the caller.
+        bool update_blob(std::size_t id, managed_blob blob) {
+            if (id >= _ids_to_positions.size() || _ids_to_positions[id] == 0) {
+                return false;
+            }
+            _blobs[_ids_to_positions[id] - 1] = blob;
+            return true;
+        }
+
+        /// erase_blob moves the last stored blob into the erased blob's slot, and returns false if the id is not
+        /// used.
+        /// _accessing_blobs must be locked by the caller.
+        bool erase_blob(std::size_t id) {
+            if (id >= _ids_to_positions.size() || _ids_to_positions[id] == 0) {
+                return false;
+            }
+            const auto position = _ids_to_positions[id] - 1;
+            if (position + 1 < _blobs.size()) {
+                _blobs[position] = _blobs.back();
+                _blobs_ids[position] = _blobs_ids.back();
+                _ids_to_positions[_blobs_ids[position]] = position + 1;
+            }
+            _blobs.pop_back();
+            _blobs_ids.pop_back();
+            _ids_to_positions[id] = 0;
+            return true;
+        }
+
+        /// check_opengl_error throws if openGL generated an error.
+        virtual void check_opengl_error() {
+            switch (glGetError()) {
+                case GL_NO_ERROR:
+                    break;
+                case GL_INVALID_ENUM:
+                    throw std::logic_error("OpenGL error: GL_INVALID_ENUM");
+                case GL_INVALID_VALUE:
+                    throw std::logic_error("OpenGL error: GL_INVALID_VALUE");
+                case GL_INVALID_OPERATION:
+                    throw std::logic_error("OpenGL error: GL_INVALID_OPERATION");
+                case GL_OUT_OF_MEMORY:
+                    throw std::logic_error("OpenGL error: GL_OUT_OF_MEMORY");
+            }
+        }
+
+        /// check_shader_error checks for shader compilation errors.
+        virtual void check_shader_error(GLuint shader_id) {
+            GLint status = 0;
+            glGetShaderiv(shader_id, GL_COMPILE_STATUS, &status);
+
+            if (status != GL_TRUE) {
+                GLint message_length = 0;
+                glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &message_length);
+                std::vector<char> error_message(message_length);
+                glGetShaderInfoLog(shader_id, message_length, nullptr, error_message.data());
+                throw std::logic_error("Shader error: " + std::string(error_message.data()));
+            }
+        }
+
+        /// check_program_error checks for program errors.
+        virtual void check_program_error(GLuint program_id) {
+            GLint status = 0;
+            glGetProgramiv(program_id, GL_LINK_STATUS, &status);
+
+            if (status != GL_TRUE) {
+                GLint message_length = 0;
+                glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &message_length);
+                std::vector<char> error_message(message_length);
+                glGetShaderInfoLog(program_id, message_length, nullptr, error_message.data());
+                throw std::logic_error("program error: " + std::string(error_message.data()));
+            }
+        }
+
+        QSize _canvas_size;
+        QColor _stroke_color;
+        float _stroke_thickness;
+        QColor _fill_color;
+        float _confidence;
+        std::vector<managed_blob> _blobs;
+        std::vector<std::size_t> _blobs_ids;
+        std::vector<std::size_t> _ids_to_positions;
+        std::vector<managed_blob> _painted_blobs;
+        std::atomic_flag _accessing_blobs;
+        QRectF _paint_area;
+        bool _program_setup;
+        GLuint _program_id;
+        GLuint _vertex_array_id;
+        std::array<GLuint, 2> _vertex_buffers_ids;
+        GLuint _confidence_location;
+        GLuint _margin_location;
+        GLuint _stroke_color_location;
+        GLuint _fill_color_location;
+        GLuint _stroke_thickness_location;
+    };
+
     /// blob_display displays gaussian blobs as ellipses.
-    class blob_display : public QQuickPaintedItem {
+    class blob_display : public QQuickItem {
         Q_OBJECT
+        Q_INTERFACES(QQmlParserStatus)
         Q_PROPERTY(QSize canvas_size READ canvas_size WRITE set_canvas_size)
         Q_PROPERTY(QColor stroke_color READ stroke_color WRITE set_stroke_color)
         Q_PROPERTY(qreal stroke_thickness READ stroke_thickness WRITE set_stroke_thickness)
         Q_PROPERTY(QColor fill_color READ fill_color WRITE set_fill_color)
         Q_PROPERTY(qreal confidence READ confidence WRITE set_confidence)
         public:
-        blob_display(QQuickItem* parent = nullptr) :
-            QQuickPaintedItem(parent),
-            _brush(Qt::transparent, Qt::SolidPattern),
+        blob_display() :
+            _ready(false),
+            _renderer_ready(false),
+            _render_scheduler(nullptr),
+            _stroke_color(Qt::black),
+            _stroke_thickness(1),
+            _fill_color(Qt::transparent),
             _confidence(1.96f) {
-            _pen.setColor(Qt::black);
-            _pen.setWidthF(1);
-            _accessing_blobs.clear(std::memory_order_release);
+            connect(this, &QQuickItem::windowChanged, this, &blob_display::handle_window_changed);
         }
         blob_display(const blob_display&) = delete;
         blob_display(blob_display&&) = delete;
@@ -33,8 +504,15 @@ namespace chameleon {
         virtual ~blob_display() {}
 
         /// set_canvas_size defines the display coordinates.
+        /// The canvas size will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
         virtual void set_canvas_size(QSize canvas_size) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("canvas_size can only be set during qml construction");
+            }
             _canvas_size = canvas_size;
+            setImplicitWidth(canvas_size.width());
+            setImplicitHeight(canvas_size.height());
         }
 
         /// canvas_size returns the currently used canvas_size.
@@ -44,32 +522,32 @@ namespace chameleon {
 
         /// set_stroke_color defines the stroke color for the blobs.
         virtual void set_stroke_color(QColor color) {
-            _pen.setColor(color);
+            _stroke_color = color;
         }
 
         /// stroke_color returns the currently used stroke color.
         virtual QColor stroke_color() const {
-            return _pen.color();
+            return _stroke_color;
         }
 
-        /// set_stroke_thickness defines the stroke thickness for the blobs.
+        /// set_stroke_thickness defines the stroke thickness for the blobs, in canvas pixels.
         virtual void set_stroke_thickness(qreal thickness) {
-            _pen.setWidthF(thickness);
+            _stroke_thickness = thickness;
         }
 
         /// stroke_thickness returns the currently used stroke thickness.
         virtual qreal stroke_thickness() const {
-            return _pen.widthF();
+            return _stroke_thickness;
         }
 
         /// set_fill_color defines the fill color for the blobs.
         virtual void set_fill_color(QColor color) {
-            _brush.setColor(color);
+            _fill_color = color;
         }
 
         /// fill_color returns the currently used fill color.
         virtual QColor fill_color() const {
-            return _brush.color();
+            return _fill_color;
         }
 
         /// set_confidence defines the confidence level for gaussian representation.
@@ -82,116 +560,160 @@ namespace chameleon {
             return _confidence;
         }
 
+        /// paint_area returns the paint area in window coordinates.
+        virtual QRectF paint_area() const {
+            return _paint_area;
+        }
+
         /// insert displays a blob, which can be updated later on using its id.
         template <typename Blob>
         void insert(std::size_t id, Blob blob) {
-            while (_accessing_blobs.test_and_set(std::memory_order_acquire)) {
-            }
-            auto id_and_blob_and_took_place = _id_to_blob.insert(
-                {id, managed_blob{blob.x, blob.y, blob.sigma_x_squared, blob.sigma_xy, blob.sigma_y_squared}});
-            if (!id_and_blob_and_took_place.second) {
-                _accessing_blobs.clear(std::memory_order_release);
-                throw std::logic_error("the given blob id was already inserted");
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
             }
-            _accessing_blobs.clear(std::memory_order_release);
+            _blob_display_renderer->insert<Blob>(id, blob);
+            request_update();
         }
 
         /// update modifies the parameters of an existing blob.
         template <typename Blob>
         void update(std::size_t id, Blob blob) {
-            while (_accessing_blobs.test_and_set(std::memory_order_acquire)) {
-            }
-            auto id_and_blob_candidate = _id_to_blob.find(id);
-            if (id_and_blob_candidate == _id_to_blob.end()) {
-                _accessing_blobs.clear(std::memory_order_release);
-                throw std::logic_error("the given blob id was not registered with insert");
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
             }
-            id_and_blob_candidate->second.x = blob.x;
-            id_and_blob_candidate->second.y = blob.y;
-            id_and_blob_candidate->second.sigma_x_squared = blob.sigma_x_squared;
-            id_and_blob_candidate->second.sigma_xy = blob.sigma_xy;
-            id_and_blob_candidate->second.sigma_y_squared = blob.sigma_y_squared;
-            _accessing_blobs.clear(std::memory_order_release);
+            _blob_display_renderer->update<Blob>(id, blob);
+            request_update();
         }
 
         /// erase removes an existing blob.
         virtual void erase(std::size_t id) {
-            while (_accessing_blobs.test_and_set(std::memory_order_acquire)) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
             }
-            if (_id_to_blob.erase(id) == 0) {
-                _accessing_blobs.clear(std::memory_order_release);
-                throw std::logic_error("the given blob id was not registered with insert");
+            _blob_display_renderer->erase(id);
+            request_update();
+        }
+
+        /// update_all replaces the displayed blobs with the given ones, the id of each blob being its offset in the
+        /// range.
+        template <typename Iterator>
+        void update_all(Iterator begin, Iterator end) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
             }
-            _accessing_blobs.clear(std::memory_order_release);
+            _blob_display_renderer->update_all<Iterator>(begin, end);
+            request_update();
         }
 
-        /// paint is called by the render thread when drawing is required.
-        virtual void paint(QPainter* painter) override {
-            painter->setPen(_pen);
-            painter->setBrush(_brush);
-            painter->setRenderHint(QPainter::Antialiasing);
-            while (_accessing_blobs.test_and_set(std::memory_order_acquire)) {
+        /// apply inserts, updates and erases blobs in order.
+        template <typename Iterator>
+        void apply(Iterator begin, Iterator end) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
             }
-            for (auto id_and_blob : _id_to_blob) {
-                painter->resetTransform();
-                painter->setWindow(0, 0, _canvas_size.width(), _canvas_size.height());
-                painter->translate(id_and_blob.second.x, _canvas_size.height() - 1 - id_and_blob.second.y);
-                const auto ellipse = blob_to_ellipse(id_and_blob.second, _confidence);
-                painter->rotate(-ellipse.angle / M_PI * 180);
-                painter->drawEllipse(QPointF(), ellipse.major_radius, ellipse.minor_radius);
+            _blob_display_renderer->apply<Iterator>(begin, end);
+            request_update();
+        }
+
+        /// componentComplete is called when all the qml values are bound.
+        virtual void componentComplete() override {
+            if (_canvas_size.width() <= 0 || _canvas_size.height() <= 0) {
+                throw std::logic_error("canvas_size cannot have a null component, make sure that it is set in qml");
             }
-            _accessing_blobs.clear(std::memory_order_release);
+            _ready.store(true, std::memory_order_release);
         }
 
+        signals:
+
+        /// paintAreaChanged notifies a paint area change.
+        void paintAreaChanged(QRectF paint_area);
+
         public slots:
+
+        /// sync adapts the renderer to external changes.
+        void sync() {
+            if (_ready.load(std::memory_order_relaxed)) {
+                if (!_blob_display_renderer) {
+                    _blob_display_renderer =
+                        std::unique_ptr<blob_display_renderer>(new blob_display_renderer(_canvas_size));
+                    connect(
+                        window(),
+                        &QQuickWindow::beforeRendering,
+                        _blob_display_renderer.get(),
+                        &blob_display_renderer::paint,
+                        Qt::DirectConnection);
+                    _renderer_ready.store(true, std::memory_order_release);
+                }
+                _blob_display_renderer->set_style(
+                    _stroke_color,
+                    static_cast<float>(_stroke_thickness),
+                    _fill_color,
+                    static_cast<float>(_confidence));
+                auto clear_area =
+                    QRectF(0, 0, width() * window()->devicePixelRatio(), height() * window()->devicePixelRatio());
+                for (auto item = static_cast<QQuickItem*>(this); item; item = item->parentItem()) {
+                    clear_area.moveLeft(clear_area.left() + item->x() * window()->devicePixelRatio());
+                    clear_area.moveTop(clear_area.top() + item->y() * window()->devicePixelRatio());
+                }
+                if (clear_area != _clear_area) {
+                    _clear_area = std::move(clear_area);
+                    if (clear_area.width() * _canvas_size.height() > clear_area.height() * _canvas_size.width()) {
+                        _paint_area.setWidth(clear_area.height() * _canvas_size.width() / _canvas_size.height());
+                        _paint_area.setHeight(clear_area.height());
+                        _paint_area.moveLeft(clear_area.left() + (clear_area.width() - _paint_area.width()) / 2);
+                        _paint_area.moveTop(clear_area.top());
+                    } else {
+                        _paint_area.setWidth(clear_area.width());
+                        _paint_area.setHeight(clear_area.width() * _canvas_size.height() / _canvas_size.width());
+                        _paint_area.moveLeft(clear_area.left());
+                        _paint_area.moveTop(clear_area.top() + (clear_area.height() - _paint_area.height()) / 2);
+                    }
+                    _blob_display_renderer->set_rendering_area(
+                        _paint_area, window()->height() * window()->devicePixelRatio());
+                    paintAreaChanged(_paint_area);
+                }
+            }
+        }
+
+        /// cleanup frees the owned renderer.
+        void cleanup() {
+            _blob_display_renderer.reset();
+        }
+
         /// trigger_draw requests a window refresh.
         void trigger_draw() {
-            QQuickPaintedItem::update();
             if (window()) {
-                window()->update();
+                render_scheduler::of(window())->request_update();
             }
         }
 
-        protected:
-        /// managed_blob represents a gaussian blob.
-        struct managed_blob {
-            float x;
-            float y;
-            float sigma_x_squared;
-            float sigma_xy;
-            float sigma_y_squared;
-        };
+        private slots:
 
-        /// ellipse represents an ellipse's parameter.
-        struct ellipse {
-            float major_radius;
-            float minor_radius;
-            float angle;
-        };
+        /// handle_window_changed must be triggered after a window transformation.
+        void handle_window_changed(QQuickWindow* window) {
+            if (window) {
+                connect(window, &QQuickWindow::beforeSynchronizing, this, &blob_display::sync, Qt::DirectConnection);
+                connect(
+                    window, &QQuickWindow::sceneGraphInvalidated, this, &blob_display::cleanup, Qt::DirectConnection);
+                window->setClearBeforeRendering(false);
+                _render_scheduler.store(render_scheduler::of(window), std::memory_order_release);
+            }
+        }
 
-        /// blob_to_ellipse calculates an ellipse's parameters from a blob.
-        static ellipse blob_to_ellipse(managed_blob blob, float confidence) {
-            const auto delta_square_root =
-                std::sqrt(
-                    std::pow(blob.sigma_x_squared - blob.sigma_y_squared, 2.0f) + 4 * std::pow(blob.sigma_xy, 2.0f))
-                / 2;
-            const auto first_order_coefficient = (blob.sigma_x_squared + blob.sigma_y_squared) / 2;
-            return ellipse{
-                confidence * std::sqrt(first_order_coefficient + delta_square_root),
-                confidence * std::sqrt(first_order_coefficient - delta_square_root),
-                blob.sigma_y_squared == blob.sigma_x_squared ?
-                    static_cast<float>(M_PI) / 4 :
-                    (std::atan(2 * blob.sigma_xy / (blob.sigma_x_squared - blob.sigma_y_squared))
-                     + (blob.sigma_y_squared > blob.sigma_x_squared ? static_cast<float>(M_PI) : 0.0f))
-                        / 2,
-            };
+        protected:
+        /// request_update schedules a window update, coalesced with the other displays of the window.
+        virtual void request_update() {
+            const auto scheduler = _render_scheduler.load(std::memory_order_acquire);
+            if (scheduler) {
+                scheduler->request_update();
+            }
         }
 
+        std::atomic_bool _ready;
+        std::atomic_bool _renderer_ready;
+        std::atomic<render_scheduler*> _render_scheduler;
         QSize _canvas_size;
-        QPen _pen;
-        QBrush _brush;
+        QColor _stroke_color;
+        qreal _stroke_thickness;
+        QColor _fill_color;
         qreal _confidence;
-        std::unordered_map<std::size_t, managed_blob> _id_to_blob;
-        std::atomic_flag _accessing_blobs;
+        std::unique_ptr<blob_display_renderer> _blob_display_renderer;
+        QRectF _clear_area;
+        QRectF _paint_area;
     };
 }
@@ -0,0 +1,466 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CHAMELEON_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CHAMELEON_NEON
+#endif
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// is_contiguous_iterator is true for iterators over standard-layout values stored next to each other in memory
+    /// (pointers and std::vector iterators).
+    /// The values behind such iterators can be read with a fixed stride, by the bulk conversion kernels.
+    template <typename Iterator>
+    struct is_contiguous_iterator {
+        typedef typename std::iterator_traits<Iterator>::value_type value_type;
+        static constexpr bool value =
+            std::is_standard_layout<value_type>::value && !std::is_same<value_type, bool>::value
+            && (std::is_pointer<Iterator>::value
+                || std::is_same<Iterator, typename std::vector<value_type>::iterator>::value
+                || std::is_same<Iterator, typename std::vector<value_type>::const_iterator>::value);
+    };
+
+    /// strided_field points to the same member in consecutive structs.
+    template <typename Field>
+    struct strided_field {
+        const uint8_t* data;
+        std::size_t stride;
+
+        /// operator[] returns the member of the index-th struct.
+        Field operator[](std::size_t index) const {
+            Field field;
+            std::memcpy(&field, data + index * stride, sizeof(Field));
+            return field;
+        }
+    };
+
+    /// make_strided_field returns the strided field of the given member of *begin.
+    /// begin must be a contiguous iterator, and field a reference to a member of *begin (or *begin itself).
+    template <typename Iterator, typename Field>
+    strided_field<Field> make_strided_field(Iterator, const Field& field) {
+        return strided_field<Field>{reinterpret_cast<const uint8_t*>(&field),
+                                    sizeof(typename std::iterator_traits<Iterator>::value_type)};
+    }
+
+    /// bulk_conversion gathers the members of contiguous structs, converts them and interleaves them.
+    /// SIMD kernels are selected at compile time (AVX2, SSE2 or NEON), with a scalar fallback.
+    namespace bulk_conversion {
+
+        /// is_small_integer is true for integer members whose values fit in a signed 32-bits integer.
+        template <typename Field>
+        struct is_small_integer {
+            static constexpr bool value =
+                std::is_integral<Field>::value && !std::is_same<Field, bool>::value
+                && (sizeof(Field) < 4 || (sizeof(Field) == 4 && std::is_signed<Field>::value));
+        };
+
+#if defined(__AVX2__)
+        /// gathered_bytes reads 4 bytes at the member address of 8 consecutive structs.
+        template <typename Field>
+        inline __m256i gathered_bytes(strided_field<Field> field, std::size_t index) {
+            const auto stride = static_cast<int>(field.stride);
+            return _mm256_i32gather_epi32(
+                reinterpret_cast<const int*>(field.data + index * field.stride),
+                _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride)),
+                1);
+        }
+
+        /// gathered_integers returns 8 consecutive small integer members, widened to 32 bits.
+        template <typename Field>
+        inline __m256i gathered_integers(strided_field<Field> field, std::size_t index) {
+            const auto bytes = gathered_bytes(field, index);
+            const auto shift = static_cast<int>(32 - 8 * sizeof(Field));
+            if (shift == 0) {
+                return bytes;
+            }
+            if (std::is_signed<Field>::value) {
+                return _mm256_srai_epi32(_mm256_slli_epi32(bytes, shift), shift);
+            }
+            return _mm256_srli_epi32(_mm256_slli_epi32(bytes, shift), shift);
+        }
+
+        /// gathered_floats returns 8 consecutive members converted to float.
+        template <typename Field>
+        inline __m256 gathered_floats(strided_field<Field> field, std::size_t index) {
+            return _mm256_cvtepi32_ps(gathered_integers(field, index));
+        }
+        inline __m256 gathered_floats(strided_field<float> field, std::size_t index) {
+            return _mm256_castsi256_ps(gathered_bytes(field, index));
+        }
+
+        /// simd_lanes is the number of structs handled per iteration.
+        constexpr std::size_t simd_lanes = 8;
+#elif defined(CHAMELEON_SSE2)
+        /// gathered_integers returns 4 consecutive members, converted to 32-bits integers.
+        template <typename Field>
+        inline __m128i gathered_integers(strided_field<Field> field, std::size_t index) {
+            return _mm_setr_epi32(
+                static_cast<int>(field[index]),
+                static_cast<int>(field[index + 1]),
+                static_cast<int>(field[index + 2]),
+                static_cast<int>(field[index + 3]));
+        }
+
+        /// gathered_floats returns 4 consecutive members converted to float.
+        template <typename Field>
+        inline __m128 gathered_floats(strided_field<Field> field, std::size_t index) {
+            return _mm_cvtepi32_ps(gathered_integers(field, index));
+        }
+        inline __m128 gathered_floats(strided_field<float> field, std::size_t index) {
+            return _mm_setr_ps(field[index], field[index + 1], field[index + 2], field[index + 3]);
+        }
+
+        /// simd_lanes is the number of structs handled per iteration.
+        constexpr std::size_t simd_lanes = 4;
+#elif defined(CHAMELEON_NEON)
+        /// gathered_floats returns 4 consecutive members converted to float.
+        template <typename Field>
+        inline float32x4_t gathered_floats(strided_field<Field> field, std::size_t index) {
+            const int32_t integers[4] = {static_cast<int32_t>(field[index]),
+                                         static_cast<int32_t>(field[index + 1]),
+                                         static_cast<int32_t>(field[index + 2]),
+                                         static_cast<int32_t>(field[index + 3])};
+            return vcvtq_f32_s32(vld1q_s32(integers));
+        }
+        inline float32x4_t gathered_floats(strided_field<float> field, std::size_t index) {
+            const float floats[4] = {field[index], field[index + 1], field[index + 2], field[index + 3]};
+            return vld1q_f32(floats);
+        }
+
+        /// simd_lanes is the number of structs handled per iteration.
+        constexpr std::size_t simd_lanes = 4;
+#else
+        /// simd_lanes is the number of structs handled per iteration.
+        constexpr std::size_t simd_lanes = 1;
+#define CHAMELEON_SCALAR
+#endif
+
+        /// has_simd_floats is true if the members can be converted to float by the SIMD kernels.
+        /// Other types (double, 64-bits and unsigned 32-bits integers) use the scalar loops.
+        template <typename Field>
+        struct has_simd_floats {
+#if defined(CHAMELEON_SCALAR)
+            static constexpr bool value = false;
+#else
+            static constexpr bool value = is_small_integer<Field>::value || std::is_same<Field, float>::value;
+#endif
+        };
+
+        /// simd_count returns the number of structs that the SIMD kernels may process.
+        /// The AVX2 gathers read 4 bytes per member and the interleaved stores write one float past the last triplet,
+        /// therefore the last struct is always left to the scalar loop.
+        template <typename Field>
+        inline std::size_t simd_count(strided_field<Field> field, std::size_t count) {
+            if (count <= simd_lanes || field.stride < 4) {
+                return 0;
+            }
+            return (count - 1) / simd_lanes * simd_lanes;
+        }
+
+        /// floats_tail converts the members from index to count with a scalar loop.
+        template <typename Field>
+        inline void floats_tail(strided_field<Field> field, std::size_t index, std::size_t count, float* output) {
+            for (; index < count; ++index) {
+                output[index] = static_cast<float>(field[index]);
+            }
+        }
+
+        /// dense_floats_head converts the leading values of a packed array (typically a frame from a grey-levels
+        /// sensor), and returns their number.
+        template <typename Field>
+        inline std::size_t dense_floats_head(const Field*, std::size_t, float*) {
+            return 0;
+        }
+        inline std::size_t dense_floats_head(const float* data, std::size_t count, float* output) {
+            std::memcpy(output, data, count * sizeof(float));
+            return count;
+        }
+#if !defined(CHAMELEON_SCALAR)
+        inline std::size_t dense_floats_head(const uint8_t* data, std::size_t count, float* output) {
+            std::size_t index = 0;
+#if defined(__AVX2__) || defined(CHAMELEON_SSE2)
+            const auto zero = _mm_setzero_si128();
+            for (; index + 16 <= count; index += 16) {
+                const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+                const auto low = _mm_unpacklo_epi8(bytes, zero);
+                const auto high = _mm_unpackhi_epi8(bytes, zero);
+                _mm_storeu_ps(output + index, _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)));
+                _mm_storeu_ps(output + index + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)));
+                _mm_storeu_ps(output + index + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)));
+                _mm_storeu_ps(output + index + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)));
+            }
+#elif defined(CHAMELEON_NEON)
+            for (; index + 16 <= count; index += 16) {
+                const auto bytes = vld1q_u8(data + index);
+                const auto low = vmovl_u8(vget_low_u8(bytes));
+                const auto high = vmovl_u8(vget_high_u8(bytes));
+                vst1q_f32(output + index, vcvtq_f32_u32(vmovl_u16(vget_low_u16(low))));
+                vst1q_f32(output + index + 4, vcvtq_f32_u32(vmovl_u16(vget_high_u16(low))));
+                vst1q_f32(output + index + 8, vcvtq_f32_u32(vmovl_u16(vget_low_u16(high))));
+                vst1q_f32(output + index + 12, vcvtq_f32_u32(vmovl_u16(vget_high_u16(high))));
+            }
+#endif
+            return index;
+        }
+        inline std::size_t dense_floats_head(const uint16_t* data, std::size_t count, float* output) {
+            std::size_t index = 0;
+#if defined(__AVX2__) || defined(CHAMELEON_SSE2)
+            const auto zero = _mm_setzero_si128();
+            for (; index + 8 <= count; index += 8) {
+                const auto words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+                _mm_storeu_ps(output + index, _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero)));
+                _mm_storeu_ps(output + index + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(words, zero)));
+            }
+#elif defined(CHAMELEON_NEON)
+            for (; index + 8 <= count; index += 8) {
+                const auto words = vld1q_u16(data + index);
+                vst1q_f32(output + index, vcvtq_f32_u32(vmovl_u16(vget_low_u16(words))));
+                vst1q_f32(output + index + 4, vcvtq_f32_u32(vmovl_u16(vget_high_u16(words))));
+            }
+#endif
+            return index;
+        }
+#endif
+
+        /// to_floats writes count members to output, converted to float.
+        /// Packed arrays of floats and small unsigned integers are read with vector loads instead of gathers.
+        template <typename Field>
+        inline typename std::enable_if<has_simd_floats<Field>::value>::type
+        to_floats(strided_field<Field> field, std::size_t count, float* output) {
+            std::size_t index = 0;
+            if (field.stride == sizeof(Field)) {
+                index = dense_floats_head(reinterpret_cast<const Field*>(field.data), count, output);
+                if (index > 0) {
+                    floats_tail(field, index, count, output);
+                    return;
+                }
+            }
+            const auto end = simd_count(field, count);
+            for (; index < end; index += simd_lanes) {
+#if defined(__AVX2__)
+                _mm256_storeu_ps(output + index, gathered_floats(field, index));
+#elif defined(CHAMELEON_SSE2)
+                _mm_storeu_ps(output + index, gathered_floats(field, index));
+#elif defined(CHAMELEON_NEON)
+                vst1q_f32(output + index, gathered_floats(field, index));
+#endif
+            }
+            floats_tail(field, index, count, output);
+        }
+        template <typename Field>
+        inline typename std::enable_if<!has_simd_floats<Field>::value>::type
+        to_floats(strided_field<Field> field, std::size_t count, float* output) {
+            floats_tail(field, 0, count, output);
+        }
+
+        /// interleaved_floats_head converts the triplets handled by the SIMD kernels, and returns their number.
+        template <typename R, typename G, typename B>
+        inline std::size_t interleaved_floats_head(
+            strided_field<R> r,
+            strided_field<G> g,
+            strided_field<B> b,
+            std::size_t count,
+            float* output,
+            std::true_type) {
+            const auto end = simd_count(r, count);
+            std::size_t index = 0;
+            for (; index < end; index += simd_lanes) {
+#if defined(__AVX2__) || defined(CHAMELEON_SSE2)
+#if defined(__AVX2__)
+                const auto rs = gathered_floats(r, index);
+                const auto gs = gathered_floats(g, index);
+                const auto bs = gathered_floats(b, index);
+                const __m128 halves[2][3] = {
+                    {_mm256_castps256_ps128(rs), _mm256_castps256_ps128(gs), _mm256_castps256_ps128(bs)},
+                    {_mm256_extractf128_ps(rs, 1), _mm256_extractf128_ps(gs, 1), _mm256_extractf128_ps(bs, 1)},
+                };
+#else
+                const __m128 halves[1][3] = {
+                    {gathered_floats(r, index), gathered_floats(g, index), gathered_floats(b, index)},
+                };
+#endif
+                for (std::size_t half = 0; half < sizeof(halves) / sizeof(halves[0]); ++half) {
+                    auto pixel_0 = halves[half][0];
+                    auto pixel_1 = halves[half][1];
+                    auto pixel_2 = halves[half][2];
+                    auto pixel_3 = _mm_setzero_ps();
+                    _MM_TRANSPOSE4_PS(pixel_0, pixel_1, pixel_2, pixel_3);
+
+                    // each store writes a spurious fourth float, overwritten by the next pixel
+                    auto pixels_output = output + (index + half * 4) * 3;
+                    _mm_storeu_ps(pixels_output, pixel_0);
+                    _mm_storeu_ps(pixels_output + 3, pixel_1);
+                    _mm_storeu_ps(pixels_output + 6, pixel_2);
+                    _mm_storeu_ps(pixels_output + 9, pixel_3);
+                }
+#elif defined(CHAMELEON_NEON)
+                float32x4x3_t pixels;
+                pixels.val[0] = gathered_floats(r, index);
+                pixels.val[1] = gathered_floats(g, index);
+                pixels.val[2] = gathered_floats(b, index);
+                vst3q_f32(output + index * 3, pixels);
+#endif
+            }
+            return index;
+        }
+        template <typename R, typename G, typename B>
+        inline std::size_t interleaved_floats_head(
+            strided_field<R>,
+            strided_field<G>,
+            strided_field<B>,
+            std::size_t,
+            float*,
+            std::false_type) {
+            return 0;
+        }
+
+        /// to_interleaved_floats writes count triplets of members to output (r0, g0, b0, r1, g1, b1...), converted to
+        /// float.
+        /// Float triplets are copied by the scalar loop, which is as fast as the SIMD transpose for plain moves.
+        template <typename R, typename G, typename B>
+        inline void to_interleaved_floats(
+            strided_field<R> r,
+            strided_field<G> g,
+            strided_field<B> b,
+            std::size_t count,
+            float* output) {
+            auto index = interleaved_floats_head(
+                r,
+                g,
+                b,
+                count,
+                output,
+                std::integral_constant<
+                    bool,
+                    has_simd_floats<R>::value && has_simd_floats<G>::value && has_simd_floats<B>::value
+                        && !(std::is_same<R, float>::value && std::is_same<G, float>::value
+                             && std::is_same<B, float>::value)>());
+            for (; index < count; ++index) {
+                output[index * 3] = static_cast<float>(r[index]);
+                output[index * 3 + 1] = static_cast<float>(g[index]);
+                output[index * 3 + 2] = static_cast<float>(b[index]);
+            }
+        }
+
+        /// to_timestamps_and_polarities writes count timestamps and polarities to output, and returns the largest
+        /// timestamp.
+        /// Timestamps are truncated to 32 bits. If packed is true, each pair is stored as (t << 1) | polarity,
+        /// otherwise the output alternates timestamps and polarities.
+        template <typename T, typename Polarity>
+        inline uint32_t to_timestamps_and_polarities(
+            strided_field<T> ts,
+            strided_field<Polarity> polarities,
+            std::size_t count,
+            bool packed,
+            uint32_t* output) {
+            uint32_t maximum_t = 0;
+            std::size_t index = 0;
+#if defined(__AVX2__) || defined(CHAMELEON_SSE2)
+            {
+                constexpr std::size_t lanes = 4;
+                const auto end = count > lanes ? count / lanes * lanes : 0;
+                const auto sign = _mm_set1_epi32(std::numeric_limits<int32_t>::min());
+                auto biased_maximum_t = sign;
+                for (; index < end; index += lanes) {
+                    const auto t = _mm_setr_epi32(
+                        static_cast<int>(static_cast<uint32_t>(ts[index])),
+                        static_cast<int>(static_cast<uint32_t>(ts[index + 1])),
+                        static_cast<int>(static_cast<uint32_t>(ts[index + 2])),
+                        static_cast<int>(static_cast<uint32_t>(ts[index + 3])));
+                    const auto polarity = _mm_setr_epi32(
+                        polarities[index] ? 1 : 0,
+                        polarities[index + 1] ? 1 : 0,
+                        polarities[index + 2] ? 1 : 0,
+                        polarities[index + 3] ? 1 : 0);
+                    if (packed) {
+                        _mm_storeu_si128(
+                            reinterpret_cast<__m128i*>(output + index), _mm_or_si128(_mm_slli_epi32(t, 1), polarity));
+                    } else {
+                        _mm_storeu_si128(
+                            reinterpret_cast<__m128i*>(output + index * 2), _mm_unpacklo_epi32(t, polarity));
+                        _mm_storeu_si128(
+                            reinterpret_cast<__m128i*>(output + index * 2 + 4), _mm_unpackhi_epi32(t, polarity));
+                    }
+
+                    // SSE2 has no unsigned maximum, the comparison is done on sign-flipped values
+                    const auto biased_t = _mm_xor_si128(t, sign);
+                    const auto greater = _mm_cmpgt_epi32(biased_t, biased_maximum_t);
+                    biased_maximum_t =
+                        _mm_or_si128(_mm_and_si128(greater, biased_t), _mm_andnot_si128(greater, biased_maximum_t));
+                }
+                if (end > 0) {
+                    uint32_t lanes_maximum_t[lanes];
+                    _mm_storeu_si128(
+                        reinterpret_cast<__m128i*>(lanes_maximum_t), _mm_xor_si128(biased_maximum_t, sign));
+                    for (auto lane_maximum_t : lanes_maximum_t) {
+                        if (lane_maximum_t > maximum_t) {
+                            maximum_t = lane_maximum_t;
+                        }
+                    }
+                }
+            }
+#elif defined(CHAMELEON_NEON)
+            {
+                constexpr std::size_t lanes = 4;
+                const auto end = count > lanes ? count / lanes * lanes : 0;
+                auto maximum_ts = vdupq_n_u32(0);
+                for (; index < end; index += lanes) {
+                    const uint32_t t_values[lanes] = {static_cast<uint32_t>(ts[index]),
+                                                      static_cast<uint32_t>(ts[index + 1]),
+                                                      static_cast<uint32_t>(ts[index + 2]),
+                                                      static_cast<uint32_t>(ts[index + 3])};
+                    const uint32_t polarity_values[lanes] = {polarities[index] ? 1u : 0u,
+                                                             polarities[index + 1] ? 1u : 0u,
+                                                             polarities[index + 2] ? 1u : 0u,
+                                                             polarities[index + 3] ? 1u : 0u};
+                    const auto t = vld1q_u32(t_values);
+                    const auto polarity = vld1q_u32(polarity_values);
+                    if (packed) {
+                        vst1q_u32(output + index, vorrq_u32(vshlq_n_u32(t, 1), polarity));
+                    } else {
+                        uint32x4x2_t pairs;
+                        pairs.val[0] = t;
+                        pairs.val[1] = polarity;
+                        vst2q_u32(output + index * 2, pairs);
+                    }
+                    maximum_ts = vmaxq_u32(maximum_ts, t);
+                }
+                if (end > 0) {
+                    uint32_t lanes_maximum_t[lanes];
+                    vst1q_u32(lanes_maximum_t, maximum_ts);
+                    for (auto lane_maximum_t : lanes_maximum_t) {
+                        if (lane_maximum_t > maximum_t) {
+                            maximum_t = lane_maximum_t;
+                        }
+                    }
+                }
+            }
+#endif
+            for (; index < count; ++index) {
+                const auto t = static_cast<uint32_t>(ts[index]);
+                if (packed) {
+                    output[index] = (t << 1) | (polarities[index] ? 1u : 0u);
+                } else {
+                    output[index * 2] = t;
+                    output[index * 2 + 1] = polarities[index] ? 1 : 0;
+                }
+                if (t > maximum_t) {
+                    maximum_t = t;
+                }
+            }
+            return maximum_t;
+        }
+    }
+}
@@ -1,6 +1,13 @@
 #pragma once
 
+#include "bulk_conversion.hpp"
+#include "gl_cache.hpp"
+#include "pbo_ring.hpp"
+#include "performance_monitor.hpp"
+#include "render_scheduler.hpp"
+#include "tiled_layout.hpp"
 #include <QQmlParserStatus>
+#include <QtCore/QTimer>
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QOpenGLFunctions_3_3_Core>
 #include <QtQuick/QQuickItem>
@@ -8,7 +15,10 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <stdexcept>
@@ -21,10 +31,36 @@ namespace chameleon {
     class color_display_renderer : public QObject, public QOpenGLFunctions_3_3_Core {
         Q_OBJECT
         public:
-        color_display_renderer(QSize canvas_size) :
+        color_display_renderer(QSize canvas_size, std::size_t format, std::size_t tile_size) :
             _canvas_size(canvas_size),
-            _colors(_canvas_size.width() * _canvas_size.height() * 3, 0),
+            _format(format),
+            _layout(_canvas_size, tile_size),
+            _lent_colors(nullptr),
+            _lent_uploaded(false),
+            _uploading_colors(nullptr),
+            _pushed_events(0),
             _program_setup(false) {
+            switch (_format) {
+                case 0:
+                    _bytes_per_component = sizeof(float);
+                    _internal_format = GL_RGB;
+                    _type = GL_FLOAT;
+                    break;
+                case 1:
+                    _bytes_per_component = sizeof(uint8_t);
+                    _internal_format = GL_RGB8;
+                    _type = GL_UNSIGNED_BYTE;
+                    break;
+                case 2:
+                    _bytes_per_component = sizeof(uint16_t);
+                    _internal_format = GL_RGB16;
+                    _type = GL_UNSIGNED_SHORT;
+                    break;
+                default:
+                    throw std::logic_error("unknown format id");
+            }
+            _row_bytes = static_cast<std::size_t>(_canvas_size.width()) * 3 * _bytes_per_component;
+            _colors.resize(_layout.size() * 3 * _bytes_per_component, 0);
             _accessing_colors.clear(std::memory_order_release);
         }
         color_display_renderer(const color_display_renderer&) = delete;
@@ -32,11 +68,12 @@ namespace chameleon {
         color_display_renderer& operator=(const color_display_renderer&) = delete;
         color_display_renderer& operator=(color_display_renderer&&) = delete;
         virtual ~color_display_renderer() {
-            glDeleteBuffers(1, &_pbo_id);
-            glDeleteTextures(1, &_texture_id);
-            glDeleteBuffers(static_cast<GLsizei>(_vertex_buffers_ids.size()), _vertex_buffers_ids.data());
-            glDeleteVertexArrays(1, &_vertex_array_id);
-            glDeleteProgram(_program_id);
+            release_lent_colors();
+            if (_program_setup) {
+                _pbo_ring.release();
+                _performance_monitor.release();
+                glDeleteTextures(1, &_texture_id);
+            }
         }
 
         /// set_rendering_area defines the rendering area.
@@ -47,34 +84,95 @@ namespace chameleon {
             _paint_area.moveTop(window_height - _paint_area.top() - _paint_area.height());
         }
 
+        /// tile_size returns the side of the pixels state's tiles, or 0 if the state is row-major.
+        virtual std::size_t tile_size() const {
+            return _layout.tile_size();
+        }
+
+        /// uploaded_bytes returns the number of bytes sent to the GPU during the last frame.
+        virtual std::size_t uploaded_bytes() const {
+            return _performance_monitor.uploaded_bytes();
+        }
+
+        /// sample_performance returns the renderer's counters, with rates measured since the previous call.
+        /// It must always be called by the same thread.
+        virtual performance_counters sample_performance() {
+            return _performance_monitor.sample();
+        }
+
         /// push adds an event to the display.
         template <typename Event>
         void push(Event event) {
-            const auto index =
-                (static_cast<std::size_t>(event.x) + static_cast<std::size_t>(event.y) * _canvas_size.width()) * 3;
-            while (_accessing_colors.test_and_set(std::memory_order_acquire)) {
+            const auto index = _layout.index(static_cast<std::size_t>(event.x), static_cast<std::size_t>(event.y)) * 3;
+            _performance_monitor.lock(_accessing_colors);
+            if (_lent_colors) {
+                copy_lent_colors();
             }
-            _colors[index] = static_cast<float>(event.r);
-            _colors[index + 1] = static_cast<float>(event.g);
-            _colors[index + 2] = static_cast<float>(event.b);
+            ++_pushed_events;
+            write(index, event.r, event.g, event.b);
             _accessing_colors.clear(std::memory_order_release);
         }
 
-        /// assign sets all the pixels at once.
+        /// push adds a batch of events to the display.
+        /// The lock is acquired once per batch rather than once per event.
         template <typename Iterator>
-        void assign(Iterator begin, Iterator end) {
-            std::size_t index = 0;
-            while (_accessing_colors.test_and_set(std::memory_order_acquire)) {
+        void push(Iterator begin, Iterator end) {
+            if (begin == end) {
+                return;
+            }
+            _performance_monitor.lock(_accessing_colors);
+            if (_lent_colors) {
+                copy_lent_colors();
             }
-            for (; begin != end; ++begin) {
-                _colors[index] = static_cast<float>(begin->r);
-                _colors[index + 1] = static_cast<float>(begin->g);
-                _colors[index + 2] = static_cast<float>(begin->g);
-                index += 3;
+            for (; begin != end; ++begin, ++_pushed_events) {
+                const auto index =
+                    _layout.index(static_cast<std::size_t>(begin->x), static_cast<std::size_t>(begin->y)) * 3;
+                write(index, begin->r, begin->g, begin->b);
             }
             _accessing_colors.clear(std::memory_order_release);
         }
 
+        /// assign sets all the pixels at once.
+        /// Contiguous ranges (pointers and std::vector iterators) are converted with SIMD kernels.
+        template <typename Iterator>
+        void assign(Iterator begin, Iterator end) {
+            _performance_monitor.lock(_accessing_colors);
+            release_lent_colors();
+            assign(begin, end, std::integral_constant<bool, is_contiguous_iterator<Iterator>::value>());
+            _accessing_colors.clear(std::memory_order_release);
+        }
+
+        /// lend replaces all the pixels with an external buffer, which the next paint uploads without intermediate
+        /// copy.
+        /// The buffer must hold width * height row-major interleaved RGB triplets in the renderer's format, even with
+        /// tiles, and remain valid until release is called. release is called once the buffer is no longer needed:
+        /// when another buffer or an assign replaces it, when a push copies it to the internal pixels, or when the
+        /// renderer is destroyed. It is called with the renderer's lock held, from either the producer or the render
+        /// thread, and must not call the renderer. If the render thread is uploading the buffer, release is called
+        /// once the upload is complete.
+        virtual void lend(const void* colors, std::function<void()> release) {
+            _performance_monitor.lock(_accessing_colors);
+            release_lent_colors();
+            _lent_colors = colors;
+            _lent_release = std::move(release);
+            _lent_uploaded = false;
+            _accessing_colors.clear(std::memory_order_release);
+        }
+
+        /// lend shares the ownership of external interleaved colors (typically a std::vector) with the renderer.
+        /// The value type must match the format (float, uint8_t or uint16_t), and the shared pointer is released once
+        /// the colors are no longer needed.
+        template <typename Colors>
+        void lend(std::shared_ptr<Colors> colors) {
+            typedef typename Colors::value_type component_type;
+            if (sizeof(component_type) != _bytes_per_component
+                || colors->size() * sizeof(component_type) != _row_bytes * _canvas_size.height()) {
+                throw std::logic_error("the lent colors do not match the canvas size and format");
+            }
+            const auto data = colors->data();
+            lend(data, [colors]() {});
+        }
+
         public slots:
 
         /// paint sends commands to the GPU.
@@ -85,93 +183,35 @@ namespace chameleon {
             if (!_program_setup) {
                 _program_setup = true;
 
-                // compile the vertex shader
-                const auto vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-                {
-                    const std::string vertex_shader(R""(
-                        #version 330 core
-                        in vec2 coordinates;
-                        out vec2 uv;
-                        uniform float width;
-                        uniform float height;
-                        void main() {
-                            gl_Position = vec4(coordinates, 0.0, 1.0);
-                            uv = vec2((coordinates.x + 1) / 2 * width, (coordinates.y + 1) / 2 * height);
-                        }
-                    )"");
-                    auto vertex_shader_content = vertex_shader.c_str();
-                    auto vertex_shader_size = vertex_shader.size();
-                    glShaderSource(
-                        vertex_shader_id,
-                        1,
-                        static_cast<const GLchar**>(&vertex_shader_content),
-                        reinterpret_cast<const GLint*>(&vertex_shader_size));
-                }
-                glCompileShader(vertex_shader_id);
-                check_shader_error(vertex_shader_id);
-
-                // compile the fragment shader
-                const auto fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-                {
-                    const std::string fragment_shader(R""(
-                            #version 330 core
-                            in vec2 uv;
-                            out vec4 color;
-                            uniform sampler2DRect sampler;
-                            void main() {
-                                color = texture(sampler, uv);
-                            }
-                        )"");
-                    auto fragment_shader_content = fragment_shader.c_str();
-                    auto fragment_shader_size = fragment_shader.size();
-                    glShaderSource(
-                        fragment_shader_id,
-                        1,
-                        static_cast<const GLchar**>(&fragment_shader_content),
-                        reinterpret_cast<const GLint*>(&fragment_shader_size));
-                }
-                glCompileShader(fragment_shader_id);
-                check_shader_error(fragment_shader_id);
-
-                // create the shaders pipeline
-                _program_id = glCreateProgram();
-                glAttachShader(_program_id, vertex_shader_id);
-                glAttachShader(_program_id, fragment_shader_id);
-                glLinkProgram(_program_id);
-                glDeleteShader(vertex_shader_id);
-                glDeleteShader(fragment_shader_id);
+                // get the program and the quad geometry, shared with the other displays of the context
+                const std::string vertex_shader(R""(
+                    #version 330 core
+                    in vec2 coordinates;
+                    out vec2 uv;
+                    uniform float width;
+                    uniform float height;
+                    void main() {
+                        gl_Position = vec4(coordinates, 0.0, 1.0);
+                        uv = vec2((coordinates.x + 1) / 2 * width, (coordinates.y + 1) / 2 * height);
+                    }
+                )"");
+                const std::string fragment_shader(R""(
+                    #version 330 core
+                    in vec2 uv;
+                    out vec4 color;
+                    uniform sampler2DRect sampler;
+                    void main() {
+                        color = texture(sampler, uv);
+                    }
+                )"");
+                auto& cache = gl_cache::current();
+                _program_id = cache.program(vertex_shader, fragment_shader);
+                _vertex_array_id = cache.quad_vertex_array();
                 glUseProgram(_program_id);
-                check_program_error(_program_id);
-
-                // create the vertex array object
-                glGenVertexArrays(1, &_vertex_array_id);
-                glBindVertexArray(_vertex_array_id);
-                glGenBuffers(static_cast<GLsizei>(_vertex_buffers_ids.size()), _vertex_buffers_ids.data());
-                {
-                    glBindBuffer(GL_ARRAY_BUFFER, std::get<0>(_vertex_buffers_ids));
-                    std::array<float, 8> coordinates{-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f};
-                    glBufferData(
-                        GL_ARRAY_BUFFER,
-                        coordinates.size() * sizeof(decltype(coordinates)::value_type),
-                        coordinates.data(),
-                        GL_STATIC_DRAW);
-                    glEnableVertexAttribArray(glGetAttribLocation(_program_id, "coordinates"));
-                    glVertexAttribPointer(glGetAttribLocation(_program_id, "coordinates"), 2, GL_FLOAT, GL_FALSE, 0, 0);
-                }
-                {
-                    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, std::get<1>(_vertex_buffers_ids));
-                    std::array<GLuint, 4> indices{0, 1, 2, 3};
-                    glBufferData(
-                        GL_ELEMENT_ARRAY_BUFFER,
-                        indices.size() * sizeof(decltype(indices)::value_type),
-                        indices.data(),
-                        GL_STATIC_DRAW);
-                }
-                glBindVertexArray(0);
 
-                // set the uniform values
-                glUniform1f(glGetUniformLocation(_program_id, "width"), static_cast<GLfloat>(_canvas_size.width()));
-                glUniform1f(glGetUniformLocation(_program_id, "height"), static_cast<GLfloat>(_canvas_size.height()));
+                // retrieve the uniform locations
+                _width_location = glGetUniformLocation(_program_id, "width");
+                _height_location = glGetUniformLocation(_program_id, "height");
 
                 // create the texture
                 glGenTextures(1, &_texture_id);
@@ -179,30 +219,29 @@ namespace chameleon {
                 glTexImage2D(
                     GL_TEXTURE_RECTANGLE,
                     0,
-                    GL_RGB,
+                    _internal_format,
                     _canvas_size.width(),
                     _canvas_size.height(),
                     0,
                     GL_RGB,
-                    GL_FLOAT,
+                    _type,
                     nullptr);
                 glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
                 glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
                 glBindTexture(GL_TEXTURE_RECTANGLE, 0);
 
-                // create the pbo
-                glGenBuffers(1, &_pbo_id);
-                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo_id);
-                glBufferData(
-                    GL_PIXEL_UNPACK_BUFFER,
-                    _colors.size() * sizeof(decltype(_colors)::value_type),
-                    nullptr,
-                    GL_DYNAMIC_DRAW);
-                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                // create the pbos
+                _pbo_ring.initialize(this, _row_bytes * _canvas_size.height());
+
+                // create the timer queries
+                _performance_monitor.initialize(this);
             }
 
             // send data to the GPU
+            _performance_monitor.begin_gpu();
             glUseProgram(_program_id);
+            glUniform1f(_width_location, static_cast<GLfloat>(_canvas_size.width()));
+            glUniform1f(_height_location, static_cast<GLfloat>(_canvas_size.height()));
             glViewport(
                 static_cast<GLint>(_paint_area.left()),
                 static_cast<GLint>(_paint_area.top()),
@@ -211,30 +250,237 @@ namespace chameleon {
             glEnable(GL_BLEND);
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
             glBindTexture(GL_TEXTURE_RECTANGLE, _texture_id);
-            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo_id);
-            glTexSubImage2D(
-                GL_TEXTURE_RECTANGLE, 0, 0, 0, _canvas_size.width(), _canvas_size.height(), GL_RGB, GL_FLOAT, 0);
-            {
-                auto buffer = reinterpret_cast<float*>(glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY));
-                if (!buffer) {
-                    throw std::logic_error("glMapBuffer returned an null pointer");
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            _performance_monitor.lock(_accessing_colors);
+            _performance_monitor.add_events(_pushed_events);
+            _pushed_events = 0;
+            if (_lent_colors) {
+                // lent colors are read from the client memory, the texture keeps them until they are replaced
+                if (!_lent_uploaded) {
+                    // the upload runs without the lock, releasing the buffer meanwhile is deferred
+                    const auto lent_colors = _lent_colors;
+                    _lent_uploaded = true;
+                    _uploading_colors = lent_colors;
+                    _accessing_colors.clear(std::memory_order_release);
+                    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                    glTexSubImage2D(
+                        GL_TEXTURE_RECTANGLE,
+                        0,
+                        0,
+                        0,
+                        _canvas_size.width(),
+                        _canvas_size.height(),
+                        GL_RGB,
+                        _type,
+                        lent_colors);
+                    _performance_monitor.set_uploaded_bytes(_row_bytes * _canvas_size.height());
+                    _performance_monitor.lock(_accessing_colors);
+                    finish_lent_upload();
+                } else {
+                    _performance_monitor.set_uploaded_bytes(0);
                 }
-                while (_accessing_colors.test_and_set(std::memory_order_acquire)) {
+                _accessing_colors.clear(std::memory_order_release);
+            } else {
+                _accessing_colors.clear(std::memory_order_release);
+                const auto copy_begin = std::chrono::steady_clock::now();
+                auto buffer = reinterpret_cast<uint8_t*>(_pbo_ring.map());
+                _performance_monitor.lock(_accessing_colors);
+                if (_layout.tiled()) {
+                    for (std::size_t y = 0; y < static_cast<std::size_t>(_canvas_size.height()); ++y) {
+                        _layout.copy_row(
+                            _colors.data(),
+                            buffer + y * _row_bytes,
+                            3 * _bytes_per_component,
+                            y,
+                            0,
+                            static_cast<std::size_t>(_canvas_size.width()));
+                    }
+                } else {
+                    std::copy(_colors.begin(), _colors.end(), buffer);
                 }
-                std::copy(_colors.begin(), _colors.end(), buffer);
                 _accessing_colors.clear(std::memory_order_release);
-                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                _performance_monitor.set_copy_duration(std::chrono::steady_clock::now() - copy_begin);
+                const auto offset = _pbo_ring.unmap();
+                glTexSubImage2D(
+                    GL_TEXTURE_RECTANGLE,
+                    0,
+                    0,
+                    0,
+                    _canvas_size.width(),
+                    _canvas_size.height(),
+                    GL_RGB,
+                    _type,
+                    reinterpret_cast<const GLvoid*>(offset));
+                _pbo_ring.fence();
+                _performance_monitor.set_uploaded_bytes(_row_bytes * _canvas_size.height());
             }
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
             glBindVertexArray(_vertex_array_id);
             glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, 0);
             glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
             glBindTexture(GL_TEXTURE_RECTANGLE, 0);
             glBindVertexArray(0);
             glUseProgram(0);
+            _performance_monitor.end_gpu();
             check_opengl_error();
         }
 
         protected:
+        /// write stores a color in the renderer's format.
+        /// index is the position of the red component.
+        /// the colors must be locked by the caller.
+        template <typename R, typename G, typename B>
+        void write(std::size_t index, R r, G g, B b) {
+            switch (_format) {
+                case 0: {
+                    auto components = reinterpret_cast<float*>(_colors.data()) + index;
+                    components[0] = static_cast<float>(r);
+                    components[1] = static_cast<float>(g);
+                    components[2] = static_cast<float>(b);
+                    break;
+                }
+                case 1: {
+                    auto components = _colors.data() + index;
+                    components[0] = static_cast<uint8_t>(r);
+                    components[1] = static_cast<uint8_t>(g);
+                    components[2] = static_cast<uint8_t>(b);
+                    break;
+                }
+                default: {
+                    auto components = reinterpret_cast<uint16_t*>(_colors.data()) + index;
+                    components[0] = static_cast<uint16_t>(r);
+                    components[1] = static_cast<uint16_t>(g);
+                    components[2] = static_cast<uint16_t>(b);
+                    break;
+                }
+            }
+        }
+
+        /// assign converts the pixels of a contiguous range.
+        /// Float colors are converted with the SIMD kernels, integer colors use the generic loop.
+        /// A tiled state is converted one row at a time, then each row is scattered to its tiles.
+        /// the colors must be locked by the caller.
+        template <typename Iterator>
+        void assign(Iterator begin, Iterator end, std::true_type) {
+            if (begin == end) {
+                return;
+            }
+            if (_format == 0) {
+                const auto count = std::min(
+                    static_cast<std::size_t>(std::distance(begin, end)),
+                    static_cast<std::size_t>(_canvas_size.width()) * _canvas_size.height());
+                if (!_layout.tiled()) {
+                    bulk_conversion::to_interleaved_floats(
+                        make_strided_field(begin, begin->r),
+                        make_strided_field(begin, begin->g),
+                        make_strided_field(begin, begin->b),
+                        count,
+                        reinterpret_cast<float*>(_colors.data()));
+                    return;
+                }
+                const auto width = static_cast<std::size_t>(_canvas_size.width());
+                _assigned_row.resize(_row_bytes);
+                for (std::size_t y = 0; y * width < count; ++y) {
+                    const auto row_begin = std::next(begin, static_cast<std::ptrdiff_t>(y * width));
+                    const auto row_count = std::min(width, count - y * width);
+                    if (row_count < width) {
+                        _layout.copy_row(_colors.data(), _assigned_row.data(), 3 * sizeof(float), y, 0, width);
+                    }
+                    bulk_conversion::to_interleaved_floats(
+                        make_strided_field(row_begin, row_begin->r),
+                        make_strided_field(row_begin, row_begin->g),
+                        make_strided_field(row_begin, row_begin->b),
+                        row_count,
+                        reinterpret_cast<float*>(_assigned_row.data()));
+                    _layout.assign_row(_assigned_row.data(), _colors.data(), 3 * sizeof(float), y);
+                }
+            } else {
+                assign(begin, end, std::false_type());
+            }
+        }
+
+        /// assign converts the pixels of a generic range.
+        /// the colors must be locked by the caller.
+        template <typename Iterator>
+        void assign(Iterator begin, Iterator end, std::false_type) {
+            switch (_format) {
+                case 0:
+                    assign_as<float>(begin, end);
+                    break;
+                case 1:
+                    assign_as<uint8_t>(begin, end);
+                    break;
+                default:
+                    assign_as<uint16_t>(begin, end);
+                    break;
+            }
+        }
+
+        /// assign_as converts the pixels of a generic range to the given component type.
+        /// the colors must be locked by the caller.
+        template <typename Component, typename Iterator>
+        void assign_as(Iterator begin, Iterator end) {
+            auto components = reinterpret_cast<Component*>(_colors.data());
+            const auto width = static_cast<std::size_t>(_canvas_size.width());
+            const auto height = static_cast<std::size_t>(_canvas_size.height());
+            std::size_t x = 0;
+            std::size_t y = 0;
+            for (; begin != end && y < height; ++begin) {
+                const auto index = _layout.index(x, y) * 3;
+                components[index] = static_cast<Component>(begin->r);
+                components[index + 1] = static_cast<Component>(begin->g);
+                components[index + 2] = static_cast<Component>(begin->b);
+                ++x;
+                if (x == width) {
+                    x = 0;
+                    ++y;
+                }
+            }
+        }
+
+        /// copy_lent_colors copies the lent colors to the internal pixels, and releases them.
+        /// The lent colors are row-major, and are scattered to the tiles if the state is tiled.
+        /// the colors must be locked by the caller.
+        virtual void copy_lent_colors() {
+            if (_layout.tiled()) {
+                const auto lent_colors = static_cast<const uint8_t*>(_lent_colors);
+                for (std::size_t y = 0; y < static_cast<std::size_t>(_canvas_size.height()); ++y) {
+                    _layout.assign_row(lent_colors + y * _row_bytes, _colors.data(), 3 * _bytes_per_component, y);
+                }
+            } else {
+                std::memcpy(_colors.data(), _lent_colors, _colors.size());
+            }
+            release_lent_colors();
+        }
+
+        /// release_lent_colors releases the lent colors, if any.
+        /// the colors must be locked by the caller.
+        virtual void release_lent_colors() {
+            if (_lent_colors) {
+                auto release = std::move(_lent_release);
+                _lent_release = nullptr;
+                if (release) {
+                    if (_lent_colors == _uploading_colors) {
+                        _deferred_releases.push_back(std::move(release));
+                    } else {
+                        release();
+                    }
+                }
+                _lent_colors = nullptr;
+            }
+        }
+
+        /// finish_lent_upload calls the releases deferred during the upload of lent colors.
+        /// the colors must be locked by the caller.
+        virtual void finish_lent_upload() {
+            _uploading_colors = nullptr;
+            auto deferred_releases = std::move(_deferred_releases);
+            _deferred_releases.clear();
+            for (auto& release : deferred_releases) {
+                release();
+            }
+        }
+
         /// check_opengl_error throws if openGL generated an error.
         virtual void check_opengl_error() {
             switch (glGetError()) {
@@ -251,36 +497,21 @@ namespace chameleon {
             }
         }
 
-        /// check_shader_error checks for shader compilation errors.
-        virtual void check_shader_error(GLuint shader_id) {
-            GLint status = 0;
-            glGetShaderiv(shader_id, GL_COMPILE_STATUS, &status);
-
-            if (status != GL_TRUE) {
-                GLint message_length = 0;
-                glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &message_length);
-                std::vector<char> error_message(message_length);
-                glGetShaderInfoLog(shader_id, message_length, nullptr, error_message.data());
-                throw std::logic_error("Shader error: " + std::string(error_message.data()));
-            }
-        }
-
-        /// check_program_error checks for program errors.
-        virtual void check_program_error(GLuint program_id) {
-            GLint status = 0;
-            glGetProgramiv(program_id, GL_LINK_STATUS, &status);
-
-            if (status != GL_TRUE) {
-                GLint message_length = 0;
-                glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &message_length);
-                std::vector<char> error_message(message_length);
-                glGetShaderInfoLog(program_id, message_length, nullptr, error_message.data());
-                throw std::logic_error("program error: " + std::string(error_message.data()));
-            }
-        }
-
         QSize _canvas_size;
-        std::vector<float> _colors;
+        std::size_t _format;
+        tiled_layout _layout;
+        std::size_t _bytes_per_component;
+        std::size_t _row_bytes;
+        GLenum _internal_format;
+        GLenum _type;
+        std::vector<uint8_t> _colors;
+        std::vector<uint8_t> _assigned_row;
+        const void* _lent_colors;
+        std::function<void()> _lent_release;
+        bool _lent_uploaded;
+        const void* _uploading_colors;
+        std::vector<std::function<void()>> _deferred_releases;
+        std::size_t _pushed_events;
         std::atomic_flag _accessing_colors;
         QRectF _clear_area;
         QRectF _paint_area;
@@ -288,8 +519,10 @@ namespace chameleon {
         GLuint _program_id;
         GLuint _vertex_array_id;
         GLuint _texture_id;
-        GLuint _pbo_id;
-        std::array<GLuint, 2> _vertex_buffers_ids;
+        pbo_ring _pbo_ring;
+        performance_monitor _performance_monitor;
+        GLuint _width_location;
+        GLuint _height_location;
     };
 
     /// color_display displays a stream of color events without tone-mapping.
@@ -297,10 +530,33 @@ namespace chameleon {
         Q_OBJECT
         Q_INTERFACES(QQmlParserStatus)
         Q_PROPERTY(QSize canvas_size READ canvas_size WRITE set_canvas_size)
+        Q_PROPERTY(Format format READ format WRITE set_format)
+        Q_PROPERTY(int tile_size READ tile_size WRITE set_tile_size)
         Q_PROPERTY(QRectF paint_area READ paint_area)
+        Q_PROPERTY(double events_per_second READ events_per_second NOTIFY performance_changed)
+        Q_PROPERTY(double lock_spins_per_second READ lock_spins_per_second NOTIFY performance_changed)
+        Q_PROPERTY(double copy_duration READ copy_duration NOTIFY performance_changed)
+        Q_PROPERTY(double gpu_duration READ gpu_duration NOTIFY performance_changed)
+        Q_PROPERTY(qint64 uploaded_bytes READ uploaded_bytes NOTIFY performance_changed)
+        Q_ENUMS(Format)
         public:
-        color_display() : _ready(false), _renderer_ready(false) {
+        /// Format defines the texture format, and the type of the stored color components.
+        /// Float components range in [0, 1], whereas Uint8 and Uint16 components are sensor levels, normalized by the
+        /// GPU (GL_RGB8 and GL_RGB16 textures).
+        enum Format { Float, Uint8, Uint16 };
+
+        color_display() :
+            _ready(false),
+            _renderer_ready(false),
+            _render_scheduler(nullptr),
+            _format(Format::Float),
+            _tile_size(0) {
             connect(this, &QQuickItem::windowChanged, this, &color_display::handle_window_changed);
+            _performance = performance_counters{};
+            _performance_timer.setInterval(1000);
+            connect(&_performance_timer, &QTimer::timeout, this, &color_display::update_performance);
+            _performance_timer.start();
+            _accessing_renderer.clear(std::memory_order_release);
         }
         color_display(const color_display&) = delete;
         color_display(color_display&&) = delete;
@@ -325,6 +581,67 @@ namespace chameleon {
             return _canvas_size;
         }
 
+        /// set_format defines the texture format.
+        /// The format will be passed to the openGL renderer, therefore it should only be set during qml construction.
+        virtual void set_format(Format format) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("format can only be set during qml construction");
+            }
+            _format = format;
+        }
+
+        /// format returns the currently used format.
+        virtual Format format() const {
+            return _format;
+        }
+
+        /// set_tile_size defines the side of the square tiles storing the pixels state, 0 (default) being row-major.
+        /// Tiles keep neighbouring pixels in the same cache lines, which speeds up pushes of spatially clustered
+        /// events, while the upload de-tiles the pixels. Lent buffers are row-major, and are uploaded as is.
+        /// The tile size will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_tile_size(int tile_size) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("tile_size can only be set during qml construction");
+            }
+            if (tile_size != 0 && (tile_size < 2 || tile_size > 256 || (tile_size & (tile_size - 1)) != 0)) {
+                throw std::logic_error("tile_size must be 0 or a power of two in the range [2, 256]");
+            }
+            _tile_size = tile_size;
+        }
+
+        /// tile_size returns the currently used tile size.
+        virtual int tile_size() const {
+            return _tile_size;
+        }
+
+        /// events_per_second returns the number of events received per second, measured over the last second.
+        virtual double events_per_second() const {
+            return _performance.events_per_second;
+        }
+
+        /// lock_spins_per_second returns the number of iterations per second spent waiting for the renderer's locks.
+        /// A high value means that producers and the render thread contend.
+        virtual double lock_spins_per_second() const {
+            return _performance.lock_spins_per_second;
+        }
+
+        /// copy_duration returns the CPU time, in microseconds, spent copying the state to the GPU buffers during the
+        /// latest frame.
+        virtual double copy_duration() const {
+            return _performance.copy_duration;
+        }
+
+        /// gpu_duration returns the GPU time, in microseconds, of the latest measured frame.
+        virtual double gpu_duration() const {
+            return _performance.gpu_duration;
+        }
+
+        /// uploaded_bytes returns the number of bytes sent to the GPU during the last frame.
+        virtual std::size_t uploaded_bytes() const {
+            return _performance.uploaded_bytes;
+        }
+
         /// paint_area returns the paint area in window coordinates.
         virtual QRectF paint_area() const {
             return _paint_area;
@@ -336,6 +653,16 @@ namespace chameleon {
             while (!_renderer_ready.load(std::memory_order_acquire)) {
             }
             _color_display_renderer->push<Event>(event);
+            request_update();
+        }
+
+        /// push adds a batch of events to the display.
+        template <typename Iterator>
+        void push(Iterator begin, Iterator end) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _color_display_renderer->push<Iterator>(begin, end);
+            request_update();
         }
 
         /// assign sets all the pixels at once.
@@ -344,6 +671,24 @@ namespace chameleon {
             while (!_renderer_ready.load(std::memory_order_acquire)) {
             }
             _color_display_renderer->assign<Iterator>(begin, end);
+            request_update();
+        }
+
+        /// lend replaces all the pixels with an external buffer, uploaded without intermediate copy.
+        virtual void lend(const void* colors, std::function<void()> release) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _color_display_renderer->lend(colors, std::move(release));
+            request_update();
+        }
+
+        /// lend shares the ownership of external interleaved colors with the display.
+        template <typename Colors>
+        void lend(std::shared_ptr<Colors> colors) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _color_display_renderer->lend(std::move(colors));
+            request_update();
         }
 
         /// componentComplete is called when all the qml values are bound.
@@ -359,21 +704,28 @@ namespace chameleon {
         /// paintAreaChanged notifies a paint area change.
         void paintAreaChanged(QRectF paint_area);
 
+        /// performance_changed notifies a change of the performance counters.
+        void performance_changed();
+
         public slots:
 
         /// sync adapts the renderer to external changes.
         void sync() {
             if (_ready.load(std::memory_order_relaxed)) {
                 if (!_color_display_renderer) {
-                    _color_display_renderer =
-                        std::unique_ptr<color_display_renderer>(new color_display_renderer(_canvas_size));
+                    _color_display_renderer = std::unique_ptr<color_display_renderer>(
+                        new color_display_renderer(
+                            _canvas_size, static_cast<std::size_t>(_format), static_cast<std::size_t>(_tile_size)));
                     connect(
                         window(),
                         &QQuickWindow::beforeRendering,
                         _color_display_renderer.get(),
                         &color_display_renderer::paint,
                         Qt::DirectConnection);
+                    while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+                    }
                     _renderer_ready.store(true, std::memory_order_release);
+                    _accessing_renderer.clear(std::memory_order_release);
                 }
                 auto clear_area =
                     QRectF(0, 0, width() * window()->devicePixelRatio(), height() * window()->devicePixelRatio());
@@ -402,14 +754,19 @@ namespace chameleon {
         }
 
         /// cleanup frees the owned renderer.
+        /// Pushes wait for the next renderer, created by sync if the scene graph is initialized again.
         void cleanup() {
+            while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+            }
+            _renderer_ready.store(false, std::memory_order_release);
             _color_display_renderer.reset();
+            _accessing_renderer.clear(std::memory_order_release);
         }
 
         /// trigger_draw requests a window refresh.
         void trigger_draw() {
             if (window()) {
-                window()->update();
+                render_scheduler::of(window())->request_update();
             }
         }
 
@@ -422,15 +779,47 @@ namespace chameleon {
                 connect(
                     window, &QQuickWindow::sceneGraphInvalidated, this, &color_display::cleanup, Qt::DirectConnection);
                 window->setClearBeforeRendering(false);
+                _render_scheduler.store(render_scheduler::of(window), std::memory_order_release);
+            }
+        }
+
+        /// update_performance samples the renderer's counters.
+        /// The renderer lock prevents cleanup from freeing the renderer during the sample.
+        void update_performance() {
+            while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+            }
+            if (_renderer_ready.load(std::memory_order_relaxed)) {
+                const auto performance = _color_display_renderer->sample_performance();
+                _accessing_renderer.clear(std::memory_order_release);
+                if (performance != _performance) {
+                    _performance = performance;
+                    performance_changed();
+                }
+            } else {
+                _accessing_renderer.clear(std::memory_order_release);
             }
         }
 
         protected:
+        /// request_update schedules a window update, coalesced with the other displays of the window.
+        virtual void request_update() {
+            const auto scheduler = _render_scheduler.load(std::memory_order_acquire);
+            if (scheduler) {
+                scheduler->request_update();
+            }
+        }
+
         std::atomic_bool _ready;
         std::atomic_bool _renderer_ready;
+        std::atomic_flag _accessing_renderer;
+        std::atomic<render_scheduler*> _render_scheduler;
         QSize _canvas_size;
+        Format _format;
+        int _tile_size;
         std::unique_ptr<color_display_renderer> _color_display_renderer;
         QRectF _clear_area;
         QRectF _paint_area;
+        performance_counters _performance;
+        QTimer _performance_timer;
     };
 }
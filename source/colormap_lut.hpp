@@ -0,0 +1,124 @@
+#pragma once
+
+#include <QtGui/QColor>
+#include <QtGui/QOpenGLFunctions_3_3_Core>
+#include <stdexcept>
+#include <vector>
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// colormap_lut stores a colormap in a 1D texture sampled by the fragment shader.
+    /// The colors are evenly spaced stops, linearly interpolated by the texture filtering. Since the colormap is data
+    /// rather than shader code, it can be replaced at any time without compiling a new program.
+    class colormap_lut {
+        public:
+        /// glsl declares the lut sampler and the function colormap(value), which maps a value in [0, 1] to a color.
+        static constexpr const char* glsl = R""(
+            uniform sampler1D lut;
+            vec4 colormap(float value) {
+                float size = float(textureSize(lut, 0));
+                return texture(lut, (clamp(value, 0.0, 1.0) * (size - 1.0) + 0.5) / size);
+            }
+        )"";
+
+        colormap_lut() : _functions(nullptr), _texture_id(0), _changed(false) {}
+        colormap_lut(const colormap_lut&) = delete;
+        colormap_lut(colormap_lut&&) = delete;
+        colormap_lut& operator=(const colormap_lut&) = delete;
+        colormap_lut& operator=(colormap_lut&&) = delete;
+        virtual ~colormap_lut() {}
+
+        /// colors returns the stops of a built-in colormap: 0 (grey), 1 (hot) or 2 (jet).
+        static std::vector<QColor> colors(std::size_t colormap) {
+            switch (colormap) {
+                case 0:
+                    return {QColor(0, 0, 0), QColor(255, 255, 255)};
+                case 1:
+                    return {QColor(0, 0, 0),
+                            QColor(128, 0, 0),
+                            QColor(255, 0, 0),
+                            QColor(255, 128, 0),
+                            QColor(255, 255, 0),
+                            QColor(255, 255, 255)};
+                case 2:
+                    return {QColor(0, 0, 255), QColor(0, 255, 255), QColor(255, 255, 0), QColor(255, 0, 0)};
+                default:
+                    throw std::logic_error("unknown colormap id");
+            }
+        }
+
+        /// set defines the colormap stops, uploaded by the next call to bind.
+        /// It must be called by the render thread, or while the render thread is blocked.
+        virtual void set(std::vector<QColor> colors) {
+            if (colors.empty()) {
+                throw std::logic_error("a colormap requires at least one color");
+            }
+            _colors = std::move(colors);
+            _changed = true;
+        }
+
+        /// initialize creates the texture.
+        /// It must be called by the render thread, with the renderer's OpenGL functions.
+        virtual void initialize(QOpenGLFunctions_3_3_Core* functions) {
+            _functions = functions;
+            _functions->glGenTextures(1, &_texture_id);
+            _functions->glBindTexture(GL_TEXTURE_1D, _texture_id);
+            _functions->glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            _functions->glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            _functions->glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            _functions->glBindTexture(GL_TEXTURE_1D, 0);
+            _changed = true;
+        }
+
+        /// bind uploads the stops if they changed, and binds the texture to the given texture unit.
+        /// The active texture unit is restored to GL_TEXTURE0.
+        virtual void bind(GLenum unit) {
+            _functions->glActiveTexture(unit);
+            _functions->glBindTexture(GL_TEXTURE_1D, _texture_id);
+            if (_changed) {
+                _changed = false;
+                std::vector<GLfloat> texels;
+                texels.reserve(_colors.size() * 4);
+                for (const auto& color : _colors) {
+                    texels.push_back(static_cast<GLfloat>(color.redF()));
+                    texels.push_back(static_cast<GLfloat>(color.greenF()));
+                    texels.push_back(static_cast<GLfloat>(color.blueF()));
+                    texels.push_back(static_cast<GLfloat>(color.alphaF()));
+                }
+                _functions->glTexImage1D(
+                    GL_TEXTURE_1D,
+                    0,
+                    GL_RGBA8,
+                    static_cast<GLsizei>(_colors.size()),
+                    0,
+                    GL_RGBA,
+                    GL_FLOAT,
+                    texels.data());
+            }
+            _functions->glActiveTexture(GL_TEXTURE0);
+        }
+
+        /// unbind unbinds the texture from the given texture unit.
+        virtual void unbind(GLenum unit) {
+            _functions->glActiveTexture(unit);
+            _functions->glBindTexture(GL_TEXTURE_1D, 0);
+            _functions->glActiveTexture(GL_TEXTURE0);
+        }
+
+        /// release deletes the texture.
+        /// It must be called by the render thread.
+        virtual void release() {
+            if (_functions) {
+                _functions->glDeleteTextures(1, &_texture_id);
+                _functions = nullptr;
+            }
+        }
+
+        protected:
+        QOpenGLFunctions_3_3_Core* _functions;
+        GLuint _texture_id;
+        std::vector<QColor> _colors;
+        bool _changed;
+    };
+}
@@ -1,6 +1,16 @@
 #pragma once
 
+#include "colormap_lut.hpp"
+#include "gl_cache.hpp"
+#include "level_of_detail.hpp"
+#include "pbo_ring.hpp"
+#include "performance_monitor.hpp"
+#include "render_scheduler.hpp"
+#include "texel_scatter.hpp"
+#include "tiled_layout.hpp"
 #include <QQmlParserStatus>
+#include <QtCore/QTimer>
+#include <QtCore/QVariant>
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QOpenGLFunctions_3_3_Core>
 #include <QtQuick/QQuickItem>
@@ -8,10 +18,12 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <cmath>
 #include <limits>
 #include <memory>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 /// chameleon provides Qt components for event stream display.
@@ -21,27 +33,52 @@ namespace chameleon {
     class delta_t_display_renderer : public QObject, public QOpenGLFunctions_3_3_Core {
         Q_OBJECT
         public:
-        delta_t_display_renderer(QSize canvas_size, float discard_ratio, std::size_t colormap) :
+        delta_t_display_renderer(
+            QSize canvas_size,
+            float discard_ratio,
+            std::size_t calibration_interval,
+            std::size_t colormap,
+            bool gpu_scatter,
+            bool lod,
+            std::size_t tile_size) :
             _canvas_size(std::move(canvas_size)),
             _discard_ratio(discard_ratio),
-            _colormap(colormap),
-            _delta_ts(_canvas_size.width() * _canvas_size.height(), std::numeric_limits<uint32_t>::max()),
+            _calibration_interval(calibration_interval),
+            _gpu_scatter(gpu_scatter),
+            _lod(lod),
+            _level_of_detail(_canvas_size),
+            _layout(_canvas_size, tile_size),
+            _delta_ts(_layout.size(), std::numeric_limits<uint32_t>::max()),
+            _calibration_delta_ts(_delta_ts.size()),
+            _dirty_rows(_canvas_size.height(), 1),
+            _pushed_events(0),
+            _maximum_pending_events(_delta_ts.size() * 2),
+            _latest_pending_events(_gpu_scatter ? _delta_ts.size() : 0),
             _discards_changed(false),
             _automatic_calibration(true),
+            _calibration_required(false),
+            _frames_since_calibration(0),
             _program_setup(false) {
+            if (_gpu_scatter && _layout.tiled()) {
+                throw std::logic_error("tile_size cannot be used with gpu_scatter");
+            }
             _accessing_delta_ts.clear(std::memory_order_release);
+            _accessing_pending_events.clear(std::memory_order_release);
             _accessing_discards.clear(std::memory_order_release);
+            _colormap_lut.set(colormap_lut::colors(colormap));
         }
         delta_t_display_renderer(const delta_t_display_renderer&) = delete;
         delta_t_display_renderer(delta_t_display_renderer&&) = delete;
         delta_t_display_renderer& operator=(const delta_t_display_renderer&) = delete;
         delta_t_display_renderer& operator=(delta_t_display_renderer&&) = delete;
         virtual ~delta_t_display_renderer() {
-            glDeleteBuffers(1, &_pbo_id);
-            glDeleteTextures(1, &_texture_id);
-            glDeleteBuffers(static_cast<GLsizei>(_vertex_buffers_ids.size()), _vertex_buffers_ids.data());
-            glDeleteVertexArrays(1, &_vertex_array_id);
-            glDeleteProgram(_program_id);
+            if (_program_setup) {
+                _pbo_ring.release();
+                _texel_scatter.release();
+                _performance_monitor.release();
+                _colormap_lut.release();
+                glDeleteTextures(1, &_texture_id);
+            }
         }
 
         /// set_rendering_area defines the rendering area.
@@ -52,11 +89,22 @@ namespace chameleon {
             _paint_area.moveTop(window_height - _paint_area.top() - _paint_area.height());
         }
 
+        /// set_region defines the part of the canvas which is displayed, an empty region displays the whole canvas.
+        /// Only the texels of the region are uploaded.
+        virtual void set_region(QRectF region) {
+            _region = region;
+        }
+
+        /// set_colormap defines the colormap stops, evenly spaced from the white discard to the black discard.
+        /// The colormap texture is updated by the next paint, the shader does not change.
+        virtual void set_colormap(std::vector<QColor> colors) {
+            _colormap_lut.set(std::move(colors));
+        }
+
         /// set_discards defines the discards.
         /// if both the black and white discards are zero (default), the discards are computed automatically.
         virtual void set_discards(QVector2D discards) {
-            while (_accessing_discards.test_and_set(std::memory_order_acquire)) {
-            }
+            _performance_monitor.lock(_accessing_discards);
             if (_automatic_calibration) {
                 if (discards.x() != 0 || discards.y() != 0) {
                     _automatic_calibration = false;
@@ -73,23 +121,105 @@ namespace chameleon {
             _accessing_discards.clear(std::memory_order_release);
         }
 
+        /// tile_size returns the side of the pixels state's tiles, or 0 if the state is row-major.
+        virtual std::size_t tile_size() const {
+            return _layout.tile_size();
+        }
+
+        /// uploaded_bytes returns the number of bytes sent to the GPU during the last frame.
+        virtual std::size_t uploaded_bytes() const {
+            return _performance_monitor.uploaded_bytes();
+        }
+
+        /// sample_performance returns the renderer's counters, with rates measured since the previous call.
+        /// It must always be called by the same thread.
+        virtual performance_counters sample_performance() {
+            return _performance_monitor.sample();
+        }
+
         /// push adds an event to the display.
         template <typename Event>
         void push(Event event) {
-            const auto index =
-                static_cast<std::size_t>(event.x) + static_cast<std::size_t>(event.y) * _canvas_size.width();
-            while (_accessing_delta_ts.test_and_set(std::memory_order_acquire)) {
+            const auto index = _layout.index(static_cast<std::size_t>(event.x), static_cast<std::size_t>(event.y));
+            if (_gpu_scatter) {
+                _performance_monitor.lock(_accessing_pending_events);
+                _pending_events.push_back(
+                    pending_event{static_cast<uint32_t>(index), static_cast<uint32_t>(event.delta_t)});
+                ++_pushed_events;
+                if (_pending_events.size() >= _maximum_pending_events) {
+                    compact_pending_events();
+                }
+                _accessing_pending_events.clear(std::memory_order_release);
+            } else {
+                _performance_monitor.lock(_accessing_delta_ts);
+                _delta_ts[index] = static_cast<uint32_t>(event.delta_t);
+                _dirty_rows[event.y] = 1;
+                ++_pushed_events;
+                _accessing_delta_ts.clear(std::memory_order_release);
+            }
+        }
+
+        /// push adds a batch of events to the display.
+        /// The lock is acquired once per batch rather than once per event.
+        template <typename Iterator>
+        void push(Iterator begin, Iterator end) {
+            if (begin == end) {
+                return;
+            }
+            if (_gpu_scatter) {
+                _performance_monitor.lock(_accessing_pending_events);
+                const auto previous_size = _pending_events.size();
+                for (; begin != end; ++begin) {
+                    _pending_events.push_back(pending_event{
+                        static_cast<uint32_t>(
+                            static_cast<std::size_t>(begin->x)
+                            + static_cast<std::size_t>(begin->y) * _canvas_size.width()),
+                        static_cast<uint32_t>(begin->delta_t)});
+                }
+                _pushed_events += _pending_events.size() - previous_size;
+                if (_pending_events.size() >= _maximum_pending_events) {
+                    compact_pending_events();
+                }
+                _accessing_pending_events.clear(std::memory_order_release);
+            } else {
+                _performance_monitor.lock(_accessing_delta_ts);
+                for (; begin != end; ++begin) {
+                    _delta_ts[_layout.index(static_cast<std::size_t>(begin->x), static_cast<std::size_t>(begin->y))] =
+                        static_cast<uint32_t>(begin->delta_t);
+                    _dirty_rows[begin->y] = 1;
+                    ++_pushed_events;
+                }
+                _accessing_delta_ts.clear(std::memory_order_release);
             }
-            _delta_ts[index] = static_cast<uint32_t>(event.delta_t);
-            _accessing_delta_ts.clear(std::memory_order_release);
         }
 
         /// assign sets all the pixels at once.
+        /// The time differences are read in row-major order, and scattered to the tiles if the state is tiled.
         template <typename Iterator>
         void assign(Iterator begin, Iterator end) {
-            while (_accessing_delta_ts.test_and_set(std::memory_order_acquire)) {
+            _performance_monitor.lock(_accessing_delta_ts);
+            if (_gpu_scatter) {
+                _performance_monitor.lock(_accessing_pending_events);
+                _pending_events.clear();
+                _accessing_pending_events.clear(std::memory_order_release);
+            }
+            if (_layout.tiled()) {
+                const auto width = static_cast<std::size_t>(_canvas_size.width());
+                const auto height = static_cast<std::size_t>(_canvas_size.height());
+                std::size_t x = 0;
+                std::size_t y = 0;
+                for (; begin != end && y < height; ++begin) {
+                    _delta_ts[_layout.index(x, y)] = static_cast<uint32_t>(*begin);
+                    ++x;
+                    if (x == width) {
+                        x = 0;
+                        ++y;
+                    }
+                }
+            } else {
+                _delta_ts.assign(begin, end);
             }
-            _delta_ts.assign(begin, end);
+            std::fill(_dirty_rows.begin(), _dirty_rows.end(), 1);
             _accessing_delta_ts.clear(std::memory_order_release);
         }
 
@@ -108,171 +238,84 @@ namespace chameleon {
             if (!_program_setup) {
                 _program_setup = true;
 
-                // compile the vertex shader
-                const auto vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-                {
-                    const std::string vertex_shader(R""(
-                        #version 330 core
-                        in vec2 coordinates;
-                        out vec2 uv;
-                        uniform float width;
-                        uniform float height;
-                        void main() {
-                            gl_Position = vec4(coordinates, 0.0, 1.0);
-                            uv = vec2((coordinates.x + 1) / 2 * width, (coordinates.y + 1) / 2 * height);
-                        }
-                    )"");
-                    auto vertex_shader_content = vertex_shader.c_str();
-                    auto vertex_shader_size = vertex_shader.size();
-                    glShaderSource(
-                        vertex_shader_id,
-                        1,
-                        static_cast<const GLchar**>(&vertex_shader_content),
-                        reinterpret_cast<const GLint*>(&vertex_shader_size));
-                }
-                glCompileShader(vertex_shader_id);
-                check_shader_error(vertex_shader_id);
-
-                // compile the fragment shader
-                const auto fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-                {
-                    std::string fragment_shader(R""(
-                        #version 330 core
-                        in vec2 uv;
-                        out vec4 color;
-                        uniform float slope;
-                        uniform float intercept;
-                        uniform usampler2DRect sampler;
-                    )"");
-                    switch (_colormap) {
-                        case 0:
-                            fragment_shader.append(R""(
-                                const float color_table_scale = 1;
-                                const vec4 color_table[3] = vec4[](
-                                    vec4(0.0, 0.0, 0.0, 1.0),
-                                    vec4(1.0, 1.0, 1.0, 1.0),
-                                    vec4(1.0, 1.0, 1.0, 1.0));
-                            )"");
-                            break;
-                        case 1:
-                            fragment_shader.append(R""(
-                                const float color_table_scale = 5;
-                                const vec4 color_table[7] = vec4[](
-                                    vec4(0.0, 0.0, 0.0, 1.0),
-                                    vec4(0.5, 0.0, 0.0, 1.0),
-                                    vec4(1.0, 0.0, 0.0, 1.0),
-                                    vec4(1.0, 0.5, 0.0, 1.0),
-                                    vec4(1.0, 1.0, 0.0, 1.0),
-                                    vec4(1.0, 1.0, 1.0, 1.0),
-                                    vec4(1.0, 1.0, 1.0, 1.0));
-                            )"");
-                            break;
-                        case 2:
-                            fragment_shader.append(R""(
-                                const float color_table_scale = 3;
-                                const vec4 color_table[5] = vec4[](
-                                    vec4(0.0, 0.0, 1.0, 1.0),
-                                    vec4(0.0, 1.0, 1.0, 1.0),
-                                    vec4(1.0, 1.0, 0.0, 1.0),
-                                    vec4(1.0, 0.0, 0.0, 1.0),
-                                    vec4(1.0, 0.0, 0.0, 1.0));
-                            )"");
-                            break;
-                        default:
-                            throw std::logic_error("unknown colormap id");
+                // get the program and the quad geometry, shared with the other displays of the context
+                const std::string vertex_shader(R""(
+                    #version 330 core
+                    in vec2 coordinates;
+                    out vec2 uv;
+                    uniform float width;
+                    uniform float height;
+                    void main() {
+                        gl_Position = vec4(coordinates, 0.0, 1.0);
+                        uv = vec2((coordinates.x + 1) / 2 * width, (coordinates.y + 1) / 2 * height);
                     }
-                    fragment_shader.append(R""(
-                        void main() {
-                            float exposure = clamp(slope * log(float(texture(sampler, uv).x)) + intercept, 0.0, 1.0) * color_table_scale;
-                            color = mix(
-                                color_table[int(exposure)],
-                                color_table[int(exposure) + 1],
-                                exposure - float(int(exposure)));
-                        }
-                    )"");
-                    auto fragment_shader_content = fragment_shader.c_str();
-                    auto fragment_shader_size = fragment_shader.size();
-                    glShaderSource(
-                        fragment_shader_id,
-                        1,
-                        static_cast<const GLchar**>(&fragment_shader_content),
-                        reinterpret_cast<const GLint*>(&fragment_shader_size));
-                }
-                glCompileShader(fragment_shader_id);
-                check_shader_error(fragment_shader_id);
-
-                // create the shaders pipeline
-                _program_id = glCreateProgram();
-                glAttachShader(_program_id, vertex_shader_id);
-                glAttachShader(_program_id, fragment_shader_id);
-                glLinkProgram(_program_id);
-                glDeleteShader(vertex_shader_id);
-                glDeleteShader(fragment_shader_id);
+                )"");
+                std::string fragment_shader(R""(
+                    #version 330 core
+                    in vec2 uv;
+                    out vec4 color;
+                    uniform float slope;
+                    uniform float intercept;
+                    uniform usampler2DRect sampler;
+                )"");
+                fragment_shader.append(colormap_lut::glsl);
+                fragment_shader.append(R""(
+                    void main() {
+                        color = colormap(slope * log(float(texture(sampler, uv).x)) + intercept);
+                    }
+                )"");
+                auto& cache = gl_cache::current();
+                _program_id = cache.program(vertex_shader, fragment_shader);
+                _vertex_array_id = cache.quad_vertex_array();
                 glUseProgram(_program_id);
-                check_program_error(_program_id);
-
-                // create the vertex array object
-                glGenVertexArrays(1, &_vertex_array_id);
-                glBindVertexArray(_vertex_array_id);
-                glGenBuffers(static_cast<GLsizei>(_vertex_buffers_ids.size()), _vertex_buffers_ids.data());
-                {
-                    glBindBuffer(GL_ARRAY_BUFFER, std::get<0>(_vertex_buffers_ids));
-                    std::array<float, 8> coordinates{-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f};
-                    glBufferData(
-                        GL_ARRAY_BUFFER,
-                        coordinates.size() * sizeof(decltype(coordinates)::value_type),
-                        coordinates.data(),
-                        GL_STATIC_DRAW);
-                    glEnableVertexAttribArray(glGetAttribLocation(_program_id, "coordinates"));
-                    glVertexAttribPointer(glGetAttribLocation(_program_id, "coordinates"), 2, GL_FLOAT, GL_FALSE, 0, 0);
-                }
-                {
-                    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, std::get<1>(_vertex_buffers_ids));
-                    std::array<GLuint, 4> indices{0, 1, 2, 3};
-                    glBufferData(
-                        GL_ELEMENT_ARRAY_BUFFER,
-                        indices.size() * sizeof(decltype(indices)::value_type),
-                        indices.data(),
-                        GL_STATIC_DRAW);
-                }
-                glBindVertexArray(0);
 
-                // set the uniform values
-                glUniform1f(glGetUniformLocation(_program_id, "width"), static_cast<GLfloat>(_canvas_size.width()));
-                glUniform1f(glGetUniformLocation(_program_id, "height"), static_cast<GLfloat>(_canvas_size.height()));
+                // retrieve the uniform locations
+                _width_location = glGetUniformLocation(_program_id, "width");
+                _height_location = glGetUniformLocation(_program_id, "height");
                 _slope_location = glGetUniformLocation(_program_id, "slope");
                 _intercept_location = glGetUniformLocation(_program_id, "intercept");
 
+                // create the colormap texture
+                glUniform1i(glGetUniformLocation(_program_id, "lut"), 1);
+                _colormap_lut.initialize(this);
+
                 // create the texture
                 glGenTextures(1, &_texture_id);
-                glBindTexture(GL_TEXTURE_RECTANGLE, _texture_id);
-                glTexImage2D(
-                    GL_TEXTURE_RECTANGLE,
-                    0,
-                    GL_R32UI,
-                    _canvas_size.width(),
-                    _canvas_size.height(),
-                    0,
-                    GL_RED_INTEGER,
-                    GL_UNSIGNED_INT,
-                    nullptr);
-                glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-                glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-                glBindTexture(GL_TEXTURE_RECTANGLE, 0);
-
-                // create the pbo
-                glGenBuffers(1, &_pbo_id);
-                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo_id);
-                glBufferData(
-                    GL_PIXEL_UNPACK_BUFFER,
-                    _delta_ts.size() * sizeof(decltype(_delta_ts)::value_type),
-                    nullptr,
-                    GL_DYNAMIC_DRAW);
-                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                allocate_texture();
+
+                // create the scatter framebuffer
+                if (_gpu_scatter) {
+                    _texel_scatter.initialize(
+                        this, _texture_id, _canvas_size, sizeof(pending_event), 1, "uvec4(value, 0u, 0u, 0u)");
+                    glUseProgram(_program_id);
+                }
+
+                // create the pbos
+                _pbo_ring.initialize(this, _delta_ts.size() * sizeof(decltype(_delta_ts)::value_type));
+
+                // create the timer queries
+                _performance_monitor.initialize(this);
+            }
+
+            // adapt the texture to the region and the paint area, the scatter pass requires the whole canvas
+            if (!_gpu_scatter
+                && _level_of_detail.update(
+                    _region,
+                    static_cast<std::size_t>(std::ceil(_paint_area.width())),
+                    static_cast<std::size_t>(std::ceil(_paint_area.height())),
+                    _lod)) {
+                allocate_texture();
+                _performance_monitor.lock(_accessing_delta_ts);
+                std::fill(_dirty_rows.begin(), _dirty_rows.end(), 1);
+                _accessing_delta_ts.clear(std::memory_order_release);
             }
 
             // send data to the GPU
+            _performance_monitor.begin_gpu();
             glUseProgram(_program_id);
+            const auto texture_size = _level_of_detail.size();
+            glUniform1f(_width_location, static_cast<GLfloat>(texture_size.width()));
+            glUniform1f(_height_location, static_cast<GLfloat>(texture_size.height()));
             glViewport(
                 static_cast<GLint>(_paint_area.left()),
                 static_cast<GLint>(_paint_area.top()),
@@ -281,59 +324,118 @@ namespace chameleon {
             glEnable(GL_BLEND);
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
             glBindTexture(GL_TEXTURE_RECTANGLE, _texture_id);
-            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo_id);
-            glTexSubImage2D(
-                GL_TEXTURE_RECTANGLE,
-                0,
-                0,
-                0,
-                _canvas_size.width(),
-                _canvas_size.height(),
-                GL_RED_INTEGER,
-                GL_UNSIGNED_INT,
-                0);
+            const auto row_size = static_cast<std::size_t>(texture_size.width());
+            _performance_monitor.lock(_accessing_discards);
+            const auto automatic_calibration = _automatic_calibration;
+            _accessing_discards.clear(std::memory_order_release);
+            std::size_t size = 0;
+            const auto copy_begin = std::chrono::steady_clock::now();
+            std::chrono::steady_clock::duration calibration_duration(0);
             {
-                auto buffer = reinterpret_cast<uint32_t*>(glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_READ_WRITE));
-                if (!buffer) {
-                    throw std::logic_error("glMapBuffer returned an null pointer");
+                auto buffer = reinterpret_cast<uint32_t*>(_pbo_ring.map());
+                _performance_monitor.lock(_accessing_delta_ts);
+                std::size_t pushed_events = 0;
+                if (_gpu_scatter) {
+                    _performance_monitor.lock(_accessing_pending_events);
+                    _painted_events.swap(_pending_events);
+                    std::swap(pushed_events, _pushed_events);
+                    _accessing_pending_events.clear(std::memory_order_release);
+                    for (const auto& event : _painted_events) {
+                        _delta_ts[event.index] = event.delta_t;
+                    }
+                } else {
+                    std::swap(pushed_events, _pushed_events);
                 }
-                while (_accessing_delta_ts.test_and_set(std::memory_order_acquire)) {
+                collect_dirty_rows();
+                _level_of_detail.texture_rows(_dirty_rows_ranges, _texture_rows_ranges);
+                for (const auto& rows : _texture_rows_ranges) {
+                    if (_level_of_detail.identity()) {
+                        _level_of_detail.copy(_layout, _delta_ts.data(), buffer, 1, rows.first, rows.second);
+                    } else {
+                        reduce(buffer, rows.first, rows.second);
+                    }
                 }
-                std::copy(_delta_ts.begin(), _delta_ts.end(), buffer);
-                _accessing_delta_ts.clear(std::memory_order_release);
-                while (_accessing_discards.test_and_set(std::memory_order_acquire)) {
+                if (!_dirty_rows_ranges.empty() || !_painted_events.empty()) {
+                    _calibration_required = true;
                 }
-                if (_automatic_calibration) {
-                    auto previous_discards = _discards;
-                    std::vector<uint32_t> sorted_delta_ts(_delta_ts.size());
-                    const auto end =
-                        std::copy_if(buffer, buffer + _delta_ts.size(), sorted_delta_ts.begin(), [](uint32_t delta_t) {
+                ++_frames_since_calibration;
+                if (automatic_calibration && _calibration_required
+                    && _frames_since_calibration >= _calibration_interval) {
+                    const auto calibration_begin = std::chrono::steady_clock::now();
+                    const auto end = std::copy_if(
+                        _delta_ts.begin(), _delta_ts.end(), _calibration_delta_ts.begin(), [](uint32_t delta_t) {
                             return delta_t < std::numeric_limits<uint32_t>::max();
                         });
-                    const auto size = static_cast<std::size_t>(std::distance(sorted_delta_ts.begin(), end));
-                    if (size > 0) {
-                        std::sort(sorted_delta_ts.begin(), end);
-                        auto black_discard_candidate =
-                            sorted_delta_ts[static_cast<std::size_t>(size * (1.0f - _discard_ratio))];
-                        auto white_discard_candidate =
-                            sorted_delta_ts[static_cast<std::size_t>(size * _discard_ratio + 0.5f)];
-                        if (black_discard_candidate > white_discard_candidate) {
-                            _discards.setX(black_discard_candidate);
-                            _discards.setY(white_discard_candidate);
-                        } else {
-                            black_discard_candidate = *std::prev(end);
-                            white_discard_candidate = sorted_delta_ts.front();
-                            if (black_discard_candidate > white_discard_candidate) {
-                                _discards.setX(black_discard_candidate);
-                                _discards.setY(white_discard_candidate);
-                            }
-                        }
-                        if (_discards != previous_discards) {
-                            _discards_changed = true;
-                        }
+                    size = static_cast<std::size_t>(std::distance(_calibration_delta_ts.begin(), end));
+                    _calibration_required = false;
+                    _frames_since_calibration = 0;
+                    calibration_duration = std::chrono::steady_clock::now() - calibration_begin;
+                }
+                _accessing_delta_ts.clear(std::memory_order_release);
+                _performance_monitor.add_events(pushed_events);
+                _performance_monitor.set_copy_duration(
+                    std::chrono::steady_clock::now() - copy_begin - calibration_duration);
+            }
+            {
+                const auto offset = _pbo_ring.unmap();
+                std::size_t uploaded_bytes = 0;
+                for (const auto& rows : _texture_rows_ranges) {
+                    glTexSubImage2D(
+                        GL_TEXTURE_RECTANGLE,
+                        0,
+                        0,
+                        static_cast<GLint>(rows.first),
+                        texture_size.width(),
+                        static_cast<GLsizei>(rows.second - rows.first),
+                        GL_RED_INTEGER,
+                        GL_UNSIGNED_INT,
+                        reinterpret_cast<const GLvoid*>(
+                            offset + rows.first * row_size * sizeof(decltype(_delta_ts)::value_type)));
+                    uploaded_bytes += (rows.second - rows.first) * row_size * sizeof(decltype(_delta_ts)::value_type);
+                }
+                _pbo_ring.fence();
+                if (_gpu_scatter && !_painted_events.empty()) {
+                    uploaded_bytes += _texel_scatter.draw(_painted_events.data(), _painted_events.size());
+                    _painted_events.clear();
+                    glUseProgram(_program_id);
+                }
+                _performance_monitor.set_uploaded_bytes(uploaded_bytes);
+            }
+            QVector2D discards_candidate;
+            if (size > 0) {
+                const auto calibration_begin = std::chrono::steady_clock::now();
+                const auto begin = _calibration_delta_ts.begin();
+                const auto end = std::next(begin, size);
+                const auto black_discard_position =
+                    std::next(begin, std::min(size - 1, static_cast<std::size_t>(size * (1.0f - _discard_ratio))));
+                const auto white_discard_position =
+                    std::next(begin, std::min(size - 1, static_cast<std::size_t>(size * _discard_ratio + 0.5f)));
+                std::nth_element(begin, black_discard_position, end);
+                if (white_discard_position < black_discard_position) {
+                    std::nth_element(begin, white_discard_position, black_discard_position);
+                } else {
+                    std::nth_element(begin, white_discard_position, end);
+                }
+                if (*black_discard_position > *white_discard_position) {
+                    discards_candidate = QVector2D(*black_discard_position, *white_discard_position);
+                } else {
+                    const auto white_and_black_discards = std::minmax_element(begin, end);
+                    if (*white_and_black_discards.second > *white_and_black_discards.first) {
+                        discards_candidate =
+                            QVector2D(*white_and_black_discards.second, *white_and_black_discards.first);
                     }
                 }
+                calibration_duration += std::chrono::steady_clock::now() - calibration_begin;
+                _performance_monitor.set_calibration_duration(calibration_duration);
+            }
+            {
+                _performance_monitor.lock(_accessing_discards);
+                if (_automatic_calibration && !discards_candidate.isNull() && discards_candidate != _discards) {
+                    _discards = discards_candidate;
+                    _discards_changed = true;
+                }
                 if (_discards_changed) {
+                    _discards_changed = false;
                     discards_changed(_discards);
                 }
                 {
@@ -342,18 +444,109 @@ namespace chameleon {
                     glUniform1f(_intercept_location, static_cast<GLfloat>(std::log(_discards.x()) / delta));
                 }
                 _accessing_discards.clear(std::memory_order_release);
-                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
             }
+            _colormap_lut.bind(GL_TEXTURE1);
             glBindVertexArray(_vertex_array_id);
             glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, 0);
+            _colormap_lut.unbind(GL_TEXTURE1);
             glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
             glBindTexture(GL_TEXTURE_RECTANGLE, 0);
             glBindVertexArray(0);
             glUseProgram(0);
+            _performance_monitor.end_gpu();
             check_opengl_error();
         }
 
         protected:
+        /// pending_event is an event waiting to be drawn into the texture by the render thread.
+        struct pending_event {
+            uint32_t index;
+            uint32_t delta_t;
+        };
+
+        /// compact_pending_events removes the pending events overwritten by a later event at the same pixel.
+        /// It bounds the memory used by pending events when the render thread falls behind.
+        /// _accessing_pending_events must be locked by the caller.
+        virtual void compact_pending_events() {
+            for (std::size_t position = 0; position < _pending_events.size(); ++position) {
+                _latest_pending_events[_pending_events[position].index] = static_cast<uint32_t>(position);
+            }
+            std::size_t size = 0;
+            for (std::size_t position = 0; position < _pending_events.size(); ++position) {
+                if (_latest_pending_events[_pending_events[position].index] == position) {
+                    _pending_events[size] = _pending_events[position];
+                    ++size;
+                }
+            }
+            _pending_events.resize(size);
+        }
+
+        /// reduce writes the texture rows [begin, end) with the smallest time difference of each block, which is the
+        /// brightest pixel. Pixels without measurement have the largest time difference, and are ignored unless the
+        /// whole block is empty.
+        /// A tiled block row is scanned one tile segment at a time.
+        /// _accessing_delta_ts must be locked by the caller.
+        virtual void reduce(uint32_t* buffer, std::size_t begin, std::size_t end) {
+            const auto delta_ts = _delta_ts.data();
+            _level_of_detail.reduce(
+                begin,
+                end,
+                [&](std::size_t index, std::size_t x_begin, std::size_t x_end, std::size_t y_begin, std::size_t y_end) {
+                    auto minimum = std::numeric_limits<uint32_t>::max();
+                    for (auto y = y_begin; y < y_end; ++y) {
+                        for (auto x = x_begin; x < x_end;) {
+                            const auto segment_end = _layout.segment_end(x, x_end);
+                            const auto row = delta_ts + _layout.index(x, y);
+                            minimum = std::min(minimum, *std::min_element(row, row + (segment_end - x)));
+                            x = segment_end;
+                        }
+                    }
+                    buffer[index] = minimum;
+                });
+        }
+
+        /// allocate_texture sizes the texture to the level of detail, the previous content is lost.
+        virtual void allocate_texture() {
+            const auto texture_size = _level_of_detail.size();
+            glBindTexture(GL_TEXTURE_RECTANGLE, _texture_id);
+            glTexImage2D(
+                GL_TEXTURE_RECTANGLE,
+                0,
+                GL_R32UI,
+                texture_size.width(),
+                texture_size.height(),
+                0,
+                GL_RED_INTEGER,
+                GL_UNSIGNED_INT,
+                nullptr);
+            glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+        }
+
+        /// collect_dirty_rows lists the ranges of rows modified since the last frame, and resets the dirty flags.
+        /// A single range spanning the whole canvas is used if most rows are dirty.
+        /// _accessing_delta_ts must be locked by the caller.
+        virtual void collect_dirty_rows() {
+            _dirty_rows_ranges.clear();
+            const auto dirty_rows = static_cast<std::size_t>(std::count(_dirty_rows.begin(), _dirty_rows.end(), 1));
+            if (dirty_rows * 2 > _dirty_rows.size()) {
+                _dirty_rows_ranges.emplace_back(0, _dirty_rows.size());
+            } else if (dirty_rows > 0) {
+                for (std::size_t y = 0; y < _dirty_rows.size(); ++y) {
+                    if (_dirty_rows[y] == 1) {
+                        auto end = y + 1;
+                        while (end < _dirty_rows.size() && _dirty_rows[end] == 1) {
+                            ++end;
+                        }
+                        _dirty_rows_ranges.emplace_back(y, end);
+                        y = end;
+                    }
+                }
+            }
+            std::fill(_dirty_rows.begin(), _dirty_rows.end(), 0);
+        }
+
         /// check_opengl_error throws if openGL generated an error.
         virtual void check_opengl_error() {
             switch (glGetError()) {
@@ -370,49 +563,44 @@ namespace chameleon {
             }
         }
 
-        /// check_shader_error checks for shader compilation errors.
-        virtual void check_shader_error(GLuint shader_id) {
-            GLint status = 0;
-            glGetShaderiv(shader_id, GL_COMPILE_STATUS, &status);
-            if (status != GL_TRUE) {
-                GLint message_length = 0;
-                glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &message_length);
-                std::vector<char> error_message(message_length);
-                glGetShaderInfoLog(shader_id, message_length, nullptr, error_message.data());
-                throw std::logic_error("Shader error: " + std::string(error_message.data()));
-            }
-        }
-
-        /// check_program_error checks for program errors.
-        virtual void check_program_error(GLuint program_id) {
-            GLint status = 0;
-            glGetProgramiv(program_id, GL_LINK_STATUS, &status);
-            if (status != GL_TRUE) {
-                GLint message_length = 0;
-                glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &message_length);
-                std::vector<char> error_message(message_length);
-                glGetShaderInfoLog(program_id, message_length, nullptr, error_message.data());
-                throw std::logic_error("program error: " + std::string(error_message.data()));
-            }
-        }
-
         QSize _canvas_size;
         float _discard_ratio;
-        std::size_t _colormap;
+        std::size_t _calibration_interval;
+        bool _gpu_scatter;
+        bool _lod;
+        level_of_detail _level_of_detail;
+        QRectF _region;
+        tiled_layout _layout;
         std::vector<uint32_t> _delta_ts;
+        std::vector<uint32_t> _calibration_delta_ts;
+        std::vector<uint8_t> _dirty_rows;
+        std::vector<std::pair<std::size_t, std::size_t>> _dirty_rows_ranges;
+        std::vector<std::pair<std::size_t, std::size_t>> _texture_rows_ranges;
+        std::size_t _pushed_events;
         std::atomic_flag _accessing_delta_ts;
+        std::vector<pending_event> _pending_events;
+        std::vector<pending_event> _painted_events;
+        std::size_t _maximum_pending_events;
+        std::vector<uint32_t> _latest_pending_events;
+        std::atomic_flag _accessing_pending_events;
         QRectF _clear_area;
         QRectF _paint_area;
         QVector2D _discards;
         std::atomic_flag _accessing_discards;
         bool _discards_changed;
         bool _automatic_calibration;
+        bool _calibration_required;
+        std::size_t _frames_since_calibration;
         bool _program_setup;
         GLuint _program_id;
         GLuint _vertex_array_id;
         GLuint _texture_id;
-        GLuint _pbo_id;
-        std::array<GLuint, 2> _vertex_buffers_ids;
+        pbo_ring _pbo_ring;
+        texel_scatter _texel_scatter;
+        colormap_lut _colormap_lut;
+        performance_monitor _performance_monitor;
+        GLuint _width_location;
+        GLuint _height_location;
         GLuint _slope_location;
         GLuint _intercept_location;
     };
@@ -424,8 +612,21 @@ namespace chameleon {
         Q_PROPERTY(QSize canvas_size READ canvas_size WRITE set_canvas_size)
         Q_PROPERTY(QVector2D discards READ discards WRITE set_discards NOTIFY discards_changed)
         Q_PROPERTY(float discard_ratio READ discard_ratio WRITE set_discard_ratio)
-        Q_PROPERTY(Colormap colormap READ colormap WRITE set_colormap)
+        Q_PROPERTY(int calibration_interval READ calibration_interval WRITE set_calibration_interval)
+        Q_PROPERTY(Colormap colormap READ colormap WRITE set_colormap NOTIFY colormap_changed)
+        Q_PROPERTY(
+            QVariantList custom_colormap READ custom_colormap WRITE set_custom_colormap NOTIFY custom_colormap_changed)
+        Q_PROPERTY(bool gpu_scatter READ gpu_scatter WRITE set_gpu_scatter)
+        Q_PROPERTY(bool lod READ lod WRITE set_lod)
+        Q_PROPERTY(int tile_size READ tile_size WRITE set_tile_size)
+        Q_PROPERTY(QRectF region READ region WRITE set_region NOTIFY region_changed)
         Q_PROPERTY(QRectF paint_area READ paint_area)
+        Q_PROPERTY(double events_per_second READ events_per_second NOTIFY performance_changed)
+        Q_PROPERTY(double lock_spins_per_second READ lock_spins_per_second NOTIFY performance_changed)
+        Q_PROPERTY(double copy_duration READ copy_duration NOTIFY performance_changed)
+        Q_PROPERTY(double gpu_duration READ gpu_duration NOTIFY performance_changed)
+        Q_PROPERTY(double calibration_duration READ calibration_duration NOTIFY performance_changed)
+        Q_PROPERTY(qint64 uploaded_bytes READ uploaded_bytes NOTIFY performance_changed)
         Q_ENUMS(Colormap)
         public:
         /// Colormap defines the colormap used by the display.
@@ -434,10 +635,20 @@ namespace chameleon {
         delta_t_display() :
             _ready(false),
             _renderer_ready(false),
+            _render_scheduler(nullptr),
             _discards(QVector2D(0, 0)),
             _discard_ratio(0.01f),
-            _colormap(Colormap::Grey) {
+            _calibration_interval(10),
+            _colormap(Colormap::Grey),
+            _colormap_changed(false),
+            _gpu_scatter(false),
+            _lod(false),
+            _tile_size(0) {
             connect(this, &QQuickItem::windowChanged, this, &delta_t_display::handle_window_changed);
+            _performance = performance_counters{};
+            _performance_timer.setInterval(1000);
+            connect(&_performance_timer, &QTimer::timeout, this, &delta_t_display::update_performance);
+            _performance_timer.start();
             _accessing_renderer.clear(std::memory_order_release);
         }
         delta_t_display(const delta_t_display&) = delete;
@@ -474,6 +685,7 @@ namespace chameleon {
                 _discards_to_load = discards;
             }
             _accessing_renderer.clear(std::memory_order_release);
+            request_update();
         }
 
         /// discards returns the currently used discards.
@@ -496,31 +708,180 @@ namespace chameleon {
             return _discard_ratio;
         }
 
-        /// set_colormap defines the colormap.
-        /// The colormap will be passed to the openGL renderer, therefore it should only be set during qml construction.
-        virtual void set_colormap(Colormap colormap) {
+        /// set_calibration_interval defines the number of frames between automatic discards updates.
+        /// The calibration interval will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_calibration_interval(int calibration_interval) {
             if (_ready.load(std::memory_order_acquire)) {
-                throw std::logic_error("colormap can only be set during qml construction");
+                throw std::logic_error("calibration_interval can only be set during qml construction");
+            }
+            if (calibration_interval < 1) {
+                throw std::logic_error("calibration_interval must be at least 1");
+            }
+            _calibration_interval = calibration_interval;
+        }
+
+        /// calibration_interval returns the currently used calibration_interval.
+        virtual int calibration_interval() const {
+            return _calibration_interval;
+        }
+
+        /// set_colormap defines the built-in colormap, used if custom_colormap is empty.
+        /// The colormap can be changed at any time, the renderer's colormap texture is updated by the next frame.
+        virtual void set_colormap(Colormap colormap) {
+            if (colormap != _colormap) {
+                _colormap = colormap;
+                _colormap_changed = true;
+                colormap_changed(_colormap);
+                trigger_draw();
             }
-            _colormap = colormap;
         }
 
-        /// colormap returns the currently used colormap.
+        /// colormap returns the currently used built-in colormap.
         virtual Colormap colormap() const {
             return _colormap;
         }
 
+        /// set_custom_colormap defines the colormap as a list of colors, evenly spaced from the white discard to the
+        /// black discard and linearly interpolated. An empty list (default) selects the built-in colormap.
+        /// The colormap can be changed at any time, the renderer's colormap texture is updated by the next frame.
+        virtual void set_custom_colormap(QVariantList custom_colormap) {
+            _custom_colormap = std::move(custom_colormap);
+            _colormap_changed = true;
+            custom_colormap_changed(_custom_colormap);
+            trigger_draw();
+        }
+
+        /// custom_colormap returns the currently used custom colormap.
+        virtual QVariantList custom_colormap() const {
+            return _custom_colormap;
+        }
+
+        /// set_gpu_scatter defines whether the pixels state is updated by the GPU.
+        /// With GPU scatter, only the events received since the last frame are sent to the GPU, and drawn into the
+        /// texture. The CPU copy is still updated to compute the automatic discards.
+        /// The GPU scatter mode will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_gpu_scatter(bool gpu_scatter) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("gpu_scatter can only be set during qml construction");
+            }
+            _gpu_scatter = gpu_scatter;
+        }
+
+        /// gpu_scatter returns the currently used GPU scatter mode.
+        virtual bool gpu_scatter() const {
+            return _gpu_scatter;
+        }
+
+        /// set_lod defines whether the canvas is reduced to the paint area size before upload.
+        /// Each on-screen pixel then shows the smallest time difference (the brightest pixel) of the canvas pixels
+        /// it covers, and the upload cost follows the number of on-screen pixels. LOD cannot be used with GPU scatter.
+        /// The lod mode will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_lod(bool lod) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("lod can only be set during qml construction");
+            }
+            _lod = lod;
+        }
+
+        /// lod returns the currently used lod mode.
+        virtual bool lod() const {
+            return _lod;
+        }
+
+        /// set_tile_size defines the side of the square tiles storing the pixels state, 0 (default) being row-major.
+        /// Tiles keep neighbouring pixels in the same cache lines, which speeds up pushes of spatially clustered
+        /// events, while the upload de-tiles the dirty rows. Tiles cannot be used with GPU scatter.
+        /// The tile size will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_tile_size(int tile_size) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("tile_size can only be set during qml construction");
+            }
+            if (tile_size != 0 && (tile_size < 2 || tile_size > 256 || (tile_size & (tile_size - 1)) != 0)) {
+                throw std::logic_error("tile_size must be 0 or a power of two in the range [2, 256]");
+            }
+            _tile_size = tile_size;
+        }
+
+        /// tile_size returns the currently used tile size.
+        virtual int tile_size() const {
+            return _tile_size;
+        }
+
+        /// set_region defines the part of the canvas which is displayed, in canvas coordinates.
+        /// Only the region is uploaded, and it is stretched to the item while keeping its aspect ratio. An empty
+        /// region (default) displays the whole canvas. The region can be changed at any time to pan and zoom, it is
+        /// ignored with GPU scatter.
+        virtual void set_region(QRectF region) {
+            if (region != _region) {
+                _region = region;
+                region_changed(_region);
+                trigger_draw();
+            }
+        }
+
+        /// region returns the currently displayed region.
+        virtual QRectF region() const {
+            return _region;
+        }
+
+        /// events_per_second returns the number of events received per second, measured over the last second.
+        virtual double events_per_second() const {
+            return _performance.events_per_second;
+        }
+
+        /// lock_spins_per_second returns the number of iterations per second spent waiting for the renderer's locks.
+        /// A high value means that producers and the render thread contend.
+        virtual double lock_spins_per_second() const {
+            return _performance.lock_spins_per_second;
+        }
+
+        /// copy_duration returns the CPU time, in microseconds, spent copying the state to the GPU buffers during the
+        /// latest frame.
+        virtual double copy_duration() const {
+            return _performance.copy_duration;
+        }
+
+        /// gpu_duration returns the GPU time, in microseconds, of the latest measured frame.
+        virtual double gpu_duration() const {
+            return _performance.gpu_duration;
+        }
+
+        /// calibration_duration returns the CPU time, in microseconds, spent calibrating the colormap during the latest
+        /// frame.
+        virtual double calibration_duration() const {
+            return _performance.calibration_duration;
+        }
+
         /// paint_area returns the paint area in window coordinates.
         virtual QRectF paint_area() const {
             return _paint_area;
         }
 
+        /// uploaded_bytes returns the number of bytes sent to the GPU during the last frame.
+        virtual std::size_t uploaded_bytes() const {
+            return _performance.uploaded_bytes;
+        }
+
         /// push adds an event to the display.
         template <typename Event>
         void push(Event event) {
             while (!_renderer_ready.load(std::memory_order_acquire)) {
             }
             _delta_t_display_renderer->push<Event>(event);
+            request_update();
+        }
+
+        /// push adds a batch of events to the display.
+        template <typename Iterator>
+        void push(Iterator begin, Iterator end) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _delta_t_display_renderer->push<Iterator>(begin, end);
+            request_update();
         }
 
         /// assign sets all the pixels at once.
@@ -529,6 +890,7 @@ namespace chameleon {
             while (!_renderer_ready.load(std::memory_order_acquire)) {
             }
             _delta_t_display_renderer->assign<Iterator>(begin, end);
+            request_update();
         }
 
         /// componentComplete is called when all the qml values are bound.
@@ -536,6 +898,12 @@ namespace chameleon {
             if (_canvas_size.width() <= 0 || _canvas_size.height() <= 0) {
                 throw std::logic_error("canvas_size cannot have a null component, make sure that it is set in qml");
             }
+            if (_lod && _gpu_scatter) {
+                throw std::logic_error("lod cannot be used with gpu_scatter");
+            }
+            if (_tile_size > 0 && _gpu_scatter) {
+                throw std::logic_error("tile_size cannot be used with gpu_scatter");
+            }
             _ready.store(true, std::memory_order_release);
         }
 
@@ -547,14 +915,25 @@ namespace chameleon {
         /// paintAreaChanged notifies a paint area change.
         void paintAreaChanged(QRectF paint_area);
 
+        /// region_changed notifies a change of the displayed region.
+        void region_changed(QRectF region);
+
+        /// colormap_changed notifies a change of the built-in colormap.
+        void colormap_changed(Colormap colormap);
+
+        /// custom_colormap_changed notifies a change of the custom colormap.
+        void custom_colormap_changed(QVariantList custom_colormap);
+
+        /// performance_changed notifies a change of the performance counters.
+        void performance_changed();
+
         public slots:
 
         /// sync adapts the renderer to external changes.
         void sync() {
             if (_ready.load(std::memory_order_relaxed)) {
                 if (!_delta_t_display_renderer) {
-                    _delta_t_display_renderer = std::unique_ptr<delta_t_display_renderer>(new delta_t_display_renderer(
-                        _canvas_size, _discard_ratio, static_cast<std::size_t>(_colormap)));
+                    _delta_t_display_renderer = std::unique_ptr<delta_t_display_renderer>(create_renderer());
                     connect(
                         window(),
                         &QQuickWindow::beforeRendering,
@@ -572,22 +951,46 @@ namespace chameleon {
                     _renderer_ready.store(true, std::memory_order_release);
                     _accessing_renderer.clear(std::memory_order_release);
                 }
+                if (_colormap_changed) {
+                    _colormap_changed = false;
+                    if (_custom_colormap.empty()) {
+                        _delta_t_display_renderer->set_colormap(
+                            colormap_lut::colors(static_cast<std::size_t>(_colormap)));
+                    } else {
+                        std::vector<QColor> colors;
+                        colors.reserve(static_cast<std::size_t>(_custom_colormap.size()));
+                        for (const auto& color : _custom_colormap) {
+                            colors.push_back(color.value<QColor>());
+                        }
+                        _delta_t_display_renderer->set_colormap(std::move(colors));
+                    }
+                }
                 auto clear_area =
                     QRectF(0, 0, width() * window()->devicePixelRatio(), height() * window()->devicePixelRatio());
                 for (auto item = static_cast<QQuickItem*>(this); item; item = item->parentItem()) {
                     clear_area.moveLeft(clear_area.left() + item->x() * window()->devicePixelRatio());
                     clear_area.moveTop(clear_area.top() + item->y() * window()->devicePixelRatio());
                 }
-                if (clear_area != _clear_area) {
+                if (clear_area != _clear_area || _region != _synced_region) {
                     _clear_area = std::move(clear_area);
-                    if (clear_area.width() * _canvas_size.height() > clear_area.height() * _canvas_size.width()) {
-                        _paint_area.setWidth(clear_area.height() * _canvas_size.width() / _canvas_size.height());
+                    _synced_region = _region;
+                    auto visible_width = static_cast<qreal>(_canvas_size.width());
+                    auto visible_height = static_cast<qreal>(_canvas_size.height());
+                    if (!_gpu_scatter) {
+                        _delta_t_display_renderer->set_region(_region);
+                        if (!_region.isEmpty()) {
+                            visible_width = _region.width();
+                            visible_height = _region.height();
+                        }
+                    }
+                    if (clear_area.width() * visible_height > clear_area.height() * visible_width) {
+                        _paint_area.setWidth(clear_area.height() * visible_width / visible_height);
                         _paint_area.setHeight(clear_area.height());
                         _paint_area.moveLeft(clear_area.left() + (clear_area.width() - _paint_area.width()) / 2);
                         _paint_area.moveTop(clear_area.top());
                     } else {
                         _paint_area.setWidth(clear_area.width());
-                        _paint_area.setHeight(clear_area.width() * _canvas_size.height() / _canvas_size.width());
+                        _paint_area.setHeight(clear_area.width() * visible_height / visible_width);
                         _paint_area.moveLeft(clear_area.left());
                         _paint_area.moveTop(clear_area.top() + (clear_area.height() - _paint_area.height()) / 2);
                     }
@@ -599,14 +1002,19 @@ namespace chameleon {
         }
 
         /// cleanup frees the owned renderer.
+        /// Pushes wait for the next renderer, created by sync if the scene graph is initialized again.
         void cleanup() {
+            while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+            }
+            _renderer_ready.store(false, std::memory_order_release);
             _delta_t_display_renderer.reset();
+            _accessing_renderer.clear(std::memory_order_release);
         }
 
         /// trigger_draw requests a window refresh.
         void trigger_draw() {
             if (window()) {
-                window()->update();
+                render_scheduler::of(window())->request_update();
             }
         }
 
@@ -632,20 +1040,70 @@ namespace chameleon {
                     &delta_t_display::cleanup,
                     Qt::DirectConnection);
                 window->setClearBeforeRendering(false);
+                _render_scheduler.store(render_scheduler::of(window), std::memory_order_release);
+            }
+        }
+
+        /// update_performance samples the renderer's counters.
+        /// The renderer lock prevents cleanup from freeing the renderer during the sample.
+        void update_performance() {
+            while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+            }
+            if (_renderer_ready.load(std::memory_order_relaxed)) {
+                const auto performance = _delta_t_display_renderer->sample_performance();
+                _accessing_renderer.clear(std::memory_order_release);
+                if (performance != _performance) {
+                    _performance = performance;
+                    performance_changed();
+                }
+            } else {
+                _accessing_renderer.clear(std::memory_order_release);
             }
         }
 
         protected:
+        /// create_renderer allocates the renderer, with the properties set during qml construction.
+        /// It is called by the render thread, and lets derived displays provide their own renderer.
+        virtual delta_t_display_renderer* create_renderer() {
+            return new delta_t_display_renderer(
+                _canvas_size,
+                _discard_ratio,
+                static_cast<std::size_t>(_calibration_interval),
+                static_cast<std::size_t>(_colormap),
+                _gpu_scatter,
+                _lod,
+                static_cast<std::size_t>(_tile_size));
+        }
+
+        /// request_update schedules a window update, coalesced with the other displays of the window.
+        virtual void request_update() {
+            const auto scheduler = _render_scheduler.load(std::memory_order_acquire);
+            if (scheduler) {
+                scheduler->request_update();
+            }
+        }
+
         std::atomic_bool _ready;
         std::atomic_bool _renderer_ready;
+        std::atomic<render_scheduler*> _render_scheduler;
         std::atomic_flag _accessing_renderer;
         QSize _canvas_size;
         QVector2D _discards;
         QVector2D _discards_to_load;
         float _discard_ratio;
+        int _calibration_interval;
         Colormap _colormap;
+        QVariantList _custom_colormap;
+        bool _colormap_changed;
+        bool _gpu_scatter;
+        bool _lod;
+        int _tile_size;
+        QRectF _region;
+        QRectF _synced_region;
         std::unique_ptr<delta_t_display_renderer> _delta_t_display_renderer;
         QRectF _clear_area;
         QRectF _paint_area;
+        performance_counters _performance;
+        QTimer _performance_timer;
     };
 }
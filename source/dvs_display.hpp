@@ -1,15 +1,31 @@
 #pragma once
 
+#include "bulk_conversion.hpp"
+#include "gl_cache.hpp"
+#include "level_of_detail.hpp"
+#include "pbo_ring.hpp"
+#include "performance_monitor.hpp"
+#include "render_scheduler.hpp"
+#include "snapshot_ring.hpp"
+#include "texel_scatter.hpp"
+#include "tiled_layout.hpp"
 #include <QQmlParserStatus>
+#include <QtCore/QPointer>
+#include <QtCore/QTimer>
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QOpenGLFunctions_3_3_Core>
 #include <QtQuick/QQuickItem>
 #include <QtQuick/qquickwindow.h>
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
+#include <cmath>
 #include <limits>
 #include <memory>
+#include <numeric>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 /// chameleon provides Qt components for event stream display.
@@ -25,32 +41,72 @@ namespace chameleon {
             QColor increase_color,
             QColor idle_color,
             QColor decrease_color,
-            QColor background_color) :
+            QColor background_color,
+            bool double_buffered,
+            bool packed,
+            bool gpu_scatter,
+            std::size_t shards,
+            bool lod,
+            std::size_t tile_size) :
             _canvas_size(canvas_size),
             _decay(decay),
             _increase_color(increase_color),
             _idle_color(idle_color),
             _decrease_color(decrease_color),
             _background_color(background_color),
-            _ts_and_are_increases(_canvas_size.width() * _canvas_size.height() * 2, 1.0f),
+            _double_buffered(double_buffered),
+            _packed(packed),
+            _gpu_scatter(gpu_scatter),
+            _lod(lod),
+            _level_of_detail(_canvas_size),
+            _layout(_canvas_size, tile_size),
+            _ts_and_are_increases(_layout.size() * (_packed ? 1 : 2), 1.0f),
             _current_t(0),
-            _program_setup(false) {
-            for (auto iterator = _ts_and_are_increases.begin(); iterator != _ts_and_are_increases.end();
-                 std::advance(iterator, 2)) {
-                *iterator = -std::numeric_limits<float>::infinity();
+            _rows_per_shard(rows_per_shard(static_cast<std::size_t>(_canvas_size.height()), shards, tile_size)),
+            _shards((_canvas_size.height() + _rows_per_shard - 1) / _rows_per_shard),
+            _rows_to_shards(_canvas_size.height()),
+            _dirty_rows(_canvas_size.height(), 1),
+            _pushed_events(0),
+            _maximum_pending_events(_canvas_size.width() * _canvas_size.height() * 2),
+            _latest_pending_events(_gpu_scatter ? _canvas_size.width() * _canvas_size.height() : 0),
+            _keyframe_interval(0),
+            _next_keyframe_t(std::numeric_limits<uint64_t>::max()),
+            _program_setup(false),
+            _upload_setup(false),
+            _uniforms_changed(true) {
+            if (_gpu_scatter && _layout.tiled()) {
+                throw std::logic_error("tile_size cannot be used with gpu_scatter");
             }
-            _accessing_ts_and_are_increases.clear(std::memory_order_release);
+            if (!_packed) {
+                for (auto iterator = _ts_and_are_increases.begin(); iterator != _ts_and_are_increases.end();
+                     std::advance(iterator, 2)) {
+                    *iterator = -std::numeric_limits<float>::infinity();
+                }
+            }
+            for (auto& shard : _shards) {
+                shard.accessing.clear(std::memory_order_release);
+                shard.current_t = 0;
+                shard.pushed_events = 0;
+            }
+            for (std::size_t y = 0; y < _rows_to_shards.size(); ++y) {
+                _rows_to_shards[y] = static_cast<uint32_t>(y / _rows_per_shard);
+            }
+            _accessing_pending_events.clear(std::memory_order_release);
+            _accessing_keyframes.clear(std::memory_order_release);
         }
         dvs_display_renderer(const dvs_display_renderer&) = delete;
         dvs_display_renderer(dvs_display_renderer&&) = delete;
         dvs_display_renderer& operator=(const dvs_display_renderer&) = delete;
         dvs_display_renderer& operator=(dvs_display_renderer&&) = delete;
         virtual ~dvs_display_renderer() {
-            glDeleteBuffers(1, &_pbo_id);
-            glDeleteTextures(1, &_texture_id);
-            glDeleteBuffers(static_cast<GLsizei>(_vertex_buffers_ids.size()), _vertex_buffers_ids.data());
-            glDeleteVertexArrays(1, &_vertex_array_id);
-            glDeleteProgram(_program_id);
+            if (_upload_setup) {
+                _pbo_ring.release();
+                _performance_monitor.release();
+            }
+            if (_program_setup) {
+                _texel_scatter.release();
+                glDeleteTextures(1, &_texture_id);
+            }
         }
 
         /// set_rendering_area defines the rendering area.
@@ -59,35 +115,335 @@ namespace chameleon {
             _paint_area.moveTop(window_height - _paint_area.top() - _paint_area.height());
         }
 
+        /// set_region defines the part of the canvas which is displayed, an empty region displays the whole canvas.
+        /// Only the texels of the region are uploaded.
+        virtual void set_region(QRectF region) {
+            _region = region;
+        }
+
+        /// set_decay defines the pixel decay, used by the next paint.
+        virtual void set_decay(float decay) {
+            _decay = decay;
+            _uniforms_changed = true;
+        }
+
+        /// set_colors defines the colors used by the next paint.
+        virtual void
+        set_colors(QColor increase_color, QColor idle_color, QColor decrease_color, QColor background_color) {
+            _increase_color = increase_color;
+            _idle_color = idle_color;
+            _decrease_color = decrease_color;
+            _background_color = background_color;
+            _uniforms_changed = true;
+        }
+
+        /// paint_area returns the rendering area set by set_rendering_area, in OpenGL window coordinates.
+        virtual QRectF paint_area() const {
+            return _paint_area;
+        }
+
+        /// canvas_size returns the display coordinates.
+        virtual QSize canvas_size() const {
+            return _canvas_size;
+        }
+
+        /// decay returns the pixel decay.
+        virtual float decay() const {
+            return _decay;
+        }
+
+        /// increase_color returns the color used to represent increasing light.
+        virtual QColor increase_color() const {
+            return _increase_color;
+        }
+
+        /// idle_color returns the color used to represent idle pixels.
+        virtual QColor idle_color() const {
+            return _idle_color;
+        }
+
+        /// decrease_color returns the color used to represent decreasing light.
+        virtual QColor decrease_color() const {
+            return _decrease_color;
+        }
+
+        /// packed returns whether each pixel is stored in a single 32-bits word.
+        virtual bool packed() const {
+            return _packed;
+        }
+
+        /// gpu_scatter returns whether the pixels state is updated by the GPU.
+        virtual bool gpu_scatter() const {
+            return _gpu_scatter;
+        }
+
+        /// tile_size returns the side of the pixels state's tiles, or 0 if the state is row-major.
+        virtual std::size_t tile_size() const {
+            return _layout.tile_size();
+        }
+
+        /// uploaded_bytes returns the number of bytes sent to the GPU during the last frame.
+        virtual std::size_t uploaded_bytes() const {
+            return _performance_monitor.uploaded_bytes();
+        }
+
+        /// sample_performance returns the renderer's counters, with rates measured since the previous call.
+        /// It must always be called by the same thread.
+        virtual performance_counters sample_performance() {
+            return _performance_monitor.sample();
+        }
+
+        /// set_keyframes enables the snapshot ring: the pixels state is stored every interval microseconds, and the
+        /// latest capacity keyframes are kept. It must be called before any event is pushed, and cannot be used with
+        /// GPU scatter since the pixels state then lives in the texture.
+        virtual void set_keyframes(uint64_t interval, std::size_t capacity) {
+            if (_gpu_scatter) {
+                throw std::logic_error("keyframes cannot be used with gpu_scatter");
+            }
+            if (interval == 0) {
+                throw std::logic_error("the keyframe interval must be larger than 0");
+            }
+            _keyframe_interval = interval;
+            _snapshot_ring.reset(
+                new snapshot_ring<uint32_t>(_ts_and_are_increases.data(), _ts_and_are_increases.size(), capacity));
+            _next_keyframe_t.store(interval, std::memory_order_release);
+        }
+
+        /// restore replaces the pixels state with the latest keyframe at or before t, and returns the keyframe's time.
+        /// The events with a timestamp larger than or equal to the returned time must then be pushed again to reach
+        /// t, the number of replayed events is bounded by the keyframe interval. If there is no such keyframe, the
+        /// pixels are reset and 0 is returned. Replayed events only create keyframes past the latest stored one.
+        virtual uint64_t restore(uint64_t t) {
+            if (!_snapshot_ring) {
+                throw std::logic_error("keyframes are not enabled");
+            }
+            _performance_monitor.lock(_accessing_keyframes);
+            lock_shards();
+            if (_double_buffered) {
+                _performance_monitor.lock(_accessing_pending_events);
+                _pending_events.clear();
+                _accessing_pending_events.clear(std::memory_order_release);
+            }
+            const auto keyframe_t = _snapshot_ring->restore(t, _ts_and_are_increases.data());
+            std::fill(_dirty_rows.begin(), _dirty_rows.end(), 1);
+            if (_double_buffered) {
+                _performance_monitor.lock(_accessing_pending_events);
+                _current_t = static_cast<uint32_t>(keyframe_t);
+                _accessing_pending_events.clear(std::memory_order_release);
+            } else {
+                for (auto& shard : _shards) {
+                    shard.current_t = static_cast<uint32_t>(keyframe_t);
+                }
+            }
+            unlock_shards();
+            _next_keyframe_t.store(
+                std::max((keyframe_t / _keyframe_interval + 1) * _keyframe_interval,
+                         _snapshot_ring->latest_t() + _keyframe_interval),
+                std::memory_order_release);
+            _accessing_keyframes.clear(std::memory_order_release);
+            return keyframe_t;
+        }
+
+        /// keyframes_bytes returns the memory used by the compressed keyframes.
+        virtual std::size_t keyframes_bytes() {
+            if (!_snapshot_ring) {
+                return 0;
+            }
+            _performance_monitor.lock(_accessing_keyframes);
+            const auto bytes = _snapshot_ring->compressed_bytes();
+            _accessing_keyframes.clear(std::memory_order_release);
+            return bytes;
+        }
+
         /// push adds an event to the display.
         template <typename Event>
         void push(Event event) {
-            const auto index =
-                (static_cast<std::size_t>(event.x) + static_cast<std::size_t>(event.y) * _canvas_size.width()) * 2;
-            while (_accessing_ts_and_are_increases.test_and_set(std::memory_order_acquire)) {
+            if (static_cast<uint64_t>(event.t) >= _next_keyframe_t.load(std::memory_order_acquire)) {
+                snapshot(static_cast<uint64_t>(event.t));
+            }
+            const auto index = _layout.index(static_cast<std::size_t>(event.x), static_cast<std::size_t>(event.y));
+            if (_double_buffered || _gpu_scatter) {
+                _performance_monitor.lock(_accessing_pending_events);
+                _pending_events.push_back(pending_event{
+                    static_cast<uint32_t>(index), static_cast<uint32_t>(event.t), event.is_increase ? 1u : 0u});
+                _current_t = static_cast<uint32_t>(event.t);
+                ++_pushed_events;
+                const auto flush_required = _pending_events.size() >= _maximum_pending_events;
+                _accessing_pending_events.clear(std::memory_order_release);
+                if (flush_required) {
+                    flush_pending_events();
+                }
+            } else {
+                auto& shard = _shards[static_cast<std::size_t>(event.y) / _rows_per_shard];
+                _performance_monitor.lock(shard.accessing);
+                write(index, static_cast<uint32_t>(event.t), event.is_increase);
+                _dirty_rows[event.y] = 1;
+                shard.current_t = static_cast<uint32_t>(event.t);
+                ++shard.pushed_events;
+                shard.accessing.clear(std::memory_order_release);
+            }
+        }
+
+        /// push adds a batch of events to the display.
+        /// The lock is acquired once per batch rather than once per event. With several shards, the events are first
+        /// grouped by shard in two passes (the iterator must be a forward iterator), and each shard's lock is acquired
+        /// once per batch. With keyframes, the batch is split at keyframe boundaries.
+        template <typename Iterator>
+        void push(Iterator begin, Iterator end) {
+            if (_keyframe_interval == 0) {
+                push_batch(begin, end);
+                return;
+            }
+            while (begin != end) {
+                const auto next_keyframe_t = _next_keyframe_t.load(std::memory_order_acquire);
+                auto keyframe_begin = begin;
+                while (keyframe_begin != end && static_cast<uint64_t>(keyframe_begin->t) < next_keyframe_t) {
+                    ++keyframe_begin;
+                }
+                push_batch(begin, keyframe_begin);
+                if (keyframe_begin != end) {
+                    snapshot(static_cast<uint64_t>(keyframe_begin->t));
+                }
+                begin = keyframe_begin;
             }
-            _ts_and_are_increases[index] = static_cast<uint32_t>(event.t);
-            _ts_and_are_increases[index + 1] = event.is_increase ? 1 : 0;
-            _current_t = static_cast<uint32_t>(event.t);
-            _accessing_ts_and_are_increases.clear(std::memory_order_release);
         }
 
         /// assign sets all the pixels at once.
+        /// Contiguous ranges (pointers and std::vector iterators) are converted with SIMD kernels.
         template <typename Iterator>
         void assign(Iterator begin, Iterator end) {
-            std::size_t index = 0;
-            while (_accessing_ts_and_are_increases.test_and_set(std::memory_order_acquire)) {
+            lock_shards();
+            if (_double_buffered || _gpu_scatter) {
+                _performance_monitor.lock(_accessing_pending_events);
+                _pending_events.clear();
+                _accessing_pending_events.clear(std::memory_order_release);
             }
-            for (; begin != end; ++begin) {
-                _ts_and_are_increases[index] = static_cast<uint32_t>(begin->t);
-                ++index;
-                _ts_and_are_increases[index] = begin->is_increase ? 1 : 0;
-                ++index;
-                if (static_cast<uint32_t>(begin->t) > _current_t) {
-                    _current_t = static_cast<uint32_t>(begin->t);
+            const auto maximum_t = assign(
+                begin, end, std::integral_constant<bool, is_contiguous_iterator<Iterator>::value>());
+            std::fill(_dirty_rows.begin(), _dirty_rows.end(), 1);
+            if (_double_buffered || _gpu_scatter) {
+                _performance_monitor.lock(_accessing_pending_events);
+                if (maximum_t > _current_t) {
+                    _current_t = maximum_t;
                 }
+                _accessing_pending_events.clear(std::memory_order_release);
+            } else if (maximum_t > _shards.front().current_t) {
+                _shards.front().current_t = maximum_t;
             }
-            _accessing_ts_and_are_increases.clear(std::memory_order_release);
+            unlock_shards();
+        }
+
+        /// upload copies the pixels modified since the last upload to the bound texture, and returns the current
+        /// timestamp.
+        /// The target is either GL_TEXTURE_RECTANGLE (the renderer's own texture) or GL_TEXTURE_2D_ARRAY, in which
+        /// case the pixels are written to the given layer. The texture must match the level of detail's size (the
+        /// canvas size unless a region or lod is used) and the packed format. It must be called by the render thread,
+        /// paint calls it, display groups call it instead of paint.
+        virtual uint32_t upload(GLenum target, GLint layer) {
+            if (!initializeOpenGLFunctions()) {
+                throw std::runtime_error("initializing the OpenGL context failed");
+            }
+            setup_upload();
+            uint32_t current_t = 0;
+            const auto texture_size = _level_of_detail.size();
+            const auto row_size = static_cast<std::size_t>(texture_size.width()) * (_packed ? 1 : 2);
+            {
+                const auto copy_begin = std::chrono::steady_clock::now();
+                auto buffer = reinterpret_cast<uint32_t*>(_pbo_ring.map());
+                lock_shards();
+                std::size_t pushed_events = 0;
+                for (auto& shard : _shards) {
+                    pushed_events += shard.pushed_events;
+                    shard.pushed_events = 0;
+                }
+                if (_double_buffered || _gpu_scatter) {
+                    _performance_monitor.lock(_accessing_pending_events);
+                    _painted_events.swap(_pending_events);
+                    current_t = _current_t;
+                    pushed_events += _pushed_events;
+                    _pushed_events = 0;
+                    _accessing_pending_events.clear(std::memory_order_release);
+                    if (!_gpu_scatter) {
+                        apply(_painted_events);
+                        _painted_events.clear();
+                    }
+                } else {
+                    // timestamps are compared with the wraparound, and idle shards are brought up to date so that they
+                    // never lag more than a frame behind the active ones
+                    current_t = _shards.front().current_t;
+                    for (const auto& shard : _shards) {
+                        if (static_cast<int32_t>(shard.current_t - current_t) > 0) {
+                            current_t = shard.current_t;
+                        }
+                    }
+                    for (auto& shard : _shards) {
+                        shard.current_t = current_t;
+                    }
+                }
+                collect_dirty_rows();
+                _level_of_detail.texture_rows(_dirty_rows_ranges, _texture_rows_ranges);
+                for (const auto& rows : _texture_rows_ranges) {
+                    if (_level_of_detail.identity()) {
+                        _level_of_detail.copy(
+                            _layout, _ts_and_are_increases.data(), buffer, _packed ? 1 : 2, rows.first, rows.second);
+                    } else {
+                        reduce(buffer, rows.first, rows.second, current_t);
+                    }
+                }
+                unlock_shards();
+                _performance_monitor.add_events(pushed_events);
+                _performance_monitor.set_copy_duration(std::chrono::steady_clock::now() - copy_begin);
+            }
+            {
+                const auto offset = _pbo_ring.unmap();
+                std::size_t uploaded_bytes = 0;
+                for (const auto& rows : _texture_rows_ranges) {
+                    const auto rows_offset = reinterpret_cast<const GLvoid*>(
+                        offset + rows.first * row_size * sizeof(decltype(_ts_and_are_increases)::value_type));
+                    if (target == GL_TEXTURE_2D_ARRAY) {
+                        glTexSubImage3D(
+                            GL_TEXTURE_2D_ARRAY,
+                            0,
+                            0,
+                            static_cast<GLint>(rows.first),
+                            layer,
+                            texture_size.width(),
+                            static_cast<GLsizei>(rows.second - rows.first),
+                            1,
+                            _packed ? GL_RED_INTEGER : GL_RG_INTEGER,
+                            GL_UNSIGNED_INT,
+                            rows_offset);
+                    } else {
+                        glTexSubImage2D(
+                            target,
+                            0,
+                            0,
+                            static_cast<GLint>(rows.first),
+                            texture_size.width(),
+                            static_cast<GLsizei>(rows.second - rows.first),
+                            _packed ? GL_RED_INTEGER : GL_RG_INTEGER,
+                            GL_UNSIGNED_INT,
+                            rows_offset);
+                    }
+                    uploaded_bytes +=
+                        (rows.second - rows.first) * row_size * sizeof(decltype(_ts_and_are_increases)::value_type);
+                }
+                _pbo_ring.fence();
+                if (_gpu_scatter && !_painted_events.empty()) {
+                    uploaded_bytes += _texel_scatter.draw(_painted_events.data(), _painted_events.size());
+                    _painted_events.clear();
+                    glUseProgram(_program_id);
+                }
+                _performance_monitor.set_uploaded_bytes(uploaded_bytes);
+            }
+            return current_t;
+        }
+
+        /// invalidate marks all the pixels as modified, so that the next upload sends the whole canvas.
+        virtual void invalidate() {
+            lock_shards();
+            std::fill(_dirty_rows.begin(), _dirty_rows.end(), 1);
+            unlock_shards();
         }
 
         public slots:
@@ -100,151 +456,112 @@ namespace chameleon {
             if (!_program_setup) {
                 _program_setup = true;
 
-                // compile the vertex shader
-                const auto vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-                {
-                    const std::string vertex_shader(R""(
-                        #version 330 core
-                        in vec2 coordinates;
-                        out vec2 uv;
-                        uniform float width;
-                        uniform float height;
-                        void main() {
-                            gl_Position = vec4(coordinates, 0.0, 1.0);
-                            uv = vec2((coordinates.x + 1) / 2 * width, (coordinates.y + 1) / 2 * height);
-                        }
-                    )"");
-                    auto vertex_shader_content = vertex_shader.c_str();
-                    auto vertex_shader_size = vertex_shader.size();
-                    glShaderSource(
-                        vertex_shader_id,
-                        1,
-                        static_cast<const GLchar**>(&vertex_shader_content),
-                        reinterpret_cast<const GLint*>(&vertex_shader_size));
-                }
-                glCompileShader(vertex_shader_id);
-                check_shader_error(vertex_shader_id);
-
-                // compile the fragment shader
-                const auto fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-                {
-                    const std::string fragment_shader(R""(
-                        #version 330 core
-                        in vec2 uv;
-                        out vec4 color;
-                        uniform float decay;
-                        uniform uint current_t;
-                        uniform vec4 increase_color;
-                        uniform vec4 idle_color;
-                        uniform vec4 decrease_color;
-                        uniform usampler2DRect sampler;
-                        void main() {
-                            uvec2 t_and_is_increase = texture(sampler, uv).xy;
-                            float lambda = exp(-float(current_t - t_and_is_increase.x) / decay);
-                            color = lambda * (t_and_is_increase.y == 1u ? increase_color : decrease_color) + (1.0 - lambda) * idle_color;
-                        }
-                    )"");
-                    auto fragment_shader_content = fragment_shader.c_str();
-                    auto fragment_shader_size = fragment_shader.size();
-                    glShaderSource(
-                        fragment_shader_id,
-                        1,
-                        static_cast<const GLchar**>(&fragment_shader_content),
-                        reinterpret_cast<const GLint*>(&fragment_shader_size));
-                }
-                glCompileShader(fragment_shader_id);
-                check_shader_error(fragment_shader_id);
-
-                // create the shaders pipeline
-                _program_id = glCreateProgram();
-                glAttachShader(_program_id, vertex_shader_id);
-                glAttachShader(_program_id, fragment_shader_id);
-                glLinkProgram(_program_id);
-                glDeleteShader(vertex_shader_id);
-                glDeleteShader(fragment_shader_id);
+                // get the program and the quad geometry, shared with the other displays of the context
+                const std::string vertex_shader(R""(
+                    #version 330 core
+                    in vec2 coordinates;
+                    out vec2 uv;
+                    uniform float width;
+                    uniform float height;
+                    void main() {
+                        gl_Position = vec4(coordinates, 0.0, 1.0);
+                        uv = vec2((coordinates.x + 1) / 2 * width, (coordinates.y + 1) / 2 * height);
+                    }
+                )"");
+                const std::string fragment_shader(
+                    std::string("#version 330 core\n") + (_packed ? "#define PACKED\n" : "") + R""(
+                    in vec2 uv;
+                    out vec4 color;
+                    uniform float decay;
+                    uniform uint current_t;
+                    uniform vec4 increase_color;
+                    uniform vec4 idle_color;
+                    uniform vec4 decrease_color;
+                    uniform usampler2DRect sampler;
+                    void main() {
+                    #ifdef PACKED
+                        uint t_and_is_increase = texture(sampler, uv).x;
+                        float lambda = exp(-float((current_t - (t_and_is_increase >> 1u)) & 0x7fffffffu) / decay);
+                        bool is_increase = (t_and_is_increase & 1u) == 1u;
+                    #else
+                        uvec2 t_and_is_increase = texture(sampler, uv).xy;
+                        float lambda = exp(-float(current_t - t_and_is_increase.x) / decay);
+                        bool is_increase = t_and_is_increase.y == 1u;
+                    #endif
+                        color = lambda * (is_increase ? increase_color : decrease_color) + (1.0 - lambda) * idle_color;
+                    }
+                )"");
+                _gl_cache = &gl_cache::current();
+                _program_id = _gl_cache->program(vertex_shader, fragment_shader);
+                _vertex_array_id = _gl_cache->quad_vertex_array();
                 glUseProgram(_program_id);
-                check_program_error(_program_id);
-
-                // create the vertex array object
-                glGenVertexArrays(1, &_vertex_array_id);
-                glBindVertexArray(_vertex_array_id);
-                glGenBuffers(static_cast<GLsizei>(_vertex_buffers_ids.size()), _vertex_buffers_ids.data());
-                {
-                    glBindBuffer(GL_ARRAY_BUFFER, std::get<0>(_vertex_buffers_ids));
-                    std::array<float, 8> coordinates{-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f};
-                    glBufferData(
-                        GL_ARRAY_BUFFER,
-                        coordinates.size() * sizeof(decltype(coordinates)::value_type),
-                        coordinates.data(),
-                        GL_STATIC_DRAW);
-                    glEnableVertexAttribArray(glGetAttribLocation(_program_id, "coordinates"));
-                    glVertexAttribPointer(glGetAttribLocation(_program_id, "coordinates"), 2, GL_FLOAT, GL_FALSE, 0, 0);
-                }
-                {
-                    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, std::get<1>(_vertex_buffers_ids));
-                    std::array<GLuint, 4> indices{0, 1, 2, 3};
-                    glBufferData(
-                        GL_ELEMENT_ARRAY_BUFFER,
-                        indices.size() * sizeof(decltype(indices)::value_type),
-                        indices.data(),
-                        GL_STATIC_DRAW);
+
+                // retrieve the uniform locations
+                _width_location = glGetUniformLocation(_program_id, "width");
+                _height_location = glGetUniformLocation(_program_id, "height");
+                _decay_location = glGetUniformLocation(_program_id, "decay");
+                _current_t_location = glGetUniformLocation(_program_id, "current_t");
+                _increase_color_location = glGetUniformLocation(_program_id, "increase_color");
+                _idle_color_location = glGetUniformLocation(_program_id, "idle_color");
+                _decrease_color_location = glGetUniformLocation(_program_id, "decrease_color");
+
+                // create the texture
+                glGenTextures(1, &_texture_id);
+                allocate_texture();
+
+                // create the scatter framebuffer
+                if (_gpu_scatter) {
+                    _texel_scatter.initialize(
+                        this,
+                        _texture_id,
+                        _canvas_size,
+                        sizeof(pending_event),
+                        2,
+                        _packed ? "uvec4((value.x << 1u) | value.y, 0u, 0u, 0u)" : "uvec4(value, 0u, 0u)");
+                    glUseProgram(_program_id);
                 }
-                glBindVertexArray(0);
+            }
+
+            // adapt the texture to the region and the paint area, the scatter pass requires the whole canvas
+            if (!_gpu_scatter
+                && _level_of_detail.update(
+                    _region,
+                    static_cast<std::size_t>(std::ceil(_paint_area.width())),
+                    static_cast<std::size_t>(std::ceil(_paint_area.height())),
+                    _lod)) {
+                allocate_texture();
+                invalidate();
+            }
 
-                // set the uniform values
-                glUniform1f(glGetUniformLocation(_program_id, "width"), static_cast<GLfloat>(_canvas_size.width()));
-                glUniform1f(glGetUniformLocation(_program_id, "height"), static_cast<GLfloat>(_canvas_size.height()));
-                glUniform1f(glGetUniformLocation(_program_id, "decay"), static_cast<GLfloat>(_decay));
+            // send data to the GPU
+            setup_upload();
+            _performance_monitor.begin_gpu();
+            glUseProgram(_program_id);
+            const auto texture_size = _level_of_detail.size();
+            glUniform1f(_width_location, static_cast<GLfloat>(texture_size.width()));
+            glUniform1f(_height_location, static_cast<GLfloat>(texture_size.height()));
+            if (_gl_cache->claim_uniforms(_program_id, this) || _uniforms_changed) {
+                _uniforms_changed = false;
+                glUniform1f(_decay_location, static_cast<GLfloat>(_decay));
                 glUniform4f(
-                    glGetUniformLocation(_program_id, "increase_color"),
+                    _increase_color_location,
                     static_cast<GLfloat>(_increase_color.redF()),
                     static_cast<GLfloat>(_increase_color.greenF()),
                     static_cast<GLfloat>(_increase_color.blueF()),
                     static_cast<GLfloat>(_increase_color.alphaF()));
                 glUniform4f(
-                    glGetUniformLocation(_program_id, "idle_color"),
+                    _idle_color_location,
                     static_cast<GLfloat>(_idle_color.redF()),
                     static_cast<GLfloat>(_idle_color.greenF()),
                     static_cast<GLfloat>(_idle_color.blueF()),
                     static_cast<GLfloat>(_idle_color.alphaF()));
                 glUniform4f(
-                    glGetUniformLocation(_program_id, "decrease_color"),
+                    _decrease_color_location,
                     static_cast<GLfloat>(_decrease_color.redF()),
                     static_cast<GLfloat>(_decrease_color.greenF()),
                     static_cast<GLfloat>(_decrease_color.blueF()),
                     static_cast<GLfloat>(_decrease_color.alphaF()));
-                _current_t_location = glGetUniformLocation(_program_id, "current_t");
-
-                // create the texture
-                glGenTextures(1, &_texture_id);
-                glBindTexture(GL_TEXTURE_RECTANGLE, _texture_id);
-                glTexImage2D(
-                    GL_TEXTURE_RECTANGLE,
-                    0,
-                    GL_RG32UI,
-                    _canvas_size.width(),
-                    _canvas_size.height(),
-                    0,
-                    GL_RG_INTEGER,
-                    GL_UNSIGNED_INT,
-                    nullptr);
-                glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-                glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-                glBindTexture(GL_TEXTURE_RECTANGLE, 0);
-
-                // create the pbo
-                glGenBuffers(1, &_pbo_id);
-                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo_id);
-                glBufferData(
-                    GL_PIXEL_UNPACK_BUFFER,
-                    _ts_and_are_increases.size() * sizeof(decltype(_ts_and_are_increases)::value_type),
-                    nullptr,
-                    GL_DYNAMIC_DRAW);
-                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
             }
-
-            // send data to the GPU
-            glUseProgram(_program_id);
             glViewport(
                 static_cast<GLint>(_paint_area.left()),
                 static_cast<GLint>(_paint_area.top()),
@@ -253,39 +570,391 @@ namespace chameleon {
             glEnable(GL_BLEND);
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
             glBindTexture(GL_TEXTURE_RECTANGLE, _texture_id);
-            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo_id);
-            glTexSubImage2D(
-                GL_TEXTURE_RECTANGLE,
-                0,
-                0,
-                0,
-                _canvas_size.width(),
-                _canvas_size.height(),
-                GL_RG_INTEGER,
-                GL_UNSIGNED_INT,
-                0);
-            {
-                auto buffer = reinterpret_cast<uint32_t*>(glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY));
-                if (!buffer) {
-                    throw std::logic_error("glMapBuffer returned an null pointer");
-                }
-                while (_accessing_ts_and_are_increases.test_and_set(std::memory_order_acquire)) {
-                }
-                glUniform1ui(_current_t_location, _current_t);
-                std::copy(_ts_and_are_increases.begin(), _ts_and_are_increases.end(), buffer);
-                _accessing_ts_and_are_increases.clear(std::memory_order_release);
-                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
-            }
+            glUniform1ui(_current_t_location, upload(GL_TEXTURE_RECTANGLE, 0));
             glBindVertexArray(_vertex_array_id);
             glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, 0);
             glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
             glBindTexture(GL_TEXTURE_RECTANGLE, 0);
             glBindVertexArray(0);
             glUseProgram(0);
+            _performance_monitor.end_gpu();
             check_opengl_error();
         }
 
         protected:
+        /// shard protects a band of rows, so that producers writing to different bands do not contend.
+        /// It is padded to two cache lines: the shards are stored in a std::vector, whose storage is not aligned to
+        /// cache lines, and a 128 bytes stride guarantees that the fields of neighbouring shards never share a line.
+        struct shard {
+            std::atomic_flag accessing;
+            uint32_t current_t;
+            uint32_t pushed_events;
+            uint8_t padding[128 - 3 * sizeof(uint32_t)];
+        };
+
+        /// sharded_event is an event being grouped by shard.
+        struct sharded_event {
+            uint32_t index;
+            uint32_t t;
+            uint16_t y;
+            bool is_increase;
+        };
+
+        /// lock_shards acquires the locks of all the shards, in order.
+        virtual void lock_shards() {
+            for (auto& shard : _shards) {
+                _performance_monitor.lock(shard.accessing);
+            }
+        }
+
+        /// unlock_shards releases the locks of all the shards.
+        virtual void unlock_shards() {
+            for (auto& shard : _shards) {
+                shard.accessing.clear(std::memory_order_release);
+            }
+        }
+
+        /// pending_event is an event waiting to be written to the pixels state by the render thread.
+        struct pending_event {
+            uint32_t index;
+            uint32_t t;
+            uint32_t is_increase;
+        };
+
+        /// write sets the state of the pixel at the given index.
+        /// In packed mode, the timestamp's 31 least significant bits and the polarity share a single word, and the
+        /// shader computes ages modulo 2^31.
+        /// the shards must be locked by the caller.
+        void write(std::size_t index, uint32_t t, bool is_increase) {
+            if (_packed) {
+                _ts_and_are_increases[index] = (t << 1) | (is_increase ? 1u : 0u);
+            } else {
+                _ts_and_are_increases[index * 2] = t;
+                _ts_and_are_increases[index * 2 + 1] = is_increase ? 1 : 0;
+            }
+        }
+
+        /// assign writes the pixels of a contiguous range, and returns the largest timestamp.
+        /// the shards must be locked by the caller.
+        /// A tiled state is converted one row at a time, then each row is scattered to its tiles.
+        template <typename Iterator>
+        uint32_t assign(Iterator begin, Iterator end, std::true_type) {
+            if (begin == end) {
+                return 0;
+            }
+            const auto count = std::min(
+                static_cast<std::size_t>(std::distance(begin, end)),
+                static_cast<std::size_t>(_canvas_size.width()) * _canvas_size.height());
+            if (!_layout.tiled()) {
+                return bulk_conversion::to_timestamps_and_polarities(
+                    make_strided_field(begin, begin->t),
+                    make_strided_field(begin, begin->is_increase),
+                    count,
+                    _packed,
+                    _ts_and_are_increases.data());
+            }
+            const auto width = static_cast<std::size_t>(_canvas_size.width());
+            const std::size_t channels = _packed ? 1 : 2;
+            _assigned_row.resize(width * channels);
+            uint32_t maximum_t = 0;
+            for (std::size_t y = 0; y * width < count; ++y) {
+                const auto row_begin = std::next(begin, static_cast<std::ptrdiff_t>(y * width));
+                const auto row_count = std::min(width, count - y * width);
+                if (row_count < width) {
+                    _layout.copy_row(_ts_and_are_increases.data(), _assigned_row.data(), channels, y, 0, width);
+                }
+                maximum_t = std::max(
+                    maximum_t,
+                    bulk_conversion::to_timestamps_and_polarities(
+                        make_strided_field(row_begin, row_begin->t),
+                        make_strided_field(row_begin, row_begin->is_increase),
+                        row_count,
+                        _packed,
+                        _assigned_row.data()));
+                _layout.assign_row(_assigned_row.data(), _ts_and_are_increases.data(), channels, y);
+            }
+            return maximum_t;
+        }
+
+        /// assign writes the pixels of a generic range, and returns the largest timestamp.
+        /// the shards must be locked by the caller.
+        template <typename Iterator>
+        uint32_t assign(Iterator begin, Iterator end, std::false_type) {
+            const auto width = static_cast<std::size_t>(_canvas_size.width());
+            std::size_t x = 0;
+            std::size_t y = 0;
+            uint32_t maximum_t = 0;
+            for (; begin != end; ++begin) {
+                write(_layout.index(x, y), static_cast<uint32_t>(begin->t), begin->is_increase);
+                ++x;
+                if (x == width) {
+                    x = 0;
+                    ++y;
+                }
+                if (static_cast<uint32_t>(begin->t) > maximum_t) {
+                    maximum_t = static_cast<uint32_t>(begin->t);
+                }
+            }
+            return maximum_t;
+        }
+
+        /// apply writes the given events to the pixels state.
+        /// the shards must be locked by the caller.
+        virtual void apply(const std::vector<pending_event>& events) {
+            for (const auto& event : events) {
+                write(event.index, event.t, event.is_increase == 1);
+                _dirty_rows[_layout.y(event.index)] = 1;
+            }
+        }
+
+        /// reduce writes the texture rows [begin, end) with max-time pooling: each texel takes the state of the most
+        /// recently updated pixel of its block, so that sparse activity remains visible when the canvas is shrunk.
+        /// Pixels are compared by age relative to current_t, with the shader's wraparound (modulo 2^31 when packed,
+        /// 2^32 otherwise), so that the pooling remains correct once the timestamps wrap.
+        /// the shards must be locked by the caller.
+        virtual void reduce(uint32_t* buffer, std::size_t begin, std::size_t end, uint32_t current_t) {
+            const auto state = _ts_and_are_increases.data();
+            if (_packed) {
+                _level_of_detail.reduce(
+                    begin,
+                    end,
+                    [&](std::size_t index,
+                        std::size_t x_begin,
+                        std::size_t x_end,
+                        std::size_t y_begin,
+                        std::size_t y_end) {
+                        uint32_t latest = state[_layout.index(x_begin, y_begin)];
+                        uint32_t latest_age = (current_t - (latest >> 1)) & 0x7fffffffu;
+                        for (auto y = y_begin; y < y_end; ++y) {
+                            for (auto x = x_begin; x < x_end; ++x) {
+                                const auto t_and_is_increase = state[_layout.index(x, y)];
+                                const auto age = (current_t - (t_and_is_increase >> 1)) & 0x7fffffffu;
+                                if (age < latest_age) {
+                                    latest = t_and_is_increase;
+                                    latest_age = age;
+                                }
+                            }
+                        }
+                        buffer[index] = latest;
+                    });
+            } else {
+                _level_of_detail.reduce(
+                    begin,
+                    end,
+                    [&](std::size_t index,
+                        std::size_t x_begin,
+                        std::size_t x_end,
+                        std::size_t y_begin,
+                        std::size_t y_end) {
+                        auto latest = state + _layout.index(x_begin, y_begin) * 2;
+                        uint32_t latest_age = current_t - latest[0];
+                        for (auto y = y_begin; y < y_end; ++y) {
+                            for (auto x = x_begin; x < x_end; ++x) {
+                                const auto t_and_is_increase = state + _layout.index(x, y) * 2;
+                                const auto age = current_t - t_and_is_increase[0];
+                                if (age < latest_age) {
+                                    latest = t_and_is_increase;
+                                    latest_age = age;
+                                }
+                            }
+                        }
+                        buffer[index * 2] = latest[0];
+                        buffer[index * 2 + 1] = latest[1];
+                    });
+            }
+        }
+
+        /// allocate_texture sizes the texture to the level of detail, the previous content is lost.
+        virtual void allocate_texture() {
+            const auto texture_size = _level_of_detail.size();
+            glBindTexture(GL_TEXTURE_RECTANGLE, _texture_id);
+            glTexImage2D(
+                GL_TEXTURE_RECTANGLE,
+                0,
+                _packed ? GL_R32UI : GL_RG32UI,
+                texture_size.width(),
+                texture_size.height(),
+                0,
+                _packed ? GL_RED_INTEGER : GL_RG_INTEGER,
+                GL_UNSIGNED_INT,
+                nullptr);
+            glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+        }
+
+        /// collect_dirty_rows lists the ranges of rows modified since the last frame, and resets the dirty flags.
+        /// A single range spanning the whole canvas is used if most rows are dirty.
+        /// the shards must be locked by the caller.
+        virtual void collect_dirty_rows() {
+            _dirty_rows_ranges.clear();
+            const auto dirty_rows = static_cast<std::size_t>(std::count(_dirty_rows.begin(), _dirty_rows.end(), 1));
+            if (dirty_rows * 2 > _dirty_rows.size()) {
+                _dirty_rows_ranges.emplace_back(0, _dirty_rows.size());
+            } else if (dirty_rows > 0) {
+                for (std::size_t y = 0; y < _dirty_rows.size(); ++y) {
+                    if (_dirty_rows[y] == 1) {
+                        auto end = y + 1;
+                        while (end < _dirty_rows.size() && _dirty_rows[end] == 1) {
+                            ++end;
+                        }
+                        _dirty_rows_ranges.emplace_back(y, end);
+                        y = end;
+                    }
+                }
+            }
+            std::fill(_dirty_rows.begin(), _dirty_rows.end(), 0);
+        }
+
+        /// compact_pending_events removes the pending events overwritten by a later event at the same pixel.
+        /// _accessing_pending_events must be locked by the caller.
+        virtual void compact_pending_events() {
+            for (std::size_t position = 0; position < _pending_events.size(); ++position) {
+                _latest_pending_events[_pending_events[position].index] = static_cast<uint32_t>(position);
+            }
+            std::size_t size = 0;
+            for (std::size_t position = 0; position < _pending_events.size(); ++position) {
+                if (_latest_pending_events[_pending_events[position].index] == position) {
+                    _pending_events[size] = _pending_events[position];
+                    ++size;
+                }
+            }
+            _pending_events.resize(size);
+        }
+
+        /// rows_per_shard returns the height of the shards' row bands.
+        /// With a tiled state, the bands are made of whole tile rows, so that producers of different shards never
+        /// write to the same tile.
+        static std::size_t rows_per_shard(std::size_t height, std::size_t shards, std::size_t tile_size) {
+            const auto rows = (height + shards - 1) / shards;
+            if (tile_size == 0) {
+                return rows;
+            }
+            return (rows + tile_size - 1) / tile_size * tile_size;
+        }
+
+        /// flush_pending_events writes the pending events to the pixels state from the calling thread.
+        /// It is used by producers to bound the memory used by pending events when the render thread falls behind.
+        /// With GPU scatter, the pixels state lives in the texture, and the pending events are compacted instead.
+        virtual void flush_pending_events() {
+            if (_gpu_scatter) {
+                _performance_monitor.lock(_accessing_pending_events);
+                compact_pending_events();
+                _accessing_pending_events.clear(std::memory_order_release);
+                return;
+            }
+            lock_shards();
+            _performance_monitor.lock(_accessing_pending_events);
+            apply(_pending_events);
+            _pending_events.clear();
+            _accessing_pending_events.clear(std::memory_order_release);
+            unlock_shards();
+        }
+
+        /// push_batch adds a batch of events without keyframes checks.
+        template <typename Iterator>
+        void push_batch(Iterator begin, Iterator end) {
+            if (begin == end) {
+                return;
+            }
+            if (_double_buffered || _gpu_scatter) {
+                _performance_monitor.lock(_accessing_pending_events);
+                const auto previous_size = _pending_events.size();
+                for (; begin != end; ++begin) {
+                    _pending_events.push_back(pending_event{
+                        static_cast<uint32_t>(
+                            _layout.index(static_cast<std::size_t>(begin->x), static_cast<std::size_t>(begin->y))),
+                        static_cast<uint32_t>(begin->t),
+                        begin->is_increase ? 1u : 0u});
+                    _current_t = static_cast<uint32_t>(begin->t);
+                }
+                _pushed_events += _pending_events.size() - previous_size;
+                const auto flush_required = _pending_events.size() >= _maximum_pending_events;
+                _accessing_pending_events.clear(std::memory_order_release);
+                if (flush_required) {
+                    flush_pending_events();
+                }
+            } else if (_shards.size() > 1) {
+                static thread_local std::vector<sharded_event> thread_grouped_events;
+                static thread_local std::vector<std::size_t> thread_offsets;
+                auto& grouped_events = thread_grouped_events;
+                auto& offsets = thread_offsets;
+                offsets.assign(_shards.size() + 1, 0);
+                for (auto iterator = begin; iterator != end; ++iterator) {
+                    ++offsets[_rows_to_shards[iterator->y] + 1];
+                }
+                std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+                grouped_events.resize(offsets.back());
+                for (; begin != end; ++begin) {
+                    grouped_events[offsets[_rows_to_shards[begin->y]]++] = sharded_event{
+                        static_cast<uint32_t>(
+                            _layout.index(static_cast<std::size_t>(begin->x), static_cast<std::size_t>(begin->y))),
+                        static_cast<uint32_t>(begin->t),
+                        static_cast<uint16_t>(begin->y),
+                        begin->is_increase};
+                }
+                std::size_t shard_begin = 0;
+                for (std::size_t index = 0; index < _shards.size(); ++index) {
+                    const auto shard_end = offsets[index];
+                    if (shard_begin < shard_end) {
+                        auto& shard = _shards[index];
+                        _performance_monitor.lock(shard.accessing);
+                        for (auto position = shard_begin; position < shard_end; ++position) {
+                            const auto& event = grouped_events[position];
+                            write(event.index, event.t, event.is_increase);
+                            _dirty_rows[event.y] = 1;
+                        }
+                        shard.current_t = grouped_events[shard_end - 1].t;
+                        shard.pushed_events += static_cast<uint32_t>(shard_end - shard_begin);
+                        shard.accessing.clear(std::memory_order_release);
+                    }
+                    shard_begin = shard_end;
+                }
+            } else {
+                auto& shard = _shards.front();
+                _performance_monitor.lock(shard.accessing);
+                for (; begin != end; ++begin) {
+                    write(
+                        _layout.index(static_cast<std::size_t>(begin->x), static_cast<std::size_t>(begin->y)),
+                        static_cast<uint32_t>(begin->t),
+                        begin->is_increase);
+                    _dirty_rows[begin->y] = 1;
+                    shard.current_t = static_cast<uint32_t>(begin->t);
+                    ++shard.pushed_events;
+                }
+                shard.accessing.clear(std::memory_order_release);
+            }
+        }
+
+        /// snapshot stores a keyframe for the interval boundary at or before t, unless another producer already did.
+        virtual void snapshot(uint64_t t) {
+            _performance_monitor.lock(_accessing_keyframes);
+            if (t >= _next_keyframe_t.load(std::memory_order_acquire)) {
+                const auto keyframe_t = t / _keyframe_interval * _keyframe_interval;
+                lock_shards();
+                if (_double_buffered) {
+                    _performance_monitor.lock(_accessing_pending_events);
+                    apply(_pending_events);
+                    _pending_events.clear();
+                    _accessing_pending_events.clear(std::memory_order_release);
+                }
+                _snapshot_ring->insert(keyframe_t, _ts_and_are_increases.data());
+                unlock_shards();
+                _next_keyframe_t.store(keyframe_t + _keyframe_interval, std::memory_order_release);
+            }
+            _accessing_keyframes.clear(std::memory_order_release);
+        }
+
+        /// setup_upload creates the pbos and the timer queries on first use.
+        virtual void setup_upload() {
+            if (!_upload_setup) {
+                _upload_setup = true;
+                _pbo_ring.initialize(
+                    this, _ts_and_are_increases.size() * sizeof(decltype(_ts_and_are_increases)::value_type));
+                _performance_monitor.initialize(this);
+            }
+        }
+
         /// check_opengl_error throws if openGL generated an error.
         virtual void check_opengl_error() {
             switch (glGetError()) {
@@ -302,50 +971,71 @@ namespace chameleon {
             }
         }
 
-        /// check_shader_error checks for shader compilation errors.
-        virtual void check_shader_error(GLuint shader_id) {
-            GLint status = 0;
-            glGetShaderiv(shader_id, GL_COMPILE_STATUS, &status);
-
-            if (status != GL_TRUE) {
-                GLint message_length = 0;
-                glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &message_length);
-                auto error_message = std::vector<char>(message_length);
-                glGetShaderInfoLog(shader_id, message_length, nullptr, error_message.data());
-                throw std::logic_error("Shader error: " + std::string(error_message.data()));
-            }
-        }
-
-        /// check_program_error checks for program errors.
-        virtual void check_program_error(GLuint program_id) {
-            GLint status = 0;
-            glGetProgramiv(program_id, GL_LINK_STATUS, &status);
-            if (status != GL_TRUE) {
-                GLint message_length = 0;
-                glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &message_length);
-                std::vector<char> error_message(message_length);
-                glGetShaderInfoLog(program_id, message_length, nullptr, error_message.data());
-                throw std::logic_error("program error: " + std::string(error_message.data()));
-            }
-        }
-
         QSize _canvas_size;
         float _decay;
         QColor _increase_color;
         QColor _idle_color;
         QColor _decrease_color;
         QColor _background_color;
+        bool _double_buffered;
+        bool _packed;
+        bool _gpu_scatter;
+        bool _lod;
+        level_of_detail _level_of_detail;
+        QRectF _region;
+        tiled_layout _layout;
         std::vector<uint32_t> _ts_and_are_increases;
+        std::vector<uint32_t> _assigned_row;
         uint32_t _current_t;
-        std::atomic_flag _accessing_ts_and_are_increases;
+        std::size_t _rows_per_shard;
+        std::vector<shard> _shards;
+        std::vector<uint32_t> _rows_to_shards;
+        std::vector<uint8_t> _dirty_rows;
+        std::vector<std::pair<std::size_t, std::size_t>> _dirty_rows_ranges;
+        std::vector<std::pair<std::size_t, std::size_t>> _texture_rows_ranges;
+        std::vector<pending_event> _pending_events;
+        std::size_t _pushed_events;
+        std::vector<pending_event> _painted_events;
+        std::size_t _maximum_pending_events;
+        std::vector<uint32_t> _latest_pending_events;
+        std::atomic_flag _accessing_pending_events;
+        std::unique_ptr<snapshot_ring<uint32_t>> _snapshot_ring;
+        uint64_t _keyframe_interval;
+        std::atomic<uint64_t> _next_keyframe_t;
+        std::atomic_flag _accessing_keyframes;
         QRectF _paint_area;
         bool _program_setup;
+        bool _upload_setup;
+        bool _uniforms_changed;
+        gl_cache* _gl_cache;
         GLuint _program_id;
         GLuint _vertex_array_id;
         GLuint _texture_id;
-        GLuint _pbo_id;
-        std::array<GLuint, 2> _vertex_buffers_ids;
+        pbo_ring _pbo_ring;
+        texel_scatter _texel_scatter;
+        performance_monitor _performance_monitor;
+        GLuint _width_location;
+        GLuint _height_location;
+        GLuint _decay_location;
         GLuint _current_t_location;
+        GLuint _increase_color_location;
+        GLuint _idle_color_location;
+        GLuint _decrease_color_location;
+    };
+
+    /// dvs_display_batch draws several dvs_display_renderers in a single pass.
+    /// A dvs_display whose ancestor item implements this interface hands its renderer over to the ancestor instead of
+    /// drawing it. insert and erase are called by the render thread, or by the GUI thread while the render thread is
+    /// blocked.
+    class dvs_display_batch {
+        public:
+        virtual ~dvs_display_batch() {}
+
+        /// insert adds a renderer to the batch.
+        virtual void insert(dvs_display_renderer* renderer) = 0;
+
+        /// erase removes a renderer from the batch, before its destruction.
+        virtual void erase(dvs_display_renderer* renderer) = 0;
     };
 
     /// dvs_display displays a stream of DVS events.
@@ -353,28 +1043,63 @@ namespace chameleon {
         Q_OBJECT
         Q_INTERFACES(QQmlParserStatus)
         Q_PROPERTY(QSize canvas_size READ canvas_size WRITE set_canvas_size)
-        Q_PROPERTY(float decay READ decay WRITE set_decay)
-        Q_PROPERTY(QColor increase_color READ increase_color WRITE set_increase_color)
-        Q_PROPERTY(QColor idle_color READ idle_color WRITE set_idle_color)
-        Q_PROPERTY(QColor decrease_color READ decrease_color WRITE set_decrease_color)
-        Q_PROPERTY(QColor background_color READ background_color WRITE set_background_color)
+        Q_PROPERTY(float decay READ decay WRITE set_decay NOTIFY decay_changed)
+        Q_PROPERTY(QColor increase_color READ increase_color WRITE set_increase_color NOTIFY increase_color_changed)
+        Q_PROPERTY(QColor idle_color READ idle_color WRITE set_idle_color NOTIFY idle_color_changed)
+        Q_PROPERTY(QColor decrease_color READ decrease_color WRITE set_decrease_color NOTIFY decrease_color_changed)
+        Q_PROPERTY(
+            QColor background_color READ background_color WRITE set_background_color NOTIFY background_color_changed)
+        Q_PROPERTY(bool double_buffered READ double_buffered WRITE set_double_buffered)
+        Q_PROPERTY(bool packed READ packed WRITE set_packed)
+        Q_PROPERTY(bool gpu_scatter READ gpu_scatter WRITE set_gpu_scatter)
+        Q_PROPERTY(int shards READ shards WRITE set_shards)
+        Q_PROPERTY(bool lod READ lod WRITE set_lod)
+        Q_PROPERTY(int tile_size READ tile_size WRITE set_tile_size)
+        Q_PROPERTY(QRectF region READ region WRITE set_region NOTIFY region_changed)
+        Q_PROPERTY(qint64 keyframe_interval READ keyframe_interval WRITE set_keyframe_interval)
+        Q_PROPERTY(int keyframes READ keyframes WRITE set_keyframes)
         Q_PROPERTY(QRectF paint_area READ paint_area)
+        Q_PROPERTY(double events_per_second READ events_per_second NOTIFY performance_changed)
+        Q_PROPERTY(double lock_spins_per_second READ lock_spins_per_second NOTIFY performance_changed)
+        Q_PROPERTY(double copy_duration READ copy_duration NOTIFY performance_changed)
+        Q_PROPERTY(double gpu_duration READ gpu_duration NOTIFY performance_changed)
+        Q_PROPERTY(qint64 uploaded_bytes READ uploaded_bytes NOTIFY performance_changed)
         public:
         dvs_display() :
             _ready(false),
             _renderer_ready(false),
+            _render_scheduler(nullptr),
             _decay(1e5),
             _increase_color(Qt::white),
             _idle_color(Qt::darkGray),
             _decrease_color(Qt::black),
-            _background_color(Qt::black) {
+            _background_color(Qt::black),
+            _double_buffered(false),
+            _packed(false),
+            _gpu_scatter(false),
+            _shards(1),
+            _lod(false),
+            _tile_size(0),
+            _keyframe_interval(0),
+            _keyframes(64),
+            _parameters_changed(false),
+            _batch(nullptr) {
             connect(this, &QQuickItem::windowChanged, this, &dvs_display::handle_window_changed);
+            _performance = performance_counters{};
+            _performance_timer.setInterval(1000);
+            connect(&_performance_timer, &QTimer::timeout, this, &dvs_display::update_performance);
+            _performance_timer.start();
+            _accessing_renderer.clear(std::memory_order_release);
         }
         dvs_display(const dvs_display&) = delete;
         dvs_display(dvs_display&&) = delete;
         dvs_display& operator=(const dvs_display&) = delete;
         dvs_display& operator=(dvs_display&&) = delete;
-        virtual ~dvs_display() {}
+        virtual ~dvs_display() {
+            if (_batch_item && _dvs_display_renderer) {
+                _batch->erase(_dvs_display_renderer.get());
+            }
+        }
 
         /// set_canvas_size defines the display coordinates.
         /// The canvas size will be passed to the openGL renderer, therefore it should only be set during qml
@@ -394,12 +1119,14 @@ namespace chameleon {
         }
 
         /// set_decay defines the pixel decay.
-        /// The decay will be passed to the openGL renderer, therefore it should only be set during qml construction.
+        /// The decay can be changed at any time, it is passed to the openGL renderer before the next frame.
         virtual void set_decay(float decay) {
-            if (_ready.load(std::memory_order_acquire)) {
-                throw std::logic_error("decay can only be set during qml construction");
+            if (decay != _decay) {
+                _decay = decay;
+                _parameters_changed = true;
+                decay_changed(_decay);
+                trigger_draw();
             }
-            _decay = decay;
         }
 
         /// decay returns the currently used decay.
@@ -408,13 +1135,14 @@ namespace chameleon {
         }
 
         /// set_increase_color defines the color used to represent increasing light.
-        /// The increase color will be passed to the openGL renderer, therefore it should only be set during qml
-        /// construction.
+        /// The increase color can be changed at any time, it is passed to the openGL renderer before the next frame.
         virtual void set_increase_color(QColor increase_color) {
-            if (_ready.load(std::memory_order_acquire)) {
-                throw std::logic_error("increase_color can only be set during qml construction");
+            if (increase_color != _increase_color) {
+                _increase_color = increase_color;
+                _parameters_changed = true;
+                increase_color_changed(_increase_color);
+                trigger_draw();
             }
-            _increase_color = increase_color;
         }
 
         /// increase_color returns the currently used increase_color.
@@ -423,13 +1151,14 @@ namespace chameleon {
         }
 
         /// set_idle_color defines the color used to represent idle pixels.
-        /// The idle color will be passed to the openGL renderer, therefore it should only be set during qml
-        /// construction.
+        /// The idle color can be changed at any time, it is passed to the openGL renderer before the next frame.
         virtual void set_idle_color(QColor idle_color) {
-            if (_ready.load(std::memory_order_acquire)) {
-                throw std::logic_error("idle_color can only be set during qml construction");
+            if (idle_color != _idle_color) {
+                _idle_color = idle_color;
+                _parameters_changed = true;
+                idle_color_changed(_idle_color);
+                trigger_draw();
             }
-            _idle_color = idle_color;
         }
 
         /// idle_color returns the currently used idle_color.
@@ -438,13 +1167,14 @@ namespace chameleon {
         }
 
         /// set_decrease_color defines the color used to represent decreasing light.
-        /// The decrease color will be passed to the openGL renderer, therefore it should only be set during qml
-        /// construction.
+        /// The decrease color can be changed at any time, it is passed to the openGL renderer before the next frame.
         virtual void set_decrease_color(QColor decrease_color) {
-            if (_ready.load(std::memory_order_acquire)) {
-                throw std::logic_error("decrease_color can only be set during qml construction");
+            if (decrease_color != _decrease_color) {
+                _decrease_color = decrease_color;
+                _parameters_changed = true;
+                decrease_color_changed(_decrease_color);
+                trigger_draw();
             }
-            _decrease_color = decrease_color;
         }
 
         /// decrease_color returns the currently used decrease_color.
@@ -453,13 +1183,14 @@ namespace chameleon {
         }
 
         /// set_background_color defines the background color used to compensate the parent's shape.
-        /// The background color will be passed to the openGL renderer, therefore it should only be set during qml
-        /// construction.
+        /// The background color can be changed at any time, it is passed to the openGL renderer before the next frame.
         virtual void set_background_color(QColor background_color) {
-            if (_ready.load(std::memory_order_acquire)) {
-                throw std::logic_error("background_color can only be set during qml construction");
+            if (background_color != _background_color) {
+                _background_color = background_color;
+                _parameters_changed = true;
+                background_color_changed(_background_color);
+                trigger_draw();
             }
-            _background_color = background_color;
         }
 
         /// background_color returns the currently used background_color.
@@ -467,17 +1198,219 @@ namespace chameleon {
             return _background_color;
         }
 
+        /// set_double_buffered defines whether events are buffered before being written to the pixels state.
+        /// When double buffering is enabled, producers only append events to a list that the render thread swaps and
+        /// applies, therefore events ingestion is not blocked while the pixels are copied to the GPU.
+        /// The double buffering mode will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_double_buffered(bool double_buffered) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("double_buffered can only be set during qml construction");
+            }
+            _double_buffered = double_buffered;
+        }
+
+        /// double_buffered returns the currently used double buffering mode.
+        virtual bool double_buffered() const {
+            return _double_buffered;
+        }
+
+        /// set_packed defines whether each pixel is stored in a single 32-bits word instead of two.
+        /// The packed format halves the pixels state memory and the upload bandwidth, at the cost of timestamps
+        /// wrapping every 2^31 microseconds (about 35 minutes). Pixels older than that may light up again.
+        /// The packed mode will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_packed(bool packed) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("packed can only be set during qml construction");
+            }
+            _packed = packed;
+        }
+
+        /// packed returns the currently used packed mode.
+        virtual bool packed() const {
+            return _packed;
+        }
+
+        /// set_gpu_scatter defines whether the pixels state is updated by the GPU.
+        /// With GPU scatter, the render thread uploads the events received since the last frame and draws them into
+        /// the texture, instead of copying the pixels state. The CPU cost then depends on the event rate rather than
+        /// the canvas size.
+        /// The GPU scatter mode will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_gpu_scatter(bool gpu_scatter) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("gpu_scatter can only be set during qml construction");
+            }
+            _gpu_scatter = gpu_scatter;
+        }
+
+        /// gpu_scatter returns the currently used GPU scatter mode.
+        virtual bool gpu_scatter() const {
+            return _gpu_scatter;
+        }
+
+        /// set_shards defines the number of row bands with their own lock.
+        /// Producers pushing events to different bands do not contend, therefore several threads can push to the
+        /// display at once. Sharding is not compatible with the double buffered and GPU scatter modes, which already
+        /// decouple the producers from the pixels state.
+        /// The number of shards will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_shards(int shards) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("shards can only be set during qml construction");
+            }
+            if (shards < 1) {
+                throw std::logic_error("shards must be at least 1");
+            }
+            _shards = shards;
+        }
+
+        /// shards returns the currently used number of shards.
+        virtual int shards() const {
+            return _shards;
+        }
+
+        /// set_lod defines whether the canvas is reduced to the paint area size before upload.
+        /// Each on-screen pixel then shows the most recent event of the canvas pixels it covers, and the upload cost
+        /// follows the number of on-screen pixels rather than the sensor size. LOD cannot be used with GPU scatter.
+        /// The lod mode will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_lod(bool lod) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("lod can only be set during qml construction");
+            }
+            _lod = lod;
+        }
+
+        /// lod returns the currently used lod mode.
+        virtual bool lod() const {
+            return _lod;
+        }
+
+        /// set_tile_size defines the side of the square tiles storing the pixels state, 0 (default) being row-major.
+        /// Tiles keep neighbouring pixels in the same cache lines, which speeds up pushes of spatially clustered events
+        /// (16 is a good start), while the upload de-tiles the dirty rows. Tiles cannot be used with GPU scatter.
+        /// The tile size will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_tile_size(int tile_size) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("tile_size can only be set during qml construction");
+            }
+            if (tile_size != 0 && (tile_size < 2 || tile_size > 256 || (tile_size & (tile_size - 1)) != 0)) {
+                throw std::logic_error("tile_size must be 0 or a power of two in the range [2, 256]");
+            }
+            _tile_size = tile_size;
+        }
+
+        /// tile_size returns the currently used tile size.
+        virtual int tile_size() const {
+            return _tile_size;
+        }
+
+        /// set_region defines the part of the canvas which is displayed, in canvas coordinates.
+        /// Only the region is uploaded, and it is stretched to the item while keeping its aspect ratio. An empty
+        /// region (default) displays the whole canvas. The region can be changed at any time to pan and zoom, it is
+        /// ignored with GPU scatter and within a display group.
+        virtual void set_region(QRectF region) {
+            if (region != _region) {
+                _region = region;
+                region_changed(_region);
+                trigger_draw();
+            }
+        }
+
+        /// region returns the currently displayed region.
+        virtual QRectF region() const {
+            return _region;
+        }
+
+        /// set_keyframe_interval defines the time between two keyframes, in microseconds.
+        /// Keyframes are compressed snapshots of the pixels state, used by restore to seek in a recording without
+        /// replaying it from the start. 0 (default) disables keyframes. Keyframes cannot be used with GPU scatter.
+        /// The keyframe interval will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_keyframe_interval(qint64 keyframe_interval) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("keyframe_interval can only be set during qml construction");
+            }
+            if (keyframe_interval < 0) {
+                throw std::logic_error("keyframe_interval cannot be negative");
+            }
+            _keyframe_interval = keyframe_interval;
+        }
+
+        /// keyframe_interval returns the currently used keyframe interval.
+        virtual qint64 keyframe_interval() const {
+            return _keyframe_interval;
+        }
+
+        /// set_keyframes defines the maximum number of stored keyframes, the oldest ones are dropped first.
+        /// The number of keyframes will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_keyframes(int keyframes) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("keyframes can only be set during qml construction");
+            }
+            if (keyframes < 1) {
+                throw std::logic_error("keyframes must be at least 1");
+            }
+            _keyframes = keyframes;
+        }
+
+        /// keyframes returns the currently used maximum number of keyframes.
+        virtual int keyframes() const {
+            return _keyframes;
+        }
+
+        /// events_per_second returns the number of events received per second, measured over the last second.
+        virtual double events_per_second() const {
+            return _performance.events_per_second;
+        }
+
+        /// lock_spins_per_second returns the number of iterations per second spent waiting for the renderer's locks.
+        /// A high value means that producers and the render thread contend.
+        virtual double lock_spins_per_second() const {
+            return _performance.lock_spins_per_second;
+        }
+
+        /// copy_duration returns the CPU time, in microseconds, spent copying the state to the GPU buffers during the
+        /// latest frame.
+        virtual double copy_duration() const {
+            return _performance.copy_duration;
+        }
+
+        /// gpu_duration returns the GPU time, in microseconds, of the latest measured frame.
+        virtual double gpu_duration() const {
+            return _performance.gpu_duration;
+        }
+
         /// paint_area returns the paint area in window coordinates.
         virtual QRectF paint_area() const {
             return _paint_area;
         }
 
+        /// uploaded_bytes returns the number of bytes sent to the GPU during the last frame.
+        virtual std::size_t uploaded_bytes() const {
+            return _performance.uploaded_bytes;
+        }
+
         /// push adds an event to the display.
         template <typename Event>
         void push(Event event) {
             while (!_renderer_ready.load(std::memory_order_acquire)) {
             }
             _dvs_display_renderer->push<Event>(event);
+            request_update();
+        }
+
+        /// push adds a batch of events to the display.
+        template <typename Iterator>
+        void push(Iterator begin, Iterator end) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _dvs_display_renderer->push<Iterator>(begin, end);
+            request_update();
         }
 
         /// assign sets all the pixels at once.
@@ -486,6 +1419,17 @@ namespace chameleon {
             while (!_renderer_ready.load(std::memory_order_acquire)) {
             }
             _dvs_display_renderer->assign<Iterator>(begin, end);
+            request_update();
+        }
+
+        /// restore seeks to the latest keyframe at or before t, and returns the keyframe's time.
+        /// The caller must then push the events with a timestamp larger than or equal to the returned time to reach t.
+        virtual qint64 restore(qint64 t) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            const auto keyframe_t = _dvs_display_renderer->restore(static_cast<uint64_t>(std::max(t, qint64(0))));
+            request_update();
+            return static_cast<qint64>(keyframe_t);
         }
 
         /// componentComplete is called when all the qml values are bound.
@@ -493,6 +1437,32 @@ namespace chameleon {
             if (_canvas_size.width() <= 0 || _canvas_size.height() <= 0) {
                 throw std::logic_error("canvas_size cannot have a null component, make sure that it is set in qml");
             }
+            if (_shards > 1 && (_double_buffered || _gpu_scatter)) {
+                throw std::logic_error("shards cannot be used with double_buffered or gpu_scatter");
+            }
+            if (_lod && _gpu_scatter) {
+                throw std::logic_error("lod cannot be used with gpu_scatter");
+            }
+            if (_keyframe_interval > 0 && _gpu_scatter) {
+                throw std::logic_error("keyframes cannot be used with gpu_scatter");
+            }
+            if (_tile_size > 0 && _gpu_scatter) {
+                throw std::logic_error("tile_size cannot be used with gpu_scatter");
+            }
+            for (auto item = parentItem(); item; item = item->parentItem()) {
+                const auto batch = dynamic_cast<dvs_display_batch*>(item);
+                if (batch) {
+                    if (_gpu_scatter) {
+                        throw std::logic_error("gpu_scatter cannot be used within a display group");
+                    }
+                    if (_lod) {
+                        throw std::logic_error("lod cannot be used within a display group");
+                    }
+                    _batch = batch;
+                    _batch_item = item;
+                    break;
+                }
+            }
             _ready.store(true, std::memory_order_release);
         }
 
@@ -501,6 +1471,27 @@ namespace chameleon {
         /// paintAreaChanged notifies a paint area change.
         void paintAreaChanged(QRectF paint_area);
 
+        /// region_changed notifies a change of the displayed region.
+        void region_changed(QRectF region);
+
+        /// decay_changed notifies a change of the decay.
+        void decay_changed(float decay);
+
+        /// increase_color_changed notifies a change of the increase color.
+        void increase_color_changed(QColor increase_color);
+
+        /// idle_color_changed notifies a change of the idle color.
+        void idle_color_changed(QColor idle_color);
+
+        /// decrease_color_changed notifies a change of the decrease color.
+        void decrease_color_changed(QColor decrease_color);
+
+        /// background_color_changed notifies a change of the background color.
+        void background_color_changed(QColor background_color);
+
+        /// performance_changed notifies a change of the performance counters.
+        void performance_changed();
+
         public slots:
 
         /// sync adapts the renderer to external changes.
@@ -508,31 +1499,68 @@ namespace chameleon {
             if (_ready.load(std::memory_order_relaxed)) {
                 if (!_dvs_display_renderer) {
                     _dvs_display_renderer = std::unique_ptr<dvs_display_renderer>(new dvs_display_renderer(
-                        _canvas_size, _decay, _increase_color, _idle_color, _decrease_color, _background_color));
-                    connect(
-                        window(),
-                        &QQuickWindow::beforeRendering,
-                        _dvs_display_renderer.get(),
-                        &dvs_display_renderer::paint,
-                        Qt::DirectConnection);
+                        _canvas_size,
+                        _decay,
+                        _increase_color,
+                        _idle_color,
+                        _decrease_color,
+                        _background_color,
+                        _double_buffered,
+                        _packed,
+                        _gpu_scatter,
+                        static_cast<std::size_t>(_shards),
+                        _lod,
+                        static_cast<std::size_t>(_tile_size)));
+                    if (_keyframe_interval > 0) {
+                        _dvs_display_renderer->set_keyframes(
+                            static_cast<uint64_t>(_keyframe_interval), static_cast<std::size_t>(_keyframes));
+                    }
+                    if (_batch_item) {
+                        _batch->insert(_dvs_display_renderer.get());
+                    } else {
+                        connect(
+                            window(),
+                            &QQuickWindow::beforeRendering,
+                            _dvs_display_renderer.get(),
+                            &dvs_display_renderer::paint,
+                            Qt::DirectConnection);
+                    }
+                    while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+                    }
                     _renderer_ready.store(true, std::memory_order_release);
+                    _accessing_renderer.clear(std::memory_order_release);
+                } else if (_parameters_changed) {
+                    _dvs_display_renderer->set_decay(_decay);
+                    _dvs_display_renderer->set_colors(
+                        _increase_color, _idle_color, _decrease_color, _background_color);
                 }
+                _parameters_changed = false;
                 auto clear_area =
                     QRectF(0, 0, width() * window()->devicePixelRatio(), height() * window()->devicePixelRatio());
                 for (auto item = static_cast<QQuickItem*>(this); item; item = item->parentItem()) {
                     clear_area.moveLeft(clear_area.left() + item->x() * window()->devicePixelRatio());
                     clear_area.moveTop(clear_area.top() + item->y() * window()->devicePixelRatio());
                 }
-                if (clear_area != _clear_area) {
+                if (clear_area != _clear_area || _region != _synced_region) {
                     _clear_area = std::move(clear_area);
-                    if (clear_area.width() * _canvas_size.height() > clear_area.height() * _canvas_size.width()) {
-                        _paint_area.setWidth(clear_area.height() * _canvas_size.width() / _canvas_size.height());
+                    _synced_region = _region;
+                    auto visible_width = static_cast<qreal>(_canvas_size.width());
+                    auto visible_height = static_cast<qreal>(_canvas_size.height());
+                    if (!_gpu_scatter && !_batch_item) {
+                        _dvs_display_renderer->set_region(_region);
+                        if (!_region.isEmpty()) {
+                            visible_width = _region.width();
+                            visible_height = _region.height();
+                        }
+                    }
+                    if (clear_area.width() * visible_height > clear_area.height() * visible_width) {
+                        _paint_area.setWidth(clear_area.height() * visible_width / visible_height);
                         _paint_area.setHeight(clear_area.height());
                         _paint_area.moveLeft(clear_area.left() + (clear_area.width() - _paint_area.width()) / 2);
                         _paint_area.moveTop(clear_area.top());
                     } else {
                         _paint_area.setWidth(clear_area.width());
-                        _paint_area.setHeight(clear_area.width() * _canvas_size.height() / _canvas_size.width());
+                        _paint_area.setHeight(clear_area.width() * visible_height / visible_width);
                         _paint_area.moveLeft(clear_area.left());
                         _paint_area.moveTop(clear_area.top() + (clear_area.height() - _paint_area.height()) / 2);
                     }
@@ -544,14 +1572,22 @@ namespace chameleon {
         }
 
         /// cleanup frees the owned renderer.
+        /// Pushes wait for the next renderer, created by sync if the scene graph is initialized again.
         void cleanup() {
+            while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+            }
+            if (_batch_item && _dvs_display_renderer) {
+                _batch->erase(_dvs_display_renderer.get());
+            }
+            _renderer_ready.store(false, std::memory_order_release);
             _dvs_display_renderer.reset();
+            _accessing_renderer.clear(std::memory_order_release);
         }
 
         /// trigger_draw requests a window refresh.
         void trigger_draw() {
             if (window()) {
-                window()->update();
+                render_scheduler::of(window())->request_update();
             }
         }
 
@@ -564,20 +1600,63 @@ namespace chameleon {
                 connect(
                     window, &QQuickWindow::sceneGraphInvalidated, this, &dvs_display::cleanup, Qt::DirectConnection);
                 window->setClearBeforeRendering(false);
+                _render_scheduler.store(render_scheduler::of(window), std::memory_order_release);
+            }
+        }
+
+        /// update_performance samples the renderer's counters.
+        /// The renderer lock prevents cleanup from freeing the renderer during the sample.
+        void update_performance() {
+            while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+            }
+            if (_renderer_ready.load(std::memory_order_relaxed)) {
+                const auto performance = _dvs_display_renderer->sample_performance();
+                _accessing_renderer.clear(std::memory_order_release);
+                if (performance != _performance) {
+                    _performance = performance;
+                    performance_changed();
+                }
+            } else {
+                _accessing_renderer.clear(std::memory_order_release);
             }
         }
 
         protected:
+        /// request_update schedules a window update, coalesced with the other displays of the window.
+        virtual void request_update() {
+            const auto scheduler = _render_scheduler.load(std::memory_order_acquire);
+            if (scheduler) {
+                scheduler->request_update();
+            }
+        }
+
         std::atomic_bool _ready;
         std::atomic_bool _renderer_ready;
+        std::atomic_flag _accessing_renderer;
+        std::atomic<render_scheduler*> _render_scheduler;
         QSize _canvas_size;
         float _decay;
         QColor _increase_color;
         QColor _idle_color;
         QColor _decrease_color;
         QColor _background_color;
+        bool _double_buffered;
+        bool _packed;
+        bool _gpu_scatter;
+        int _shards;
+        bool _lod;
+        int _tile_size;
+        qint64 _keyframe_interval;
+        int _keyframes;
+        bool _parameters_changed;
+        QRectF _region;
+        QRectF _synced_region;
+        dvs_display_batch* _batch;
+        QPointer<QQuickItem> _batch_item;
         std::unique_ptr<dvs_display_renderer> _dvs_display_renderer;
         QRectF _clear_area;
         QRectF _paint_area;
+        performance_counters _performance;
+        QTimer _performance_timer;
     };
 }
@@ -0,0 +1,466 @@
+#pragma once
+
+#include "dvs_display.hpp"
+#include "gl_cache.hpp"
+#include <QQmlParserStatus>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFunctions_3_3_Core>
+#include <QtQuick/QQuickItem>
+#include <QtQuick/qquickwindow.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// dvs_display_group_renderer handles openGL calls for a dvs_display_group.
+    /// The pixels of every display are stored in the layers of a single texture array, and every display is drawn by
+    /// the same instanced call, after a single clear of the group's area.
+    class dvs_display_group_renderer : public QObject, public QOpenGLFunctions_3_3_Core {
+        Q_OBJECT
+        public:
+        dvs_display_group_renderer(QColor color) :
+            _color(color),
+            _packed(false),
+            _layout_changed(false),
+            _program_setup(false),
+            _layers(0) {
+            _accessing_renderers.clear(std::memory_order_release);
+        }
+        dvs_display_group_renderer(const dvs_display_group_renderer&) = delete;
+        dvs_display_group_renderer(dvs_display_group_renderer&&) = delete;
+        dvs_display_group_renderer& operator=(const dvs_display_group_renderer&) = delete;
+        dvs_display_group_renderer& operator=(dvs_display_group_renderer&&) = delete;
+        virtual ~dvs_display_group_renderer() {
+            if (_program_setup) {
+                glDeleteBuffers(1, &_instances_buffer_id);
+                glDeleteVertexArrays(1, &_vertex_array_id);
+                if (_layers > 0) {
+                    glDeleteTextures(1, &_texture_id);
+                }
+            }
+        }
+
+        /// set_rendering_area defines the clear area, which contains the paint areas of the displays.
+        virtual void set_rendering_area(QRectF clear_area, int window_height) {
+            _clear_area = clear_area;
+            _clear_area.moveTop(window_height - _clear_area.top() - _clear_area.height());
+        }
+
+        /// insert adds a display's renderer to the group.
+        /// All the renderers of a group must have the same canvas size and packed mode.
+        virtual void insert(dvs_display_renderer* renderer) {
+            while (_accessing_renderers.test_and_set(std::memory_order_acquire)) {
+            }
+            if (!_renderers.empty()
+                && (renderer->canvas_size() != _canvas_size || renderer->packed() != _packed)) {
+                _accessing_renderers.clear(std::memory_order_release);
+                throw std::logic_error("the displays of a group must have the same canvas_size and packed mode");
+            }
+            _canvas_size = renderer->canvas_size();
+            _packed = renderer->packed();
+            _renderers.push_back(renderer);
+            _layout_changed = true;
+            _accessing_renderers.clear(std::memory_order_release);
+        }
+
+        /// erase removes a display's renderer from the group.
+        virtual void erase(dvs_display_renderer* renderer) {
+            while (_accessing_renderers.test_and_set(std::memory_order_acquire)) {
+            }
+            _renderers.erase(std::remove(_renderers.begin(), _renderers.end(), renderer), _renderers.end());
+            _layout_changed = true;
+            _accessing_renderers.clear(std::memory_order_release);
+        }
+
+        public slots:
+
+        /// paint sends commands to the GPU.
+        void paint() {
+            if (!initializeOpenGLFunctions()) {
+                throw std::runtime_error("initializing the OpenGL context failed");
+            }
+            if (!_program_setup) {
+                _program_setup = true;
+
+                // create the instances buffer, the quad's vertices are computed from their ids
+                glGenVertexArrays(1, &_vertex_array_id);
+                glBindVertexArray(_vertex_array_id);
+                glGenBuffers(1, &_instances_buffer_id);
+                glBindBuffer(GL_ARRAY_BUFFER, _instances_buffer_id);
+                const auto stride = static_cast<GLsizei>(sizeof(instance));
+                for (GLuint index = 0; index < 4; ++index) {
+                    glEnableVertexAttribArray(1 + index);
+                    glVertexAttribPointer(
+                        1 + index,
+                        4,
+                        GL_FLOAT,
+                        GL_FALSE,
+                        stride,
+                        reinterpret_cast<const GLvoid*>(offsetof(instance, paint_area) + index * 4 * sizeof(float)));
+                    glVertexAttribDivisor(1 + index, 1);
+                }
+                glEnableVertexAttribArray(5);
+                glVertexAttribPointer(
+                    5, 1, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const GLvoid*>(offsetof(instance, decay)));
+                glVertexAttribDivisor(5, 1);
+                glEnableVertexAttribArray(6);
+                glVertexAttribIPointer(
+                    6, 1, GL_UNSIGNED_INT, stride, reinterpret_cast<const GLvoid*>(offsetof(instance, current_t)));
+                glVertexAttribDivisor(6, 1);
+                glEnableVertexAttribArray(7);
+                glVertexAttribIPointer(
+                    7, 1, GL_INT, stride, reinterpret_cast<const GLvoid*>(offsetof(instance, layer)));
+                glVertexAttribDivisor(7, 1);
+                glBindVertexArray(0);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            }
+
+            // clear the group's area
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(
+                static_cast<GLint>(_clear_area.left()),
+                static_cast<GLint>(_clear_area.top()),
+                static_cast<GLsizei>(_clear_area.width()),
+                static_cast<GLsizei>(_clear_area.height()));
+            glClearColor(
+                static_cast<GLfloat>(_color.redF()),
+                static_cast<GLfloat>(_color.greenF()),
+                static_cast<GLfloat>(_color.blueF()),
+                static_cast<GLfloat>(_color.alphaF()));
+            glClear(GL_COLOR_BUFFER_BIT);
+            glDisable(GL_SCISSOR_TEST);
+            while (_accessing_renderers.test_and_set(std::memory_order_acquire)) {
+            }
+            if (_renderers.empty()) {
+                _accessing_renderers.clear(std::memory_order_release);
+                check_opengl_error();
+                return;
+            }
+            if (_layout_changed) {
+                _layout_changed = false;
+                update_layout();
+            }
+
+            // send data to the GPU
+            glBindTexture(GL_TEXTURE_2D_ARRAY, _texture_id);
+            _instances.resize(_renderers.size());
+            for (std::size_t index = 0; index < _renderers.size(); ++index) {
+                const auto renderer = _renderers[index];
+                auto& current_instance = _instances[index];
+                const auto paint_area = renderer->paint_area();
+                current_instance.paint_area[0] = static_cast<float>(paint_area.left() - _clear_area.left());
+                current_instance.paint_area[1] = static_cast<float>(paint_area.top() - _clear_area.top());
+                current_instance.paint_area[2] = static_cast<float>(paint_area.width());
+                current_instance.paint_area[3] = static_cast<float>(paint_area.height());
+                write_color(renderer->increase_color(), current_instance.increase_color);
+                write_color(renderer->idle_color(), current_instance.idle_color);
+                write_color(renderer->decrease_color(), current_instance.decrease_color);
+                current_instance.decay = renderer->decay();
+                current_instance.current_t = renderer->upload(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(index));
+                current_instance.layer = static_cast<int32_t>(index);
+            }
+            _accessing_renderers.clear(std::memory_order_release);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glBindBuffer(GL_ARRAY_BUFFER, _instances_buffer_id);
+            glBufferData(
+                GL_ARRAY_BUFFER,
+                static_cast<GLsizeiptr>(_instances.size() * sizeof(instance)),
+                _instances.data(),
+                GL_STREAM_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            // draw all the displays
+            glUseProgram(_program_id);
+            glUniform2f(
+                _viewport_size_location,
+                static_cast<GLfloat>(_clear_area.width()),
+                static_cast<GLfloat>(_clear_area.height()));
+            glUniform2f(
+                _canvas_size_location,
+                static_cast<GLfloat>(_canvas_size.width()),
+                static_cast<GLfloat>(_canvas_size.height()));
+            glViewport(
+                static_cast<GLint>(_clear_area.left()),
+                static_cast<GLint>(_clear_area.top()),
+                static_cast<GLsizei>(_clear_area.width()),
+                static_cast<GLsizei>(_clear_area.height()));
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glBindVertexArray(_vertex_array_id);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(_instances.size()));
+            glBindVertexArray(0);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            glUseProgram(0);
+            check_opengl_error();
+        }
+
+        protected:
+        /// instance holds the per-display attributes of the instanced draw.
+        struct instance {
+            float paint_area[4];
+            float increase_color[4];
+            float idle_color[4];
+            float decrease_color[4];
+            float decay;
+            uint32_t current_t;
+            int32_t layer;
+        };
+
+        /// write_color stores a color as four floats.
+        static void write_color(const QColor& color, float* components) {
+            components[0] = static_cast<float>(color.redF());
+            components[1] = static_cast<float>(color.greenF());
+            components[2] = static_cast<float>(color.blueF());
+            components[3] = static_cast<float>(color.alphaF());
+        }
+
+        /// update_layout assigns a layer to each renderer, and resizes the texture array if needed.
+        /// Every renderer uploads its whole canvas on the next frame, since layers may have moved.
+        /// _accessing_renderers must be locked by the caller.
+        virtual void update_layout() {
+            const std::string vertex_shader(R""(
+                #version 330 core
+                layout(location = 1) in vec4 paint_area;
+                layout(location = 2) in vec4 increase_color;
+                layout(location = 3) in vec4 idle_color;
+                layout(location = 4) in vec4 decrease_color;
+                layout(location = 5) in float decay;
+                layout(location = 6) in uint current_t;
+                layout(location = 7) in int layer;
+                out vec2 uv;
+                flat out vec4 instance_increase_color;
+                flat out vec4 instance_idle_color;
+                flat out vec4 instance_decrease_color;
+                flat out float instance_decay;
+                flat out uint instance_current_t;
+                flat out int instance_layer;
+                uniform vec2 viewport_size;
+                uniform vec2 canvas_size;
+                void main() {
+                    vec2 position = vec2((gl_VertexID & 2) >> 1, gl_VertexID & 1);
+                    gl_Position =
+                        vec4((paint_area.xy + position * paint_area.zw) / viewport_size * 2.0 - 1.0, 0.0, 1.0);
+                    uv = position * canvas_size;
+                    instance_increase_color = increase_color;
+                    instance_idle_color = idle_color;
+                    instance_decrease_color = decrease_color;
+                    instance_decay = decay;
+                    instance_current_t = current_t;
+                    instance_layer = layer;
+                }
+            )"");
+            const std::string fragment_shader(
+                std::string("#version 330 core\n") + (_packed ? "#define PACKED\n" : "") + R""(
+                in vec2 uv;
+                flat in vec4 instance_increase_color;
+                flat in vec4 instance_idle_color;
+                flat in vec4 instance_decrease_color;
+                flat in float instance_decay;
+                flat in uint instance_current_t;
+                flat in int instance_layer;
+                out vec4 color;
+                uniform usampler2DArray sampler;
+                void main() {
+                    ivec3 texel = ivec3(ivec2(uv), instance_layer);
+                #ifdef PACKED
+                    uint t_and_is_increase = texelFetch(sampler, texel, 0).x;
+                    float lambda = exp(
+                        -float((instance_current_t - (t_and_is_increase >> 1u)) & 0x7fffffffu) / instance_decay);
+                    bool is_increase = (t_and_is_increase & 1u) == 1u;
+                #else
+                    uvec2 t_and_is_increase = texelFetch(sampler, texel, 0).xy;
+                    float lambda = exp(-float(instance_current_t - t_and_is_increase.x) / instance_decay);
+                    bool is_increase = t_and_is_increase.y == 1u;
+                #endif
+                    color = lambda * (is_increase ? instance_increase_color : instance_decrease_color)
+                            + (1.0 - lambda) * instance_idle_color;
+                }
+            )"");
+            _program_id = gl_cache::current().program(vertex_shader, fragment_shader);
+            _viewport_size_location = glGetUniformLocation(_program_id, "viewport_size");
+            _canvas_size_location = glGetUniformLocation(_program_id, "canvas_size");
+            const auto layers = static_cast<GLsizei>(_renderers.size());
+            if (layers > _layers || _canvas_size != _texture_size || _packed != _texture_packed) {
+                if (_layers > 0) {
+                    glDeleteTextures(1, &_texture_id);
+                }
+                _layers = std::max(layers, _layers);
+                _texture_size = _canvas_size;
+                _texture_packed = _packed;
+                glGenTextures(1, &_texture_id);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, _texture_id);
+                glTexImage3D(
+                    GL_TEXTURE_2D_ARRAY,
+                    0,
+                    _packed ? GL_R32UI : GL_RG32UI,
+                    _canvas_size.width(),
+                    _canvas_size.height(),
+                    _layers,
+                    0,
+                    _packed ? GL_RED_INTEGER : GL_RG_INTEGER,
+                    GL_UNSIGNED_INT,
+                    nullptr);
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            }
+            for (const auto renderer : _renderers) {
+                renderer->invalidate();
+            }
+        }
+
+        /// check_opengl_error throws if openGL generated an error.
+        virtual void check_opengl_error() {
+            switch (glGetError()) {
+                case GL_NO_ERROR:
+                    break;
+                case GL_INVALID_ENUM:
+                    throw std::logic_error("OpenGL error: GL_INVALID_ENUM");
+                case GL_INVALID_VALUE:
+                    throw std::logic_error("OpenGL error: GL_INVALID_VALUE");
+                case GL_INVALID_OPERATION:
+                    throw std::logic_error("OpenGL error: GL_INVALID_OPERATION");
+                case GL_OUT_OF_MEMORY:
+                    throw std::logic_error("OpenGL error: GL_OUT_OF_MEMORY");
+            }
+        }
+
+        QColor _color;
+        QRectF _clear_area;
+        std::vector<dvs_display_renderer*> _renderers;
+        std::atomic_flag _accessing_renderers;
+        QSize _canvas_size;
+        bool _packed;
+        bool _layout_changed;
+        std::vector<instance> _instances;
+        bool _program_setup;
+        GLuint _program_id;
+        GLuint _vertex_array_id;
+        GLuint _instances_buffer_id;
+        GLuint _texture_id;
+        GLsizei _layers;
+        QSize _texture_size;
+        bool _texture_packed;
+        GLint _viewport_size_location;
+        GLint _canvas_size_location;
+    };
+
+    /// dvs_display_group draws the dvs_displays it contains in a single pass.
+    /// The group clears its own area with the given color, therefore it replaces the background_cleaner behind the
+    /// displays. The displays must share the same canvas size and packed mode, and cannot use GPU scatter.
+    class dvs_display_group : public QQuickItem, public dvs_display_batch {
+        Q_OBJECT
+        Q_INTERFACES(QQmlParserStatus)
+        Q_PROPERTY(QColor color READ color WRITE set_color)
+        public:
+        dvs_display_group() : _ready(false), _color(Qt::black) {
+            connect(this, &QQuickItem::windowChanged, this, &dvs_display_group::handle_window_changed);
+        }
+        dvs_display_group(const dvs_display_group&) = delete;
+        dvs_display_group(dvs_display_group&&) = delete;
+        dvs_display_group& operator=(const dvs_display_group&) = delete;
+        dvs_display_group& operator=(dvs_display_group&&) = delete;
+        virtual ~dvs_display_group() {}
+
+        /// set_color defines the clear color.
+        /// The color will be passed to the openGL renderer, therefore it should only be set during qml construction.
+        virtual void set_color(QColor color) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("color can only be set during qml construction");
+            }
+            _color = color;
+        }
+
+        /// color returns the currently used color.
+        virtual QColor color() const {
+            return _color;
+        }
+
+        /// insert adds a display's renderer to the group.
+        virtual void insert(dvs_display_renderer* renderer) override {
+            create_renderer();
+            _dvs_display_group_renderer->insert(renderer);
+        }
+
+        /// erase removes a display's renderer from the group.
+        virtual void erase(dvs_display_renderer* renderer) override {
+            if (_dvs_display_group_renderer) {
+                _dvs_display_group_renderer->erase(renderer);
+            }
+        }
+
+        /// componentComplete is called when all the qml values are bound.
+        virtual void componentComplete() override {
+            _ready.store(true, std::memory_order_release);
+        }
+
+        public slots:
+
+        /// sync adapts the renderer to external changes.
+        void sync() {
+            if (_ready.load(std::memory_order_relaxed)) {
+                create_renderer();
+                auto clear_area =
+                    QRectF(0, 0, width() * window()->devicePixelRatio(), height() * window()->devicePixelRatio());
+                for (auto item = static_cast<QQuickItem*>(this); item; item = item->parentItem()) {
+                    clear_area.moveLeft(clear_area.left() + item->x() * window()->devicePixelRatio());
+                    clear_area.moveTop(clear_area.top() + item->y() * window()->devicePixelRatio());
+                }
+                if (clear_area != _clear_area) {
+                    _clear_area = std::move(clear_area);
+                    _dvs_display_group_renderer->set_rendering_area(
+                        _clear_area, window()->height() * window()->devicePixelRatio());
+                }
+            }
+        }
+
+        /// cleanup resets the renderer.
+        void cleanup() {
+            _dvs_display_group_renderer.reset();
+        }
+
+        private slots:
+
+        /// handle_window_changed must be triggered after a window change.
+        void handle_window_changed(QQuickWindow* window) {
+            if (window) {
+                connect(
+                    window, &QQuickWindow::beforeSynchronizing, this, &dvs_display_group::sync, Qt::DirectConnection);
+                connect(
+                    window,
+                    &QQuickWindow::sceneGraphInvalidated,
+                    this,
+                    &dvs_display_group::cleanup,
+                    Qt::DirectConnection);
+                window->setClearBeforeRendering(false);
+            }
+        }
+
+        protected:
+        /// create_renderer creates the renderer on first use.
+        /// The displays may insert their renderers before the group's first sync.
+        virtual void create_renderer() {
+            if (!_dvs_display_group_renderer) {
+                _dvs_display_group_renderer =
+                    std::unique_ptr<dvs_display_group_renderer>(new dvs_display_group_renderer(_color));
+                connect(
+                    window(),
+                    &QQuickWindow::beforeRendering,
+                    _dvs_display_group_renderer.get(),
+                    &dvs_display_group_renderer::paint,
+                    Qt::DirectConnection);
+            }
+        }
+
+        std::atomic_bool _ready;
+        QColor _color;
+        std::unique_ptr<dvs_display_group_renderer> _dvs_display_group_renderer;
+        QRectF _clear_area;
+    };
+}
@@ -0,0 +1,343 @@
+#pragma once
+
+#include "render_scheduler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// lag_policy defines how an event_player catches up when delivering the events takes longer than playing them.
+    /// drop discards the events older than the maximum latency, which bounds the latency whatever the event rate.
+    /// merge delivers the late events with the current ones, in the same batches, which bounds the latency as long
+    /// as the displays ingest events faster than they are played, and never loses events.
+    enum class lag_policy {
+        drop,
+        merge,
+    };
+
+    /// event_player replays a stream of events to displays, paced by the events' timestamps.
+    /// A dedicated thread reads the events from a source and, once per frame, delivers the events whose timestamp
+    /// was reached to every sink with a single batched push. The events must have a timestamp field t, in
+    /// microseconds, and the source must provide them in chronological order. When a render scheduler is given, the
+    /// batches are delivered just before the window's frames, otherwise every frame_interval.
+    template <typename Event>
+    class event_player {
+        public:
+        /// as_fast_as_possible is a speed which delivers the events as soon as they are read.
+        static constexpr double as_fast_as_possible = std::numeric_limits<double>::infinity();
+
+        /// source appends the next events to a buffer, and returns false once the stream is exhausted.
+        typedef std::function<bool(std::vector<Event>&)> source;
+
+        /// sink receives a batch of chronologically ordered events.
+        typedef std::function<void(
+            typename std::vector<Event>::const_iterator, typename std::vector<Event>::const_iterator)>
+            sink;
+
+        event_player(
+            source event_source,
+            double speed,
+            lag_policy policy = lag_policy::drop,
+            std::chrono::microseconds maximum_latency = std::chrono::microseconds(100000),
+            std::chrono::microseconds frame_interval = std::chrono::microseconds(16667)) :
+            _source(std::move(event_source)),
+            _speed(speed),
+            _policy(policy),
+            _maximum_latency(maximum_latency),
+            _frame_interval(frame_interval),
+            _frame_clock(nullptr),
+            _running(false),
+            _finished(false),
+            _t(0),
+            _dropped_events(0),
+            _started(false),
+            _more(true),
+            _position(0) {
+            if (!(speed > 0)) {
+                throw std::logic_error("speed must be strictly positive");
+            }
+            if (_frame_interval.count() <= 0) {
+                throw std::logic_error("frame_interval must be strictly positive");
+            }
+        }
+        event_player(const event_player&) = delete;
+        event_player(event_player&&) = delete;
+        event_player& operator=(const event_player&) = delete;
+        event_player& operator=(event_player&&) = delete;
+        virtual ~event_player() {
+            join();
+        }
+
+        /// add_sink registers a batch handler, called by the player thread.
+        /// It must be called before start.
+        virtual void add_sink(sink event_sink) {
+            if (_thread.joinable()) {
+                throw std::logic_error("sinks can only be added before start");
+            }
+            _sinks.push_back(std::move(event_sink));
+        }
+
+        /// add_display registers a display, which receives the batches with its push(begin, end) method.
+        /// It must be called before start, and the display must outlive the playback.
+        template <typename Display>
+        void add_display(Display& display) {
+            add_sink([&display](
+                         typename std::vector<Event>::const_iterator begin,
+                         typename std::vector<Event>::const_iterator end) { display.push(begin, end); });
+        }
+
+        /// set_frame_clock aligns the batches with the frames of the given scheduler's window.
+        /// It must be called before start, and the scheduler must outlive the playback.
+        virtual void set_frame_clock(const render_scheduler* scheduler) {
+            if (_thread.joinable()) {
+                throw std::logic_error("the frame clock can only be set before start");
+            }
+            _frame_clock = scheduler;
+        }
+
+        /// set_speed changes the playback speed, the stream's time is preserved.
+        /// It can be called by any thread.
+        virtual void set_speed(double speed) {
+            if (!(speed > 0)) {
+                throw std::logic_error("speed must be strictly positive");
+            }
+            _speed.store(speed, std::memory_order_release);
+        }
+
+        /// speed returns the currently used playback speed.
+        virtual double speed() const {
+            return _speed.load(std::memory_order_acquire);
+        }
+
+        /// start launches the player thread.
+        virtual void start() {
+            if (_thread.joinable()) {
+                throw std::logic_error("the player is already started");
+            }
+            _running = true;
+            _thread = std::thread(&event_player::play, this);
+        }
+
+        /// stop interrupts the playback and waits for the player thread, which can be started again to resume it.
+        /// It throws if the source or a sink threw.
+        virtual void stop() {
+            join();
+            if (!_error.empty()) {
+                const auto error = std::move(_error);
+                _error.clear();
+                throw std::runtime_error(error);
+            }
+        }
+
+        /// finished returns whether all the events were delivered.
+        virtual bool finished() const {
+            return _finished.load(std::memory_order_acquire);
+        }
+
+        /// t returns the stream time reached by the playback, in microseconds.
+        virtual uint64_t t() const {
+            return _t.load(std::memory_order_acquire);
+        }
+
+        /// dropped_events returns the number of events discarded by the drop policy.
+        virtual std::size_t dropped_events() const {
+            return _dropped_events.load(std::memory_order_acquire);
+        }
+
+        protected:
+        /// frame_lead is the time between a delivery and the frame it is aligned with.
+        static constexpr std::chrono::nanoseconds::rep frame_lead = 1000000;
+
+        /// join stops the player thread.
+        virtual void join() {
+            {
+                const std::lock_guard<std::mutex> lock(_running_mutex);
+                _running = false;
+            }
+            _running_changed.notify_all();
+            if (_thread.joinable()) {
+                _thread.join();
+            }
+        }
+
+        /// available reads the source until an event is buffered, and returns false if the stream is exhausted.
+        virtual bool available() {
+            while (_position == _buffer.size() && _more) {
+                _buffer.clear();
+                _position = 0;
+                _more = _source(_buffer);
+            }
+            return _position < _buffer.size();
+        }
+
+        /// deliver passes the buffered events up to end to every sink.
+        virtual void deliver(typename std::vector<Event>::const_iterator end) {
+            const auto begin = std::next(_buffer.cbegin(), static_cast<std::ptrdiff_t>(_position));
+            for (auto& event_sink : _sinks) {
+                event_sink(begin, end);
+            }
+            _position = static_cast<std::size_t>(std::distance(_buffer.cbegin(), end));
+        }
+
+        /// next_frame returns the delivery time of the first frame after now.
+        virtual std::chrono::steady_clock::time_point next_frame(
+            std::chrono::steady_clock::time_point now,
+            std::chrono::steady_clock::time_point previous_frame) const {
+            const auto now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+            auto reference = std::chrono::duration_cast<std::chrono::nanoseconds>(previous_frame.time_since_epoch())
+                                 .count();
+            auto interval = std::chrono::duration_cast<std::chrono::nanoseconds>(_frame_interval).count();
+            if (_frame_clock) {
+                const auto frame_t = _frame_clock->frame_t();
+                const auto frame_interval = _frame_clock->frame_interval();
+                if (frame_t > 0 && frame_interval > 0) {
+                    reference = frame_t - frame_lead;
+                    interval = frame_interval;
+                }
+            }
+            const auto frames = now_ns >= reference ? (now_ns - reference) / interval + 1 : 0;
+            return std::chrono::steady_clock::time_point(
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::nanoseconds(reference + frames * interval)));
+        }
+
+        /// play delivers the events until the stream is exhausted or the player is stopped.
+        /// It is executed by the player thread.
+        virtual void play() {
+            try {
+                if (!_started) {
+                    _started = true;
+                    _more = true;
+                    _position = 0;
+                    if (!available()) {
+                        _finished.store(true, std::memory_order_release);
+                        return;
+                    }
+                    _t.store(_buffer[_position].t, std::memory_order_release);
+                }
+                auto speed = _speed.load(std::memory_order_acquire);
+                auto anchor_t = _t.load(std::memory_order_acquire);
+                auto anchor = std::chrono::steady_clock::now();
+                auto frame = anchor;
+                for (;;) {
+                    const auto target_speed = _speed.load(std::memory_order_acquire);
+                    if (std::isinf(target_speed)) {
+                        {
+                            const std::lock_guard<std::mutex> lock(_running_mutex);
+                            if (!_running) {
+                                return;
+                            }
+                        }
+                        if (!available()) {
+                            break;
+                        }
+                        deliver(_buffer.cend());
+                        _t.store(_buffer.back().t, std::memory_order_release);
+                        speed = target_speed;
+                        continue;
+                    }
+                    frame = next_frame(std::chrono::steady_clock::now(), frame);
+                    {
+                        std::unique_lock<std::mutex> lock(_running_mutex);
+                        if (_running_changed.wait_until(lock, frame, [this]() { return !_running; })) {
+                            return;
+                        }
+                    }
+                    const auto now = std::chrono::steady_clock::now();
+                    if (target_speed != speed) {
+                        if (!std::isinf(speed)) {
+                            anchor_t = playback_t(anchor_t, anchor, now, speed);
+                        } else {
+                            anchor_t = _t.load(std::memory_order_acquire);
+                        }
+                        anchor = now;
+                        speed = target_speed;
+                    }
+                    const auto target_t = playback_t(anchor_t, anchor, now, speed);
+                    if (_policy == lag_policy::drop) {
+                        const auto window = static_cast<uint64_t>(
+                            std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(_maximum_latency)
+                                .count()
+                            * speed);
+                        if (target_t > window) {
+                            while (available() && _buffer[_position].t < target_t - window) {
+                                const auto end = std::lower_bound(
+                                    std::next(_buffer.cbegin(), static_cast<std::ptrdiff_t>(_position)),
+                                    _buffer.cend(),
+                                    target_t - window,
+                                    [](const Event& event, uint64_t t) { return event.t < t; });
+                                const auto position = static_cast<std::size_t>(std::distance(_buffer.cbegin(), end));
+                                _dropped_events.fetch_add(position - _position, std::memory_order_acq_rel);
+                                _position = position;
+                            }
+                        }
+                    }
+                    while (available() && _buffer[_position].t <= target_t) {
+                        deliver(std::upper_bound(
+                            std::next(_buffer.cbegin(), static_cast<std::ptrdiff_t>(_position)),
+                            _buffer.cend(),
+                            target_t,
+                            [](uint64_t t, const Event& event) { return t < event.t; }));
+                    }
+                    _t.store(target_t, std::memory_order_release);
+                    if (!available()) {
+                        break;
+                    }
+                }
+                _finished.store(true, std::memory_order_release);
+            } catch (const std::exception& exception) {
+                _error = exception.what();
+            }
+        }
+
+        /// playback_t returns the stream time reached at now, given the stream time at anchor.
+        static uint64_t playback_t(
+            uint64_t anchor_t,
+            std::chrono::steady_clock::time_point anchor,
+            std::chrono::steady_clock::time_point now,
+            double speed) {
+            return anchor_t
+                   + static_cast<uint64_t>(
+                       std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(now - anchor).count()
+                       * speed);
+        }
+
+        source _source;
+        std::vector<sink> _sinks;
+        std::atomic<double> _speed;
+        const lag_policy _policy;
+        const std::chrono::microseconds _maximum_latency;
+        const std::chrono::microseconds _frame_interval;
+        const render_scheduler* _frame_clock;
+        std::thread _thread;
+        bool _running;
+        std::mutex _running_mutex;
+        std::condition_variable _running_changed;
+        std::atomic_bool _finished;
+        std::atomic<uint64_t> _t;
+        std::atomic<std::size_t> _dropped_events;
+        std::string _error;
+        bool _started;
+        bool _more;
+        std::vector<Event> _buffer;
+        std::size_t _position;
+    };
+
+    template <typename Event>
+    constexpr double event_player<Event>::as_fast_as_possible;
+
+    template <typename Event>
+    constexpr std::chrono::nanoseconds::rep event_player<Event>::frame_lead;
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "delta_t_display.hpp"
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// event_rate_display_renderer counts the events of each pixel over a sliding time window.
+    /// The window is split into a ring of bins, each listing the pixels of its events. An event increments its
+    /// pixel's count, and the counts of an expired bin's events are decremented, therefore updates cost O(events)
+    /// rather than O(window x pixels). Counts are converted to mean time differences (window / count), so that the
+    /// delta_t_display_renderer's colormap, calibration and level of detail apply unchanged.
+    class event_rate_display_renderer : public delta_t_display_renderer {
+        Q_OBJECT
+        public:
+        event_rate_display_renderer(
+            QSize canvas_size,
+            uint64_t window,
+            std::size_t bins,
+            float discard_ratio,
+            std::size_t calibration_interval,
+            std::size_t colormap,
+            bool lod,
+            std::size_t tile_size) :
+            delta_t_display_renderer(canvas_size, discard_ratio, calibration_interval, colormap, false, lod, tile_size),
+            _window(window),
+            _bin_duration(bins > 0 ? window / bins : 0),
+            _counts(_delta_ts.size(), 0),
+            _bins(bins),
+            _current_bin(0),
+            _started(false) {
+            if (bins < 1) {
+                throw std::logic_error("bins must be at least 1");
+            }
+            if (_bin_duration < 1) {
+                throw std::logic_error("window must be at least bins microseconds long");
+            }
+            if (_window > std::numeric_limits<uint32_t>::max()) {
+                throw std::logic_error("window must be smaller than 2^32 microseconds");
+            }
+        }
+        event_rate_display_renderer(const event_rate_display_renderer&) = delete;
+        event_rate_display_renderer(event_rate_display_renderer&&) = delete;
+        event_rate_display_renderer& operator=(const event_rate_display_renderer&) = delete;
+        event_rate_display_renderer& operator=(event_rate_display_renderer&&) = delete;
+        virtual ~event_rate_display_renderer() {}
+
+        /// push adds an event to the display.
+        /// Events must be pushed in chronological order, late events are counted in the current bin.
+        template <typename Event>
+        void push(Event event) {
+            _performance_monitor.lock(_accessing_delta_ts);
+            advance_to(event.t);
+            add(_layout.index(static_cast<std::size_t>(event.x), static_cast<std::size_t>(event.y)));
+            _accessing_delta_ts.clear(std::memory_order_release);
+        }
+
+        /// push adds a batch of events to the display.
+        /// The lock is acquired once per batch rather than once per event.
+        template <typename Iterator>
+        void push(Iterator begin, Iterator end) {
+            if (begin == end) {
+                return;
+            }
+            _performance_monitor.lock(_accessing_delta_ts);
+            for (; begin != end; ++begin) {
+                advance_to(begin->t);
+                add(_layout.index(static_cast<std::size_t>(begin->x), static_cast<std::size_t>(begin->y)));
+            }
+            _accessing_delta_ts.clear(std::memory_order_release);
+        }
+
+        /// advance expires the bins older than the window ending at t, without adding events.
+        /// It lets the rates decrease while no event is pushed.
+        virtual void advance(uint64_t t) {
+            _performance_monitor.lock(_accessing_delta_ts);
+            advance_to(t);
+            _accessing_delta_ts.clear(std::memory_order_release);
+        }
+
+        /// count returns the number of events of the given pixel in the current window.
+        virtual uint32_t count(std::size_t x, std::size_t y) {
+            _performance_monitor.lock(_accessing_delta_ts);
+            const auto result = _counts[_layout.index(x, y)];
+            _accessing_delta_ts.clear(std::memory_order_release);
+            return result;
+        }
+
+        protected:
+        /// add counts an event in the current bin.
+        /// _accessing_delta_ts must be locked by the caller.
+        virtual void add(std::size_t index) {
+            ++_counts[index];
+            _bins[_current_bin % _bins.size()].push_back(static_cast<uint32_t>(index));
+            update(index);
+            ++_pushed_events;
+        }
+
+        /// update converts a pixel's count to a mean time difference, and marks its row dirty.
+        /// _accessing_delta_ts must be locked by the caller.
+        virtual void update(std::size_t index) {
+            const auto count = _counts[index];
+            _delta_ts[index] = count == 0 ? std::numeric_limits<uint32_t>::max()
+                                          : std::max(static_cast<uint32_t>(1), static_cast<uint32_t>(_window / count));
+            _dirty_rows[_layout.y(index)] = 1;
+        }
+
+        /// advance_to moves the current bin to the one containing t, and subtracts the events of the expired bins.
+        /// _accessing_delta_ts must be locked by the caller.
+        virtual void advance_to(uint64_t t) {
+            const auto bin = t / _bin_duration;
+            if (!_started) {
+                _started = true;
+                _current_bin = bin;
+                return;
+            }
+            if (bin <= _current_bin) {
+                return;
+            }
+            const auto steps = std::min(bin - _current_bin, static_cast<uint64_t>(_bins.size()));
+            for (uint64_t step = 1; step <= steps; ++step) {
+                auto& indices = _bins[(_current_bin + step) % _bins.size()];
+                for (const auto index : indices) {
+                    --_counts[index];
+                    update(index);
+                }
+                indices.clear();
+            }
+            _current_bin = bin;
+        }
+
+        const uint64_t _window;
+        const uint64_t _bin_duration;
+        std::vector<uint32_t> _counts;
+        std::vector<std::vector<uint32_t>> _bins;
+        uint64_t _current_bin;
+        bool _started;
+    };
+
+    /// event_rate_display displays the number of events of each pixel over a sliding time window.
+    /// The rates are shown with delta_t_display's colormaps and calibration, the discards being expressed as mean
+    /// time differences between events, in microseconds (time_window / count).
+    class event_rate_display : public delta_t_display {
+        Q_OBJECT
+        Q_PROPERTY(qint64 time_window READ time_window WRITE set_time_window)
+        Q_PROPERTY(int bins READ bins WRITE set_bins)
+        public:
+        event_rate_display() : delta_t_display(), _time_window(1000000), _bins(16) {}
+        event_rate_display(const event_rate_display&) = delete;
+        event_rate_display(event_rate_display&&) = delete;
+        event_rate_display& operator=(const event_rate_display&) = delete;
+        event_rate_display& operator=(event_rate_display&&) = delete;
+        virtual ~event_rate_display() {}
+
+        /// set_time_window defines the duration over which events are counted, in microseconds.
+        /// The time window will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_time_window(qint64 time_window) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("time_window can only be set during qml construction");
+            }
+            if (time_window < 1 || time_window > std::numeric_limits<uint32_t>::max()) {
+                throw std::logic_error("time_window must be in the range [1, 2^32 - 1]");
+            }
+            _time_window = time_window;
+        }
+
+        /// time_window returns the currently used time window.
+        virtual qint64 time_window() const {
+            return _time_window;
+        }
+
+        /// set_bins defines the number of bins splitting the window.
+        /// More bins make the window slide more smoothly, at the cost of memory.
+        /// The number of bins will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_bins(int bins) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("bins can only be set during qml construction");
+            }
+            if (bins < 1) {
+                throw std::logic_error("bins must be at least 1");
+            }
+            _bins = bins;
+        }
+
+        /// bins returns the currently used number of bins.
+        virtual int bins() const {
+            return _bins;
+        }
+
+        /// push adds an event to the display.
+        template <typename Event>
+        void push(Event event) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            rate_renderer()->push<Event>(event);
+            request_update();
+        }
+
+        /// push adds a batch of events to the display.
+        template <typename Iterator>
+        void push(Iterator begin, Iterator end) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            rate_renderer()->push<Iterator>(begin, end);
+            request_update();
+        }
+
+        /// advance expires the events older than the time window ending at t.
+        virtual void advance(qint64 t) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            rate_renderer()->advance(static_cast<uint64_t>(t));
+            request_update();
+        }
+
+        /// assign is not supported, since the counts are derived from the events.
+        template <typename Iterator>
+        void assign(Iterator begin, Iterator end) = delete;
+
+        /// componentComplete is called when all the qml values are bound.
+        virtual void componentComplete() override {
+            if (_gpu_scatter) {
+                throw std::logic_error("gpu_scatter is not supported by event_rate_display");
+            }
+            if (_time_window < _bins) {
+                throw std::logic_error("time_window must be at least bins microseconds long");
+            }
+            delta_t_display::componentComplete();
+        }
+
+        protected:
+        /// create_renderer allocates an event rate renderer.
+        virtual delta_t_display_renderer* create_renderer() override {
+            return new event_rate_display_renderer(
+                _canvas_size,
+                static_cast<uint64_t>(_time_window),
+                static_cast<std::size_t>(_bins),
+                _discard_ratio,
+                static_cast<std::size_t>(_calibration_interval),
+                static_cast<std::size_t>(_colormap),
+                _lod,
+                static_cast<std::size_t>(_tile_size));
+        }
+
+        /// rate_renderer returns the renderer as an event rate renderer.
+        virtual event_rate_display_renderer* rate_renderer() {
+            return static_cast<event_rate_display_renderer*>(_delta_t_display_renderer.get());
+        }
+
+        qint64 _time_window;
+        int _bins;
+    };
+}
@@ -0,0 +1,1024 @@
+#pragma once
+
+#include "colormap_lut.hpp"
+#include "gl_cache.hpp"
+#include "pbo_ring.hpp"
+#include "render_scheduler.hpp"
+#include <QQmlParserStatus>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFunctions_3_3_Core>
+#include <QtQuick/QQuickItem>
+#include <QtQuick/qquickwindow.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// event_surface_renderer stores the state of a change detection sensor and shares it with several displays.
+    /// The state is a struct of arrays: the timestamps and polarities, followed by the time differences between the
+    /// last two events of each pixel. Both arrays are uploaded once per frame to a single texture, with the time
+    /// differences in the texture's upper half. Only the rows modified since the previous frame are copied to a pixel
+    /// buffer and uploaded.
+    class event_surface_renderer : public QObject, public QOpenGLFunctions_3_3_Core {
+        Q_OBJECT
+        public:
+        event_surface_renderer(QSize canvas_size) :
+            _canvas_size(canvas_size),
+            _pixels(static_cast<std::size_t>(_canvas_size.width() * _canvas_size.height())),
+            _ts(_pixels, std::numeric_limits<uint64_t>::max()),
+            _ts_and_delta_ts(_pixels * 2, 0),
+            _dirty_rows(static_cast<std::size_t>(_canvas_size.height()), 1),
+            _current_t(0),
+            _painted_current_t(0),
+            _texture_setup(false),
+            _uploaded(false) {
+            std::fill(
+                std::next(_ts_and_delta_ts.begin(), _pixels),
+                _ts_and_delta_ts.end(),
+                static_cast<uint32_t>(no_delta_t));
+            _accessing_surface.clear(std::memory_order_release);
+        }
+        event_surface_renderer(const event_surface_renderer&) = delete;
+        event_surface_renderer(event_surface_renderer&&) = delete;
+        event_surface_renderer& operator=(const event_surface_renderer&) = delete;
+        event_surface_renderer& operator=(event_surface_renderer&&) = delete;
+        virtual ~event_surface_renderer() {
+            if (_texture_setup) {
+                _pbo_ring.release();
+                glDeleteTextures(1, &_texture_id);
+            }
+        }
+
+        /// no_delta_t is the time difference of pixels which have not received two events yet.
+        static constexpr uint32_t no_delta_t = std::numeric_limits<uint32_t>::max();
+
+        /// push adds an event to the surface.
+        template <typename Event>
+        void push(Event event) {
+            while (_accessing_surface.test_and_set(std::memory_order_acquire)) {
+            }
+            write(
+                static_cast<std::size_t>(event.x) + static_cast<std::size_t>(event.y) * _canvas_size.width(),
+                static_cast<uint64_t>(event.t),
+                event.is_increase);
+            _accessing_surface.clear(std::memory_order_release);
+        }
+
+        /// push adds a batch of events to the surface.
+        /// The lock is acquired once per batch rather than once per event.
+        template <typename Iterator>
+        void push(Iterator begin, Iterator end) {
+            if (begin == end) {
+                return;
+            }
+            while (_accessing_surface.test_and_set(std::memory_order_acquire)) {
+            }
+            for (; begin != end; ++begin) {
+                write(
+                    static_cast<std::size_t>(begin->x) + static_cast<std::size_t>(begin->y) * _canvas_size.width(),
+                    static_cast<uint64_t>(begin->t),
+                    begin->is_increase);
+            }
+            _accessing_surface.clear(std::memory_order_release);
+        }
+
+        /// upload sends the rows modified since the previous frame to the GPU, and returns the texture id.
+        /// Only the first call of each frame copies and uploads the rows, the other displays reuse the texture.
+        /// It must be called by the render thread.
+        virtual GLuint upload() {
+            if (!initializeOpenGLFunctions()) {
+                throw std::runtime_error("initializing the OpenGL context failed");
+            }
+            if (!_texture_setup) {
+                _texture_setup = true;
+                glGenTextures(1, &_texture_id);
+                glBindTexture(GL_TEXTURE_RECTANGLE, _texture_id);
+                glTexImage2D(
+                    GL_TEXTURE_RECTANGLE,
+                    0,
+                    GL_R32UI,
+                    _canvas_size.width(),
+                    _canvas_size.height() * 2,
+                    0,
+                    GL_RED_INTEGER,
+                    GL_UNSIGNED_INT,
+                    nullptr);
+                glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+                _pbo_ring.initialize(this, _ts_and_delta_ts.size() * sizeof(decltype(_ts_and_delta_ts)::value_type));
+            }
+            if (!_uploaded) {
+                _uploaded = true;
+                const auto row_size = static_cast<std::size_t>(_canvas_size.width());
+                const auto height = static_cast<std::size_t>(_canvas_size.height());
+                {
+                    auto buffer = reinterpret_cast<uint32_t*>(_pbo_ring.map());
+                    while (_accessing_surface.test_and_set(std::memory_order_acquire)) {
+                    }
+                    collect_dirty_rows();
+                    for (const auto& rows : _dirty_rows_ranges) {
+                        for (const auto offset : {static_cast<std::size_t>(0), height}) {
+                            std::copy(
+                                std::next(
+                                    _ts_and_delta_ts.begin(),
+                                    static_cast<std::ptrdiff_t>((offset + rows.first) * row_size)),
+                                std::next(
+                                    _ts_and_delta_ts.begin(),
+                                    static_cast<std::ptrdiff_t>((offset + rows.second) * row_size)),
+                                buffer + (offset + rows.first) * row_size);
+                        }
+                    }
+                    _painted_current_t = _current_t;
+                    _accessing_surface.clear(std::memory_order_release);
+                }
+                const auto buffer_offset = _pbo_ring.unmap();
+                glBindTexture(GL_TEXTURE_RECTANGLE, _texture_id);
+                for (const auto& rows : _dirty_rows_ranges) {
+                    for (const auto offset : {static_cast<std::size_t>(0), height}) {
+                        glTexSubImage2D(
+                            GL_TEXTURE_RECTANGLE,
+                            0,
+                            0,
+                            static_cast<GLint>(offset + rows.first),
+                            _canvas_size.width(),
+                            static_cast<GLsizei>(rows.second - rows.first),
+                            GL_RED_INTEGER,
+                            GL_UNSIGNED_INT,
+                            reinterpret_cast<const GLvoid*>(
+                                buffer_offset
+                                + (offset + rows.first) * row_size * sizeof(decltype(_ts_and_delta_ts)::value_type)));
+                    }
+                }
+                _pbo_ring.fence();
+                glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            }
+            return _texture_id;
+        }
+
+        /// current_t returns the timestamp of the last uploaded event, truncated to 31 bits like the texture's
+        /// timestamps.
+        /// It must be called by the render thread, after upload.
+        virtual uint32_t current_t() const {
+            return static_cast<uint32_t>(_painted_current_t) & 0x7fffffffu;
+        }
+
+        /// copy_delta_ts writes the time differences of the pixels which received at least two events to the given
+        /// buffer, which must hold pixels() values, and returns their number.
+        /// It locks the surface, and can be called by any thread.
+        virtual std::size_t copy_delta_ts(uint32_t* delta_ts) {
+            while (_accessing_surface.test_and_set(std::memory_order_acquire)) {
+            }
+            const auto end = std::copy_if(
+                std::next(_ts_and_delta_ts.begin(), static_cast<std::ptrdiff_t>(_pixels)),
+                _ts_and_delta_ts.end(),
+                delta_ts,
+                [](uint32_t delta_t) { return delta_t < no_delta_t; });
+            _accessing_surface.clear(std::memory_order_release);
+            return static_cast<std::size_t>(std::distance(delta_ts, end));
+        }
+
+        /// pixels returns the number of pixels of the surface.
+        virtual std::size_t pixels() const {
+            return _pixels;
+        }
+
+        public slots:
+
+        /// end_frame allows the next upload call to send the surface to the GPU.
+        void end_frame() {
+            _uploaded = false;
+        }
+
+        protected:
+        /// write updates the pixel at the given index.
+        /// _accessing_surface must be locked by the caller.
+        void write(std::size_t index, uint64_t t, bool is_increase) {
+            auto& previous_t = _ts[index];
+            if (previous_t != std::numeric_limits<uint64_t>::max() && t >= previous_t) {
+                _ts_and_delta_ts[_pixels + index] =
+                    static_cast<uint32_t>(std::min(t - previous_t, static_cast<uint64_t>(no_delta_t - 1)));
+            }
+            previous_t = t;
+            _ts_and_delta_ts[index] = (static_cast<uint32_t>(t) << 1) | (is_increase ? 1u : 0u);
+            _dirty_rows[index / static_cast<std::size_t>(_canvas_size.width())] = 1;
+            if (t > _current_t) {
+                _current_t = t;
+            }
+        }
+
+        /// collect_dirty_rows lists the ranges of rows modified since the last frame, and resets the dirty flags.
+        /// A single range spanning the whole canvas is used if most rows are dirty.
+        /// _accessing_surface must be locked by the caller.
+        virtual void collect_dirty_rows() {
+            _dirty_rows_ranges.clear();
+            const auto dirty_rows = static_cast<std::size_t>(std::count(_dirty_rows.begin(), _dirty_rows.end(), 1));
+            if (dirty_rows * 2 > _dirty_rows.size()) {
+                _dirty_rows_ranges.emplace_back(0, _dirty_rows.size());
+            } else if (dirty_rows > 0) {
+                for (std::size_t y = 0; y < _dirty_rows.size(); ++y) {
+                    if (_dirty_rows[y] == 1) {
+                        auto end = y + 1;
+                        while (end < _dirty_rows.size() && _dirty_rows[end] == 1) {
+                            ++end;
+                        }
+                        _dirty_rows_ranges.emplace_back(y, end);
+                        y = end;
+                    }
+                }
+            }
+            std::fill(_dirty_rows.begin(), _dirty_rows.end(), 0);
+        }
+
+        QSize _canvas_size;
+        std::size_t _pixels;
+        std::vector<uint64_t> _ts;
+        std::vector<uint32_t> _ts_and_delta_ts;
+        std::vector<uint8_t> _dirty_rows;
+        std::vector<std::pair<std::size_t, std::size_t>> _dirty_rows_ranges;
+        uint64_t _current_t;
+        uint64_t _painted_current_t;
+        std::atomic_flag _accessing_surface;
+        bool _texture_setup;
+        bool _uploaded;
+        GLuint _texture_id;
+        pbo_ring _pbo_ring;
+    };
+
+    /// event_surface ingests a stream of change detection events once, for several event_surface_display.
+    /// It does not draw anything.
+    class event_surface : public QQuickItem {
+        Q_OBJECT
+        Q_INTERFACES(QQmlParserStatus)
+        Q_PROPERTY(QSize canvas_size READ canvas_size WRITE set_canvas_size)
+        public:
+        event_surface() : _ready(false), _renderer_ready(false), _render_scheduler(nullptr) {
+            connect(this, &QQuickItem::windowChanged, this, &event_surface::handle_window_changed);
+        }
+        event_surface(const event_surface&) = delete;
+        event_surface(event_surface&&) = delete;
+        event_surface& operator=(const event_surface&) = delete;
+        event_surface& operator=(event_surface&&) = delete;
+        virtual ~event_surface() {}
+
+        /// set_canvas_size defines the surface coordinates.
+        /// The canvas size will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_canvas_size(QSize canvas_size) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("canvas_size can only be set during qml construction");
+            }
+            _canvas_size = canvas_size;
+        }
+
+        /// canvas_size returns the currently used canvas_size.
+        virtual QSize canvas_size() const {
+            return _canvas_size;
+        }
+
+        /// renderer returns the surface's renderer, or nullptr if it has not been created yet.
+        /// It must be called by the render thread.
+        virtual event_surface_renderer* renderer() const {
+            return _event_surface_renderer.get();
+        }
+
+        /// push adds an event to the surface.
+        template <typename Event>
+        void push(Event event) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _event_surface_renderer->push<Event>(event);
+            request_update();
+        }
+
+        /// push adds a batch of events to the surface.
+        template <typename Iterator>
+        void push(Iterator begin, Iterator end) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _event_surface_renderer->push<Iterator>(begin, end);
+            request_update();
+        }
+
+        /// componentComplete is called when all the qml values are bound.
+        virtual void componentComplete() override {
+            if (_canvas_size.width() <= 0 || _canvas_size.height() <= 0) {
+                throw std::logic_error("canvas_size cannot have a null component, make sure that it is set in qml");
+            }
+            _ready.store(true, std::memory_order_release);
+        }
+
+        public slots:
+
+        /// sync creates the renderer.
+        /// It is also called by the displays using the surface, which may be synchronized first.
+        void sync() {
+            if (_ready.load(std::memory_order_relaxed) && !_event_surface_renderer) {
+                _event_surface_renderer =
+                    std::unique_ptr<event_surface_renderer>(new event_surface_renderer(_canvas_size));
+                connect(
+                    window(),
+                    &QQuickWindow::afterRendering,
+                    _event_surface_renderer.get(),
+                    &event_surface_renderer::end_frame,
+                    Qt::DirectConnection);
+                _renderer_ready.store(true, std::memory_order_release);
+            }
+        }
+
+        /// cleanup frees the owned renderer.
+        void cleanup() {
+            _event_surface_renderer.reset();
+        }
+
+        /// trigger_draw requests a window refresh.
+        void trigger_draw() {
+            if (window()) {
+                render_scheduler::of(window())->request_update();
+            }
+        }
+
+        private slots:
+
+        /// handle_window_changed must be triggered after a window transformation.
+        void handle_window_changed(QQuickWindow* window) {
+            if (window) {
+                connect(window, &QQuickWindow::beforeSynchronizing, this, &event_surface::sync, Qt::DirectConnection);
+                connect(
+                    window, &QQuickWindow::sceneGraphInvalidated, this, &event_surface::cleanup, Qt::DirectConnection);
+                _render_scheduler.store(render_scheduler::of(window), std::memory_order_release);
+            }
+        }
+
+        protected:
+        /// request_update schedules a window update, coalesced with the other displays of the window.
+        virtual void request_update() {
+            const auto scheduler = _render_scheduler.load(std::memory_order_acquire);
+            if (scheduler) {
+                scheduler->request_update();
+            }
+        }
+
+        std::atomic_bool _ready;
+        std::atomic_bool _renderer_ready;
+        std::atomic<render_scheduler*> _render_scheduler;
+        QSize _canvas_size;
+        std::unique_ptr<event_surface_renderer> _event_surface_renderer;
+    };
+
+    /// event_surface_display_renderer handles openGL calls for an event_surface_display.
+    class event_surface_display_renderer : public QObject, public QOpenGLFunctions_3_3_Core {
+        Q_OBJECT
+        public:
+        event_surface_display_renderer(
+            event_surface_renderer* surface,
+            QSize canvas_size,
+            std::size_t style,
+            float decay,
+            QColor increase_color,
+            QColor idle_color,
+            QColor decrease_color,
+            QVector2D discards,
+            float discard_ratio,
+            std::size_t calibration_interval,
+            std::size_t colormap) :
+            _surface(surface),
+            _canvas_size(canvas_size),
+            _style(style),
+            _decay(decay),
+            _increase_color(increase_color),
+            _idle_color(idle_color),
+            _decrease_color(decrease_color),
+            _discards(discards),
+            _automatic_calibration(discards.isNull()),
+            _discard_ratio(discard_ratio),
+            _calibration_interval(calibration_interval),
+            _frames_since_calibration(calibration_interval),
+            _program_setup(false),
+            _uniforms_changed(true) {
+            if (_automatic_calibration) {
+                _calibration_delta_ts.resize(_surface->pixels());
+            }
+            _colormap_lut.set(colormap_lut::colors(colormap));
+        }
+        event_surface_display_renderer(const event_surface_display_renderer&) = delete;
+        event_surface_display_renderer(event_surface_display_renderer&&) = delete;
+        event_surface_display_renderer& operator=(const event_surface_display_renderer&) = delete;
+        event_surface_display_renderer& operator=(event_surface_display_renderer&&) = delete;
+        virtual ~event_surface_display_renderer() {
+            _colormap_lut.release();
+        }
+
+        /// set_rendering_area defines the rendering area.
+        virtual void set_rendering_area(QRectF paint_area, int window_height) {
+            _paint_area = paint_area;
+            _paint_area.moveTop(window_height - _paint_area.top() - _paint_area.height());
+        }
+
+        /// set_decay defines the pixel decay of the ChangeDetection style, used by the next paint.
+        virtual void set_decay(float decay) {
+            _decay = decay;
+            _uniforms_changed = true;
+        }
+
+        /// set_colors defines the colors of the ChangeDetection style, used by the next paint.
+        virtual void set_colors(QColor increase_color, QColor idle_color, QColor decrease_color) {
+            _increase_color = increase_color;
+            _idle_color = idle_color;
+            _decrease_color = decrease_color;
+            _uniforms_changed = true;
+        }
+
+        /// set_colormap defines the colormap stops of the DeltaT style, uploaded by the next paint.
+        virtual void set_colormap(std::vector<QColor> colors) {
+            _colormap_lut.set(std::move(colors));
+        }
+
+        public slots:
+
+        /// paint sends commands to the GPU.
+        void paint() {
+            if (!initializeOpenGLFunctions()) {
+                throw std::runtime_error("initializing the OpenGL context failed");
+            }
+            const auto texture_id = _surface->upload();
+            if (!_program_setup) {
+                _program_setup = true;
+
+                // get the program and the quad geometry, shared with the other displays of the context
+                const std::string vertex_shader(R""(
+                    #version 330 core
+                    in vec2 coordinates;
+                    out vec2 uv;
+                    uniform float width;
+                    uniform float height;
+                    void main() {
+                        gl_Position = vec4(coordinates, 0.0, 1.0);
+                        uv = vec2((coordinates.x + 1) / 2 * width, (coordinates.y + 1) / 2 * height);
+                    }
+                )"");
+                std::string fragment_shader(R""(
+                    #version 330 core
+                    in vec2 uv;
+                    out vec4 color;
+                    uniform float height;
+                    uniform usampler2DRect sampler;
+                )"");
+                switch (_style) {
+                    case 0:
+                        fragment_shader.append(R""(
+                            uniform float decay;
+                            uniform uint current_t;
+                            uniform vec4 increase_color;
+                            uniform vec4 idle_color;
+                            uniform vec4 decrease_color;
+                            void main() {
+                                uint t_and_is_increase = texture(sampler, uv).x;
+                                float lambda =
+                                    exp(-float((current_t - (t_and_is_increase >> 1u)) & 0x7fffffffu) / decay);
+                                color = lambda
+                                            * ((t_and_is_increase & 1u) == 1u ? increase_color : decrease_color)
+                                        + (1.0 - lambda) * idle_color;
+                            }
+                        )"");
+                        break;
+                    case 1:
+                        fragment_shader.append(R""(
+                            uniform float slope;
+                            uniform float intercept;
+                        )"");
+                        fragment_shader.append(colormap_lut::glsl);
+                        fragment_shader.append(R""(
+                            void main() {
+                                color = colormap(
+                                    slope * log(float(texture(sampler, vec2(uv.x, uv.y + height)).x)) + intercept);
+                            }
+                        )"");
+                        break;
+                    default:
+                        throw std::logic_error("unknown style id");
+                }
+                _gl_cache = &gl_cache::current();
+                _program_id = _gl_cache->program(vertex_shader, fragment_shader);
+                _vertex_array_id = _gl_cache->quad_vertex_array();
+                glUseProgram(_program_id);
+
+                // retrieve the uniform locations
+                _width_location = glGetUniformLocation(_program_id, "width");
+                _height_location = glGetUniformLocation(_program_id, "height");
+                if (_style == 0) {
+                    _decay_location = glGetUniformLocation(_program_id, "decay");
+                    _current_t_location = glGetUniformLocation(_program_id, "current_t");
+                    _increase_color_location = glGetUniformLocation(_program_id, "increase_color");
+                    _idle_color_location = glGetUniformLocation(_program_id, "idle_color");
+                    _decrease_color_location = glGetUniformLocation(_program_id, "decrease_color");
+                } else {
+                    _slope_location = glGetUniformLocation(_program_id, "slope");
+                    _intercept_location = glGetUniformLocation(_program_id, "intercept");
+                    glUniform1i(glGetUniformLocation(_program_id, "lut"), 1);
+                    _colormap_lut.initialize(this);
+                }
+            }
+
+            // draw the shared texture
+            glUseProgram(_program_id);
+            glUniform1f(_width_location, static_cast<GLfloat>(_canvas_size.width()));
+            glUniform1f(_height_location, static_cast<GLfloat>(_canvas_size.height()));
+            if (_style == 0 && (_gl_cache->claim_uniforms(_program_id, this) || _uniforms_changed)) {
+                _uniforms_changed = false;
+                glUniform1f(_decay_location, static_cast<GLfloat>(_decay));
+                glUniform4f(
+                    _increase_color_location,
+                    static_cast<GLfloat>(_increase_color.redF()),
+                    static_cast<GLfloat>(_increase_color.greenF()),
+                    static_cast<GLfloat>(_increase_color.blueF()),
+                    static_cast<GLfloat>(_increase_color.alphaF()));
+                glUniform4f(
+                    _idle_color_location,
+                    static_cast<GLfloat>(_idle_color.redF()),
+                    static_cast<GLfloat>(_idle_color.greenF()),
+                    static_cast<GLfloat>(_idle_color.blueF()),
+                    static_cast<GLfloat>(_idle_color.alphaF()));
+                glUniform4f(
+                    _decrease_color_location,
+                    static_cast<GLfloat>(_decrease_color.redF()),
+                    static_cast<GLfloat>(_decrease_color.greenF()),
+                    static_cast<GLfloat>(_decrease_color.blueF()),
+                    static_cast<GLfloat>(_decrease_color.alphaF()));
+            }
+            glViewport(
+                static_cast<GLint>(_paint_area.left()),
+                static_cast<GLint>(_paint_area.top()),
+                static_cast<GLsizei>(_paint_area.width()),
+                static_cast<GLsizei>(_paint_area.height()));
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glBindTexture(GL_TEXTURE_RECTANGLE, texture_id);
+            if (_style == 0) {
+                glUniform1ui(_current_t_location, static_cast<GLuint>(_surface->current_t()));
+            } else {
+                if (_automatic_calibration) {
+                    ++_frames_since_calibration;
+                    if (_frames_since_calibration >= _calibration_interval) {
+                        _frames_since_calibration = 0;
+                        calibrate();
+                    }
+                }
+                if (_discards.x() > _discards.y()) {
+                    const auto delta = std::log(_discards.x() / _discards.y());
+                    glUniform1f(_slope_location, static_cast<GLfloat>(-1.0f / delta));
+                    glUniform1f(_intercept_location, static_cast<GLfloat>(std::log(_discards.x()) / delta));
+                }
+                _colormap_lut.bind(GL_TEXTURE1);
+            }
+            glBindVertexArray(_vertex_array_id);
+            glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, 0);
+            glBindVertexArray(0);
+            if (_style == 1) {
+                _colormap_lut.unbind(GL_TEXTURE1);
+            }
+            glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+            glUseProgram(0);
+            check_opengl_error();
+        }
+
+        protected:
+        /// calibrate computes the discards from the surface's time differences.
+        virtual void calibrate() {
+            const auto size = _surface->copy_delta_ts(_calibration_delta_ts.data());
+            const auto begin = _calibration_delta_ts.begin();
+            const auto end = std::next(begin, static_cast<std::ptrdiff_t>(size));
+            if (size == 0) {
+                return;
+            }
+            const auto black_discard_position =
+                std::next(begin, std::min(size - 1, static_cast<std::size_t>(size * (1.0f - _discard_ratio))));
+            const auto white_discard_position =
+                std::next(begin, std::min(size - 1, static_cast<std::size_t>(size * _discard_ratio + 0.5f)));
+            std::nth_element(begin, black_discard_position, end);
+            if (white_discard_position < black_discard_position) {
+                std::nth_element(begin, white_discard_position, black_discard_position);
+            } else {
+                std::nth_element(begin, white_discard_position, end);
+            }
+            if (*black_discard_position > *white_discard_position) {
+                _discards = QVector2D(*black_discard_position, *white_discard_position);
+            } else {
+                const auto white_and_black_discards = std::minmax_element(begin, end);
+                if (*white_and_black_discards.second > *white_and_black_discards.first) {
+                    _discards = QVector2D(*white_and_black_discards.second, *white_and_black_discards.first);
+                }
+            }
+        }
+
+        /// check_opengl_error throws if openGL generated an error.
+        virtual void check_opengl_error() {
+            switch (glGetError()) {
+                case GL_NO_ERROR:
+                    break;
+                case GL_INVALID_ENUM:
+                    throw std::logic_error("OpenGL error: GL_INVALID_ENUM");
+                case GL_INVALID_VALUE:
+                    throw std::logic_error("OpenGL error: GL_INVALID_VALUE");
+                case GL_INVALID_OPERATION:
+                    throw std::logic_error("OpenGL error: GL_INVALID_OPERATION");
+                case GL_OUT_OF_MEMORY:
+                    throw std::logic_error("OpenGL error: GL_OUT_OF_MEMORY");
+            }
+        }
+
+        event_surface_renderer* _surface;
+        QSize _canvas_size;
+        std::size_t _style;
+        float _decay;
+        QColor _increase_color;
+        QColor _idle_color;
+        QColor _decrease_color;
+        QVector2D _discards;
+        bool _automatic_calibration;
+        float _discard_ratio;
+        std::size_t _calibration_interval;
+        std::size_t _frames_since_calibration;
+        colormap_lut _colormap_lut;
+        std::vector<uint32_t> _calibration_delta_ts;
+        QRectF _paint_area;
+        bool _program_setup;
+        bool _uniforms_changed;
+        gl_cache* _gl_cache;
+        GLuint _program_id;
+        GLuint _vertex_array_id;
+        GLuint _width_location;
+        GLuint _height_location;
+        GLuint _decay_location;
+        GLuint _current_t_location;
+        GLuint _increase_color_location;
+        GLuint _idle_color_location;
+        GLuint _decrease_color_location;
+        GLuint _slope_location;
+        GLuint _intercept_location;
+    };
+
+    /// event_surface_display displays the content of an event_surface.
+    /// Several displays, with different styles, can share the same surface.
+    class event_surface_display : public QQuickItem {
+        Q_OBJECT
+        Q_INTERFACES(QQmlParserStatus)
+        Q_PROPERTY(chameleon::event_surface* surface READ surface WRITE set_surface)
+        Q_PROPERTY(Style style READ style WRITE set_style)
+        Q_PROPERTY(float decay READ decay WRITE set_decay NOTIFY decay_changed)
+        Q_PROPERTY(QColor increase_color READ increase_color WRITE set_increase_color NOTIFY increase_color_changed)
+        Q_PROPERTY(QColor idle_color READ idle_color WRITE set_idle_color NOTIFY idle_color_changed)
+        Q_PROPERTY(QColor decrease_color READ decrease_color WRITE set_decrease_color NOTIFY decrease_color_changed)
+        Q_PROPERTY(QVector2D discards READ discards WRITE set_discards)
+        Q_PROPERTY(float discard_ratio READ discard_ratio WRITE set_discard_ratio)
+        Q_PROPERTY(int calibration_interval READ calibration_interval WRITE set_calibration_interval)
+        Q_PROPERTY(Colormap colormap READ colormap WRITE set_colormap NOTIFY colormap_changed)
+        Q_PROPERTY(QRectF paint_area READ paint_area)
+        Q_ENUMS(Style)
+        Q_ENUMS(Colormap)
+        public:
+        /// Style defines how the surface is displayed.
+        /// ChangeDetection shows the decayed polarities, like a dvs_display, and DeltaT the time differences between
+        /// successive events, like a delta_t_display.
+        enum Style { ChangeDetection, DeltaT };
+
+        /// Colormap defines the colormap used by the DeltaT style.
+        enum Colormap { Grey, Hot, Jet };
+
+        event_surface_display() :
+            _ready(false),
+            _surface(nullptr),
+            _style(Style::ChangeDetection),
+            _decay(1e5),
+            _increase_color(Qt::white),
+            _idle_color(Qt::gray),
+            _decrease_color(Qt::black),
+            _discards(QVector2D(0, 0)),
+            _discard_ratio(0.01f),
+            _calibration_interval(10),
+            _colormap(Colormap::Grey),
+            _parameters_changed(false) {
+            connect(this, &QQuickItem::windowChanged, this, &event_surface_display::handle_window_changed);
+        }
+        event_surface_display(const event_surface_display&) = delete;
+        event_surface_display(event_surface_display&&) = delete;
+        event_surface_display& operator=(const event_surface_display&) = delete;
+        event_surface_display& operator=(event_surface_display&&) = delete;
+        virtual ~event_surface_display() {}
+
+        /// set_surface defines the displayed surface.
+        /// The surface will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_surface(event_surface* surface) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("surface can only be set during qml construction");
+            }
+            _surface = surface;
+        }
+
+        /// surface returns the currently used surface.
+        virtual event_surface* surface() const {
+            return _surface;
+        }
+
+        /// set_style defines the display style.
+        /// The style will be passed to the openGL renderer, therefore it should only be set during qml construction.
+        virtual void set_style(Style style) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("style can only be set during qml construction");
+            }
+            _style = style;
+        }
+
+        /// style returns the currently used style.
+        virtual Style style() const {
+            return _style;
+        }
+
+        /// set_decay defines the pixel decay of the ChangeDetection style.
+        /// The decay can be changed at any time, it is passed to the openGL renderer before the next frame.
+        virtual void set_decay(float decay) {
+            if (decay != _decay) {
+                _decay = decay;
+                _parameters_changed = true;
+                decay_changed(_decay);
+                trigger_draw();
+            }
+        }
+
+        /// decay returns the currently used decay.
+        virtual float decay() const {
+            return _decay;
+        }
+
+        /// set_increase_color defines the color used to represent increase events.
+        /// The color can be changed at any time, it is passed to the openGL renderer before the next frame.
+        virtual void set_increase_color(const QColor& increase_color) {
+            if (increase_color != _increase_color) {
+                _increase_color = increase_color;
+                _parameters_changed = true;
+                increase_color_changed(_increase_color);
+                trigger_draw();
+            }
+        }
+
+        /// increase_color returns the currently used increase_color.
+        virtual QColor increase_color() const {
+            return _increase_color;
+        }
+
+        /// set_idle_color defines the color used to represent idle pixels.
+        /// The color can be changed at any time, it is passed to the openGL renderer before the next frame.
+        virtual void set_idle_color(const QColor& idle_color) {
+            if (idle_color != _idle_color) {
+                _idle_color = idle_color;
+                _parameters_changed = true;
+                idle_color_changed(_idle_color);
+                trigger_draw();
+            }
+        }
+
+        /// idle_color returns the currently used idle_color.
+        virtual QColor idle_color() const {
+            return _idle_color;
+        }
+
+        /// set_decrease_color defines the color used to represent decrease events.
+        /// The color can be changed at any time, it is passed to the openGL renderer before the next frame.
+        virtual void set_decrease_color(const QColor& decrease_color) {
+            if (decrease_color != _decrease_color) {
+                _decrease_color = decrease_color;
+                _parameters_changed = true;
+                decrease_color_changed(_decrease_color);
+                trigger_draw();
+            }
+        }
+
+        /// decrease_color returns the currently used decrease_color.
+        virtual QColor decrease_color() const {
+            return _decrease_color;
+        }
+
+        /// set_discards defines the discards of the DeltaT style.
+        /// if both the black and white discards are zero (default), the discards are computed automatically.
+        /// The discards will be passed to the openGL renderer, therefore they should only be set during qml
+        /// construction.
+        virtual void set_discards(QVector2D discards) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("discards can only be set during qml construction");
+            }
+            _discards = discards;
+        }
+
+        /// discards returns the currently used discards.
+        virtual QVector2D discards() const {
+            return _discards;
+        }
+
+        /// set_discard_ratio defines the discards ratio.
+        /// The discards ratio will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_discard_ratio(float discard_ratio) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("discard_ratio can only be set during qml construction");
+            }
+            _discard_ratio = discard_ratio;
+        }
+
+        /// discard_ratio returns the currently used discard_ratio.
+        virtual float discard_ratio() const {
+            return _discard_ratio;
+        }
+
+        /// set_calibration_interval defines the number of frames between automatic discards updates.
+        /// The calibration interval will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_calibration_interval(int calibration_interval) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("calibration_interval can only be set during qml construction");
+            }
+            if (calibration_interval < 1) {
+                throw std::logic_error("calibration_interval must be at least 1");
+            }
+            _calibration_interval = calibration_interval;
+        }
+
+        /// calibration_interval returns the currently used calibration_interval.
+        virtual int calibration_interval() const {
+            return _calibration_interval;
+        }
+
+        /// set_colormap defines the colormap of the DeltaT style.
+        /// The colormap can be changed at any time, the renderer's colormap texture is updated by the next frame.
+        virtual void set_colormap(Colormap colormap) {
+            if (colormap != _colormap) {
+                _colormap = colormap;
+                _parameters_changed = true;
+                colormap_changed(_colormap);
+                trigger_draw();
+            }
+        }
+
+        /// colormap returns the currently used colormap.
+        virtual Colormap colormap() const {
+            return _colormap;
+        }
+
+        /// paint_area returns the paint area in window coordinates.
+        virtual QRectF paint_area() const {
+            return _paint_area;
+        }
+
+        /// componentComplete is called when all the qml values are bound.
+        virtual void componentComplete() override {
+            if (!_surface) {
+                throw std::logic_error("surface cannot be null, make sure that it is set in qml");
+            }
+            setImplicitWidth(_surface->canvas_size().width());
+            setImplicitHeight(_surface->canvas_size().height());
+            _ready.store(true, std::memory_order_release);
+        }
+
+        signals:
+
+        /// paintAreaChanged notifies a paint area change.
+        void paintAreaChanged(QRectF paint_area);
+
+        /// decay_changed notifies a change of the decay.
+        void decay_changed(float decay);
+
+        /// increase_color_changed notifies a change of the increase color.
+        void increase_color_changed(QColor increase_color);
+
+        /// idle_color_changed notifies a change of the idle color.
+        void idle_color_changed(QColor idle_color);
+
+        /// decrease_color_changed notifies a change of the decrease color.
+        void decrease_color_changed(QColor decrease_color);
+
+        /// colormap_changed notifies a change of the colormap.
+        void colormap_changed(Colormap colormap);
+
+        public slots:
+
+        /// sync adapts the renderer to external changes.
+        void sync() {
+            if (_ready.load(std::memory_order_relaxed)) {
+                const auto canvas_size = _surface->canvas_size();
+                if (!_event_surface_display_renderer) {
+                    _surface->sync();
+                    if (!_surface->renderer()) {
+                        return;
+                    }
+                    _event_surface_display_renderer =
+                        std::unique_ptr<event_surface_display_renderer>(new event_surface_display_renderer(
+                            _surface->renderer(),
+                            canvas_size,
+                            static_cast<std::size_t>(_style),
+                            _decay,
+                            _increase_color,
+                            _idle_color,
+                            _decrease_color,
+                            _discards,
+                            _discard_ratio,
+                            static_cast<std::size_t>(_calibration_interval),
+                            static_cast<std::size_t>(_colormap)));
+                    connect(
+                        window(),
+                        &QQuickWindow::beforeRendering,
+                        _event_surface_display_renderer.get(),
+                        &event_surface_display_renderer::paint,
+                        Qt::DirectConnection);
+                } else if (_parameters_changed) {
+                    _event_surface_display_renderer->set_decay(_decay);
+                    _event_surface_display_renderer->set_colors(_increase_color, _idle_color, _decrease_color);
+                    _event_surface_display_renderer->set_colormap(
+                        colormap_lut::colors(static_cast<std::size_t>(_colormap)));
+                }
+                _parameters_changed = false;
+                auto clear_area =
+                    QRectF(0, 0, width() * window()->devicePixelRatio(), height() * window()->devicePixelRatio());
+                for (auto item = static_cast<QQuickItem*>(this); item; item = item->parentItem()) {
+                    clear_area.moveLeft(clear_area.left() + item->x() * window()->devicePixelRatio());
+                    clear_area.moveTop(clear_area.top() + item->y() * window()->devicePixelRatio());
+                }
+                if (clear_area != _clear_area) {
+                    _clear_area = std::move(clear_area);
+                    if (clear_area.width() * canvas_size.height() > clear_area.height() * canvas_size.width()) {
+                        _paint_area.setWidth(clear_area.height() * canvas_size.width() / canvas_size.height());
+                        _paint_area.setHeight(clear_area.height());
+                        _paint_area.moveLeft(clear_area.left() + (clear_area.width() - _paint_area.width()) / 2);
+                        _paint_area.moveTop(clear_area.top());
+                    } else {
+                        _paint_area.setWidth(clear_area.width());
+                        _paint_area.setHeight(clear_area.width() * canvas_size.height() / canvas_size.width());
+                        _paint_area.moveLeft(clear_area.left());
+                        _paint_area.moveTop(clear_area.top() + (clear_area.height() - _paint_area.height()) / 2);
+                    }
+                    _event_surface_display_renderer->set_rendering_area(
+                        _paint_area, window()->height() * window()->devicePixelRatio());
+                    paintAreaChanged(_paint_area);
+                }
+            }
+        }
+
+        /// cleanup frees the owned renderer.
+        void cleanup() {
+            _event_surface_display_renderer.reset();
+        }
+
+        /// trigger_draw requests a window refresh.
+        void trigger_draw() {
+            if (window()) {
+                render_scheduler::of(window())->request_update();
+            }
+        }
+
+        private slots:
+
+        /// handle_window_changed must be triggered after a window transformation.
+        void handle_window_changed(QQuickWindow* window) {
+            if (window) {
+                connect(
+                    window,
+                    &QQuickWindow::beforeSynchronizing,
+                    this,
+                    &event_surface_display::sync,
+                    Qt::DirectConnection);
+                connect(
+                    window,
+                    &QQuickWindow::sceneGraphInvalidated,
+                    this,
+                    &event_surface_display::cleanup,
+                    Qt::DirectConnection);
+                window->setClearBeforeRendering(false);
+            }
+        }
+
+        protected:
+        std::atomic_bool _ready;
+        event_surface* _surface;
+        Style _style;
+        float _decay;
+        QColor _increase_color;
+        QColor _idle_color;
+        QColor _decrease_color;
+        QVector2D _discards;
+        float _discard_ratio;
+        int _calibration_interval;
+        Colormap _colormap;
+        bool _parameters_changed;
+        std::unique_ptr<event_surface_display_renderer> _event_surface_display_renderer;
+        QRectF _clear_area;
+        QRectF _paint_area;
+    };
+}
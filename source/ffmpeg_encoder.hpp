@@ -0,0 +1,332 @@
+#pragma once
+
+#include "frame_generator.hpp"
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// ffmpeg_codec lists the video encoders used by ffmpeg_encoder.
+    /// software uses libx264 on the CPU, the other codecs use the GPU's encoder through VAAPI (Linux), NVENC (Nvidia)
+    /// or VideoToolbox (macOS), which must be supported by the installed ffmpeg.
+    enum class ffmpeg_codec {
+        software,
+        vaapi,
+        nvenc,
+        videotoolbox,
+    };
+
+    /// ffmpeg_encoder writes NV12 frames to the standard input of an ffmpeg process, which encodes them as H.264.
+    /// Since the frames are converted by the GPU and hardware codecs do not convert them again, continuous recording
+    /// only costs a copy per frame on the CPU. The process is started on the first frame, with the frame's
+    /// dimensions, and the executable is looked up in the path. The arguments are passed to the process without a
+    /// shell, therefore the filename needs no escaping.
+    class ffmpeg_encoder : public frame_encoder {
+        public:
+        ffmpeg_encoder(
+            const std::string& filename,
+            double frame_rate,
+            ffmpeg_codec codec,
+            const std::string& executable = "ffmpeg") :
+            _filename(filename),
+            _frame_rate(frame_rate),
+            _codec(codec),
+            _executable(executable),
+            _running(false),
+            _width(0),
+            _height(0) {
+            if (_frame_rate <= 0) {
+                throw std::logic_error("frame_rate must be strictly positive");
+            }
+        }
+        ffmpeg_encoder(const ffmpeg_encoder&) = delete;
+        ffmpeg_encoder(ffmpeg_encoder&&) = delete;
+        ffmpeg_encoder& operator=(const ffmpeg_encoder&) = delete;
+        ffmpeg_encoder& operator=(ffmpeg_encoder&&) = delete;
+        virtual ~ffmpeg_encoder() {
+            if (_running) {
+                stop();
+            }
+        }
+
+        /// format returns the frame format expected by encode.
+        virtual frame_format format() const override {
+            return frame_format::nv12;
+        }
+
+        /// encode writes a frame to the ffmpeg process.
+        /// If the process exited (for instance because the codec is not available), it throws instead of raising
+        /// SIGPIPE.
+        virtual void encode(const frame& captured) override {
+            if (captured.format != frame_format::nv12) {
+                throw std::logic_error("ffmpeg_encoder expects NV12 frames");
+            }
+            if (!_running) {
+                _width = captured.width;
+                _height = captured.height;
+                if (!start(arguments())) {
+                    throw std::runtime_error(std::string("starting '") + _executable + "' failed");
+                }
+            } else if (captured.width != _width || captured.height != _height) {
+                throw std::logic_error("the frame dimensions changed during the recording");
+            }
+            if (!write(captured.pixels.data(), captured.pixels.size())) {
+                throw std::runtime_error(std::string("writing to '") + _executable + "' failed");
+            }
+        }
+
+        /// finish closes the ffmpeg standard input, and waits for the end of the encoding.
+        virtual void finish() override {
+            if (_running) {
+                if (!stop()) {
+                    throw std::runtime_error(std::string("encoding '") + _filename + "' failed");
+                }
+            }
+        }
+
+        protected:
+        /// arguments returns the ffmpeg arguments for the current dimensions, starting with the executable.
+        virtual std::vector<std::string> arguments() const {
+            std::vector<std::string> result{_executable,
+                                            "-loglevel",
+                                            "error",
+                                            "-y",
+                                            "-f",
+                                            "rawvideo",
+                                            "-pix_fmt",
+                                            "nv12",
+                                            "-s",
+                                            std::to_string(_width) + "x" + std::to_string(_height),
+                                            "-framerate",
+                                            std::to_string(_frame_rate),
+                                            "-i",
+                                            "-"};
+            switch (_codec) {
+                case ffmpeg_codec::software:
+                    result.insert(result.end(), {"-c:v", "libx264", "-preset", "veryfast", "-pix_fmt", "yuv420p"});
+                    break;
+                case ffmpeg_codec::vaapi:
+                    result.insert(
+                        result.end(),
+                        {"-vaapi_device", "/dev/dri/renderD128", "-vf", "format=nv12,hwupload", "-c:v", "h264_vaapi"});
+                    break;
+                case ffmpeg_codec::nvenc:
+                    result.insert(result.end(), {"-c:v", "h264_nvenc"});
+                    break;
+                case ffmpeg_codec::videotoolbox:
+                    result.insert(result.end(), {"-c:v", "h264_videotoolbox"});
+                    break;
+            }
+            result.push_back(_filename);
+            return result;
+        }
+
+#ifdef _WIN32
+        /// start runs the process with a pipe as standard input, and returns false if it could not be started.
+        virtual bool start(const std::vector<std::string>& arguments) {
+            SECURITY_ATTRIBUTES attributes{sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE};
+            HANDLE read_handle = nullptr;
+            HANDLE write_handle = nullptr;
+            if (!CreatePipe(&read_handle, &write_handle, &attributes, 0)) {
+                return false;
+            }
+            SetHandleInformation(write_handle, HANDLE_FLAG_INHERIT, 0);
+            std::string command_line;
+            for (const auto& argument : arguments) {
+                if (!command_line.empty()) {
+                    command_line.push_back(' ');
+                }
+                command_line.append(quote(argument));
+            }
+            STARTUPINFOA startup_info{};
+            startup_info.cb = sizeof(startup_info);
+            startup_info.dwFlags = STARTF_USESTDHANDLES;
+            startup_info.hStdInput = read_handle;
+            startup_info.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+            startup_info.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+            PROCESS_INFORMATION process_information{};
+            const auto created = CreateProcessA(
+                nullptr,
+                &command_line[0],
+                nullptr,
+                nullptr,
+                TRUE,
+                0,
+                nullptr,
+                nullptr,
+                &startup_info,
+                &process_information);
+            CloseHandle(read_handle);
+            if (!created) {
+                CloseHandle(write_handle);
+                return false;
+            }
+            CloseHandle(process_information.hThread);
+            _process = process_information.hProcess;
+            _stdin = write_handle;
+            _running = true;
+            return true;
+        }
+
+        /// write sends bytes to the process's standard input, and returns false if the process closed it.
+        virtual bool write(const uint8_t* data, std::size_t size) {
+            while (size > 0) {
+                const auto chunk = static_cast<DWORD>(size < (1u << 30) ? size : (1u << 30));
+                DWORD written = 0;
+                if (!WriteFile(_stdin, data, chunk, &written, nullptr)) {
+                    return false;
+                }
+                data += written;
+                size -= written;
+            }
+            return true;
+        }
+
+        /// stop closes the process's standard input, waits for its end, and returns whether it succeeded.
+        virtual bool stop() {
+            _running = false;
+            CloseHandle(_stdin);
+            WaitForSingleObject(_process, INFINITE);
+            DWORD exit_code = 1;
+            GetExitCodeProcess(_process, &exit_code);
+            CloseHandle(_process);
+            return exit_code == 0;
+        }
+
+        /// quote escapes an argument with the rules used by the C runtime to split command lines.
+        static std::string quote(const std::string& argument) {
+            if (!argument.empty() && argument.find_first_of(" \t\n\v\"") == std::string::npos) {
+                return argument;
+            }
+            std::string result("\"");
+            std::size_t backslashes = 0;
+            for (const auto character : argument) {
+                if (character == '\\') {
+                    ++backslashes;
+                } else {
+                    if (character == '"') {
+                        result.append(backslashes + 1, '\\');
+                    }
+                    backslashes = 0;
+                }
+                result.push_back(character);
+            }
+            result.append(backslashes, '\\');
+            result.push_back('"');
+            return result;
+        }
+
+        HANDLE _process;
+        HANDLE _stdin;
+#else
+        /// start runs the process with a pipe as standard input, and returns false if it could not be started.
+        virtual bool start(const std::vector<std::string>& arguments) {
+            int pipe_fds[2];
+            if (pipe(pipe_fds) != 0) {
+                return false;
+            }
+
+            // neither end is inherited by other children, the child's standard input is a duplicate
+            fcntl(pipe_fds[0], F_SETFD, FD_CLOEXEC);
+            fcntl(pipe_fds[1], F_SETFD, FD_CLOEXEC);
+            posix_spawn_file_actions_t actions;
+            posix_spawn_file_actions_init(&actions);
+            posix_spawn_file_actions_adddup2(&actions, pipe_fds[0], STDIN_FILENO);
+            std::vector<char*> argv;
+            for (const auto& argument : arguments) {
+                argv.push_back(const_cast<char*>(argument.c_str()));
+            }
+            argv.push_back(nullptr);
+            pid_t pid = 0;
+            const auto status = posix_spawnp(&pid, argv.front(), &actions, nullptr, argv.data(), environ);
+            posix_spawn_file_actions_destroy(&actions);
+            close(pipe_fds[0]);
+            if (status != 0) {
+                close(pipe_fds[1]);
+                return false;
+            }
+            _pid = pid;
+            _stdin = pipe_fds[1];
+            _running = true;
+            return true;
+        }
+
+        /// write sends bytes to the process's standard input, and returns false if the process closed it.
+        /// SIGPIPE is blocked in the calling thread during the write, and a SIGPIPE raised by the write is consumed,
+        /// so that a dead process is reported as an error instead of terminating the application.
+        virtual bool write(const uint8_t* data, std::size_t size) {
+            sigset_t sigpipe;
+            sigemptyset(&sigpipe);
+            sigaddset(&sigpipe, SIGPIPE);
+            sigset_t pending;
+            sigpending(&pending);
+            const auto sigpipe_was_pending = sigismember(&pending, SIGPIPE) == 1;
+            sigset_t previous_mask;
+            pthread_sigmask(SIG_BLOCK, &sigpipe, &previous_mask);
+            auto success = true;
+            while (size > 0) {
+                const auto written = ::write(_stdin, data, size);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    success = false;
+                    break;
+                }
+                data += written;
+                size -= static_cast<std::size_t>(written);
+            }
+            if (!success && !sigpipe_was_pending) {
+                sigpending(&pending);
+                if (sigismember(&pending, SIGPIPE) == 1) {
+                    int signal = 0;
+                    sigwait(&sigpipe, &signal);
+                }
+            }
+            pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
+            return success;
+        }
+
+        /// stop closes the process's standard input, waits for its end, and returns whether it succeeded.
+        virtual bool stop() {
+            _running = false;
+            close(_stdin);
+            int status = 0;
+            while (waitpid(_pid, &status, 0) < 0) {
+                if (errno != EINTR) {
+                    return false;
+                }
+            }
+            return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+
+        pid_t _pid;
+        int _stdin;
+#endif
+
+        const std::string _filename;
+        const double _frame_rate;
+        const ffmpeg_codec _codec;
+        const std::string _executable;
+        bool _running;
+        std::size_t _width;
+        std::size_t _height;
+    };
+}
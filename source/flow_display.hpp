@@ -1,14 +1,22 @@
 #pragma once
 
+#include "performance_monitor.hpp"
+#include "render_scheduler.hpp"
+#include "snapshot_ring.hpp"
+#include "tiled_layout.hpp"
 #include <QQmlParserStatus>
+#include <QtCore/QTimer>
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QOpenGLFunctions_3_3_Core>
 #include <QtQuick/QQuickItem>
 #include <QtQuick/qquickwindow.h>
 #include <algorithm>
-#include <array>
 #include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <stdexcept>
@@ -21,25 +29,30 @@ namespace chameleon {
     class flow_display_renderer : public QObject, public QOpenGLFunctions_3_3_Core {
         Q_OBJECT
         public:
-        flow_display_renderer(QSize canvas_size, float speed_to_length, float decay) :
+        flow_display_renderer(
+            QSize canvas_size,
+            float speed_to_length,
+            float decay,
+            bool sparse,
+            std::size_t tile_size) :
             _canvas_size(canvas_size),
             _speed_to_length(speed_to_length),
             _decay(decay),
+            _sparse(sparse),
+            _layout(_canvas_size, tile_size),
+            _lifetime(decay * std::log(256.0f)),
+            _epoch(0),
+            _current_t(0),
+            _pushed_events(0),
+            _keyframe_interval(0),
+            _next_keyframe_t(std::numeric_limits<uint64_t>::max()),
             _program_setup(false) {
-            _indices.reserve(_canvas_size.width() * _canvas_size.height());
-            _coordinates.reserve(_canvas_size.width() * _canvas_size.height() * 2);
-            _ts_and_flows.reserve(_canvas_size.width() * _canvas_size.height() * 3);
-            for (qint32 y = 0; y < _canvas_size.height(); ++y) {
-                for (qint32 x = 0; x < _canvas_size.width(); ++x) {
-                    _indices.push_back(x + y * _canvas_size.width());
-                    _coordinates.push_back(static_cast<float>(x));
-                    _coordinates.push_back(static_cast<float>(y));
-                    _ts_and_flows.push_back(-std::numeric_limits<float>::infinity());
-                    _ts_and_flows.push_back(static_cast<float>(0.0));
-                    _ts_and_flows.push_back(static_cast<float>(0.0));
-                }
+            if (_sparse) {
+                _active_positions.resize(_layout.size(), 0);
+            } else {
+                _pixels.resize(_layout.size(), pixel{0, 0, 0});
+                _painted_pixels.resize(_pixels.size());
             }
-
             _accessing_flows.clear(std::memory_order_release);
         }
         flow_display_renderer(const flow_display_renderer&) = delete;
@@ -47,9 +60,12 @@ namespace chameleon {
         flow_display_renderer& operator=(const flow_display_renderer&) = delete;
         flow_display_renderer& operator=(flow_display_renderer&&) = delete;
         virtual ~flow_display_renderer() {
-            glDeleteBuffers(static_cast<GLsizei>(_vertex_buffers_ids.size()), _vertex_buffers_ids.data());
-            glDeleteVertexArrays(1, &_vertex_array_id);
-            glDeleteProgram(_program_id);
+            if (_program_setup) {
+                _performance_monitor.release();
+                glDeleteBuffers(1, &_vertex_buffer_id);
+                glDeleteVertexArrays(1, &_vertex_array_id);
+                glDeleteProgram(_program_id);
+            }
         }
 
         /// set_rendering_area defines the rendering area.
@@ -58,17 +74,135 @@ namespace chameleon {
             _paint_area.moveTop(window_height - _paint_area.top() - _paint_area.height());
         }
 
+        /// set_speed_to_length defines the arrows length ratio, used by the next paint.
+        virtual void set_speed_to_length(float speed_to_length) {
+            _speed_to_length = speed_to_length;
+        }
+
+        /// set_decay defines the flow decay, used by the next paint.
+        /// In sparse mode, the pixels lifetime follows the decay.
+        virtual void set_decay(float decay) {
+            _performance_monitor.lock(_accessing_flows);
+            _decay = decay;
+            _lifetime = decay * std::log(256.0f);
+            _accessing_flows.clear(std::memory_order_release);
+        }
+
+        /// tile_size returns the side of the pixels state's tiles, or 0 if the state is row-major.
+        virtual std::size_t tile_size() const {
+            return _layout.tile_size();
+        }
+
+        /// uploaded_bytes returns the number of bytes sent to the GPU during the last frame.
+        virtual std::size_t uploaded_bytes() const {
+            return _performance_monitor.uploaded_bytes();
+        }
+
+        /// sample_performance returns the renderer's counters, with rates measured since the previous call.
+        /// It must always be called by the same thread.
+        virtual performance_counters sample_performance() {
+            return _performance_monitor.sample();
+        }
+
+        /// set_keyframes enables the snapshot ring: the flows state is stored every interval microseconds, and the
+        /// latest capacity keyframes are kept. It must be called before any event is pushed.
+        virtual void set_keyframes(uint64_t interval, std::size_t capacity) {
+            if (interval == 0) {
+                throw std::logic_error("the keyframe interval must be larger than 0");
+            }
+            _performance_monitor.lock(_accessing_flows);
+            _keyframe_interval = interval;
+            _keyframe_state.assign(_layout.size() * 2 + 2, 0);
+            _snapshot_ring.reset(new snapshot_ring<uint32_t>(_keyframe_state.data(), _keyframe_state.size(), capacity));
+            _next_keyframe_t = interval;
+            _accessing_flows.clear(std::memory_order_release);
+        }
+
+        /// restore replaces the flows state with the latest keyframe at or before t, and returns the keyframe's time.
+        /// The events with a timestamp larger than or equal to the returned time must then be pushed again to reach
+        /// t. If there is no such keyframe, the pixels are reset and 0 is returned. Replayed events only create
+        /// keyframes past the latest stored one.
+        virtual uint64_t restore(uint64_t t) {
+            if (!_snapshot_ring) {
+                throw std::logic_error("keyframes are not enabled");
+            }
+            _performance_monitor.lock(_accessing_flows);
+            const auto keyframe_t = _snapshot_ring->restore(t, _keyframe_state.data());
+            const auto pixels = _layout.size();
+            _epoch = static_cast<uint64_t>(_keyframe_state[pixels * 2])
+                     | (static_cast<uint64_t>(_keyframe_state[pixels * 2 + 1]) << 32);
+            if (_sparse) {
+                _active_pixels.clear();
+                std::fill(_active_positions.begin(), _active_positions.end(), 0);
+                for (std::size_t index = 0; index < pixels; ++index) {
+                    if (_keyframe_state[index * 2 + 1] != 0) {
+                        pixel restored;
+                        std::memcpy(&restored, &_keyframe_state[index * 2], sizeof(pixel));
+                        _active_pixels.push_back(
+                            active_pixel{static_cast<uint32_t>(index), restored.t, restored.vx, restored.vy});
+                        _active_positions[index] = static_cast<uint32_t>(_active_pixels.size());
+                    }
+                }
+            } else {
+                std::memcpy(_pixels.data(), _keyframe_state.data(), pixels * sizeof(pixel));
+            }
+            _current_t = keyframe_t;
+            _next_keyframe_t = std::max(
+                (keyframe_t / _keyframe_interval + 1) * _keyframe_interval,
+                _snapshot_ring->latest_t() + _keyframe_interval);
+            _accessing_flows.clear(std::memory_order_release);
+            return keyframe_t;
+        }
+
+        /// keyframes_bytes returns the memory used by the compressed keyframes.
+        virtual std::size_t keyframes_bytes() {
+            if (!_snapshot_ring) {
+                return 0;
+            }
+            _performance_monitor.lock(_accessing_flows);
+            const auto bytes = _snapshot_ring->compressed_bytes();
+            _accessing_flows.clear(std::memory_order_release);
+            return bytes;
+        }
+
         /// push adds an event to the display.
         template <typename Event>
         void push(Event event) {
-            const auto index =
-                (static_cast<std::size_t>(event.x) + static_cast<std::size_t>(event.y) * _canvas_size.width()) * 3;
-            while (_accessing_flows.test_and_set(std::memory_order_acquire)) {
-            }
-            _current_t = event.t;
-            _ts_and_flows[index] = static_cast<float>(event.t);
-            _ts_and_flows[index + 1] = static_cast<float>(event.vx);
-            _ts_and_flows[index + 2] = static_cast<float>(event.vy);
+            _performance_monitor.lock(_accessing_flows);
+            if (static_cast<uint64_t>(event.t) >= _next_keyframe_t) {
+                snapshot(static_cast<uint64_t>(event.t));
+            }
+            _current_t = static_cast<uint64_t>(event.t);
+            ++_pushed_events;
+            write(
+                static_cast<std::size_t>(event.x),
+                static_cast<std::size_t>(event.y),
+                static_cast<uint64_t>(event.t),
+                static_cast<float>(event.vx),
+                static_cast<float>(event.vy));
+            _accessing_flows.clear(std::memory_order_release);
+        }
+
+        /// push adds a batch of events to the display.
+        /// The lock is acquired once per batch rather than once per event.
+        template <typename Iterator>
+        void push(Iterator begin, Iterator end) {
+            if (begin == end) {
+                return;
+            }
+            _performance_monitor.lock(_accessing_flows);
+            for (; begin != end; ++begin, ++_pushed_events) {
+                if (static_cast<uint64_t>(begin->t) >= _next_keyframe_t) {
+                    snapshot(static_cast<uint64_t>(begin->t));
+                }
+                _current_t = static_cast<uint64_t>(begin->t);
+                write(
+                    static_cast<std::size_t>(begin->x),
+                    static_cast<std::size_t>(begin->y),
+                    static_cast<uint64_t>(begin->t),
+                    static_cast<float>(begin->vx),
+                    static_cast<float>(begin->vy));
+            }
             _accessing_flows.clear(std::memory_order_release);
         }
 
@@ -76,16 +210,24 @@ namespace chameleon {
         template <typename Iterator>
         void assign(Iterator begin, Iterator end) {
             std::size_t index = 0;
-            while (_accessing_flows.test_and_set(std::memory_order_acquire)) {
+            _performance_monitor.lock(_accessing_flows);
+            if (_sparse) {
+                _active_pixels.clear();
+                std::fill(_active_positions.begin(), _active_positions.end(), 0);
             }
             for (; begin != end; ++begin) {
-                if (begin->t > _current_t) {
-                    _current_t = begin->t;
+                if (static_cast<uint64_t>(begin->t) > _current_t) {
+                    _current_t = static_cast<uint64_t>(begin->t);
+                }
+                if (!_sparse || begin->vx != 0 || begin->vy != 0) {
+                    write(
+                        index % static_cast<std::size_t>(_canvas_size.width()),
+                        index / static_cast<std::size_t>(_canvas_size.width()),
+                        static_cast<uint64_t>(begin->t),
+                        static_cast<float>(begin->vx),
+                        static_cast<float>(begin->vy));
                 }
-                _ts_and_flows[index] = static_cast<float>(begin->t);
-                _ts_and_flows[index + 1] = static_cast<float>(begin->vx);
-                _ts_and_flows[index + 2] = static_cast<float>(begin->vy);
-                index += 3;
+                ++index;
             }
             _accessing_flows.clear(std::memory_order_release);
         }
@@ -103,16 +245,21 @@ namespace chameleon {
                 // compile the vertex shader
                 const auto vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
                 {
-                    const std::string vertex_shader(R""(
+                    std::string vertex_shader(R""(
                         #version 330 core
-                        in vec2 coordinates;
-                        in vec3 t_and_flow;
-                        out vec3 geometry_t_and_flow;
-                        uniform float width;
-                        uniform float height;
+                        in uint index;
+                        in uint t;
+                        in vec2 flow;
+                        out vec3 geometry_age_and_flow;
+                        uniform bool sparse;
+                        uniform uint current_t;
+                    )"");
+                    vertex_shader.append(tiled_layout::glsl);
+                    vertex_shader.append(R""(
                         void main() {
-                            gl_Position = vec4(coordinates.x, coordinates.y, 0.0, 1.0);
-                            geometry_t_and_flow = t_and_flow;
+                            uvec2 position = tiled_position(sparse ? index : uint(gl_VertexID));
+                            gl_Position = vec4(float(position.x), float(position.y), 0.0, 1.0);
+                            geometry_age_and_flow = vec3(t > current_t ? -1.0 : float(current_t - t), flow);
                         }
                     )"");
                     auto vertex_shader_content = vertex_shader.c_str();
@@ -134,13 +281,12 @@ namespace chameleon {
                         #define flow_display_pi 3.1415926535897932384626433832795
                         layout(points) in;
                         layout(line_strip, max_vertices = 2) out;
-                        in vec3 geometry_t_and_flow[];
+                        in vec3 geometry_age_and_flow[];
                         out vec4 fragment_color;
                         uniform float width;
                         uniform float height;
                         uniform float speed_to_length;
                         uniform float decay;
-                        uniform float current_t;
                         const vec3 color_table[7] = vec3[](
                             vec3(1.0, 1.0, 0.0),
                             vec3(0.0, 1.0, 0.0),
@@ -150,16 +296,16 @@ namespace chameleon {
                             vec3(1.0, 0.0, 0.0),
                             vec3(1.0, 1.0, 0.0));
                         void main() {
-                            if (geometry_t_and_flow[0].x > current_t) {
+                            if (geometry_age_and_flow[0].x < 0.0) {
                                 return;
                             }
-                            vec2 speed_vector = vec2(geometry_t_and_flow[0].y, geometry_t_and_flow[0].z)
+                            vec2 speed_vector = vec2(geometry_age_and_flow[0].y, geometry_age_and_flow[0].z)
                                                 * speed_to_length;
                             float speed = length(speed_vector);
                             if (speed == 0) {
                                 return;
                             }
-                            float alpha = exp(-(current_t - geometry_t_and_flow[0].x) / decay);
+                            float alpha = exp(-geometry_age_and_flow[0].x / decay);
                             float float_index =
                                 clamp(atan(speed_vector.y, speed_vector.x) / (2 * flow_display_pi) + 0.5, 0.0, 1.0)
                                 * 6.0;
@@ -227,52 +373,90 @@ namespace chameleon {
                 check_program_error(_program_id);
 
                 // create the vertex buffer and array objects
-                glGenBuffers(static_cast<GLsizei>(_vertex_buffers_ids.size()), _vertex_buffers_ids.data());
-                glBindBuffer(GL_ARRAY_BUFFER, std::get<0>(_vertex_buffers_ids));
-                glBufferData(
-                    GL_ARRAY_BUFFER,
-                    _coordinates.size() * sizeof(decltype(_coordinates)::value_type),
-                    _coordinates.data(),
-                    GL_STATIC_DRAW);
-                glBindBuffer(GL_ARRAY_BUFFER, std::get<1>(_vertex_buffers_ids));
-                glBufferData(
-                    GL_ARRAY_BUFFER,
-                    _ts_and_flows.size() * sizeof(decltype(_ts_and_flows)::value_type),
-                    nullptr,
-                    GL_DYNAMIC_DRAW);
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, std::get<2>(_vertex_buffers_ids));
-                glBufferData(
-                    GL_ELEMENT_ARRAY_BUFFER,
-                    _indices.size() * sizeof(decltype(_indices)::value_type),
-                    _indices.data(),
-                    GL_STATIC_DRAW);
+                // the dense mode derives the pixel coordinates from gl_VertexID, the sparse mode from the index
+                glGenBuffers(1, &_vertex_buffer_id);
                 glGenVertexArrays(1, &_vertex_array_id);
                 glBindVertexArray(_vertex_array_id);
-                glBindBuffer(GL_ARRAY_BUFFER, std::get<0>(_vertex_buffers_ids));
-                glEnableVertexAttribArray(glGetAttribLocation(_program_id, "coordinates"));
-                glVertexAttribPointer(glGetAttribLocation(_program_id, "coordinates"), 2, GL_FLOAT, GL_FALSE, 0, 0);
-                glBindBuffer(GL_ARRAY_BUFFER, std::get<1>(_vertex_buffers_ids));
-                glEnableVertexAttribArray(glGetAttribLocation(_program_id, "t_and_flow"));
-                glVertexAttribPointer(glGetAttribLocation(_program_id, "t_and_flow"), 3, GL_FLOAT, GL_FALSE, 0, 0);
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, std::get<2>(_vertex_buffers_ids));
+                glBindBuffer(GL_ARRAY_BUFFER, _vertex_buffer_id);
+                if (_sparse) {
+                    glEnableVertexAttribArray(glGetAttribLocation(_program_id, "index"));
+                    glVertexAttribIPointer(
+                        glGetAttribLocation(_program_id, "index"),
+                        1,
+                        GL_UNSIGNED_INT,
+                        sizeof(active_pixel),
+                        reinterpret_cast<const GLvoid*>(offsetof(active_pixel, index)));
+                    glEnableVertexAttribArray(glGetAttribLocation(_program_id, "t"));
+                    glVertexAttribIPointer(
+                        glGetAttribLocation(_program_id, "t"),
+                        1,
+                        GL_UNSIGNED_INT,
+                        sizeof(active_pixel),
+                        reinterpret_cast<const GLvoid*>(offsetof(active_pixel, t)));
+                    glEnableVertexAttribArray(glGetAttribLocation(_program_id, "flow"));
+                    glVertexAttribPointer(
+                        glGetAttribLocation(_program_id, "flow"),
+                        2,
+                        GL_HALF_FLOAT,
+                        GL_FALSE,
+                        sizeof(active_pixel),
+                        reinterpret_cast<const GLvoid*>(offsetof(active_pixel, vx)));
+                } else {
+                    glBufferData(GL_ARRAY_BUFFER, _pixels.size() * sizeof(pixel), nullptr, GL_DYNAMIC_DRAW);
+                    glEnableVertexAttribArray(glGetAttribLocation(_program_id, "t"));
+                    glVertexAttribIPointer(
+                        glGetAttribLocation(_program_id, "t"),
+                        1,
+                        GL_UNSIGNED_INT,
+                        sizeof(pixel),
+                        reinterpret_cast<const GLvoid*>(offsetof(pixel, t)));
+                    glEnableVertexAttribArray(glGetAttribLocation(_program_id, "flow"));
+                    glVertexAttribPointer(
+                        glGetAttribLocation(_program_id, "flow"),
+                        2,
+                        GL_HALF_FLOAT,
+                        GL_FALSE,
+                        sizeof(pixel),
+                        reinterpret_cast<const GLvoid*>(offsetof(pixel, vx)));
+                }
                 glBindVertexArray(0);
 
                 // set uniform values
                 glUniform1f(glGetUniformLocation(_program_id, "width"), static_cast<GLfloat>(_canvas_size.width()));
                 glUniform1f(glGetUniformLocation(_program_id, "height"), static_cast<GLfloat>(_canvas_size.height()));
-                glUniform1f(
-                    glGetUniformLocation(_program_id, "speed_to_length"), static_cast<GLfloat>(_speed_to_length));
-                glUniform1f(glGetUniformLocation(_program_id, "decay"), static_cast<GLfloat>(_decay));
+                glUniform1i(glGetUniformLocation(_program_id, "sparse"), _sparse ? 1 : 0);
+                glUniform1ui(
+                    glGetUniformLocation(_program_id, "tiled_layout_width"),
+                    static_cast<GLuint>(_canvas_size.width()));
+                glUniform1ui(
+                    glGetUniformLocation(_program_id, "tiled_layout_shift"), static_cast<GLuint>(_layout.shift()));
+                glUniform1ui(
+                    glGetUniformLocation(_program_id, "tiled_layout_tiles_per_row"),
+                    static_cast<GLuint>(_layout.tiles_per_row()));
+                _speed_to_length_location = glGetUniformLocation(_program_id, "speed_to_length");
+                _decay_location = glGetUniformLocation(_program_id, "decay");
                 _current_t_location = glGetUniformLocation(_program_id, "current_t");
+
+                // create the timer queries
+                _performance_monitor.initialize(this);
             }
 
             // send data to the GPU
-            std::vector<float> local_ts_and_flows(_ts_and_flows.size());
-            while (_accessing_flows.test_and_set(std::memory_order_acquire)) {
+            _performance_monitor.begin_gpu();
+            const auto copy_begin = std::chrono::steady_clock::now();
+            _performance_monitor.lock(_accessing_flows);
+            const auto local_current_t = offset(_current_t);
+            const auto pushed_events = _pushed_events;
+            _pushed_events = 0;
+            if (_sparse) {
+                evict();
+                _painted_active_pixels.assign(_active_pixels.begin(), _active_pixels.end());
+            } else {
+                std::copy(_pixels.begin(), _pixels.end(), _painted_pixels.begin());
             }
-            const auto local_current_t = _current_t;
-            std::copy(_ts_and_flows.begin(), _ts_and_flows.end(), local_ts_and_flows.begin());
             _accessing_flows.clear(std::memory_order_release);
+            _performance_monitor.add_events(pushed_events);
+            _performance_monitor.set_copy_duration(std::chrono::steady_clock::now() - copy_begin);
             glUseProgram(_program_id);
             glViewport(
                 static_cast<GLint>(_paint_area.left()),
@@ -282,26 +466,195 @@ namespace chameleon {
             glDisable(GL_DEPTH_TEST);
             glEnable(GL_BLEND);
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            glBindBuffer(GL_ARRAY_BUFFER, std::get<1>(_vertex_buffers_ids));
-            glBufferData(
-                GL_ARRAY_BUFFER,
-                local_ts_and_flows.size() * sizeof(decltype(local_ts_and_flows)::value_type),
-                nullptr,
-                GL_DYNAMIC_DRAW);
-            glBufferSubData(
-                GL_ARRAY_BUFFER,
-                0,
-                local_ts_and_flows.size() * sizeof(decltype(local_ts_and_flows)::value_type),
-                local_ts_and_flows.data());
-            glUniform1f(_current_t_location, static_cast<GLfloat>(local_current_t));
-            glBindVertexArray(_vertex_array_id);
-            glDrawElements(GL_POINTS, static_cast<GLsizei>(_indices.size()), GL_UNSIGNED_INT, nullptr);
-            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, _vertex_buffer_id);
+            glUniform1ui(_current_t_location, static_cast<GLuint>(local_current_t));
+            glUniform1f(_speed_to_length_location, static_cast<GLfloat>(_speed_to_length / flow_scale));
+            glUniform1f(_decay_location, static_cast<GLfloat>(_decay));
+            if (_sparse) {
+                _performance_monitor.set_uploaded_bytes(
+                    _painted_active_pixels.size() * sizeof(decltype(_painted_active_pixels)::value_type));
+                if (!_painted_active_pixels.empty()) {
+                    glBufferData(
+                        GL_ARRAY_BUFFER,
+                        _painted_active_pixels.size() * sizeof(decltype(_painted_active_pixels)::value_type),
+                        _painted_active_pixels.data(),
+                        GL_STREAM_DRAW);
+                    glBindVertexArray(_vertex_array_id);
+                    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(_painted_active_pixels.size()));
+                    glBindVertexArray(0);
+                }
+            } else {
+                _performance_monitor.set_uploaded_bytes(_painted_pixels.size() * sizeof(pixel));
+                glBufferData(GL_ARRAY_BUFFER, _painted_pixels.size() * sizeof(pixel), nullptr, GL_DYNAMIC_DRAW);
+                glBufferSubData(GL_ARRAY_BUFFER, 0, _painted_pixels.size() * sizeof(pixel), _painted_pixels.data());
+                glBindVertexArray(_vertex_array_id);
+                glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(_painted_pixels.size()));
+                glBindVertexArray(0);
+            }
             glUseProgram(0);
+            _performance_monitor.end_gpu();
             check_opengl_error();
         }
 
         protected:
+        /// flow_scale converts speeds from pixels per microsecond to pixels per second before they are stored as half
+        /// floats, whose precision is best around 1.
+        static constexpr float flow_scale = 1e6f;
+
+        /// rebase_threshold is the timestamp offset above which the epoch is moved forward.
+        static constexpr uint64_t rebase_threshold = static_cast<uint64_t>(1) << 31;
+
+        /// rebase_step is the granularity of epoch moves.
+        static constexpr uint64_t rebase_step = static_cast<uint64_t>(1) << 30;
+
+        /// pixel is the state of a pixel in dense mode: its timestamp relative to the epoch, and its flow as half
+        /// floats. The pixel coordinates are derived from its index by the vertex shader.
+        struct pixel {
+            uint32_t t;
+            uint16_t vx;
+            uint16_t vy;
+        };
+
+        /// active_pixel is a vertex of the sparse mode, holding the index, timestamp and flow of a pixel.
+        struct active_pixel {
+            uint32_t index;
+            uint32_t t;
+            uint16_t vx;
+            uint16_t vy;
+        };
+
+        /// to_half converts a float to a half float, rounding to the nearest even value.
+        /// Values beyond the half float range are clamped to the largest finite half float, and NaNs become 0.
+        static uint16_t to_half(float value) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+            const auto magnitude = bits & 0x7fffffff;
+            if (magnitude > 0x7f800000) {
+                return 0;
+            }
+            if (magnitude >= 0x477fe000) {
+                return static_cast<uint16_t>(sign | 0x7bff);
+            }
+            uint32_t result;
+            uint32_t remainder;
+            uint32_t halfway;
+            if (magnitude < 0x38800000) {
+                if (magnitude < 0x33000000) {
+                    return sign;
+                }
+                const auto shift = 126 - (magnitude >> 23);
+                const auto mantissa = (magnitude & 0x7fffff) | 0x800000;
+                result = mantissa >> shift;
+                remainder = mantissa & ((1u << shift) - 1);
+                halfway = 1u << (shift - 1);
+            } else {
+                result = (magnitude - 0x38000000) >> 13;
+                remainder = magnitude & 0x1fff;
+                halfway = 0x1000;
+            }
+            if (remainder > halfway || (remainder == halfway && (result & 1) == 1)) {
+                ++result;
+            }
+            return static_cast<uint16_t>(sign | result);
+        }
+
+        /// offset converts a timestamp to the epoch's reference, earlier timestamps are clamped to the epoch.
+        /// _accessing_flows must be locked by the caller.
+        uint32_t offset(uint64_t t) const {
+            return t > _epoch ? static_cast<uint32_t>(t - _epoch) : 0;
+        }
+
+        /// rebase moves the epoch forward so that t fits in the timestamp offsets.
+        /// The stored offsets are shifted accordingly, and pixels older than the new epoch are clamped to it. Since
+        /// the epoch moves in large steps, this happens about every half hour of sensor time.
+        /// _accessing_flows must be locked by the caller.
+        virtual void rebase(uint64_t t) {
+            const auto shift = ((t - _epoch - rebase_threshold) / rebase_step + 1) * rebase_step;
+            _epoch += shift;
+            const auto rebased_t = [shift](uint32_t pixel_t) {
+                return pixel_t > shift ? static_cast<uint32_t>(pixel_t - shift) : 0;
+            };
+            if (_sparse) {
+                for (auto& active : _active_pixels) {
+                    active.t = rebased_t(active.t);
+                }
+            } else {
+                for (auto& dense : _pixels) {
+                    dense.t = rebased_t(dense.t);
+                }
+            }
+        }
+
+        /// write updates the pixel at the given coordinates.
+        /// In sparse mode, the pixel is added to the active pixels if it is not already there.
+        /// _accessing_flows must be locked by the caller.
+        void write(std::size_t x, std::size_t y, uint64_t t, float vx, float vy) {
+            if (t >= _epoch + rebase_threshold) {
+                rebase(t);
+            }
+            const auto index = _layout.index(x, y);
+            const auto t_offset = offset(t);
+            const auto half_vx = to_half(vx * flow_scale);
+            const auto half_vy = to_half(vy * flow_scale);
+            if (_sparse) {
+                auto& position = _active_positions[index];
+                if (position == 0) {
+                    _active_pixels.push_back(active_pixel{static_cast<uint32_t>(index), t_offset, half_vx, half_vy});
+                    position = static_cast<uint32_t>(_active_pixels.size());
+                } else {
+                    auto& active = _active_pixels[position - 1];
+                    active.t = t_offset;
+                    active.vx = half_vx;
+                    active.vy = half_vy;
+                }
+            } else {
+                _pixels[index] = pixel{t_offset, half_vx, half_vy};
+            }
+        }
+
+        /// snapshot stores a keyframe for the interval boundary at or before t.
+        /// The keyframe holds every pixel in the dense layout (padding included if the state is tiled), followed by the
+        /// epoch.
+        /// _accessing_flows must be locked by the caller.
+        virtual void snapshot(uint64_t t) {
+            const auto keyframe_t = t / _keyframe_interval * _keyframe_interval;
+            const auto pixels = _layout.size();
+            if (_sparse) {
+                std::fill(_keyframe_state.begin(), _keyframe_state.end(), 0);
+                for (const auto& active : _active_pixels) {
+                    const pixel dense{active.t, active.vx, active.vy};
+                    std::memcpy(&_keyframe_state[active.index * 2], &dense, sizeof(pixel));
+                }
+            } else {
+                std::memcpy(_keyframe_state.data(), _pixels.data(), pixels * sizeof(pixel));
+            }
+            _keyframe_state[pixels * 2] = static_cast<uint32_t>(_epoch);
+            _keyframe_state[pixels * 2 + 1] = static_cast<uint32_t>(_epoch >> 32);
+            _snapshot_ring->insert(keyframe_t, _keyframe_state.data());
+            _next_keyframe_t = keyframe_t + _keyframe_interval;
+        }
+
+        /// evict removes the pixels which decayed below the display precision from the active pixels.
+        /// _accessing_flows must be locked by the caller.
+        virtual void evict() {
+            const auto current_t = offset(_current_t);
+            for (std::size_t position = 0; position < _active_pixels.size();) {
+                const auto& active = _active_pixels[position];
+                if (active.t <= current_t && static_cast<float>(current_t - active.t) > _lifetime) {
+                    _active_positions[active.index] = 0;
+                    if (position + 1 < _active_pixels.size()) {
+                        const auto& last_pixel = _active_pixels.back();
+                        _active_positions[last_pixel.index] = static_cast<uint32_t>(position + 1);
+                        _active_pixels[position] = last_pixel;
+                    }
+                    _active_pixels.pop_back();
+                } else {
+                    ++position;
+                }
+            }
+        }
+
         /// check_opengl_error throws if openGL generated an error.
         virtual void check_opengl_error() {
             switch (glGetError()) {
@@ -349,17 +702,31 @@ namespace chameleon {
         QSize _canvas_size;
         float _speed_to_length;
         float _decay;
-        float _current_t;
-        std::vector<GLuint> _indices;
-        std::vector<float> _coordinates;
-        std::vector<float> _ts_and_flows;
+        bool _sparse;
+        tiled_layout _layout;
+        float _lifetime;
+        uint64_t _epoch;
+        uint64_t _current_t;
+        std::size_t _pushed_events;
+        std::vector<pixel> _pixels;
+        std::vector<pixel> _painted_pixels;
+        std::vector<active_pixel> _active_pixels;
+        std::vector<active_pixel> _painted_active_pixels;
+        std::vector<uint32_t> _active_positions;
         std::atomic_flag _accessing_flows;
+        std::unique_ptr<snapshot_ring<uint32_t>> _snapshot_ring;
+        std::vector<uint32_t> _keyframe_state;
+        uint64_t _keyframe_interval;
+        uint64_t _next_keyframe_t;
         QRectF _paint_area;
         bool _program_setup;
         GLuint _program_id;
         GLuint _vertex_array_id;
-        std::array<GLuint, 3> _vertex_buffers_ids;
+        GLuint _vertex_buffer_id;
         GLuint _current_t_location;
+        GLuint _speed_to_length_location;
+        GLuint _decay_location;
+        performance_monitor _performance_monitor;
     };
 
     /// flow_display displays a stream of flow events.
@@ -367,11 +734,35 @@ namespace chameleon {
         Q_OBJECT
         Q_INTERFACES(QQmlParserStatus)
         Q_PROPERTY(QSize canvas_size READ canvas_size WRITE set_canvas_size)
-        Q_PROPERTY(float speed_to_length READ speed_to_length WRITE set_speed_to_length)
-        Q_PROPERTY(float decay READ decay WRITE set_decay)
+        Q_PROPERTY(float speed_to_length READ speed_to_length WRITE set_speed_to_length NOTIFY speed_to_length_changed)
+        Q_PROPERTY(float decay READ decay WRITE set_decay NOTIFY decay_changed)
+        Q_PROPERTY(bool sparse READ sparse WRITE set_sparse)
+        Q_PROPERTY(int tile_size READ tile_size WRITE set_tile_size)
+        Q_PROPERTY(qint64 keyframe_interval READ keyframe_interval WRITE set_keyframe_interval)
+        Q_PROPERTY(int keyframes READ keyframes WRITE set_keyframes)
+        Q_PROPERTY(double events_per_second READ events_per_second NOTIFY performance_changed)
+        Q_PROPERTY(double lock_spins_per_second READ lock_spins_per_second NOTIFY performance_changed)
+        Q_PROPERTY(double copy_duration READ copy_duration NOTIFY performance_changed)
+        Q_PROPERTY(double gpu_duration READ gpu_duration NOTIFY performance_changed)
+        Q_PROPERTY(qint64 uploaded_bytes READ uploaded_bytes NOTIFY performance_changed)
         public:
-        flow_display() : _ready(false), _renderer_ready(false), _speed_to_length(1e6), _decay(1e5) {
+        flow_display() :
+            _ready(false),
+            _renderer_ready(false),
+            _render_scheduler(nullptr),
+            _speed_to_length(1e6),
+            _decay(1e5),
+            _sparse(false),
+            _tile_size(0),
+            _keyframe_interval(0),
+            _keyframes(64),
+            _parameters_changed(false) {
             connect(this, &QQuickItem::windowChanged, this, &flow_display::handle_window_changed);
+            _performance = performance_counters{};
+            _performance_timer.setInterval(1000);
+            connect(&_performance_timer, &QTimer::timeout, this, &flow_display::update_performance);
+            _performance_timer.start();
+            _accessing_renderer.clear(std::memory_order_release);
         }
         flow_display(const flow_display&) = delete;
         flow_display(flow_display&&) = delete;
@@ -397,13 +788,15 @@ namespace chameleon {
         }
 
         /// set_speed_to_length defines the length in pixels of the arrow representing a one-pixel-per-microsecond
-        /// speed. The length to speed ratio will be passed to the openGL renderer, therefore it should only be set
-        /// during qml construction.
+        /// speed. The length to speed ratio can be changed at any time, it is passed to the openGL renderer before
+        /// the next frame.
         virtual void set_speed_to_length(float speed_to_length) {
-            if (_ready.load(std::memory_order_acquire)) {
-                throw std::logic_error("speed_to_length can only be set during qml construction");
+            if (speed_to_length != _speed_to_length) {
+                _speed_to_length = speed_to_length;
+                _parameters_changed = true;
+                speed_to_length_changed(_speed_to_length);
+                trigger_draw();
             }
-            _speed_to_length = speed_to_length;
         }
 
         /// speed_to_length returns the currently used speed_to_length.
@@ -412,12 +805,14 @@ namespace chameleon {
         }
 
         /// set_decay defines the flow decay.
-        /// The decay will be passed to the openGL renderer, therefore it should only be set during qml construction.
+        /// The decay can be changed at any time, it is passed to the openGL renderer before the next frame.
         virtual void set_decay(float decay) {
-            if (_ready.load(std::memory_order_acquire)) {
-                throw std::logic_error("decay can only be set during qml construction");
+            if (decay != _decay) {
+                _decay = decay;
+                _parameters_changed = true;
+                decay_changed(_decay);
+                trigger_draw();
             }
-            _decay = decay;
         }
 
         /// decay returns the currently used decay.
@@ -425,6 +820,109 @@ namespace chameleon {
             return _decay;
         }
 
+        /// set_sparse defines whether only the recently active pixels are sent to the GPU.
+        /// In sparse mode, pixels are dropped once their arrow has faded out, and the work per frame depends on the
+        /// scene activity rather than the canvas size.
+        /// The sparse mode will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_sparse(bool sparse) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("sparse can only be set during qml construction");
+            }
+            _sparse = sparse;
+        }
+
+        /// sparse returns the currently used sparse mode.
+        virtual bool sparse() const {
+            return _sparse;
+        }
+
+        /// set_tile_size defines the side of the square tiles storing the pixels state, 0 (default) being row-major.
+        /// Tiles keep neighbouring pixels in the same cache lines, which speeds up pushes of spatially clustered
+        /// events. The state is uploaded as is, and the vertex shader converts the tiled indices to pixel
+        /// coordinates.
+        /// The tile size will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_tile_size(int tile_size) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("tile_size can only be set during qml construction");
+            }
+            if (tile_size != 0 && (tile_size < 2 || tile_size > 256 || (tile_size & (tile_size - 1)) != 0)) {
+                throw std::logic_error("tile_size must be 0 or a power of two in the range [2, 256]");
+            }
+            _tile_size = tile_size;
+        }
+
+        /// tile_size returns the currently used tile size.
+        virtual int tile_size() const {
+            return _tile_size;
+        }
+
+        /// set_keyframe_interval defines the time between two keyframes, in microseconds.
+        /// Keyframes are compressed snapshots of the flows state, used by restore to seek in a recording without
+        /// replaying it from the start. 0 (default) disables keyframes.
+        /// The keyframe interval will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_keyframe_interval(qint64 keyframe_interval) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("keyframe_interval can only be set during qml construction");
+            }
+            if (keyframe_interval < 0) {
+                throw std::logic_error("keyframe_interval cannot be negative");
+            }
+            _keyframe_interval = keyframe_interval;
+        }
+
+        /// keyframe_interval returns the currently used keyframe interval.
+        virtual qint64 keyframe_interval() const {
+            return _keyframe_interval;
+        }
+
+        /// set_keyframes defines the maximum number of stored keyframes, the oldest ones are dropped first.
+        /// The number of keyframes will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_keyframes(int keyframes) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("keyframes can only be set during qml construction");
+            }
+            if (keyframes < 1) {
+                throw std::logic_error("keyframes must be at least 1");
+            }
+            _keyframes = keyframes;
+        }
+
+        /// keyframes returns the currently used maximum number of keyframes.
+        virtual int keyframes() const {
+            return _keyframes;
+        }
+
+        /// events_per_second returns the number of events received per second, measured over the last second.
+        virtual double events_per_second() const {
+            return _performance.events_per_second;
+        }
+
+        /// lock_spins_per_second returns the number of iterations per second spent waiting for the renderer's locks.
+        /// A high value means that producers and the render thread contend.
+        virtual double lock_spins_per_second() const {
+            return _performance.lock_spins_per_second;
+        }
+
+        /// copy_duration returns the CPU time, in microseconds, spent copying the state to the GPU buffers during the
+        /// latest frame.
+        virtual double copy_duration() const {
+            return _performance.copy_duration;
+        }
+
+        /// gpu_duration returns the GPU time, in microseconds, of the latest measured frame.
+        virtual double gpu_duration() const {
+            return _performance.gpu_duration;
+        }
+
+        /// uploaded_bytes returns the number of bytes sent to the GPU during the last frame.
+        virtual std::size_t uploaded_bytes() const {
+            return _performance.uploaded_bytes;
+        }
+
         /// paint_area returns the paint area in window coordinates.
         virtual QRectF paint_area() const {
             return _paint_area;
@@ -436,6 +934,16 @@ namespace chameleon {
             while (!_renderer_ready.load(std::memory_order_acquire)) {
             }
             _flow_display_renderer->push<Event>(event);
+            request_update();
+        }
+
+        /// push adds a batch of events to the display.
+        template <typename Iterator>
+        void push(Iterator begin, Iterator end) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _flow_display_renderer->push<Iterator>(begin, end);
+            request_update();
         }
 
         /// assign sets all the pixels at once.
@@ -444,6 +952,17 @@ namespace chameleon {
             while (!_renderer_ready.load(std::memory_order_acquire)) {
             }
             _flow_display_renderer->assign<Iterator>(begin, end);
+            request_update();
+        }
+
+        /// restore seeks to the latest keyframe at or before t, and returns the keyframe's time.
+        /// The caller must then push the events with a timestamp larger than or equal to the returned time to reach t.
+        virtual qint64 restore(qint64 t) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            const auto keyframe_t = _flow_display_renderer->restore(static_cast<uint64_t>(std::max(t, qint64(0))));
+            request_update();
+            return static_cast<qint64>(keyframe_t);
         }
 
         /// componentComplete is called when all the qml values are bound.
@@ -459,6 +978,15 @@ namespace chameleon {
         /// paintAreaChanged notifies a paint area change.
         void paintAreaChanged(QRectF paint_area);
 
+        /// speed_to_length_changed notifies a change of the arrows length ratio.
+        void speed_to_length_changed(float speed_to_length);
+
+        /// decay_changed notifies a change of the decay.
+        void decay_changed(float decay);
+
+        /// performance_changed notifies a change of the performance counters.
+        void performance_changed();
+
         public slots:
 
         /// sync adapts the renderer to external changes.
@@ -466,15 +994,27 @@ namespace chameleon {
             if (_ready.load(std::memory_order_relaxed)) {
                 if (!_flow_display_renderer) {
                     _flow_display_renderer = std::unique_ptr<flow_display_renderer>(
-                        new flow_display_renderer(_canvas_size, _speed_to_length, _decay));
+                        new flow_display_renderer(
+                            _canvas_size, _speed_to_length, _decay, _sparse, static_cast<std::size_t>(_tile_size)));
+                    if (_keyframe_interval > 0) {
+                        _flow_display_renderer->set_keyframes(
+                            static_cast<uint64_t>(_keyframe_interval), static_cast<std::size_t>(_keyframes));
+                    }
                     connect(
                         window(),
                         &QQuickWindow::beforeRendering,
                         _flow_display_renderer.get(),
                         &flow_display_renderer::paint,
                         Qt::DirectConnection);
+                    while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+                    }
                     _renderer_ready.store(true, std::memory_order_release);
+                    _accessing_renderer.clear(std::memory_order_release);
+                } else if (_parameters_changed) {
+                    _flow_display_renderer->set_speed_to_length(_speed_to_length);
+                    _flow_display_renderer->set_decay(_decay);
                 }
+                _parameters_changed = false;
                 auto clear_area =
                     QRectF(0, 0, width() * window()->devicePixelRatio(), height() * window()->devicePixelRatio());
                 for (auto item = static_cast<QQuickItem*>(this); item; item = item->parentItem()) {
@@ -502,14 +1042,19 @@ namespace chameleon {
         }
 
         /// cleanup frees the owned renderer.
+        /// Pushes wait for the next renderer, created by sync if the scene graph is initialized again.
         void cleanup() {
+            while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+            }
+            _renderer_ready.store(false, std::memory_order_release);
             _flow_display_renderer.reset();
+            _accessing_renderer.clear(std::memory_order_release);
         }
 
         /// trigger_draw requests a window refresh.
         void trigger_draw() {
             if (window()) {
-                window()->update();
+                render_scheduler::of(window())->request_update();
             }
         }
 
@@ -522,17 +1067,52 @@ namespace chameleon {
                 connect(
                     window, &QQuickWindow::sceneGraphInvalidated, this, &flow_display::cleanup, Qt::DirectConnection);
                 window->setClearBeforeRendering(false);
+                _render_scheduler.store(render_scheduler::of(window), std::memory_order_release);
+            }
+        }
+
+        /// update_performance samples the renderer's counters.
+        /// The renderer lock prevents cleanup from freeing the renderer during the sample.
+        void update_performance() {
+            while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+            }
+            if (_renderer_ready.load(std::memory_order_relaxed)) {
+                const auto performance = _flow_display_renderer->sample_performance();
+                _accessing_renderer.clear(std::memory_order_release);
+                if (performance != _performance) {
+                    _performance = performance;
+                    performance_changed();
+                }
+            } else {
+                _accessing_renderer.clear(std::memory_order_release);
             }
         }
 
         protected:
+        /// request_update schedules a window update, coalesced with the other displays of the window.
+        virtual void request_update() {
+            const auto scheduler = _render_scheduler.load(std::memory_order_acquire);
+            if (scheduler) {
+                scheduler->request_update();
+            }
+        }
+
         std::atomic_bool _ready;
         std::atomic_bool _renderer_ready;
+        std::atomic_flag _accessing_renderer;
+        std::atomic<render_scheduler*> _render_scheduler;
         QSize _canvas_size;
         float _speed_to_length;
         float _decay;
+        bool _sparse;
+        int _tile_size;
+        qint64 _keyframe_interval;
+        int _keyframes;
+        bool _parameters_changed;
         std::unique_ptr<flow_display_renderer> _flow_display_renderer;
         QRectF _clear_area;
         QRectF _paint_area;
+        performance_counters _performance;
+        QTimer _performance_timer;
     };
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "gl_cache.hpp"
 #include <QQmlParserStatus>
 #include <QtCore/QDir>
 #include <QtGui/QImage>
@@ -7,26 +8,121 @@
 #include <QtGui/QOpenGLFunctions_3_3_Core>
 #include <QtQuick/QQuickItem>
 #include <QtQuick/qquickwindow.h>
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 /// chameleon provides Qt components for event stream display.
 namespace chameleon {
 
+    /// frame_format lists the pixel layouts of captured frames.
+    /// rgba_bottom_up stores RGBA bytes, bottom row first, as read from the window. rgba stores RGBA bytes, top row
+    /// first. nv12 stores a full-resolution luma plane followed by a half-resolution plane of interleaved U and V
+    /// bytes, top row first (BT.601, limited range), and is 2.67 times smaller than RGBA. Flipping and conversion
+    /// are performed by the GPU.
+    enum class frame_format {
+        rgba_bottom_up,
+        rgba,
+        nv12,
+    };
+
+    /// frame is a captured image.
+    struct frame {
+        std::size_t width;
+        std::size_t height;
+        std::vector<uint8_t> pixels;
+        frame_format format;
+
+        /// bytes returns the size of the pixels for the frame's dimensions and format.
+        std::size_t bytes() const {
+            return format == frame_format::nv12 ? width * height * 3 / 2 : width * height * 4;
+        }
+    };
+
+    /// frame_encoder compresses a stream of frames, for instance to a video file.
+    /// encode is called by a frame_generator worker thread, in capture order.
+    class frame_encoder {
+        public:
+        virtual ~frame_encoder() {}
+
+        /// format returns the frame format expected by encode.
+        virtual frame_format format() const = 0;
+
+        /// encode compresses a frame.
+        virtual void encode(const frame& captured) = 0;
+
+        /// finish flushes the encoder once the last frame is encoded.
+        virtual void finish() = 0;
+    };
+
     /// frame_generator_renderer handles openGL calls for a frame_generator.
     class frame_generator_renderer : public QObject, public QOpenGLFunctions_3_3_Core {
         Q_OBJECT
         public:
-        frame_generator_renderer() : _before_rendering_done(false), _closing(false) {
+        frame_generator_renderer(std::size_t workers, std::size_t maximum_queued_frames) :
+            _before_rendering_done(false),
+            _waiting_for_pixels(false),
+            _closing(false),
+            _maximum_queued_frames(maximum_queued_frames),
+            _queued_frames(0),
+            _handed_frames(0),
+            _stream_index(0),
+            _next_stream_index(0),
+            _running(true),
+            _readbacks_setup(false),
+            _next_readback(0),
+            _conversion_setup(false),
+            _capture_texture_size(0, 0),
+            _output_texture_size(0, 0),
+            _output_format(frame_format::rgba_bottom_up) {
             _rendering_not_required.clear(std::memory_order_release);
+            for (auto& readback : _readbacks) {
+                readback.buffer_id = 0;
+                readback.size = 0;
+                readback.fence = nullptr;
+                readback.busy = false;
+            }
+            for (std::size_t index = 0; index < workers; ++index) {
+                _workers.emplace_back(&frame_generator_renderer::work, this);
+            }
         }
         frame_generator_renderer(const frame_generator_renderer&) = delete;
         frame_generator_renderer(frame_generator_renderer&&) = delete;
         frame_generator_renderer& operator=(const frame_generator_renderer&) = delete;
         frame_generator_renderer& operator=(frame_generator_renderer&&) = delete;
-        virtual ~frame_generator_renderer() {}
+        virtual ~frame_generator_renderer() {
+            {
+                const std::lock_guard<std::mutex> lock(_jobs_mutex);
+                _running = false;
+            }
+            _jobs_changed.notify_all();
+            for (auto& worker : _workers) {
+                worker.join();
+            }
+            if (_readbacks_setup) {
+                for (auto& readback : _readbacks) {
+                    if (readback.fence) {
+                        glDeleteSync(readback.fence);
+                    }
+                    glDeleteBuffers(1, &readback.buffer_id);
+                }
+            }
+            if (_conversion_setup) {
+                glDeleteFramebuffers(1, &_capture_framebuffer_id);
+                glDeleteTextures(1, &_capture_texture_id);
+                glDeleteFramebuffers(1, &_output_framebuffer_id);
+                glDeleteTextures(1, &_output_texture_id);
+            }
+        }
 
         /// set_rendering_area defines the rendering area.
         virtual void set_rendering_area(QRectF capture_area, int window_height) {
@@ -44,7 +140,9 @@ namespace chameleon {
             }
             _pixels_mutex.unlock();
             std::unique_lock<std::mutex> lock(_pixels_mutex);
+            _waiting_for_pixels = true;
             _pixels_updated.wait(lock);
+            _waiting_for_pixels = false;
             auto success = true;
             if (!_closing) {
                 success = QImage(
@@ -53,13 +151,47 @@ namespace chameleon {
                               static_cast<int>(_image_height),
                               static_cast<int>(4 * _image_width),
                               QImage::Format_RGBA8888_Premultiplied)
-                              .mirrored()
                               .save(filename);
             }
             lock.unlock();
             return success;
         }
 
+        /// capture queues a request for the next rendered frame, without waiting for the render.
+        /// The frame is read back asynchronously and passed to the handler on a worker thread.
+        /// If ordered is true, the handler is called after the handlers of the previous ordered captures.
+        /// The requests waiting for a render and the frames handed to the workers are bounded by the maximum number
+        /// of queued frames. capture returns false, and drops the request, if the waiting requests alone reach the
+        /// bound, since only a render (which the caller may be preventing) can consume them. Otherwise, it blocks
+        /// until the workers bring the total under the bound, which they do regardless of the renders.
+        virtual bool capture(std::function<void(const frame&)> handler, bool ordered, frame_format format) {
+            std::unique_lock<std::mutex> lock(_jobs_mutex);
+            _jobs_changed.wait(lock, [this]() {
+                return _requests.size() >= _maximum_queued_frames
+                       || _requests.size() + _handed_frames < _maximum_queued_frames || _closing;
+            });
+            if (_closing || _requests.size() >= _maximum_queued_frames) {
+                return false;
+            }
+            _requests.push_back(job{std::move(handler), frame{0, 0, {}, format}, ordered, 0});
+            ++_queued_frames;
+            return true;
+        }
+
+        /// wait_for_queued_frames blocks until all queued frames are handled, or the timeout expires.
+        /// It returns false on timeout, and throws if a handler failed.
+        virtual bool wait_for_queued_frames(std::chrono::milliseconds timeout) {
+            std::unique_lock<std::mutex> lock(_jobs_mutex);
+            const auto done =
+                _jobs_changed.wait_for(lock, timeout, [this]() { return _queued_frames == 0 || _closing; });
+            if (!_error.empty()) {
+                const auto error = std::move(_error);
+                _error.clear();
+                throw std::runtime_error(error);
+            }
+            return done;
+        }
+
         public slots:
 
         /// before_rendering_callback must be called when the window is about to be rendered.
@@ -74,36 +206,368 @@ namespace chameleon {
             if (!initializeOpenGLFunctions()) {
                 throw std::runtime_error("initializing the OpenGL context failed");
             }
-            glEnable(GL_SCISSOR_TEST);
+            if (!_readbacks_setup) {
+                _readbacks_setup = true;
+                for (auto& readback : _readbacks) {
+                    glGenBuffers(1, &readback.buffer_id);
+                }
+            }
+            dispatch_readbacks(false);
             {
-                const std::lock_guard<std::mutex> lock(_pixels_mutex);
-                _pixels.resize(_capture_area.width() * _capture_area.height() * 4);
-                glReadPixels(
-                    static_cast<GLint>(_capture_area.left()),
-                    static_cast<GLint>(_capture_area.top()),
-                    static_cast<GLsizei>(_capture_area.width()),
-                    static_cast<GLsizei>(_capture_area.height()),
-                    GL_RGBA,
-                    GL_UNSIGNED_BYTE,
-                    _pixels.data());
-                _image_width = _capture_area.width();
-                _image_height = _capture_area.height();
+                std::unique_lock<std::mutex> lock(_jobs_mutex);
+                if (!_requests.empty()) {
+                    auto job = std::move(_requests.front());
+                    _requests.pop_front();
+                    lock.unlock();
+                    if (_readbacks[_next_readback].busy) {
+                        dispatch_readbacks(true);
+                    }
+                    auto& readback = _readbacks[_next_readback];
+                    readback.capture = std::move(job);
+                    set_dimensions(readback.capture.captured);
+                    const auto size = readback.capture.captured.bytes();
+                    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer_id);
+                    if (readback.size < size) {
+                        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_READ);
+                        readback.size = size;
+                    }
+                    read_capture(readback.capture.captured, nullptr);
+                    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+                    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                    readback.busy = true;
+                    _next_readback = (_next_readback + 1) % _readbacks.size();
+                    lock.lock();
+                    const auto queue_full = _queued_frames >= _maximum_queued_frames;
+                    lock.unlock();
+                    if (queue_full) {
+                        dispatch_readbacks(true);
+                    }
+                }
+            }
+            {
+                std::unique_lock<std::mutex> lock(_pixels_mutex);
+                if (_waiting_for_pixels) {
+                    frame captured{0, 0, {}, frame_format::rgba};
+                    set_dimensions(captured);
+                    _pixels.resize(captured.bytes());
+                    read_capture(captured, _pixels.data());
+                    _image_width = captured.width;
+                    _image_height = captured.height;
+                    lock.unlock();
+                    _pixels_updated.notify_one();
+                }
             }
-            _pixels_updated.notify_one();
-            glDisable(GL_SCISSOR_TEST);
             check_opengl_error();
         }
 
+        /// finish_readbacks waits for the pending readbacks and hands them to the workers.
+        /// It must be called by the render thread.
+        void finish_readbacks() {
+            while (std::any_of(_readbacks.begin(), _readbacks.end(), [](const readback& candidate) {
+                return candidate.busy;
+            })) {
+                dispatch_readbacks(true);
+            }
+        }
+
         /// closing is called when the window is about to be closed.
         void closing() {
             {
-                const std::lock_guard<std::mutex> lock(_pixels_mutex);
+                const std::lock_guard<std::mutex> pixels_lock(_pixels_mutex);
+                const std::lock_guard<std::mutex> jobs_lock(_jobs_mutex);
                 _closing = true;
+                _queued_frames -= _requests.size();
+                _requests.clear();
             }
             _pixels_updated.notify_one();
+            _jobs_changed.notify_all();
         }
 
         protected:
+        /// job is a capture request, and the captured frame once read back.
+        struct job {
+            std::function<void(const frame&)> handler;
+            frame captured;
+            bool ordered;
+            std::size_t stream_index;
+        };
+
+        /// readback is a pixel pack buffer receiving a frame from the GPU.
+        struct readback {
+            GLuint buffer_id;
+            std::size_t size;
+            GLsync fence;
+            bool busy;
+            job capture;
+        };
+
+        /// dispatch_readbacks copies the completed readbacks to their frames and hands them to the workers, in
+        /// capture order.
+        /// If blocking is true, it waits for the oldest readback to complete.
+        virtual void dispatch_readbacks(bool blocking) {
+            for (std::size_t offset = 0; offset < _readbacks.size(); ++offset) {
+                auto& readback = _readbacks[(_next_readback + offset) % _readbacks.size()];
+                if (!readback.busy) {
+                    continue;
+                }
+                for (;;) {
+                    const auto status = glClientWaitSync(
+                        readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, blocking ? 1000000000 : 0);
+                    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+                        break;
+                    }
+                    if (status == GL_WAIT_FAILED) {
+                        throw std::logic_error("glClientWaitSync failed");
+                    }
+                    if (!blocking) {
+                        return;
+                    }
+                }
+                blocking = false;
+                glDeleteSync(readback.fence);
+                readback.fence = nullptr;
+                readback.busy = false;
+                auto& captured = readback.capture.captured;
+                captured.pixels.resize(captured.bytes());
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer_id);
+                const auto pixels = glMapBufferRange(
+                    GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(captured.pixels.size()), GL_MAP_READ_BIT);
+                if (!pixels) {
+                    throw std::logic_error("glMapBufferRange returned an null pointer");
+                }
+                std::memcpy(captured.pixels.data(), pixels, captured.pixels.size());
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+                {
+                    const std::lock_guard<std::mutex> lock(_jobs_mutex);
+                    if (readback.capture.ordered) {
+                        readback.capture.stream_index = _stream_index;
+                        ++_stream_index;
+                    }
+                    _jobs.push_back(std::move(readback.capture));
+                    ++_handed_frames;
+                }
+                _jobs_changed.notify_all();
+            }
+        }
+
+        /// set_dimensions sets the frame's width and height from the capture area.
+        /// NV12 frames have even dimensions, therefore their last column or row may be dropped.
+        virtual void set_dimensions(frame& captured) const {
+            captured.width = static_cast<std::size_t>(_capture_area.width());
+            captured.height = static_cast<std::size_t>(_capture_area.height());
+            if (captured.format == frame_format::nv12) {
+                captured.width -= captured.width % 2;
+                captured.height -= captured.height % 2;
+            }
+        }
+
+        /// read_capture reads the capture area in the frame's format to pixels, or to the bound pixel pack buffer if
+        /// pixels is nullptr.
+        /// Unless the format is rgba_bottom_up, the capture area is copied to a texture and drawn into an output
+        /// framebuffer by a shader which flips the rows and converts the colors, so that the read back pixels are
+        /// ready to use. The OpenGL state used by the scene graph is restored.
+        virtual void read_capture(const frame& captured, GLvoid* pixels) {
+            const auto x = static_cast<GLint>(_capture_area.left());
+            const auto y = static_cast<GLint>(_capture_area.top());
+            const auto width = static_cast<GLsizei>(captured.width);
+            const auto height = static_cast<GLsizei>(captured.height);
+            if (captured.format == frame_format::rgba_bottom_up) {
+                glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+                return;
+            }
+            if (width == 0 || height == 0) {
+                return;
+            }
+            GLint target_framebuffer_id;
+            glGetIntegerv(GL_FRAMEBUFFER_BINDING, &target_framebuffer_id);
+            std::array<GLint, 4> viewport;
+            glGetIntegerv(GL_VIEWPORT, viewport.data());
+            const auto scissor_test = glIsEnabled(GL_SCISSOR_TEST);
+            const auto blend = glIsEnabled(GL_BLEND);
+            const auto depth_test = glIsEnabled(GL_DEPTH_TEST);
+            glDisable(GL_SCISSOR_TEST);
+            glDisable(GL_BLEND);
+            glDisable(GL_DEPTH_TEST);
+            setup_conversion(QSize(x + width, y + height), QSize(width, height), captured.format);
+
+            // copy the capture area with identical bounds, which resolves multisampled targets
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(target_framebuffer_id));
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _capture_framebuffer_id);
+            glBlitFramebuffer(
+                x, y, x + width, y + height, x, y, x + width, y + height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+            // flip and convert
+            const auto output_height = captured.format == frame_format::nv12 ? height * 3 / 2 : height;
+            glBindFramebuffer(GL_FRAMEBUFFER, _output_framebuffer_id);
+            glViewport(0, 0, width, output_height);
+            glUseProgram(_program_id);
+            glUniform2i(_origin_location, x, y);
+            glUniform1i(_height_location, height);
+            glUniform1i(_nv12_location, captured.format == frame_format::nv12 ? 1 : 0);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, _capture_texture_id);
+            glBindVertexArray(_vertex_array_id);
+            glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, 0);
+            glBindVertexArray(0);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glUseProgram(0);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(
+                0,
+                0,
+                width,
+                output_height,
+                captured.format == frame_format::nv12 ? GL_RED : GL_RGBA,
+                GL_UNSIGNED_BYTE,
+                pixels);
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+            // restore the scene graph state
+            glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(target_framebuffer_id));
+            glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+            if (scissor_test) {
+                glEnable(GL_SCISSOR_TEST);
+            }
+            if (blend) {
+                glEnable(GL_BLEND);
+            }
+            if (depth_test) {
+                glEnable(GL_DEPTH_TEST);
+            }
+        }
+
+        /// setup_conversion creates the conversion program and framebuffers on first use, and resizes the
+        /// textures when the capture area or the format change.
+        virtual void setup_conversion(QSize capture_size, QSize output_size, frame_format format) {
+            if (!_conversion_setup) {
+                _conversion_setup = true;
+                const std::string vertex_shader(R""(
+                    #version 330 core
+                    in vec2 coordinates;
+                    void main() {
+                        gl_Position = vec4(coordinates, 0.0, 1.0);
+                    }
+                )"");
+                const std::string fragment_shader(R""(
+                    #version 330 core
+                    out vec4 color;
+                    uniform sampler2D capture;
+                    uniform ivec2 origin;
+                    uniform int height;
+                    uniform bool nv12;
+                    vec4 pixel(int x, int y) {
+                        return texelFetch(capture, origin + ivec2(x, height - 1 - y), 0);
+                    }
+                    void main() {
+                        ivec2 position = ivec2(gl_FragCoord.xy);
+                        if (!nv12) {
+                            color = pixel(position.x, position.y);
+                        } else if (position.y < height) {
+                            vec3 rgb = pixel(position.x, position.y).rgb;
+                            color = vec4((16.0 + dot(rgb, vec3(65.481, 128.553, 24.966))) / 255.0, 0.0, 0.0, 1.0);
+                        } else {
+                            int x = position.x - position.x % 2;
+                            int y = (position.y - height) * 2;
+                            vec3 rgb = (pixel(x, y).rgb + pixel(x + 1, y).rgb + pixel(x, y + 1).rgb
+                                        + pixel(x + 1, y + 1).rgb)
+                                       / 4.0;
+                            vec3 weights = position.x % 2 == 0 ? vec3(-37.797, -74.203, 112.0)
+                                                               : vec3(112.0, -93.786, -18.214);
+                            color = vec4((128.0 + dot(rgb, weights)) / 255.0, 0.0, 0.0, 1.0);
+                        }
+                    }
+                )"");
+                auto& cache = gl_cache::current();
+                _program_id = cache.program(vertex_shader, fragment_shader);
+                _vertex_array_id = cache.quad_vertex_array();
+                glUseProgram(_program_id);
+                glUniform1i(glGetUniformLocation(_program_id, "capture"), 0);
+                _origin_location = glGetUniformLocation(_program_id, "origin");
+                _height_location = glGetUniformLocation(_program_id, "height");
+                _nv12_location = glGetUniformLocation(_program_id, "nv12");
+                glGenTextures(1, &_capture_texture_id);
+                glGenFramebuffers(1, &_capture_framebuffer_id);
+                glGenTextures(1, &_output_texture_id);
+                glGenFramebuffers(1, &_output_framebuffer_id);
+            }
+            if (_capture_texture_size.width() < capture_size.width()
+                || _capture_texture_size.height() < capture_size.height()) {
+                _capture_texture_size = capture_size.expandedTo(_capture_texture_size);
+                allocate_texture(_capture_texture_id, _capture_framebuffer_id, _capture_texture_size, GL_RGBA8);
+            }
+            if (output_size != _output_texture_size || format != _output_format) {
+                _output_texture_size = output_size;
+                _output_format = format;
+                if (format == frame_format::nv12) {
+                    allocate_texture(
+                        _output_texture_id,
+                        _output_framebuffer_id,
+                        QSize(output_size.width(), output_size.height() * 3 / 2),
+                        GL_R8);
+                } else {
+                    allocate_texture(_output_texture_id, _output_framebuffer_id, output_size, GL_RGBA8);
+                }
+            }
+        }
+
+        /// allocate_texture resizes a texture and attaches it to a framebuffer.
+        virtual void allocate_texture(GLuint texture_id, GLuint framebuffer_id, QSize size, GLint internal_format) {
+            glBindTexture(GL_TEXTURE_2D, texture_id);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexImage2D(
+                GL_TEXTURE_2D,
+                0,
+                internal_format,
+                size.width(),
+                size.height(),
+                0,
+                internal_format == GL_R8 ? GL_RED : GL_RGBA,
+                GL_UNSIGNED_BYTE,
+                nullptr);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer_id);
+            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_id, 0);
+            if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                throw std::logic_error("the capture framebuffer is incomplete");
+            }
+        }
+
+        /// work runs jobs until the renderer is destroyed.
+        /// It is executed by each worker thread.
+        virtual void work() {
+            std::unique_lock<std::mutex> lock(_jobs_mutex);
+            for (;;) {
+                _jobs_changed.wait(lock, [this]() { return !_jobs.empty() || !_running; });
+                if (_jobs.empty()) {
+                    return;
+                }
+                auto job = std::move(_jobs.front());
+                _jobs.pop_front();
+                if (job.ordered) {
+                    _jobs_changed.wait(lock, [&]() { return _next_stream_index == job.stream_index; });
+                }
+                lock.unlock();
+                std::string error;
+                try {
+                    job.handler(job.captured);
+                } catch (const std::exception& exception) {
+                    error = exception.what();
+                }
+                lock.lock();
+                if (job.ordered) {
+                    ++_next_stream_index;
+                }
+                if (!error.empty() && _error.empty()) {
+                    _error = std::move(error);
+                }
+                --_queued_frames;
+                --_handed_frames;
+                _jobs_changed.notify_all();
+            }
+        }
+
         /// check_opengl_error throws if openGL generated an error.
         virtual void check_opengl_error() {
             switch (glGetError()) {
@@ -129,14 +593,45 @@ namespace chameleon {
         std::condition_variable _pixels_updated;
         std::size_t _image_width;
         std::size_t _image_height;
+        bool _waiting_for_pixels;
         bool _closing;
+        std::size_t _maximum_queued_frames;
+        std::size_t _queued_frames;
+        std::size_t _handed_frames;
+        std::size_t _stream_index;
+        std::size_t _next_stream_index;
+        bool _running;
+        std::string _error;
+        std::deque<job> _requests;
+        std::deque<job> _jobs;
+        std::mutex _jobs_mutex;
+        std::condition_variable _jobs_changed;
+        std::vector<std::thread> _workers;
+        bool _readbacks_setup;
+        std::array<readback, 3> _readbacks;
+        std::size_t _next_readback;
+        bool _conversion_setup;
+        GLuint _program_id;
+        GLuint _vertex_array_id;
+        GLuint _origin_location;
+        GLuint _height_location;
+        GLuint _nv12_location;
+        GLuint _capture_texture_id;
+        GLuint _capture_framebuffer_id;
+        QSize _capture_texture_size;
+        GLuint _output_texture_id;
+        GLuint _output_framebuffer_id;
+        QSize _output_texture_size;
+        frame_format _output_format;
     };
 
     /// frame_generator takes screenshots of the window.
     class frame_generator : public QQuickItem {
         Q_OBJECT
+        Q_PROPERTY(int workers READ workers WRITE set_workers)
+        Q_PROPERTY(int maximum_queued_frames READ maximum_queued_frames WRITE set_maximum_queued_frames)
         public:
-        frame_generator() : _closing(false), _renderer_ready(false) {
+        frame_generator() : _closing(false), _renderer_ready(false), _workers(2), _maximum_queued_frames(8) {
             connect(this, &QQuickItem::windowChanged, this, &frame_generator::handle_window_changed);
         }
         frame_generator(const frame_generator&) = delete;
@@ -145,6 +640,46 @@ namespace chameleon {
         frame_generator& operator=(frame_generator&&) = delete;
         virtual ~frame_generator() {}
 
+        /// set_workers defines the number of threads handling asynchronous captures.
+        /// The number of workers will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_workers(int workers) {
+            if (_renderer_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("workers can only be set during qml construction");
+            }
+            if (workers < 1) {
+                throw std::logic_error("workers must be at least 1");
+            }
+            _workers = workers;
+        }
+
+        /// workers returns the currently used number of workers.
+        virtual int workers() const {
+            return _workers;
+        }
+
+        /// set_maximum_queued_frames defines the number of asynchronous captures which can be pending at once.
+        /// Asynchronous captures block when this number is reached, until a worker handles a frame, which bounds the
+        /// memory used by the frames and the capture latency. Captures are dropped instead if all the pending
+        /// captures still wait for a render, so that a capture from the GUI thread never waits for a render that it
+        /// prevents.
+        /// The maximum number of queued frames will be passed to the openGL renderer, therefore it should only be set
+        /// during qml construction.
+        virtual void set_maximum_queued_frames(int maximum_queued_frames) {
+            if (_renderer_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("maximum_queued_frames can only be set during qml construction");
+            }
+            if (maximum_queued_frames < 1) {
+                throw std::logic_error("maximum_queued_frames must be at least 1");
+            }
+            _maximum_queued_frames = maximum_queued_frames;
+        }
+
+        /// maximum_queued_frames returns the currently used maximum number of queued frames.
+        virtual int maximum_queued_frames() const {
+            return _maximum_queued_frames;
+        }
+
         /// save_frame_to triggers a frame render and stores the resulting png image to the given file.
         virtual void save_frame_to(const std::string& filename) {
             while (!_renderer_ready.load(std::memory_order_acquire)) {
@@ -156,12 +691,73 @@ namespace chameleon {
             }
         }
 
+        /// save_frame_to_async requests a frame render, and stores the resulting png image to the given file from a
+        /// worker thread.
+        /// Unlike save_frame_to, it does not wait for the render, and the pixels are read back without stalling the
+        /// render thread. Errors are reported by flush. It can be called from any thread, including the GUI thread.
+        /// It returns false if the capture was dropped because maximum_queued_frames captures wait for a render.
+        virtual bool save_frame_to_async(const std::string& filename) {
+            return capture(
+                [filename](const frame& captured) {
+                    if (!QImage(
+                             captured.pixels.data(),
+                             static_cast<int>(captured.width),
+                             static_cast<int>(captured.height),
+                             static_cast<int>(4 * captured.width),
+                             QImage::Format_RGBA8888_Premultiplied)
+                             .save(QString::fromStdString(filename))) {
+                        throw std::runtime_error(std::string("saving a frame to '") + filename + "' failed");
+                    }
+                },
+                false,
+                frame_format::rgba);
+        }
+
+        /// stream_frame_to requests a frame render, and passes the pixels to the handler from a worker thread.
+        /// Handlers are called in request order, therefore they can write to a pipe (for instance an encoder's
+        /// standard input). Exceptions thrown by the handler are reported by flush. Like save_frame_to_async, it can
+        /// be called from the GUI thread, and returns false if the capture was dropped.
+        virtual bool stream_frame_to(std::function<void(const frame&)> handler) {
+            return stream_frame_to(std::move(handler), frame_format::rgba_bottom_up);
+        }
+
+        /// stream_frame_to requests a frame render in the given format.
+        virtual bool stream_frame_to(std::function<void(const frame&)> handler, frame_format format) {
+            return capture(std::move(handler), true, format);
+        }
+
+        /// encode_frame_to requests a frame render, and passes it to the encoder in its format.
+        /// The encoder must outlive the capture, which is guaranteed after flush. Like stream_frame_to, it returns false
+        /// if the capture was dropped.
+        virtual bool encode_frame_to(frame_encoder& encoder) {
+            return stream_frame_to([&encoder](const frame& captured) { encoder.encode(captured); }, encoder.format());
+        }
+
+        /// finish_readbacks hands the frames being read back to the workers, without waiting for the next render.
+        /// It must be called by the render thread, and is meant for scenes rendered on demand.
+        virtual void finish_readbacks() {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _frame_generator_renderer->finish_readbacks();
+        }
+
+        /// flush blocks until all the asynchronous captures are handled, and throws if one of them failed.
+        virtual void flush() {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            while (!_closing.load(std::memory_order_relaxed)
+                   && !_frame_generator_renderer->wait_for_queued_frames(std::chrono::milliseconds(20))) {
+                QMetaObject::invokeMethod(window(), "update", Qt::QueuedConnection);
+            }
+        }
+
         public slots:
 
         /// sync addapts the renderer to external changes.
         void sync() {
             if (!_frame_generator_renderer) {
-                _frame_generator_renderer = std::unique_ptr<frame_generator_renderer>(new frame_generator_renderer());
+                _frame_generator_renderer = std::unique_ptr<frame_generator_renderer>(new frame_generator_renderer(
+                    static_cast<std::size_t>(_workers), static_cast<std::size_t>(_maximum_queued_frames)));
                 connect(
                     window(),
                     SIGNAL(closing(QQuickCloseEvent*)),
@@ -231,8 +827,20 @@ namespace chameleon {
         }
 
         protected:
+        /// capture forwards an asynchronous capture to the renderer, and returns false if it was dropped.
+        virtual bool capture(std::function<void(const frame&)> handler, bool ordered, frame_format format) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            if (_closing.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            return _frame_generator_renderer->capture(std::move(handler), ordered, format);
+        }
+
         std::atomic_bool _closing;
         std::atomic_bool _renderer_ready;
+        int _workers;
+        int _maximum_queued_frames;
         std::unique_ptr<frame_generator_renderer> _frame_generator_renderer;
         QRectF _capture_area;
     };
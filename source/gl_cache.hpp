@@ -0,0 +1,294 @@
+#pragma once
+
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFunctions_3_3_Core>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// gl_cache shares compiled programs and the full-screen quad between the renderers of an OpenGL context.
+    /// Programs are keyed by their shader sources, therefore renderers with identical options share a program, and
+    /// must set their uniforms before each draw, unless claim_uniforms reports that no other renderer used the
+    /// program since. The cached objects are owned by the cache, and live as long as the
+    /// context.
+    /// If a program binaries directory is set and GL_ARB_get_program_binary is available, linked programs are
+    /// saved to disk and loaded on the next start instead of being compiled.
+    class gl_cache : public QOpenGLFunctions_3_3_Core {
+        public:
+        /// coordinates_location is the attribute location of the quad coordinates in every cached program.
+        static constexpr GLuint coordinates_location = 0;
+
+        gl_cache(const gl_cache&) = delete;
+        gl_cache(gl_cache&&) = delete;
+        gl_cache& operator=(const gl_cache&) = delete;
+        gl_cache& operator=(gl_cache&&) = delete;
+        virtual ~gl_cache() {}
+
+        /// current returns the cache of the current OpenGL context, and creates it on first use.
+        /// It must be called by the render thread.
+        static gl_cache& current() {
+            const auto context = QOpenGLContext::currentContext();
+            if (!context) {
+                throw std::runtime_error("the cache requires a current OpenGL context");
+            }
+            std::lock_guard<std::mutex> lock(caches_mutex());
+            auto& cache = caches()[context];
+            if (!cache) {
+                cache = std::unique_ptr<gl_cache>(new gl_cache(context));
+                QObject::connect(
+                    context,
+                    &QOpenGLContext::aboutToBeDestroyed,
+                    [context]() {
+                        std::lock_guard<std::mutex> lock(caches_mutex());
+                        caches().erase(context);
+                    });
+            }
+            return *cache;
+        }
+
+        /// set_program_binaries_directory enables the persistence of linked programs in the given directory.
+        /// An empty directory (the default) disables persistence. The directory must exist.
+        static void set_program_binaries_directory(const std::string& directory) {
+            std::lock_guard<std::mutex> lock(caches_mutex());
+            program_binaries_directory() = directory;
+        }
+
+        /// program returns a linked program for the given shaders, compiled on first use.
+        /// The attribute named coordinates is bound to coordinates_location, so that the program can draw
+        /// quad_vertex_array.
+        virtual GLuint program(const std::string& vertex_shader, const std::string& fragment_shader) {
+            const auto key = vertex_shader + '\0' + fragment_shader;
+            auto program_candidate = _programs.find(key);
+            if (program_candidate != _programs.end()) {
+                return program_candidate->second;
+            }
+            const auto program_id = glCreateProgram();
+            glBindAttribLocation(program_id, coordinates_location, "coordinates");
+            std::string binary_filename;
+            {
+                std::lock_guard<std::mutex> lock(caches_mutex());
+                if (!program_binaries_directory().empty() && _get_program_binary && _program_binary
+                    && _program_parameter) {
+                    std::stringstream filename;
+                    filename << program_binaries_directory() << "/chameleon_" << std::hex << std::setw(16)
+                             << std::setfill('0') << std::hash<std::string>()(_renderer + '\0' + key) << ".bin";
+                    binary_filename = filename.str();
+                }
+            }
+            if (binary_filename.empty() || !load_binary(program_id, binary_filename)) {
+                compile_and_link(program_id, vertex_shader, fragment_shader);
+                if (!binary_filename.empty()) {
+                    save_binary(program_id, binary_filename);
+                }
+            }
+            _programs.insert({key, program_id});
+            return program_id;
+        }
+
+        /// claim_uniforms records that the given renderer is about to set the uniforms of a shared program, and returns
+        /// true if another renderer used the program since the given renderer's previous claim. Uniforms which rarely
+        /// change (decay, colors...) then only need to be sent when they change or when the claim returns true.
+        virtual bool claim_uniforms(GLuint program_id, const void* renderer) {
+            auto& owner = _uniforms_owners[program_id];
+            const auto claimed = owner != renderer;
+            owner = renderer;
+            return claimed;
+        }
+
+        /// quad_vertex_array returns a vertex array covering the viewport, drawn with
+        /// glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, 0).
+        virtual GLuint quad_vertex_array() {
+            if (_quad_vertex_array_id == 0) {
+                glGenVertexArrays(1, &_quad_vertex_array_id);
+                glBindVertexArray(_quad_vertex_array_id);
+                glGenBuffers(static_cast<GLsizei>(_quad_buffers_ids.size()), _quad_buffers_ids.data());
+                {
+                    glBindBuffer(GL_ARRAY_BUFFER, std::get<0>(_quad_buffers_ids));
+                    std::array<float, 8> coordinates{-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f};
+                    glBufferData(
+                        GL_ARRAY_BUFFER,
+                        coordinates.size() * sizeof(decltype(coordinates)::value_type),
+                        coordinates.data(),
+                        GL_STATIC_DRAW);
+                    glEnableVertexAttribArray(coordinates_location);
+                    glVertexAttribPointer(coordinates_location, 2, GL_FLOAT, GL_FALSE, 0, 0);
+                }
+                {
+                    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, std::get<1>(_quad_buffers_ids));
+                    std::array<GLuint, 4> indices{0, 1, 2, 3};
+                    glBufferData(
+                        GL_ELEMENT_ARRAY_BUFFER,
+                        indices.size() * sizeof(decltype(indices)::value_type),
+                        indices.data(),
+                        GL_STATIC_DRAW);
+                }
+                glBindVertexArray(0);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            }
+            return _quad_vertex_array_id;
+        }
+
+        protected:
+        typedef void(QOPENGLF_APIENTRY* get_program_binary_function)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+        typedef void(QOPENGLF_APIENTRY* program_binary_function)(GLuint, GLenum, const void*, GLsizei);
+        typedef void(QOPENGLF_APIENTRY* program_parameter_function)(GLuint, GLenum, GLint);
+
+        gl_cache(QOpenGLContext* context) :
+            _get_program_binary(nullptr),
+            _program_binary(nullptr),
+            _program_parameter(nullptr),
+            _quad_vertex_array_id(0) {
+            if (!initializeOpenGLFunctions()) {
+                throw std::runtime_error("initializing the OpenGL context failed");
+            }
+            _quad_buffers_ids.fill(0);
+            if (context->hasExtension("GL_ARB_get_program_binary")) {
+                _get_program_binary =
+                    reinterpret_cast<get_program_binary_function>(context->getProcAddress("glGetProgramBinary"));
+                _program_binary = reinterpret_cast<program_binary_function>(context->getProcAddress("glProgramBinary"));
+                _program_parameter =
+                    reinterpret_cast<program_parameter_function>(context->getProcAddress("glProgramParameteri"));
+            }
+
+            // binaries are only valid for the driver that produced them
+            for (const auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+                const auto value = glGetString(name);
+                if (value) {
+                    _renderer.append(reinterpret_cast<const char*>(value));
+                }
+                _renderer.push_back('\0');
+            }
+        }
+
+        /// caches returns the caches of all the contexts.
+        static std::unordered_map<QOpenGLContext*, std::unique_ptr<gl_cache>>& caches() {
+            static std::unordered_map<QOpenGLContext*, std::unique_ptr<gl_cache>> instance;
+            return instance;
+        }
+
+        /// caches_mutex protects the caches map and the program binaries directory.
+        static std::mutex& caches_mutex() {
+            static std::mutex instance;
+            return instance;
+        }
+
+        /// program_binaries_directory returns the directory used to persist programs.
+        static std::string& program_binaries_directory() {
+            static std::string instance;
+            return instance;
+        }
+
+        /// compile_and_link compiles the shaders and links them into the given program.
+        virtual void
+        compile_and_link(GLuint program_id, const std::string& vertex_shader, const std::string& fragment_shader) {
+            const auto vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
+            compile(vertex_shader_id, vertex_shader);
+            const auto fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+            compile(fragment_shader_id, fragment_shader);
+            if (_program_parameter) {
+                _program_parameter(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            }
+            glAttachShader(program_id, vertex_shader_id);
+            glAttachShader(program_id, fragment_shader_id);
+            glLinkProgram(program_id);
+            glDetachShader(program_id, vertex_shader_id);
+            glDetachShader(program_id, fragment_shader_id);
+            glDeleteShader(vertex_shader_id);
+            glDeleteShader(fragment_shader_id);
+            GLint status = 0;
+            glGetProgramiv(program_id, GL_LINK_STATUS, &status);
+            if (status != GL_TRUE) {
+                GLint message_length = 0;
+                glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &message_length);
+                std::vector<char> error_message(message_length);
+                glGetProgramInfoLog(program_id, message_length, nullptr, error_message.data());
+                throw std::logic_error("program error: " + std::string(error_message.data()));
+            }
+        }
+
+        /// compile compiles the given shader source and checks for errors.
+        virtual void compile(GLuint shader_id, const std::string& shader) {
+            auto shader_content = shader.c_str();
+            auto shader_size = static_cast<GLint>(shader.size());
+            glShaderSource(shader_id, 1, static_cast<const GLchar**>(&shader_content), &shader_size);
+            glCompileShader(shader_id);
+            GLint status = 0;
+            glGetShaderiv(shader_id, GL_COMPILE_STATUS, &status);
+            if (status != GL_TRUE) {
+                GLint message_length = 0;
+                glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &message_length);
+                std::vector<char> error_message(message_length);
+                glGetShaderInfoLog(shader_id, message_length, nullptr, error_message.data());
+                throw std::logic_error("Shader error: " + std::string(error_message.data()));
+            }
+        }
+
+        /// load_binary loads a saved program, and returns false if the file is missing or rejected by the driver.
+        virtual bool load_binary(GLuint program_id, const std::string& filename) {
+            std::ifstream input(filename, std::ios::binary);
+            if (!input.good()) {
+                return false;
+            }
+            uint32_t format = 0;
+            input.read(reinterpret_cast<char*>(&format), sizeof(format));
+            if (input.gcount() != sizeof(format)) {
+                return false;
+            }
+            std::vector<char> binary((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+            if (binary.empty()) {
+                return false;
+            }
+            _program_binary(
+                program_id, static_cast<GLenum>(format), binary.data(), static_cast<GLsizei>(binary.size()));
+            GLint status = 0;
+            glGetProgramiv(program_id, GL_LINK_STATUS, &status);
+            return status == GL_TRUE;
+        }
+
+        /// save_binary writes the given linked program to a file.
+        /// Failures are ignored, since the program is compiled again on the next start.
+        virtual void save_binary(GLuint program_id, const std::string& filename) {
+            GLint length = 0;
+            glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+            if (length <= 0) {
+                return;
+            }
+            std::vector<char> binary(static_cast<std::size_t>(length));
+            GLenum format = 0;
+            _get_program_binary(program_id, length, nullptr, &format, binary.data());
+            std::ofstream output(filename, std::ios::binary);
+            const auto stored_format = static_cast<uint32_t>(format);
+            output.write(reinterpret_cast<const char*>(&stored_format), sizeof(stored_format));
+            output.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+        }
+
+        get_program_binary_function _get_program_binary;
+        program_binary_function _program_binary;
+        program_parameter_function _program_parameter;
+        std::string _renderer;
+        std::unordered_map<std::string, GLuint> _programs;
+        std::unordered_map<GLuint, const void*> _uniforms_owners;
+        GLuint _quad_vertex_array_id;
+        std::array<GLuint, 2> _quad_buffers_ids;
+    };
+}
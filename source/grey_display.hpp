@@ -1,6 +1,13 @@
 #pragma once
 
+#include "bulk_conversion.hpp"
+#include "gl_cache.hpp"
+#include "level_of_detail.hpp"
+#include "pbo_ring.hpp"
+#include "performance_monitor.hpp"
+#include "render_scheduler.hpp"
 #include <QQmlParserStatus>
+#include <QtCore/QTimer>
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QOpenGLFunctions_3_3_Core>
 #include <QtQuick/QQuickItem>
@@ -8,7 +15,10 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <stdexcept>
@@ -21,10 +31,37 @@ namespace chameleon {
     class grey_display_renderer : public QObject, public QOpenGLFunctions_3_3_Core {
         Q_OBJECT
         public:
-        grey_display_renderer(QSize canvas_size) :
+        grey_display_renderer(QSize canvas_size, std::size_t format, bool lod) :
             _canvas_size(canvas_size),
-            _exposures(_canvas_size.width() * _canvas_size.height(), 0),
+            _format(format),
+            _lod(lod),
+            _level_of_detail(_canvas_size),
+            _lent_exposures(nullptr),
+            _lent_uploaded(false),
+            _uploading_exposures(nullptr),
+            _pushed_events(0),
             _program_setup(false) {
+            switch (_format) {
+                case 0:
+                    _bytes_per_pixel = sizeof(float);
+                    _internal_format = GL_RED;
+                    _type = GL_FLOAT;
+                    break;
+                case 1:
+                    _bytes_per_pixel = sizeof(uint8_t);
+                    _internal_format = GL_R8;
+                    _type = GL_UNSIGNED_BYTE;
+                    break;
+                case 2:
+                    _bytes_per_pixel = sizeof(uint16_t);
+                    _internal_format = GL_R16;
+                    _type = GL_UNSIGNED_SHORT;
+                    break;
+                default:
+                    throw std::logic_error("unknown format id");
+            }
+            _exposures.resize(
+                static_cast<std::size_t>(_canvas_size.width()) * _canvas_size.height() * _bytes_per_pixel, 0);
             _accessing_exposures.clear(std::memory_order_release);
         }
         grey_display_renderer(const grey_display_renderer&) = delete;
@@ -32,11 +69,12 @@ namespace chameleon {
         grey_display_renderer& operator=(const grey_display_renderer&) = delete;
         grey_display_renderer& operator=(grey_display_renderer&&) = delete;
         virtual ~grey_display_renderer() {
-            glDeleteBuffers(1, &_pbo_id);
-            glDeleteTextures(1, &_texture_id);
-            glDeleteBuffers(static_cast<GLsizei>(_vertex_buffers_ids.size()), _vertex_buffers_ids.data());
-            glDeleteVertexArrays(1, &_vertex_array_id);
-            glDeleteProgram(_program_id);
+            release_lent_exposures();
+            if (_program_setup) {
+                _pbo_ring.release();
+                _performance_monitor.release();
+                glDeleteTextures(1, &_texture_id);
+            }
         }
 
         /// set_rendering_area defines the rendering area.
@@ -47,26 +85,103 @@ namespace chameleon {
             _paint_area.moveTop(window_height - _paint_area.top() - _paint_area.height());
         }
 
+        /// set_region defines the part of the canvas which is displayed, an empty region displays the whole canvas.
+        /// Only the texels of the region are uploaded.
+        virtual void set_region(QRectF region) {
+            _region = region;
+        }
+
+        /// uploaded_bytes returns the number of bytes sent to the GPU during the last frame.
+        virtual std::size_t uploaded_bytes() const {
+            return _performance_monitor.uploaded_bytes();
+        }
+
+        /// sample_performance returns the renderer's counters, with rates measured since the previous call.
+        /// It must always be called by the same thread.
+        virtual performance_counters sample_performance() {
+            return _performance_monitor.sample();
+        }
+
         /// push adds an event to the display.
         template <typename Event>
         void push(Event event) {
             const auto index =
                 static_cast<std::size_t>(event.x) + static_cast<std::size_t>(event.y) * _canvas_size.width();
-            while (_accessing_exposures.test_and_set(std::memory_order_acquire)) {
+            _performance_monitor.lock(_accessing_exposures);
+            if (_lent_exposures) {
+                copy_lent_exposures();
+            }
+            ++_pushed_events;
+            write(index, event.exposure);
+            _accessing_exposures.clear(std::memory_order_release);
+        }
+
+        /// push adds a batch of events to the display.
+        /// The lock is acquired once per batch rather than once per event.
+        template <typename Iterator>
+        void push(Iterator begin, Iterator end) {
+            if (begin == end) {
+                return;
+            }
+            _performance_monitor.lock(_accessing_exposures);
+            if (_lent_exposures) {
+                copy_lent_exposures();
+            }
+            for (; begin != end; ++begin, ++_pushed_events) {
+                const auto index =
+                    static_cast<std::size_t>(begin->x) + static_cast<std::size_t>(begin->y) * _canvas_size.width();
+                write(index, begin->exposure);
             }
-            _exposures[index] = static_cast<float>(event.exposure);
             _accessing_exposures.clear(std::memory_order_release);
         }
 
         /// assign sets all the pixels at once.
+        /// Contiguous ranges of arithmetic values (pointers and std::vector iterators) are converted with SIMD
+        /// kernels.
         template <typename Iterator>
         void assign(Iterator begin, Iterator end) {
-            while (_accessing_exposures.test_and_set(std::memory_order_acquire)) {
-            }
-            _exposures.assign(begin, end);
+            _performance_monitor.lock(_accessing_exposures);
+            release_lent_exposures();
+            assign(
+                begin,
+                end,
+                std::integral_constant<
+                    bool,
+                    is_contiguous_iterator<Iterator>::value
+                        && std::is_arithmetic<typename std::iterator_traits<Iterator>::value_type>::value>());
+            _accessing_exposures.clear(std::memory_order_release);
+        }
+
+        /// lend replaces all the pixels with an external buffer, which the next paint uploads without intermediate
+        /// copy.
+        /// The buffer must hold width * height exposures in the renderer's format, and remain valid until release is
+        /// called. release is called once the buffer is no longer needed: when another buffer or an assign replaces it,
+        /// when a push copies it to the internal pixels, or when the renderer is destroyed. It is called with the
+        /// renderer's lock held, from either the producer or the render thread, and must not call the renderer. If
+        /// the render thread is uploading the buffer, release is called once the upload is complete.
+        virtual void lend(const void* exposures, std::function<void()> release) {
+            _performance_monitor.lock(_accessing_exposures);
+            release_lent_exposures();
+            _lent_exposures = exposures;
+            _lent_release = std::move(release);
+            _lent_uploaded = false;
             _accessing_exposures.clear(std::memory_order_release);
         }
 
+        /// lend shares the ownership of external exposures (typically a std::vector) with the renderer.
+        /// The value type must match the format (float, uint8_t or uint16_t), and the shared pointer is released once
+        /// the exposures are no longer needed.
+        template <typename Exposures>
+        void lend(std::shared_ptr<Exposures> exposures) {
+            typedef typename Exposures::value_type exposure_type;
+            if (sizeof(exposure_type) != _bytes_per_pixel
+                || exposures->size() * sizeof(exposure_type) != _exposures.size()) {
+                throw std::logic_error("the lent exposures do not match the canvas size and format");
+            }
+            const auto data = exposures->data();
+            lend(data, [exposures]() {});
+        }
+
         public slots:
 
         /// paint sends commands to the GPU.
@@ -77,124 +192,65 @@ namespace chameleon {
             if (!_program_setup) {
                 _program_setup = true;
 
-                // compile the vertex shader
-                const auto vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-                {
-                    const std::string vertex_shader(R""(
-                        #version 330 core
-                        in vec2 coordinates;
-                        out vec2 uv;
-                        uniform float width;
-                        uniform float height;
-                        void main() {
-                            gl_Position = vec4(coordinates, 0.0, 1.0);
-                            uv = vec2((coordinates.x + 1) / 2 * width, (coordinates.y + 1) / 2 * height);
-                        }
-                    )"");
-                    auto vertex_shader_content = vertex_shader.c_str();
-                    auto vertex_shader_size = vertex_shader.size();
-                    glShaderSource(
-                        vertex_shader_id,
-                        1,
-                        static_cast<const GLchar**>(&vertex_shader_content),
-                        reinterpret_cast<const GLint*>(&vertex_shader_size));
-                }
-                glCompileShader(vertex_shader_id);
-                check_shader_error(vertex_shader_id);
-
-                // compile the fragment shader
-                const auto fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-                {
-                    const std::string fragment_shader(R""(
-                        #version 330 core
-                        in vec2 uv;
-                        out vec4 color;
-                        uniform sampler2DRect sampler;
-                        void main() {
-                            color = texture(sampler, uv).xxxw;
-                        }
-                    )"");
-                    auto fragment_shader_content = fragment_shader.c_str();
-                    auto fragment_shader_size = fragment_shader.size();
-                    glShaderSource(
-                        fragment_shader_id,
-                        1,
-                        static_cast<const GLchar**>(&fragment_shader_content),
-                        reinterpret_cast<const GLint*>(&fragment_shader_size));
-                }
-                glCompileShader(fragment_shader_id);
-                check_shader_error(fragment_shader_id);
-
-                // create the shaders pipeline
-                _program_id = glCreateProgram();
-                glAttachShader(_program_id, vertex_shader_id);
-                glAttachShader(_program_id, fragment_shader_id);
-                glLinkProgram(_program_id);
-                glDeleteShader(vertex_shader_id);
-                glDeleteShader(fragment_shader_id);
+                // get the program and the quad geometry, shared with the other displays of the context
+                const std::string vertex_shader(R""(
+                    #version 330 core
+                    in vec2 coordinates;
+                    out vec2 uv;
+                    uniform float width;
+                    uniform float height;
+                    void main() {
+                        gl_Position = vec4(coordinates, 0.0, 1.0);
+                        uv = vec2((coordinates.x + 1) / 2 * width, (coordinates.y + 1) / 2 * height);
+                    }
+                )"");
+                const std::string fragment_shader(R""(
+                    #version 330 core
+                    in vec2 uv;
+                    out vec4 color;
+                    uniform sampler2DRect sampler;
+                    void main() {
+                        color = texture(sampler, uv).xxxw;
+                    }
+                )"");
+                auto& cache = gl_cache::current();
+                _program_id = cache.program(vertex_shader, fragment_shader);
+                _vertex_array_id = cache.quad_vertex_array();
                 glUseProgram(_program_id);
-                check_program_error(_program_id);
-
-                // create the vertex array object
-                glGenVertexArrays(1, &_vertex_array_id);
-                glBindVertexArray(_vertex_array_id);
-                glGenBuffers(static_cast<GLsizei>(_vertex_buffers_ids.size()), _vertex_buffers_ids.data());
-                {
-                    glBindBuffer(GL_ARRAY_BUFFER, std::get<0>(_vertex_buffers_ids));
-                    std::array<float, 8> coordinates{-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f};
-                    glBufferData(
-                        GL_ARRAY_BUFFER,
-                        coordinates.size() * sizeof(decltype(coordinates)::value_type),
-                        coordinates.data(),
-                        GL_STATIC_DRAW);
-                    glEnableVertexAttribArray(glGetAttribLocation(_program_id, "coordinates"));
-                    glVertexAttribPointer(glGetAttribLocation(_program_id, "coordinates"), 2, GL_FLOAT, GL_FALSE, 0, 0);
-                }
-                {
-                    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, std::get<1>(_vertex_buffers_ids));
-                    std::array<GLuint, 4> indices{0, 1, 2, 3};
-                    glBufferData(
-                        GL_ELEMENT_ARRAY_BUFFER,
-                        indices.size() * sizeof(decltype(indices)::value_type),
-                        indices.data(),
-                        GL_STATIC_DRAW);
-                }
-                glBindVertexArray(0);
 
-                // set the uniform values
-                glUniform1f(glGetUniformLocation(_program_id, "width"), static_cast<GLfloat>(_canvas_size.width()));
-                glUniform1f(glGetUniformLocation(_program_id, "height"), static_cast<GLfloat>(_canvas_size.height()));
+                // retrieve the uniform locations
+                _width_location = glGetUniformLocation(_program_id, "width");
+                _height_location = glGetUniformLocation(_program_id, "height");
 
                 // create the texture
                 glGenTextures(1, &_texture_id);
-                glBindTexture(GL_TEXTURE_RECTANGLE, _texture_id);
-                glTexImage2D(
-                    GL_TEXTURE_RECTANGLE,
-                    0,
-                    GL_RED,
-                    _canvas_size.width(),
-                    _canvas_size.height(),
-                    0,
-                    GL_RED,
-                    GL_FLOAT,
-                    nullptr);
-                glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-                glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-                glBindTexture(GL_TEXTURE_RECTANGLE, 0);
-
-                // create the pbo
-                glGenBuffers(1, &_pbo_id);
-                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo_id);
-                glBufferData(
-                    GL_PIXEL_UNPACK_BUFFER,
-                    _exposures.size() * sizeof(decltype(_exposures)::value_type),
-                    nullptr,
-                    GL_DYNAMIC_DRAW);
-                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                allocate_texture();
+
+                // create the pbos
+                _pbo_ring.initialize(this, _exposures.size());
+
+                // create the timer queries
+                _performance_monitor.initialize(this);
+            }
+
+            // adapt the texture to the region and the paint area
+            if (_level_of_detail.update(
+                    _region,
+                    static_cast<std::size_t>(std::ceil(_paint_area.width())),
+                    static_cast<std::size_t>(std::ceil(_paint_area.height())),
+                    _lod)) {
+                allocate_texture();
+                _performance_monitor.lock(_accessing_exposures);
+                _lent_uploaded = false;
+                _accessing_exposures.clear(std::memory_order_release);
             }
 
             // send data to the GPU
+            _performance_monitor.begin_gpu();
             glUseProgram(_program_id);
+            const auto texture_size = _level_of_detail.size();
+            glUniform1f(_width_location, static_cast<GLfloat>(texture_size.width()));
+            glUniform1f(_height_location, static_cast<GLfloat>(texture_size.height()));
             glViewport(
                 static_cast<GLint>(_paint_area.left()),
                 static_cast<GLint>(_paint_area.top()),
@@ -203,30 +259,242 @@ namespace chameleon {
             glEnable(GL_BLEND);
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
             glBindTexture(GL_TEXTURE_RECTANGLE, _texture_id);
-            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo_id);
-            glTexSubImage2D(
-                GL_TEXTURE_RECTANGLE, 0, 0, 0, _canvas_size.width(), _canvas_size.height(), GL_RED, GL_FLOAT, 0);
-            {
-                auto buffer = reinterpret_cast<float*>(glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY));
-                if (!buffer) {
-                    throw std::logic_error("glMapBuffer returned an null pointer");
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            _performance_monitor.lock(_accessing_exposures);
+            _performance_monitor.add_events(_pushed_events);
+            _pushed_events = 0;
+            if (_lent_exposures && (_lent_uploaded || _level_of_detail.complete())) {
+                // lent exposures are read from the client memory, the texture keeps them until they are replaced
+                if (!_lent_uploaded) {
+                    // the upload runs without the lock, releasing the buffer meanwhile is deferred
+                    const auto lent_exposures = _lent_exposures;
+                    _lent_uploaded = true;
+                    _uploading_exposures = lent_exposures;
+                    _accessing_exposures.clear(std::memory_order_release);
+                    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                    glTexSubImage2D(
+                        GL_TEXTURE_RECTANGLE,
+                        0,
+                        0,
+                        0,
+                        _canvas_size.width(),
+                        _canvas_size.height(),
+                        GL_RED,
+                        _type,
+                        lent_exposures);
+                    _performance_monitor.set_uploaded_bytes(_exposures.size());
+                    _performance_monitor.lock(_accessing_exposures);
+                    finish_lent_upload();
+                } else {
+                    _performance_monitor.set_uploaded_bytes(0);
                 }
-                while (_accessing_exposures.test_and_set(std::memory_order_acquire)) {
+                _accessing_exposures.clear(std::memory_order_release);
+            } else {
+                // lent exposures which do not fit the texture are reduced like the internal pixels
+                _accessing_exposures.clear(std::memory_order_release);
+                const auto copy_begin = std::chrono::steady_clock::now();
+                auto buffer = reinterpret_cast<uint8_t*>(_pbo_ring.map());
+                _performance_monitor.lock(_accessing_exposures);
+                if (_lent_exposures) {
+                    write_texels(reinterpret_cast<const uint8_t*>(_lent_exposures), buffer);
+                    _lent_uploaded = true;
+                } else {
+                    write_texels(_exposures.data(), buffer);
                 }
-                std::copy(_exposures.begin(), _exposures.end(), buffer);
                 _accessing_exposures.clear(std::memory_order_release);
-                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                _performance_monitor.set_copy_duration(std::chrono::steady_clock::now() - copy_begin);
+                const auto offset = _pbo_ring.unmap();
+                glTexSubImage2D(
+                    GL_TEXTURE_RECTANGLE,
+                    0,
+                    0,
+                    0,
+                    texture_size.width(),
+                    texture_size.height(),
+                    GL_RED,
+                    _type,
+                    reinterpret_cast<const GLvoid*>(offset));
+                _pbo_ring.fence();
+                _performance_monitor.set_uploaded_bytes(_level_of_detail.pixels() * _bytes_per_pixel);
             }
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
             glBindVertexArray(_vertex_array_id);
             glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, 0);
             glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
             glBindTexture(GL_TEXTURE_RECTANGLE, 0);
             glBindVertexArray(0);
             glUseProgram(0);
+            _performance_monitor.end_gpu();
             check_opengl_error();
         }
 
         protected:
+        /// write stores an exposure in the renderer's format.
+        /// the exposures must be locked by the caller.
+        template <typename Exposure>
+        void write(std::size_t index, Exposure exposure) {
+            switch (_format) {
+                case 0:
+                    reinterpret_cast<float*>(_exposures.data())[index] = static_cast<float>(exposure);
+                    break;
+                case 1:
+                    _exposures[index] = static_cast<uint8_t>(exposure);
+                    break;
+                default:
+                    reinterpret_cast<uint16_t*>(_exposures.data())[index] = static_cast<uint16_t>(exposure);
+                    break;
+            }
+        }
+
+        /// assign converts the exposures of a contiguous range.
+        /// Float exposures are converted with the SIMD kernels, and integer exposures matching the format are copied.
+        /// the exposures must be locked by the caller.
+        template <typename Iterator>
+        void assign(Iterator begin, Iterator end, std::true_type) {
+            typedef typename std::iterator_traits<Iterator>::value_type exposure_type;
+            const auto count = std::min(
+                static_cast<std::size_t>(std::distance(begin, end)), _exposures.size() / _bytes_per_pixel);
+            if (count == 0) {
+                return;
+            }
+            if (_format == 0) {
+                bulk_conversion::to_floats(
+                    make_strided_field(begin, *begin), count, reinterpret_cast<float*>(_exposures.data()));
+            } else if (
+                std::is_integral<exposure_type>::value && std::is_unsigned<exposure_type>::value
+                && sizeof(exposure_type) == _bytes_per_pixel) {
+                std::memcpy(_exposures.data(), &(*begin), count * _bytes_per_pixel);
+            } else {
+                assign(begin, std::next(begin, count), std::false_type());
+            }
+        }
+
+        /// assign converts the exposures of a generic range.
+        /// the exposures must be locked by the caller.
+        template <typename Iterator>
+        void assign(Iterator begin, Iterator end, std::false_type) {
+            switch (_format) {
+                case 0:
+                    assign_as<float>(begin, end);
+                    break;
+                case 1:
+                    assign_as<uint8_t>(begin, end);
+                    break;
+                default:
+                    assign_as<uint16_t>(begin, end);
+                    break;
+            }
+        }
+
+        /// assign_as converts the exposures of a generic range to the given type.
+        /// the exposures must be locked by the caller.
+        template <typename Exposure, typename Iterator>
+        void assign_as(Iterator begin, Iterator end) {
+            auto exposures = reinterpret_cast<Exposure*>(_exposures.data());
+            const auto pixels = _exposures.size() / sizeof(Exposure);
+            for (std::size_t index = 0; begin != end && index < pixels; ++begin, ++index) {
+                exposures[index] = static_cast<Exposure>(*begin);
+            }
+        }
+
+        /// write_texels copies the region of the given exposures to the texture buffer, reduced to the level of detail.
+        /// Reduced texels are the mean of the pixels they cover.
+        /// the exposures must be locked by the caller.
+        virtual void write_texels(const uint8_t* exposures, uint8_t* buffer) {
+            if (_level_of_detail.identity()) {
+                _level_of_detail.copy(
+                    exposures, buffer, _bytes_per_pixel, 0, static_cast<std::size_t>(_level_of_detail.size().height()));
+                return;
+            }
+            switch (_format) {
+                case 0:
+                    reduce_as<float, double>(exposures, buffer);
+                    break;
+                case 1:
+                    reduce_as<uint8_t, uint64_t>(exposures, buffer);
+                    break;
+                default:
+                    reduce_as<uint16_t, uint64_t>(exposures, buffer);
+                    break;
+            }
+        }
+
+        /// reduce_as averages the blocks of exposures of the given type, accumulated with the given sum type.
+        template <typename Exposure, typename Sum>
+        void reduce_as(const uint8_t* exposures, uint8_t* buffer) {
+            const auto width = static_cast<std::size_t>(_canvas_size.width());
+            const auto source = reinterpret_cast<const Exposure*>(exposures);
+            const auto texels = reinterpret_cast<Exposure*>(buffer);
+            _level_of_detail.reduce(
+                0,
+                static_cast<std::size_t>(_level_of_detail.size().height()),
+                [&](std::size_t index, std::size_t x_begin, std::size_t x_end, std::size_t y_begin, std::size_t y_end) {
+                    Sum sum = 0;
+                    for (auto y = y_begin; y < y_end; ++y) {
+                        for (auto x = x_begin; x < x_end; ++x) {
+                            sum += source[x + y * width];
+                        }
+                    }
+                    const auto count = static_cast<Sum>((x_end - x_begin) * (y_end - y_begin));
+                    texels[index] = static_cast<Exposure>(
+                        std::is_integral<Sum>::value ? (sum + count / 2) / count : sum / count);
+                });
+        }
+
+        /// allocate_texture sizes the texture to the level of detail, the previous content is lost.
+        virtual void allocate_texture() {
+            const auto texture_size = _level_of_detail.size();
+            glBindTexture(GL_TEXTURE_RECTANGLE, _texture_id);
+            glTexImage2D(
+                GL_TEXTURE_RECTANGLE,
+                0,
+                _internal_format,
+                texture_size.width(),
+                texture_size.height(),
+                0,
+                GL_RED,
+                _type,
+                nullptr);
+            glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+        }
+
+        /// copy_lent_exposures copies the lent exposures to the internal pixels, and releases them.
+        /// the exposures must be locked by the caller.
+        virtual void copy_lent_exposures() {
+            std::memcpy(_exposures.data(), _lent_exposures, _exposures.size());
+            release_lent_exposures();
+        }
+
+        /// release_lent_exposures releases the lent exposures, if any.
+        /// the exposures must be locked by the caller.
+        virtual void release_lent_exposures() {
+            if (_lent_exposures) {
+                auto release = std::move(_lent_release);
+                _lent_release = nullptr;
+                if (release) {
+                    if (_lent_exposures == _uploading_exposures) {
+                        _deferred_releases.push_back(std::move(release));
+                    } else {
+                        release();
+                    }
+                }
+                _lent_exposures = nullptr;
+            }
+        }
+
+        /// finish_lent_upload calls the releases deferred during the upload of lent exposures.
+        /// the exposures must be locked by the caller.
+        virtual void finish_lent_upload() {
+            _uploading_exposures = nullptr;
+            auto deferred_releases = std::move(_deferred_releases);
+            _deferred_releases.clear();
+            for (auto& release : deferred_releases) {
+                release();
+            }
+        }
+
         /// check_opengl_error throws if openGL generated an error.
         virtual void check_opengl_error() {
             switch (glGetError()) {
@@ -243,36 +511,21 @@ namespace chameleon {
             }
         }
 
-        /// check_shader_error checks for shader compilation errors.
-        virtual void check_shader_error(GLuint shader_id) {
-            GLint status = 0;
-            glGetShaderiv(shader_id, GL_COMPILE_STATUS, &status);
-
-            if (status != GL_TRUE) {
-                GLint message_length = 0;
-                glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &message_length);
-                std::vector<char> error_message(message_length);
-                glGetShaderInfoLog(shader_id, message_length, nullptr, error_message.data());
-                throw std::logic_error("Shader error: " + std::string(error_message.data()));
-            }
-        }
-
-        /// check_program_error checks for program errors.
-        virtual void check_program_error(GLuint program_id) {
-            GLint status = 0;
-            glGetProgramiv(program_id, GL_LINK_STATUS, &status);
-
-            if (status != GL_TRUE) {
-                GLint message_length = 0;
-                glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &message_length);
-                std::vector<char> error_message(message_length);
-                glGetShaderInfoLog(program_id, message_length, nullptr, error_message.data());
-                throw std::logic_error("program error: " + std::string(error_message.data()));
-            }
-        }
-
         QSize _canvas_size;
-        std::vector<float> _exposures;
+        std::size_t _format;
+        bool _lod;
+        level_of_detail _level_of_detail;
+        QRectF _region;
+        std::size_t _bytes_per_pixel;
+        GLenum _internal_format;
+        GLenum _type;
+        std::vector<uint8_t> _exposures;
+        const void* _lent_exposures;
+        std::function<void()> _lent_release;
+        bool _lent_uploaded;
+        const void* _uploading_exposures;
+        std::vector<std::function<void()>> _deferred_releases;
+        std::size_t _pushed_events;
         std::atomic_flag _accessing_exposures;
         QRectF _clear_area;
         QRectF _paint_area;
@@ -280,8 +533,10 @@ namespace chameleon {
         GLuint _program_id;
         GLuint _vertex_array_id;
         GLuint _texture_id;
-        GLuint _pbo_id;
-        std::array<GLuint, 2> _vertex_buffers_ids;
+        pbo_ring _pbo_ring;
+        performance_monitor _performance_monitor;
+        GLuint _width_location;
+        GLuint _height_location;
     };
 
     /// grey_display displays a stream of events without tone-mapping.
@@ -289,10 +544,34 @@ namespace chameleon {
         Q_OBJECT
         Q_INTERFACES(QQmlParserStatus)
         Q_PROPERTY(QSize canvas_size READ canvas_size WRITE set_canvas_size)
+        Q_PROPERTY(Format format READ format WRITE set_format)
+        Q_PROPERTY(bool lod READ lod WRITE set_lod)
+        Q_PROPERTY(QRectF region READ region WRITE set_region NOTIFY region_changed)
         Q_PROPERTY(QRectF paint_area READ paint_area)
+        Q_PROPERTY(double events_per_second READ events_per_second NOTIFY performance_changed)
+        Q_PROPERTY(double lock_spins_per_second READ lock_spins_per_second NOTIFY performance_changed)
+        Q_PROPERTY(double copy_duration READ copy_duration NOTIFY performance_changed)
+        Q_PROPERTY(double gpu_duration READ gpu_duration NOTIFY performance_changed)
+        Q_PROPERTY(qint64 uploaded_bytes READ uploaded_bytes NOTIFY performance_changed)
+        Q_ENUMS(Format)
         public:
-        grey_display() : _ready(false), _renderer_ready(false) {
+        /// Format defines the texture format, and the type of the stored exposures.
+        /// Float exposures range in [0, 1], whereas Uint8 and Uint16 exposures are sensor levels, normalized by the
+        /// GPU (GL_R8 and GL_R16 textures).
+        enum Format { Float, Uint8, Uint16 };
+
+        grey_display() :
+            _ready(false),
+            _renderer_ready(false),
+            _render_scheduler(nullptr),
+            _format(Format::Float),
+            _lod(false) {
             connect(this, &QQuickItem::windowChanged, this, &grey_display::handle_window_changed);
+            _performance = performance_counters{};
+            _performance_timer.setInterval(1000);
+            connect(&_performance_timer, &QTimer::timeout, this, &grey_display::update_performance);
+            _performance_timer.start();
+            _accessing_renderer.clear(std::memory_order_release);
         }
         grey_display(const grey_display&) = delete;
         grey_display(grey_display&&) = delete;
@@ -317,6 +596,80 @@ namespace chameleon {
             return _canvas_size;
         }
 
+        /// set_format defines the texture format.
+        /// The format will be passed to the openGL renderer, therefore it should only be set during qml construction.
+        virtual void set_format(Format format) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("format can only be set during qml construction");
+            }
+            _format = format;
+        }
+
+        /// format returns the currently used format.
+        virtual Format format() const {
+            return _format;
+        }
+
+        /// set_lod defines whether the canvas is reduced to the paint area size before upload.
+        /// Each on-screen pixel then shows the mean of the canvas pixels it covers, and the upload cost follows the
+        /// number of on-screen pixels rather than the sensor size.
+        /// The lod mode will be passed to the openGL renderer, therefore it should only be set during qml
+        /// construction.
+        virtual void set_lod(bool lod) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("lod can only be set during qml construction");
+            }
+            _lod = lod;
+        }
+
+        /// lod returns the currently used lod mode.
+        virtual bool lod() const {
+            return _lod;
+        }
+
+        /// set_region defines the part of the canvas which is displayed, in canvas coordinates.
+        /// Only the region is uploaded, and it is stretched to the item while keeping its aspect ratio. An empty
+        /// region (default) displays the whole canvas. The region can be changed at any time to pan and zoom.
+        virtual void set_region(QRectF region) {
+            if (region != _region) {
+                _region = region;
+                region_changed(_region);
+                trigger_draw();
+            }
+        }
+
+        /// region returns the currently displayed region.
+        virtual QRectF region() const {
+            return _region;
+        }
+
+        /// events_per_second returns the number of events received per second, measured over the last second.
+        virtual double events_per_second() const {
+            return _performance.events_per_second;
+        }
+
+        /// lock_spins_per_second returns the number of iterations per second spent waiting for the renderer's locks.
+        /// A high value means that producers and the render thread contend.
+        virtual double lock_spins_per_second() const {
+            return _performance.lock_spins_per_second;
+        }
+
+        /// copy_duration returns the CPU time, in microseconds, spent copying the state to the GPU buffers during the
+        /// latest frame.
+        virtual double copy_duration() const {
+            return _performance.copy_duration;
+        }
+
+        /// gpu_duration returns the GPU time, in microseconds, of the latest measured frame.
+        virtual double gpu_duration() const {
+            return _performance.gpu_duration;
+        }
+
+        /// uploaded_bytes returns the number of bytes sent to the GPU during the last frame.
+        virtual std::size_t uploaded_bytes() const {
+            return _performance.uploaded_bytes;
+        }
+
         /// paint_area returns the paint area in window coordinates.
         virtual QRectF paint_area() const {
             return _paint_area;
@@ -328,6 +681,16 @@ namespace chameleon {
             while (!_renderer_ready.load(std::memory_order_acquire)) {
             }
             _grey_display_renderer->push<Event>(event);
+            request_update();
+        }
+
+        /// push adds a batch of events to the display.
+        template <typename Iterator>
+        void push(Iterator begin, Iterator end) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _grey_display_renderer->push<Iterator>(begin, end);
+            request_update();
         }
 
         /// assign sets all the pixels at once.
@@ -336,6 +699,24 @@ namespace chameleon {
             while (!_renderer_ready.load(std::memory_order_acquire)) {
             }
             _grey_display_renderer->assign<Iterator>(begin, end);
+            request_update();
+        }
+
+        /// lend replaces all the pixels with an external buffer, uploaded without intermediate copy.
+        virtual void lend(const void* exposures, std::function<void()> release) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _grey_display_renderer->lend(exposures, std::move(release));
+            request_update();
+        }
+
+        /// lend shares the ownership of external exposures with the display.
+        template <typename Exposures>
+        void lend(std::shared_ptr<Exposures> exposures) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _grey_display_renderer->lend(std::move(exposures));
+            request_update();
         }
 
         /// componentComplete is called when all the qml values are bound.
@@ -351,21 +732,30 @@ namespace chameleon {
         /// paintAreaChanged notifies a paint area change.
         void paintAreaChanged(QRectF paint_area);
 
+        /// region_changed notifies a change of the displayed region.
+        void region_changed(QRectF region);
+
+        /// performance_changed notifies a change of the performance counters.
+        void performance_changed();
+
         public slots:
 
         /// sync adapts the renderer to external changes.
         void sync() {
             if (_ready.load(std::memory_order_relaxed)) {
                 if (!_grey_display_renderer) {
-                    _grey_display_renderer =
-                        std::unique_ptr<grey_display_renderer>(new grey_display_renderer(_canvas_size));
+                    _grey_display_renderer = std::unique_ptr<grey_display_renderer>(
+                        new grey_display_renderer(_canvas_size, static_cast<std::size_t>(_format), _lod));
                     connect(
                         window(),
                         &QQuickWindow::beforeRendering,
                         _grey_display_renderer.get(),
                         &grey_display_renderer::paint,
                         Qt::DirectConnection);
+                    while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+                    }
                     _renderer_ready.store(true, std::memory_order_release);
+                    _accessing_renderer.clear(std::memory_order_release);
                 }
                 auto clear_area =
                     QRectF(0, 0, width() * window()->devicePixelRatio(), height() * window()->devicePixelRatio());
@@ -373,16 +763,24 @@ namespace chameleon {
                     clear_area.moveLeft(clear_area.left() + item->x() * window()->devicePixelRatio());
                     clear_area.moveTop(clear_area.top() + item->y() * window()->devicePixelRatio());
                 }
-                if (clear_area != _clear_area) {
+                if (clear_area != _clear_area || _region != _synced_region) {
                     _clear_area = std::move(clear_area);
-                    if (clear_area.width() * _canvas_size.height() > clear_area.height() * _canvas_size.width()) {
-                        _paint_area.setWidth(clear_area.height() * _canvas_size.width() / _canvas_size.height());
+                    _synced_region = _region;
+                    auto visible_width = static_cast<qreal>(_canvas_size.width());
+                    auto visible_height = static_cast<qreal>(_canvas_size.height());
+                    _grey_display_renderer->set_region(_region);
+                    if (!_region.isEmpty()) {
+                        visible_width = _region.width();
+                        visible_height = _region.height();
+                    }
+                    if (clear_area.width() * visible_height > clear_area.height() * visible_width) {
+                        _paint_area.setWidth(clear_area.height() * visible_width / visible_height);
                         _paint_area.setHeight(clear_area.height());
                         _paint_area.moveLeft(clear_area.left() + (clear_area.width() - _paint_area.width()) / 2);
                         _paint_area.moveTop(clear_area.top());
                     } else {
                         _paint_area.setWidth(clear_area.width());
-                        _paint_area.setHeight(clear_area.width() * _canvas_size.height() / _canvas_size.width());
+                        _paint_area.setHeight(clear_area.width() * visible_height / visible_width);
                         _paint_area.moveLeft(clear_area.left());
                         _paint_area.moveTop(clear_area.top() + (clear_area.height() - _paint_area.height()) / 2);
                     }
@@ -394,14 +792,19 @@ namespace chameleon {
         }
 
         /// cleanup frees the owned renderer.
+        /// Pushes wait for the next renderer, created by sync if the scene graph is initialized again.
         void cleanup() {
+            while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+            }
+            _renderer_ready.store(false, std::memory_order_release);
             _grey_display_renderer.reset();
+            _accessing_renderer.clear(std::memory_order_release);
         }
 
         /// trigger_draw requests a window refresh.
         void trigger_draw() {
             if (window()) {
-                window()->update();
+                render_scheduler::of(window())->request_update();
             }
         }
 
@@ -414,15 +817,49 @@ namespace chameleon {
                 connect(
                     window, &QQuickWindow::sceneGraphInvalidated, this, &grey_display::cleanup, Qt::DirectConnection);
                 window->setClearBeforeRendering(false);
+                _render_scheduler.store(render_scheduler::of(window), std::memory_order_release);
+            }
+        }
+
+        /// update_performance samples the renderer's counters.
+        /// The renderer lock prevents cleanup from freeing the renderer during the sample.
+        void update_performance() {
+            while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+            }
+            if (_renderer_ready.load(std::memory_order_relaxed)) {
+                const auto performance = _grey_display_renderer->sample_performance();
+                _accessing_renderer.clear(std::memory_order_release);
+                if (performance != _performance) {
+                    _performance = performance;
+                    performance_changed();
+                }
+            } else {
+                _accessing_renderer.clear(std::memory_order_release);
             }
         }
 
         protected:
+        /// request_update schedules a window update, coalesced with the other displays of the window.
+        virtual void request_update() {
+            const auto scheduler = _render_scheduler.load(std::memory_order_acquire);
+            if (scheduler) {
+                scheduler->request_update();
+            }
+        }
+
         std::atomic_bool _ready;
         std::atomic_bool _renderer_ready;
+        std::atomic_flag _accessing_renderer;
+        std::atomic<render_scheduler*> _render_scheduler;
         QSize _canvas_size;
+        Format _format;
+        bool _lod;
+        QRectF _region;
+        QRectF _synced_region;
         std::unique_ptr<grey_display_renderer> _grey_display_renderer;
         QRectF _clear_area;
         QRectF _paint_area;
+        performance_counters _performance;
+        QTimer _performance_timer;
     };
 }
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "frame_generator.hpp"
+#include <QtGui/QOffscreenSurface>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFramebufferObject>
+#include <QtGui/QOpenGLFunctions>
+#include <QtQml/QQmlComponent>
+#include <QtQml/QQmlEngine>
+#include <QtQuick/QQuickItem>
+#include <QtQuick/QQuickRenderControl>
+#include <QtQuick/qquickwindow.h>
+#include <memory>
+#include <stdexcept>
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// headless_renderer renders a qml scene into an offscreen framebuffer, without a visible window.
+    /// Frames are rendered on demand by the calling thread, which acts as the render thread, therefore event files
+    /// can be replayed as fast as the GPU allows.
+    class headless_renderer : public QObject {
+        Q_OBJECT
+        public:
+        headless_renderer(QSize size) : _size(size) {
+            QSurfaceFormat format;
+            format.setDepthBufferSize(24);
+            format.setStencilBufferSize(8);
+            format.setVersion(3, 3);
+            format.setProfile(QSurfaceFormat::CoreProfile);
+            _context.setFormat(format);
+            if (!_context.create()) {
+                throw std::runtime_error("creating the OpenGL context failed");
+            }
+            _surface.setFormat(_context.format());
+            _surface.create();
+            _render_control = std::unique_ptr<QQuickRenderControl>(new QQuickRenderControl());
+            _window = std::unique_ptr<QQuickWindow>(new QQuickWindow(_render_control.get()));
+            _window->setGeometry(0, 0, _size.width(), _size.height());
+            if (!_context.makeCurrent(&_surface)) {
+                throw std::runtime_error("making the OpenGL context current failed");
+            }
+            _render_control->initialize(&_context);
+            _framebuffer = std::unique_ptr<QOpenGLFramebufferObject>(
+                new QOpenGLFramebufferObject(_size, QOpenGLFramebufferObject::CombinedDepthStencil));
+            _window->setRenderTarget(_framebuffer.get());
+        }
+        headless_renderer(const headless_renderer&) = delete;
+        headless_renderer(headless_renderer&&) = delete;
+        headless_renderer& operator=(const headless_renderer&) = delete;
+        headless_renderer& operator=(headless_renderer&&) = delete;
+        virtual ~headless_renderer() {
+            _context.makeCurrent(&_surface);
+            _root.reset();
+            _component.reset();
+            _render_control->invalidate();
+            _framebuffer.reset();
+            _window.reset();
+            _render_control.reset();
+            _context.doneCurrent();
+        }
+
+        /// load creates the qml scene from the given data, and renders a first frame.
+        /// The first frame creates the displays' renderers, which is required before pushing events.
+        virtual void load(const QByteArray& data) {
+            _root.reset();
+            _component = std::unique_ptr<QQmlComponent>(new QQmlComponent(&_engine));
+            _component->setData(data, QUrl());
+            if (_component->isError()) {
+                throw std::runtime_error(_component->errorString().toStdString());
+            }
+            _root = std::unique_ptr<QObject>(_component->create());
+            auto item = qobject_cast<QQuickItem*>(_root.get());
+            if (!item) {
+                throw std::logic_error("the qml root object must be an Item");
+            }
+            item->setParentItem(_window->contentItem());
+            item->setWidth(_size.width());
+            item->setHeight(_size.height());
+            render();
+        }
+
+        /// root returns the root object of the qml scene.
+        virtual QObject* root() const {
+            return _root.get();
+        }
+
+        /// render draws a frame into the framebuffer.
+        virtual void render() {
+            if (!_context.makeCurrent(&_surface)) {
+                throw std::runtime_error("making the OpenGL context current failed");
+            }
+            _render_control->polishItems();
+            _render_control->sync();
+            _render_control->render();
+            _context.functions()->glFlush();
+        }
+
+        /// image returns the last rendered frame.
+        virtual QImage image() {
+            _context.makeCurrent(&_surface);
+            return _framebuffer->toImage();
+        }
+
+        /// replay pushes events to the scene, and renders a frame every frame_duration (in timestamp units).
+        /// push is called with each range of events belonging to a frame, and before_render with the frame's
+        /// timestamp before it is rendered (for instance to request a capture from a frame_generator).
+        template <typename Iterator, typename Push, typename BeforeRender>
+        void replay(Iterator begin, Iterator end, uint64_t frame_duration, Push push, BeforeRender before_render) {
+            if (begin == end) {
+                return;
+            }
+            auto frame_t = static_cast<uint64_t>(begin->t) + frame_duration;
+            auto frame_begin = begin;
+            for (; begin != end; ++begin) {
+                if (static_cast<uint64_t>(begin->t) >= frame_t) {
+                    push(frame_begin, begin);
+                    frame_begin = begin;
+                    while (static_cast<uint64_t>(begin->t) >= frame_t) {
+                        before_render(frame_t);
+                        render();
+                        frame_t += frame_duration;
+                    }
+                }
+            }
+            push(frame_begin, end);
+            before_render(frame_t);
+            render();
+            flush();
+        }
+
+        /// flush waits for the asynchronous captures of the scene's frame generators.
+        virtual void flush() {
+            if (!_root) {
+                return;
+            }
+            _context.makeCurrent(&_surface);
+            auto frame_generators = _root->findChildren<frame_generator*>();
+            if (auto root_frame_generator = qobject_cast<frame_generator*>(_root.get())) {
+                frame_generators.append(root_frame_generator);
+            }
+            for (auto frame_generator : frame_generators) {
+                frame_generator->finish_readbacks();
+                frame_generator->flush();
+            }
+        }
+
+        protected:
+        QSize _size;
+        QOpenGLContext _context;
+        QOffscreenSurface _surface;
+        std::unique_ptr<QQuickRenderControl> _render_control;
+        std::unique_ptr<QQuickWindow> _window;
+        std::unique_ptr<QOpenGLFramebufferObject> _framebuffer;
+        QQmlEngine _engine;
+        std::unique_ptr<QQmlComponent> _component;
+        std::unique_ptr<QObject> _root;
+    };
+}
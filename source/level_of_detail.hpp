@@ -0,0 +1,186 @@
+#pragma once
+
+#include "tiled_layout.hpp"
+#include <QtCore/QRectF>
+#include <QtCore/QSize>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// level_of_detail maps the texture of a display to a region of its canvas.
+    /// The region is the visible part of the canvas, the whole canvas by default. When reduction is enabled and the
+    /// region has more pixels than the paint area, each texel covers a block of canvas pixels, so that the uploaded
+    /// data follows the on-screen size rather than the sensor size. The displays choose how a block is reduced.
+    class level_of_detail {
+        public:
+        level_of_detail(QSize canvas_size) :
+            _canvas_width(static_cast<std::size_t>(canvas_size.width())),
+            _canvas_height(static_cast<std::size_t>(canvas_size.height())),
+            _left(0),
+            _top(0),
+            _region_width(0),
+            _region_height(0),
+            _width(0),
+            _height(0) {
+            update(QRectF(), 0, 0, false);
+        }
+        level_of_detail(const level_of_detail&) = delete;
+        level_of_detail(level_of_detail&&) = delete;
+        level_of_detail& operator=(const level_of_detail&) = delete;
+        level_of_detail& operator=(level_of_detail&&) = delete;
+        virtual ~level_of_detail() {}
+
+        /// update computes the texture layout, and returns true if it changed.
+        /// The region is given in canvas coordinates and clipped to the canvas, an empty region selects the whole
+        /// canvas. The target size is the paint area in device pixels, ignored if reduce is false.
+        virtual bool update(QRectF region, std::size_t target_width, std::size_t target_height, bool reduce) {
+            std::size_t left = 0;
+            std::size_t top = 0;
+            std::size_t right = _canvas_width;
+            std::size_t bottom = _canvas_height;
+            if (!region.isEmpty()) {
+                left = clamp(std::floor(region.left()), _canvas_width - 1);
+                top = clamp(std::floor(region.top()), _canvas_height - 1);
+                right = std::max(left + 1, clamp(std::ceil(region.left() + region.width()), _canvas_width));
+                bottom = std::max(top + 1, clamp(std::ceil(region.top() + region.height()), _canvas_height));
+            }
+            auto width = right - left;
+            auto height = bottom - top;
+            if (reduce && target_width > 0 && target_height > 0) {
+                width = std::min(width, target_width);
+                height = std::min(height, target_height);
+            }
+            if (left == _left && top == _top && right - left == _region_width && bottom - top == _region_height
+                && width == _width && height == _height) {
+                return false;
+            }
+            _left = left;
+            _top = top;
+            _region_width = right - left;
+            _region_height = bottom - top;
+            _width = width;
+            _height = height;
+            boundaries(_left, _region_width, _width, _columns);
+            boundaries(_top, _region_height, _height, _rows);
+            return true;
+        }
+
+        /// size returns the texture size.
+        virtual QSize size() const {
+            return QSize(static_cast<int>(_width), static_cast<int>(_height));
+        }
+
+        /// pixels returns the number of texels.
+        virtual std::size_t pixels() const {
+            return _width * _height;
+        }
+
+        /// identity returns true if each texel is a single canvas pixel.
+        virtual bool identity() const {
+            return _width == _region_width && _height == _region_height;
+        }
+
+        /// complete returns true if the texture holds the whole canvas, pixel for pixel.
+        virtual bool complete() const {
+            return identity() && _width == _canvas_width && _height == _canvas_height;
+        }
+
+        /// texture_rows converts sorted ranges of canvas rows to the sorted ranges of texture rows they overlap.
+        /// Rows outside the region are skipped, and overlapping texture ranges are merged.
+        virtual void texture_rows(
+            const std::vector<std::pair<std::size_t, std::size_t>>& canvas_rows,
+            std::vector<std::pair<std::size_t, std::size_t>>& rows) const {
+            rows.clear();
+            for (const auto& range : canvas_rows) {
+                const auto first = std::max(range.first, _top);
+                const auto last = std::min(range.second, _top + _region_height);
+                if (first >= last) {
+                    continue;
+                }
+                const auto begin = static_cast<std::size_t>(
+                    std::distance(_rows.begin(), std::upper_bound(_rows.begin(), _rows.end(), first)) - 1);
+                const auto end = static_cast<std::size_t>(
+                    std::distance(_rows.begin(), std::lower_bound(_rows.begin(), _rows.end(), last)));
+                if (!rows.empty() && begin <= rows.back().second) {
+                    rows.back().second = std::max(rows.back().second, end);
+                } else {
+                    rows.emplace_back(begin, end);
+                }
+            }
+        }
+
+        /// copy writes the texture rows [begin, end) from the canvas pixels, when identity is true.
+        /// Each pixel is made of channels values.
+        template <typename Value>
+        void copy(const Value* canvas, Value* texture, std::size_t channels, std::size_t begin, std::size_t end) const {
+            for (auto y = begin; y < end; ++y) {
+                const auto source = canvas + ((_top + y) * _canvas_width + _left) * channels;
+                std::copy(source, source + _width * channels, texture + y * _width * channels);
+            }
+        }
+
+        /// copy writes the texture rows [begin, end) from canvas pixels stored with the given layout, when identity
+        /// is true.
+        template <typename Value>
+        void copy(
+            const tiled_layout& layout,
+            const Value* canvas,
+            Value* texture,
+            std::size_t channels,
+            std::size_t begin,
+            std::size_t end) const {
+            for (auto y = begin; y < end; ++y) {
+                layout.copy_row(canvas, texture + y * _width * channels, channels, _top + y, _left, _left + _width);
+            }
+        }
+
+        /// reduce calls the given function for each texel of the rows [begin, end).
+        /// The function is called with the texel index, and the canvas block [x_begin, x_end) x [y_begin, y_end)
+        /// covered by the texel.
+        template <typename Reduce>
+        void reduce(std::size_t begin, std::size_t end, Reduce reduce) const {
+            for (auto y = begin; y < end; ++y) {
+                for (std::size_t x = 0; x < _width; ++x) {
+                    reduce(y * _width + x, _columns[x], _columns[x + 1], _rows[y], _rows[y + 1]);
+                }
+            }
+        }
+
+        protected:
+        /// clamp converts a coordinate to an index in the range [0, maximum].
+        static std::size_t clamp(double value, std::size_t maximum) {
+            if (value <= 0) {
+                return 0;
+            }
+            return std::min(static_cast<std::size_t>(value), maximum);
+        }
+
+        /// boundaries splits the range [offset, offset + length) in size blocks.
+        static void boundaries(
+            std::size_t offset,
+            std::size_t length,
+            std::size_t size,
+            std::vector<std::size_t>& boundaries) {
+            boundaries.resize(size + 1);
+            for (std::size_t index = 0; index <= size; ++index) {
+                boundaries[index] = offset + index * length / size;
+            }
+        }
+
+        const std::size_t _canvas_width;
+        const std::size_t _canvas_height;
+        std::size_t _left;
+        std::size_t _top;
+        std::size_t _region_width;
+        std::size_t _region_height;
+        std::size_t _width;
+        std::size_t _height;
+        std::vector<std::size_t> _columns;
+        std::vector<std::size_t> _rows;
+    };
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFunctions_3_3_Core>
+#include <array>
+#include <stdexcept>
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// pbo_ring manages several pixel unpack buffers used in turn, so that the CPU writes the next frame while the
+    /// GPU transfers the previous ones.
+    /// If GL_ARB_buffer_storage is available, a single persistently mapped buffer split in regions is used instead.
+    /// Fences guarantee that a buffer (or region) is never written while the GPU still reads it.
+    class pbo_ring {
+        public:
+        /// size is the number of buffers in the ring.
+        static constexpr std::size_t size = 3;
+
+        pbo_ring() : _functions(nullptr), _persistent(false), _buffer_size(0), _index(0), _persistent_buffer(nullptr) {
+            _ids.fill(0);
+            _fences.fill(nullptr);
+        }
+        pbo_ring(const pbo_ring&) = delete;
+        pbo_ring(pbo_ring&&) = delete;
+        pbo_ring& operator=(const pbo_ring&) = delete;
+        pbo_ring& operator=(pbo_ring&&) = delete;
+        virtual ~pbo_ring() {}
+
+        /// initialize allocates the buffers, each large enough to hold buffer_size bytes.
+        /// It must be called by the render thread, with the renderer's OpenGL functions.
+        virtual void initialize(QOpenGLFunctions_3_3_Core* functions, std::size_t buffer_size) {
+            _functions = functions;
+            _buffer_size = (buffer_size + alignment - 1) / alignment * alignment;
+            const auto context = QOpenGLContext::currentContext();
+            buffer_storage_function buffer_storage = nullptr;
+            if (context && context->hasExtension("GL_ARB_buffer_storage")) {
+                buffer_storage = reinterpret_cast<buffer_storage_function>(context->getProcAddress("glBufferStorage"));
+            }
+            _persistent = buffer_storage != nullptr;
+            if (_persistent) {
+                _functions->glGenBuffers(1, _ids.data());
+                _functions->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _ids.front());
+                buffer_storage(
+                    GL_PIXEL_UNPACK_BUFFER,
+                    static_cast<GLsizeiptr>(_buffer_size * size),
+                    nullptr,
+                    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+                _persistent_buffer = reinterpret_cast<uint8_t*>(_functions->glMapBufferRange(
+                    GL_PIXEL_UNPACK_BUFFER,
+                    0,
+                    static_cast<GLsizeiptr>(_buffer_size * size),
+                    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT));
+                if (!_persistent_buffer) {
+                    throw std::logic_error("glMapBufferRange returned an null pointer");
+                }
+            } else {
+                _functions->glGenBuffers(static_cast<GLsizei>(_ids.size()), _ids.data());
+                for (auto id : _ids) {
+                    _functions->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, id);
+                    _functions->glBufferData(
+                        GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(_buffer_size), nullptr, GL_STREAM_DRAW);
+                }
+            }
+            _functions->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+
+        /// map binds the next buffer to GL_PIXEL_UNPACK_BUFFER and returns a write-only pointer to its content.
+        /// It blocks only if the GPU has not yet consumed the buffer, which requires the CPU to be a whole ring ahead.
+        virtual void* map() {
+            wait(_index);
+            if (_persistent) {
+                _functions->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _ids.front());
+                return _persistent_buffer + _index * _buffer_size;
+            }
+            _functions->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _ids[_index]);
+            auto buffer = _functions->glMapBufferRange(
+                GL_PIXEL_UNPACK_BUFFER,
+                0,
+                static_cast<GLsizeiptr>(_buffer_size),
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            if (!buffer) {
+                throw std::logic_error("glMapBufferRange returned an null pointer");
+            }
+            return buffer;
+        }
+
+        /// unmap flushes the data written to the mapped buffer.
+        /// It returns the offset of the mapped data in the bound buffer, to be used as the glTexSubImage2D pointer.
+        virtual std::size_t unmap() {
+            if (_persistent) {
+                return _index * _buffer_size;
+            }
+            _functions->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            return 0;
+        }
+
+        /// fence must be called after the commands reading the mapped buffer, and moves to the next buffer.
+        virtual void fence() {
+            _fences[_index] = _functions->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            _index = (_index + 1) % size;
+        }
+
+        /// release frees the buffers.
+        /// It must be called by the render thread.
+        virtual void release() {
+            if (!_functions) {
+                return;
+            }
+            for (auto& fence : _fences) {
+                if (fence) {
+                    _functions->glDeleteSync(fence);
+                    fence = nullptr;
+                }
+            }
+            if (_persistent) {
+                _functions->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _ids.front());
+                _functions->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                _functions->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                _functions->glDeleteBuffers(1, _ids.data());
+            } else {
+                _functions->glDeleteBuffers(static_cast<GLsizei>(_ids.size()), _ids.data());
+            }
+            _functions = nullptr;
+        }
+
+        /// persistent returns true if the ring uses a persistently mapped buffer.
+        virtual bool persistent() const {
+            return _persistent;
+        }
+
+        protected:
+        /// alignment is the number of bytes used to align buffer regions.
+        static constexpr std::size_t alignment = 256;
+
+        /// buffer_storage_function is the signature of glBufferStorage, which is not part of OpenGL 3.3.
+        typedef void(QOPENGLF_APIENTRY* buffer_storage_function)(GLenum, GLsizeiptr, const void*, GLbitfield);
+
+        /// wait blocks until the GPU is done with the given buffer.
+        virtual void wait(std::size_t index) {
+            if (!_fences[index]) {
+                return;
+            }
+            for (;;) {
+                const auto status =
+                    _functions->glClientWaitSync(_fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+                if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+                    break;
+                }
+                if (status == GL_WAIT_FAILED) {
+                    throw std::logic_error("glClientWaitSync failed");
+                }
+            }
+            _functions->glDeleteSync(_fences[index]);
+            _fences[index] = nullptr;
+        }
+
+        QOpenGLFunctions_3_3_Core* _functions;
+        bool _persistent;
+        std::size_t _buffer_size;
+        std::size_t _index;
+        uint8_t* _persistent_buffer;
+        std::array<GLuint, size> _ids;
+        std::array<GLsync, size> _fences;
+    };
+}
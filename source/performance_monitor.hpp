@@ -0,0 +1,187 @@
+#pragma once
+
+#include <QtGui/QOpenGLFunctions_3_3_Core>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// performance_counters is a snapshot of a renderer's costs.
+    /// Rates are measured over the time elapsed since the previous snapshot, durations are given in microseconds and
+    /// describe the latest measured frame.
+    struct performance_counters {
+        double events_per_second;
+        double lock_spins_per_second;
+        double copy_duration;
+        double gpu_duration;
+        double calibration_duration;
+        std::size_t uploaded_bytes;
+
+        bool operator!=(const performance_counters& other) const {
+            return events_per_second != other.events_per_second
+                   || lock_spins_per_second != other.lock_spins_per_second || copy_duration != other.copy_duration
+                   || gpu_duration != other.gpu_duration || calibration_duration != other.calibration_duration
+                   || uploaded_bytes != other.uploaded_bytes;
+        }
+    };
+
+    /// performance_monitor gathers the counters of a renderer.
+    /// The counters are written by the producers and the render thread, and sampled by the GUI thread.
+    /// GPU durations are measured with GL_TIME_ELAPSED queries, whose results are read a few frames later so that the
+    /// render thread never waits for the GPU.
+    class performance_monitor {
+        public:
+        /// queries is the number of timer queries in flight.
+        static constexpr std::size_t queries = 4;
+
+        performance_monitor() :
+            _events(0),
+            _lock_spins(0),
+            _copy_duration(0),
+            _gpu_duration(0),
+            _calibration_duration(0),
+            _uploaded_bytes(0),
+            _functions(nullptr),
+            _query_index(0),
+            _measuring(false),
+            _sampled_events(0),
+            _sampled_lock_spins(0),
+            _sample_t(std::chrono::steady_clock::now()) {
+            _query_ids.fill(0);
+            _pending.fill(false);
+        }
+        performance_monitor(const performance_monitor&) = delete;
+        performance_monitor(performance_monitor&&) = delete;
+        performance_monitor& operator=(const performance_monitor&) = delete;
+        performance_monitor& operator=(performance_monitor&&) = delete;
+        virtual ~performance_monitor() {}
+
+        /// lock acquires the given spin lock, and counts the iterations spent waiting.
+        /// An uncontended acquisition costs a single test_and_set.
+        virtual void lock(std::atomic_flag& flag) {
+            if (flag.test_and_set(std::memory_order_acquire)) {
+                uint64_t spins = 0;
+                do {
+                    ++spins;
+                } while (flag.test_and_set(std::memory_order_acquire));
+                _lock_spins.fetch_add(spins, std::memory_order_relaxed);
+            }
+        }
+
+        /// add_events accumulates the number of events received by the renderer.
+        virtual void add_events(std::size_t events) {
+            _events.fetch_add(events, std::memory_order_relaxed);
+        }
+
+        /// set_copy_duration stores the time spent copying the state to the GPU buffers during the last frame.
+        virtual void set_copy_duration(std::chrono::steady_clock::duration duration) {
+            _copy_duration.store(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), std::memory_order_relaxed);
+        }
+
+        /// set_calibration_duration stores the time spent on the colormap calibration during the last frame.
+        virtual void set_calibration_duration(std::chrono::steady_clock::duration duration) {
+            _calibration_duration.store(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), std::memory_order_relaxed);
+        }
+
+        /// set_uploaded_bytes stores the number of bytes sent to the GPU during the last frame.
+        virtual void set_uploaded_bytes(std::size_t uploaded_bytes) {
+            _uploaded_bytes.store(uploaded_bytes, std::memory_order_relaxed);
+        }
+
+        /// uploaded_bytes returns the number of bytes sent to the GPU during the last frame.
+        virtual std::size_t uploaded_bytes() const {
+            return _uploaded_bytes.load(std::memory_order_relaxed);
+        }
+
+        /// initialize creates the timer queries.
+        /// It must be called by the render thread, with the renderer's OpenGL functions.
+        virtual void initialize(QOpenGLFunctions_3_3_Core* functions) {
+            _functions = functions;
+            _functions->glGenQueries(static_cast<GLsizei>(_query_ids.size()), _query_ids.data());
+        }
+
+        /// begin_gpu starts measuring the GPU time of the commands that follow.
+        /// The results of the previous queries are collected if available. When all the queries are still in flight,
+        /// the frame is not measured.
+        virtual void begin_gpu() {
+            for (std::size_t offset = 0; offset < queries; ++offset) {
+                const auto index = (_query_index + offset) % queries;
+                if (_pending[index]) {
+                    GLuint available = 0;
+                    _functions->glGetQueryObjectuiv(_query_ids[index], GL_QUERY_RESULT_AVAILABLE, &available);
+                    if (available == GL_FALSE) {
+                        break;
+                    }
+                    GLuint64 elapsed = 0;
+                    _functions->glGetQueryObjectui64v(_query_ids[index], GL_QUERY_RESULT, &elapsed);
+                    _gpu_duration.store(elapsed, std::memory_order_relaxed);
+                    _pending[index] = false;
+                }
+            }
+            _measuring = !_pending[_query_index];
+            if (_measuring) {
+                _functions->glBeginQuery(GL_TIME_ELAPSED, _query_ids[_query_index]);
+            }
+        }
+
+        /// end_gpu stops the measure started by begin_gpu.
+        virtual void end_gpu() {
+            if (_measuring) {
+                _functions->glEndQuery(GL_TIME_ELAPSED);
+                _pending[_query_index] = true;
+                _query_index = (_query_index + 1) % queries;
+                _measuring = false;
+            }
+        }
+
+        /// release deletes the timer queries.
+        /// It must be called by the render thread.
+        virtual void release() {
+            if (_functions) {
+                _functions->glDeleteQueries(static_cast<GLsizei>(_query_ids.size()), _query_ids.data());
+                _functions = nullptr;
+            }
+        }
+
+        /// sample returns the current counters.
+        /// It must always be called by the same thread, since it keeps track of the previous sample.
+        virtual performance_counters sample() {
+            const auto now = std::chrono::steady_clock::now();
+            const auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(now - _sample_t).count();
+            const auto events = _events.load(std::memory_order_relaxed);
+            const auto lock_spins = _lock_spins.load(std::memory_order_relaxed);
+            performance_counters counters{
+                elapsed > 0 ? static_cast<double>(events - _sampled_events) / elapsed : 0.0,
+                elapsed > 0 ? static_cast<double>(lock_spins - _sampled_lock_spins) / elapsed : 0.0,
+                static_cast<double>(_copy_duration.load(std::memory_order_relaxed)) / 1e3,
+                static_cast<double>(_gpu_duration.load(std::memory_order_relaxed)) / 1e3,
+                static_cast<double>(_calibration_duration.load(std::memory_order_relaxed)) / 1e3,
+                _uploaded_bytes.load(std::memory_order_relaxed)};
+            _sampled_events = events;
+            _sampled_lock_spins = lock_spins;
+            _sample_t = now;
+            return counters;
+        }
+
+        protected:
+        std::atomic<uint64_t> _events;
+        std::atomic<uint64_t> _lock_spins;
+        std::atomic<uint64_t> _copy_duration;
+        std::atomic<uint64_t> _gpu_duration;
+        std::atomic<uint64_t> _calibration_duration;
+        std::atomic<std::size_t> _uploaded_bytes;
+        QOpenGLFunctions_3_3_Core* _functions;
+        std::array<GLuint, queries> _query_ids;
+        std::array<bool, queries> _pending;
+        std::size_t _query_index;
+        bool _measuring;
+        uint64_t _sampled_events;
+        uint64_t _sampled_lock_spins;
+        std::chrono::steady_clock::time_point _sample_t;
+    };
+}
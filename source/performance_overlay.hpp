@@ -0,0 +1,118 @@
+#pragma once
+
+#include <QtGui/QPainter>
+#include <QtQuick/QQuickPaintedItem>
+#include <array>
+#include <iomanip>
+#include <sstream>
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// performance_overlay displays the performance counters of a display as text.
+    /// The display can be any item exposing the performance properties (events_per_second, lock_spins_per_second,
+    /// copy_duration, gpu_duration, calibration_duration and uploaded_bytes) and the performance_changed signal.
+    /// Missing properties are skipped.
+    class performance_overlay : public QQuickPaintedItem {
+        Q_OBJECT
+        Q_PROPERTY(QObject* display READ display WRITE set_display NOTIFY display_changed)
+        Q_PROPERTY(QColor color READ color WRITE set_color)
+        public:
+        performance_overlay() : _display(nullptr), _color(Qt::white) {}
+        performance_overlay(const performance_overlay&) = delete;
+        performance_overlay(performance_overlay&&) = delete;
+        performance_overlay& operator=(const performance_overlay&) = delete;
+        performance_overlay& operator=(performance_overlay&&) = delete;
+        virtual ~performance_overlay() {}
+
+        /// set_display defines the monitored display.
+        /// It can be changed at any time, a null display clears the overlay.
+        virtual void set_display(QObject* display) {
+            if (display == _display) {
+                return;
+            }
+            if (_display) {
+                disconnect(_display, nullptr, this, nullptr);
+            }
+            _display = display;
+            if (_display) {
+                connect(_display, SIGNAL(performance_changed()), this, SLOT(update()));
+                connect(_display, &QObject::destroyed, this, &performance_overlay::handle_display_destroyed);
+            }
+            display_changed(_display);
+            update();
+        }
+
+        /// display returns the currently monitored display.
+        virtual QObject* display() const {
+            return _display;
+        }
+
+        /// set_color defines the text color.
+        virtual void set_color(QColor color) {
+            _color = color;
+            update();
+        }
+
+        /// color returns the currently used text color.
+        virtual QColor color() const {
+            return _color;
+        }
+
+        /// paint draws the counters.
+        virtual void paint(QPainter* painter) override {
+            if (!_display) {
+                return;
+            }
+            std::stringstream text;
+            text << std::fixed;
+            const std::array<row, 5> rows{{
+                {"events_per_second", " ev/s", 0},
+                {"lock_spins_per_second", " spins/s", 0},
+                {"copy_duration", " us copy", 1},
+                {"gpu_duration", " us gpu", 1},
+                {"calibration_duration", " us calibration", 1},
+            }};
+            for (const auto& counter : rows) {
+                const auto value = _display->property(counter.name);
+                if (value.isValid()) {
+                    text << std::setprecision(counter.precision) << value.toDouble() << counter.unit << "\n";
+                }
+            }
+            {
+                const auto value = _display->property("uploaded_bytes");
+                if (value.isValid()) {
+                    text << value.toLongLong() << " B uploaded\n";
+                }
+            }
+            QPen pen;
+            pen.setColor(_color);
+            painter->setPen(pen);
+            painter->drawText(boundingRect(), Qt::AlignLeft | Qt::AlignTop, QString::fromStdString(text.str()));
+        }
+
+        signals:
+
+        /// display_changed notifies a change of the monitored display.
+        void display_changed(QObject* display);
+
+        private slots:
+
+        /// handle_display_destroyed clears the display when it is deleted.
+        void handle_display_destroyed() {
+            _display = nullptr;
+            update();
+        }
+
+        protected:
+        /// row describes a displayed property.
+        struct row {
+            const char* name;
+            const char* unit;
+            int precision;
+        };
+
+        QObject* _display;
+        QColor _color;
+    };
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtCore/QTimer>
+#include <QtGui/QSurfaceFormat>
+#include <QtQuick/QSGRendererInterface>
+#include <QtQuick/qquickwindow.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// render_scheduler updates a window only when one of its displays changed.
+    /// A single scheduler is attached to each window, therefore the requests of all the displays of a window, sent
+    /// from any thread, are coalesced into a single update. The maximum frame rate bounds the updates triggered by the
+    /// scheduler, whereas the frames requested by Qt itself (resize, expose...) are not delayed.
+    class render_scheduler : public QObject {
+        Q_OBJECT
+        public:
+        render_scheduler(const render_scheduler&) = delete;
+        render_scheduler(render_scheduler&&) = delete;
+        render_scheduler& operator=(const render_scheduler&) = delete;
+        render_scheduler& operator=(render_scheduler&&) = delete;
+        virtual ~render_scheduler() {}
+
+        /// of returns the scheduler of the given window, and creates it on first use.
+        /// The scheduler is owned by the window. It must be called by the GUI thread.
+        static render_scheduler* of(QQuickWindow* window) {
+            auto scheduler = window->findChild<render_scheduler*>(QString(), Qt::FindDirectChildrenOnly);
+            if (!scheduler) {
+                scheduler = new render_scheduler(window);
+            }
+            return scheduler;
+        }
+
+        /// configure_opengl selects the scene graph backend and the OpenGL version required by the displays.
+        /// The displays issue OpenGL 3.3 core calls from the render thread, therefore the scene graph must run on
+        /// native OpenGL. In particular, it disables ANGLE on Windows, which translates OpenGL ES to Direct3D. It must
+        /// be called before the application is created.
+        static void configure_opengl() {
+            QCoreApplication::setAttribute(Qt::AA_UseDesktopOpenGL);
+            QQuickWindow::setSceneGraphBackend(QSGRendererInterface::OpenGL);
+            auto format = QSurfaceFormat::defaultFormat();
+            format.setVersion(3, 3);
+            format.setProfile(QSurfaceFormat::CoreProfile);
+            QSurfaceFormat::setDefaultFormat(format);
+        }
+
+        /// set_maximum_fps defines the maximum number of updates per second triggered by the scheduler.
+        /// A null maximum (the default) disables the limit, the frame rate is then bounded by the swap interval.
+        /// It must be called by the GUI thread.
+        virtual void set_maximum_fps(double maximum_fps) {
+            if (maximum_fps < 0) {
+                throw std::logic_error("maximum_fps must be positive or null");
+            }
+            _maximum_fps = maximum_fps;
+        }
+
+        /// maximum_fps returns the currently used maximum frame rate.
+        virtual double maximum_fps() const {
+            return _maximum_fps;
+        }
+
+        /// frame_t returns the start time of the latest frame, as a steady clock timestamp in nanoseconds.
+        /// It can be called by any thread, and returns 0 before the first frame.
+        virtual int64_t frame_t() const {
+            return _frame_t.load(std::memory_order_acquire);
+        }
+
+        /// frame_interval returns the average time between two consecutive frames in nanoseconds, or 0 if it is not
+        /// known yet. Idle periods longer than 100 ms are ignored.
+        /// It can be called by any thread.
+        virtual int64_t frame_interval() const {
+            return _frame_interval.load(std::memory_order_acquire);
+        }
+
+        /// request_update schedules a window update.
+        /// It can be called by any thread, and only reads a flag if an update is already pending, therefore displays
+        /// can call it after each event.
+        virtual void request_update() {
+            if (!_requested.load(std::memory_order_acquire) && !_requested.exchange(true, std::memory_order_acq_rel)) {
+                QMetaObject::invokeMethod(this, "schedule", Qt::QueuedConnection);
+            }
+        }
+
+        private slots:
+
+        /// schedule updates the window, or delays the update to honour the maximum frame rate.
+        void schedule() {
+            if (_timer.isActive()) {
+                return;
+            }
+            if (_maximum_fps > 0) {
+                const auto remaining =
+                    static_cast<int64_t>(1e9 / _maximum_fps) - (now() - _frame_t.load(std::memory_order_acquire));
+                if (remaining > 0) {
+                    _timer.start(static_cast<int>((remaining + 999999) / 1000000));
+                    return;
+                }
+            }
+            update_window();
+        }
+
+        /// update_window asks Qt for a new frame, unless a frame started since the request.
+        void update_window() {
+            if (_requested.load(std::memory_order_acquire)) {
+                _window->update();
+            }
+        }
+
+        /// start_frame is called by the render loop before the displays are synchronized.
+        /// The requests sent afterwards trigger another update, the ones sent before are handled by this frame.
+        /// The first frame checks that the scene graph renders with OpenGL, Qt Quick's other backends (software,
+        /// Direct3D 12, or the RHI's Vulkan, Metal and Direct3D 11) cannot run the displays. Since it runs on the
+        /// render thread, the error is logged rather than thrown.
+        void start_frame() {
+            if (!_graphics_api_checked) {
+                _graphics_api_checked = true;
+                const auto renderer_interface = _window->rendererInterface();
+                if (renderer_interface && renderer_interface->graphicsApi() != QSGRendererInterface::OpenGL) {
+                    qCritical(
+                        "the displays require the OpenGL scene graph backend, call "
+                        "render_scheduler::configure_opengl before creating the application");
+                }
+            }
+            _requested.store(false, std::memory_order_release);
+            const auto frame_t = now();
+            const auto previous_frame_t = _frame_t.exchange(frame_t, std::memory_order_acq_rel);
+            if (previous_frame_t > 0 && frame_t - previous_frame_t < maximum_frame_interval) {
+                const auto frame_interval = _frame_interval.load(std::memory_order_relaxed);
+                _frame_interval.store(
+                    frame_interval == 0 ? frame_t - previous_frame_t
+                                        : (frame_interval * 7 + (frame_t - previous_frame_t)) / 8,
+                    std::memory_order_release);
+            }
+        }
+
+        protected:
+        /// maximum_frame_interval is the longest time between two frames taken into account by frame_interval, in
+        /// nanoseconds.
+        static constexpr int64_t maximum_frame_interval = 100000000;
+
+        render_scheduler(QQuickWindow* window) :
+            QObject(window),
+            _window(window),
+            _maximum_fps(0),
+            _requested(false),
+            _frame_t(0),
+            _frame_interval(0),
+            _graphics_api_checked(false) {
+            _timer.setSingleShot(true);
+            connect(&_timer, &QTimer::timeout, this, &render_scheduler::update_window);
+            connect(
+                _window,
+                &QQuickWindow::beforeSynchronizing,
+                this,
+                &render_scheduler::start_frame,
+                Qt::DirectConnection);
+        }
+
+        /// now returns a monotonic timestamp in nanoseconds.
+        static int64_t now() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        }
+
+        QQuickWindow* _window;
+        double _maximum_fps;
+        std::atomic_bool _requested;
+        std::atomic<int64_t> _frame_t;
+        std::atomic<int64_t> _frame_interval;
+        bool _graphics_api_checked;
+        QTimer _timer;
+    };
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <vector>
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// snapshot_ring stores compressed keyframes of a renderer's state, so that a recording can be scrubbed without
+    /// replaying it from the start.
+    /// Each keyframe is the XOR of the state with a reference (the previous keyframe, or the initial state for full
+    /// keyframes), with runs of zero words encoded as counts. Since most pixels do not change between two keyframes,
+    /// deltas are much smaller than the state. A full keyframe every full_interval keyframes bounds the number of
+    /// deltas decoded by a restore. When the ring is full, the oldest keyframe is dropped.
+    template <typename Value>
+    class snapshot_ring {
+        static_assert(sizeof(Value) == sizeof(uint32_t), "snapshot_ring values must be 32 bits wide");
+
+        public:
+        /// full_interval is the number of keyframes between two full keyframes.
+        static constexpr std::size_t full_interval = 16;
+
+        snapshot_ring(const Value* initial_state, std::size_t size, std::size_t capacity) :
+            _initial_state(initial_state, initial_state + size),
+            _previous_state(_initial_state),
+            _scratch(size),
+            _capacity(capacity) {
+            if (_capacity < 1) {
+                throw std::logic_error("the snapshot ring capacity must be at least 1");
+            }
+        }
+        snapshot_ring(const snapshot_ring&) = delete;
+        snapshot_ring(snapshot_ring&&) = delete;
+        snapshot_ring& operator=(const snapshot_ring&) = delete;
+        snapshot_ring& operator=(snapshot_ring&&) = delete;
+        virtual ~snapshot_ring() {}
+
+        /// insert stores the given state as a keyframe at time t.
+        /// t must be larger than the latest keyframe's time.
+        virtual void insert(uint64_t t, const Value* state) {
+            if (!_keyframes.empty() && t <= _keyframes.back().t) {
+                throw std::logic_error("keyframes must be inserted in chronological order");
+            }
+            const auto full = _keyframes.empty() || _keyframes.back().depth + 1 >= full_interval;
+            _keyframes.push_back(keyframe{t, full ? 0 : _keyframes.back().depth + 1, {}});
+            encode(state, full ? _initial_state.data() : _previous_state.data(), _keyframes.back().words);
+            std::copy(state, state + _previous_state.size(), _previous_state.begin());
+            if (_keyframes.size() > _capacity) {
+                if (_keyframes.size() > 1 && _keyframes[1].depth > 0) {
+                    // the second keyframe becomes the oldest, therefore it must be stored in full
+                    std::copy(_initial_state.begin(), _initial_state.end(), _scratch.begin());
+                    decode(_keyframes[0].words, _scratch.data());
+                    decode(_keyframes[1].words, _scratch.data());
+                    encode(_scratch.data(), _initial_state.data(), _keyframes[1].words);
+                    _keyframes[1].depth = 0;
+                }
+                _keyframes.pop_front();
+            }
+        }
+
+        /// restore writes the latest keyframe at or before t to state, and returns its time.
+        /// If there is no such keyframe, the initial state is written and 0 is returned. The keyframes are kept, so
+        /// that a recording can be scrubbed back and forth.
+        virtual uint64_t restore(uint64_t t, Value* state) const {
+            const auto end = std::upper_bound(
+                _keyframes.begin(), _keyframes.end(), t, [](uint64_t value, const keyframe& candidate) {
+                    return value < candidate.t;
+                });
+            std::copy(_initial_state.begin(), _initial_state.end(), state);
+            if (end == _keyframes.begin()) {
+                return 0;
+            }
+            auto begin = std::prev(end);
+            while (begin->depth > 0) {
+                --begin;
+            }
+            for (; begin != end; ++begin) {
+                decode(begin->words, state);
+            }
+            return std::prev(end)->t;
+        }
+
+        /// latest_t returns the time of the latest keyframe, or 0 if the ring is empty.
+        virtual uint64_t latest_t() const {
+            return _keyframes.empty() ? 0 : _keyframes.back().t;
+        }
+
+        /// size returns the number of stored keyframes.
+        virtual std::size_t size() const {
+            return _keyframes.size();
+        }
+
+        /// compressed_bytes returns the memory used by the encoded keyframes.
+        virtual std::size_t compressed_bytes() const {
+            std::size_t bytes = 0;
+            for (const auto& keyframe : _keyframes) {
+                bytes += keyframe.words.size() * sizeof(uint32_t);
+            }
+            return bytes;
+        }
+
+        protected:
+        /// keyframe is an encoded state.
+        /// depth is the number of deltas since the previous full keyframe, 0 for a full keyframe.
+        struct keyframe {
+            uint64_t t;
+            std::size_t depth;
+            std::vector<uint32_t> words;
+        };
+
+        /// bits returns the binary representation of a value.
+        static uint32_t bits(Value value) {
+            uint32_t result;
+            std::memcpy(&result, &value, sizeof(result));
+            return result;
+        }
+
+        /// encode writes the XOR of state and reference as a sequence of (zeros, literals) pairs, each followed by
+        /// the literal words. A literal run ends on two consecutive zero words.
+        virtual void encode(const Value* state, const Value* reference, std::vector<uint32_t>& words) {
+            words.clear();
+            const auto size = _previous_state.size();
+            std::size_t index = 0;
+            while (index < size) {
+                const auto zeros_begin = index;
+                while (index < size && bits(state[index]) == bits(reference[index])) {
+                    ++index;
+                }
+                words.push_back(static_cast<uint32_t>(index - zeros_begin));
+                const auto header = words.size();
+                words.push_back(0);
+                while (index < size
+                       && (bits(state[index]) != bits(reference[index])
+                           || (index + 1 < size && bits(state[index + 1]) != bits(reference[index + 1])))) {
+                    words.push_back(bits(state[index]) ^ bits(reference[index]));
+                    ++index;
+                }
+                words[header] = static_cast<uint32_t>(words.size() - header - 1);
+            }
+            words.shrink_to_fit();
+        }
+
+        /// decode applies an encoded XOR to state.
+        virtual void decode(const std::vector<uint32_t>& words, Value* state) const {
+            std::size_t index = 0;
+            for (std::size_t position = 0; position < words.size();) {
+                index += words[position];
+                const auto literals = words[position + 1];
+                position += 2;
+                for (std::size_t literal = 0; literal < literals; ++literal, ++position, ++index) {
+                    const auto value = bits(state[index]) ^ words[position];
+                    std::memcpy(&state[index], &value, sizeof(value));
+                }
+            }
+        }
+
+        const std::vector<Value> _initial_state;
+        std::vector<Value> _previous_state;
+        std::vector<Value> _scratch;
+        const std::size_t _capacity;
+        std::deque<keyframe> _keyframes;
+    };
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <QtGui/QOpenGLFunctions_3_3_Core>
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// texel_scatter writes sparse texels to an integer texture, by drawing one point per texel into a framebuffer.
+    /// Points are rasterized in order, therefore the last texel drawn at a given pixel wins.
+    class texel_scatter {
+        public:
+        texel_scatter() :
+            _functions(nullptr),
+            _stride(0),
+            _program_id(0),
+            _vertex_array_id(0),
+            _buffer_id(0),
+            _framebuffer_id(0) {}
+        texel_scatter(const texel_scatter&) = delete;
+        texel_scatter(texel_scatter&&) = delete;
+        texel_scatter& operator=(const texel_scatter&) = delete;
+        texel_scatter& operator=(texel_scatter&&) = delete;
+        virtual ~texel_scatter() {}
+
+        /// initialize compiles the scatter program and attaches the texture to a framebuffer.
+        /// Each event is stride bytes long, and starts with a uint32 pixel index followed by components uint32 values.
+        /// The values are available in the shader as value, and texel is the GLSL expression computing the uvec4
+        /// written to the texture.
+        /// It must be called by the render thread, with the renderer's OpenGL functions.
+        virtual void initialize(
+            QOpenGLFunctions_3_3_Core* functions,
+            GLuint texture_id,
+            QSize canvas_size,
+            std::size_t stride,
+            GLint components,
+            const std::string& texel) {
+            _functions = functions;
+            _canvas_size = canvas_size;
+            _stride = stride;
+
+            // compile the shaders
+            const auto vertex_shader_id = _functions->glCreateShader(GL_VERTEX_SHADER);
+            {
+                std::string vertex_shader(R""(
+                    #version 330 core
+                    in uint index;
+                )"");
+                vertex_shader.append(
+                    components == 1 ? std::string("in uint value;")
+                                    : "in uvec" + std::to_string(components) + " value;");
+                vertex_shader.append(R""(
+                    flat out uvec4 texel;
+                    uniform uint width;
+                    uniform vec2 size;
+                    void main() {
+                        vec2 position = vec2(float(index % width), float(index / width)) + 0.5;
+                        gl_Position = vec4(position / size * 2.0 - 1.0, 0.0, 1.0);
+                        texel = )"");
+                vertex_shader.append(texel);
+                vertex_shader.append(R""(;
+                    }
+                )"");
+                compile(vertex_shader_id, vertex_shader);
+            }
+            const auto fragment_shader_id = _functions->glCreateShader(GL_FRAGMENT_SHADER);
+            compile(fragment_shader_id, R""(
+                #version 330 core
+                flat in uvec4 texel;
+                out uvec4 color;
+                void main() {
+                    color = texel;
+                }
+            )"");
+            _program_id = _functions->glCreateProgram();
+            _functions->glAttachShader(_program_id, vertex_shader_id);
+            _functions->glAttachShader(_program_id, fragment_shader_id);
+            _functions->glLinkProgram(_program_id);
+            _functions->glDeleteShader(vertex_shader_id);
+            _functions->glDeleteShader(fragment_shader_id);
+            {
+                GLint status = 0;
+                _functions->glGetProgramiv(_program_id, GL_LINK_STATUS, &status);
+                if (status != GL_TRUE) {
+                    GLint message_length = 0;
+                    _functions->glGetProgramiv(_program_id, GL_INFO_LOG_LENGTH, &message_length);
+                    std::vector<char> error_message(message_length);
+                    _functions->glGetProgramInfoLog(_program_id, message_length, nullptr, error_message.data());
+                    throw std::logic_error("program error: " + std::string(error_message.data()));
+                }
+            }
+            _functions->glUseProgram(_program_id);
+            _functions->glUniform1ui(
+                _functions->glGetUniformLocation(_program_id, "width"), static_cast<GLuint>(_canvas_size.width()));
+            _functions->glUniform2f(
+                _functions->glGetUniformLocation(_program_id, "size"),
+                static_cast<GLfloat>(_canvas_size.width()),
+                static_cast<GLfloat>(_canvas_size.height()));
+            _functions->glUseProgram(0);
+
+            // create the vertex array object
+            _functions->glGenVertexArrays(1, &_vertex_array_id);
+            _functions->glBindVertexArray(_vertex_array_id);
+            _functions->glGenBuffers(1, &_buffer_id);
+            _functions->glBindBuffer(GL_ARRAY_BUFFER, _buffer_id);
+            {
+                const auto location = static_cast<GLuint>(_functions->glGetAttribLocation(_program_id, "index"));
+                _functions->glEnableVertexAttribArray(location);
+                _functions->glVertexAttribIPointer(
+                    location, 1, GL_UNSIGNED_INT, static_cast<GLsizei>(_stride), reinterpret_cast<const GLvoid*>(0));
+            }
+            {
+                const auto location = static_cast<GLuint>(_functions->glGetAttribLocation(_program_id, "value"));
+                _functions->glEnableVertexAttribArray(location);
+                _functions->glVertexAttribIPointer(
+                    location,
+                    components,
+                    GL_UNSIGNED_INT,
+                    static_cast<GLsizei>(_stride),
+                    reinterpret_cast<const GLvoid*>(sizeof(uint32_t)));
+            }
+            _functions->glBindVertexArray(0);
+            _functions->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            // create the framebuffer
+            GLint previous_framebuffer_id = 0;
+            _functions->glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_framebuffer_id);
+            _functions->glGenFramebuffers(1, &_framebuffer_id);
+            _functions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _framebuffer_id);
+            _functions->glFramebufferTexture2D(
+                GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_RECTANGLE, texture_id, 0);
+            if (_functions->glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                throw std::logic_error("the scatter framebuffer is incomplete");
+            }
+            _functions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(previous_framebuffer_id));
+        }
+
+        /// draw writes the given events to the texture, and returns the number of bytes sent to the GPU.
+        /// The current framebuffer, viewport and scissor test are restored, but the program and vertex array are not.
+        virtual std::size_t draw(const void* events, std::size_t count) {
+            if (count == 0) {
+                return 0;
+            }
+            GLint previous_framebuffer_id = 0;
+            _functions->glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_framebuffer_id);
+            std::array<GLint, 4> previous_viewport;
+            _functions->glGetIntegerv(GL_VIEWPORT, previous_viewport.data());
+            const auto scissor_test = _functions->glIsEnabled(GL_SCISSOR_TEST);
+            _functions->glDisable(GL_SCISSOR_TEST);
+            _functions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _framebuffer_id);
+            _functions->glViewport(0, 0, _canvas_size.width(), _canvas_size.height());
+            _functions->glUseProgram(_program_id);
+            _functions->glBindVertexArray(_vertex_array_id);
+            _functions->glBindBuffer(GL_ARRAY_BUFFER, _buffer_id);
+            _functions->glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(count * _stride), events, GL_STREAM_DRAW);
+            _functions->glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(count));
+            _functions->glBindBuffer(GL_ARRAY_BUFFER, 0);
+            _functions->glBindVertexArray(0);
+            _functions->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(previous_framebuffer_id));
+            _functions->glViewport(
+                previous_viewport[0], previous_viewport[1], previous_viewport[2], previous_viewport[3]);
+            if (scissor_test == GL_TRUE) {
+                _functions->glEnable(GL_SCISSOR_TEST);
+            }
+            return count * _stride;
+        }
+
+        /// release frees the program, buffers and framebuffer.
+        /// It must be called by the render thread.
+        virtual void release() {
+            if (!_functions) {
+                return;
+            }
+            _functions->glDeleteFramebuffers(1, &_framebuffer_id);
+            _functions->glDeleteBuffers(1, &_buffer_id);
+            _functions->glDeleteVertexArrays(1, &_vertex_array_id);
+            _functions->glDeleteProgram(_program_id);
+            _functions = nullptr;
+        }
+
+        protected:
+        /// compile compiles the given shader source and checks for errors.
+        virtual void compile(GLuint shader_id, const std::string& shader) {
+            auto shader_content = shader.c_str();
+            auto shader_size = static_cast<GLint>(shader.size());
+            _functions->glShaderSource(shader_id, 1, static_cast<const GLchar**>(&shader_content), &shader_size);
+            _functions->glCompileShader(shader_id);
+            GLint status = 0;
+            _functions->glGetShaderiv(shader_id, GL_COMPILE_STATUS, &status);
+            if (status != GL_TRUE) {
+                GLint message_length = 0;
+                _functions->glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &message_length);
+                std::vector<char> error_message(message_length);
+                _functions->glGetShaderInfoLog(shader_id, message_length, nullptr, error_message.data());
+                throw std::logic_error("Shader error: " + std::string(error_message.data()));
+            }
+        }
+
+        QOpenGLFunctions_3_3_Core* _functions;
+        QSize _canvas_size;
+        std::size_t _stride;
+        GLuint _program_id;
+        GLuint _vertex_array_id;
+        GLuint _buffer_id;
+        GLuint _framebuffer_id;
+    };
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <QtCore/QSize>
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// tiled_layout maps canvas pixels to indices in a renderer's state.
+    /// With a tile size of 0, the state is row-major. Otherwise, the canvas is split into square tiles stored one
+    /// after the other, each tile being row-major, so that the pixels of a small neighbourhood share a few cache lines
+    /// instead of one per row. Clustered events (moving edges, gestures) then touch less memory. The canvas is padded
+    /// to a whole number of tiles, and the padding pixels are never written.
+    class tiled_layout {
+        public:
+        /// glsl declares the layout uniforms and the function tiled_position(index), which returns the pixel
+        /// coordinates of a state index. The uniforms are set with shift and tiles_per_row, a shift of 0 being
+        /// row-major.
+        static constexpr const char* glsl = R""(
+            uniform uint tiled_layout_width;
+            uniform uint tiled_layout_shift;
+            uniform uint tiled_layout_tiles_per_row;
+            uvec2 tiled_position(uint index) {
+                if (tiled_layout_shift == 0u) {
+                    return uvec2(index % tiled_layout_width, index / tiled_layout_width);
+                }
+                uint shift = tiled_layout_shift;
+                uint mask = (1u << shift) - 1u;
+                uint tile = index >> (shift * 2u);
+                return uvec2(
+                    ((tile % tiled_layout_tiles_per_row) << shift) | (index & mask),
+                    ((tile / tiled_layout_tiles_per_row) << shift) | ((index >> shift) & mask));
+            }
+        )"";
+
+        tiled_layout(QSize canvas_size, std::size_t tile_size) :
+            _width(static_cast<std::size_t>(canvas_size.width())),
+            _height(static_cast<std::size_t>(canvas_size.height())),
+            _shift(0),
+            _mask(0),
+            _tiles_per_row(0),
+            _size(_width * _height) {
+            if (tile_size > 0) {
+                if (tile_size < 2 || tile_size > 256 || (tile_size & (tile_size - 1)) != 0) {
+                    throw std::logic_error("tile_size must be 0 or a power of two in the range [2, 256]");
+                }
+                while ((static_cast<std::size_t>(1) << _shift) < tile_size) {
+                    ++_shift;
+                }
+                _mask = tile_size - 1;
+                _tiles_per_row = (_width + _mask) >> _shift;
+                _size = _tiles_per_row * ((_height + _mask) >> _shift) * tile_size * tile_size;
+            }
+        }
+        tiled_layout(const tiled_layout&) = delete;
+        tiled_layout(tiled_layout&&) = delete;
+        tiled_layout& operator=(const tiled_layout&) = delete;
+        tiled_layout& operator=(tiled_layout&&) = delete;
+        virtual ~tiled_layout() {}
+
+        /// tiled returns false if the state is row-major.
+        bool tiled() const {
+            return _shift > 0;
+        }
+
+        /// tile_size returns the tiles' side, or 0 if the state is row-major.
+        std::size_t tile_size() const {
+            return tiled() ? _mask + 1 : 0;
+        }
+
+        /// shift returns the base 2 logarithm of the tile size, or 0 if the state is row-major.
+        std::size_t shift() const {
+            return _shift;
+        }
+
+        /// tiles_per_row returns the number of tiles in a row of tiles, or 0 if the state is row-major.
+        std::size_t tiles_per_row() const {
+            return _tiles_per_row;
+        }
+
+        /// size returns the number of pixels in the state, including the padding.
+        std::size_t size() const {
+            return _size;
+        }
+
+        /// index returns the state index of the given pixel.
+        std::size_t index(std::size_t x, std::size_t y) const {
+            if (_shift == 0) {
+                return x + y * _width;
+            }
+            return ((((y >> _shift) * _tiles_per_row + (x >> _shift)) << _shift | (y & _mask)) << _shift)
+                   | (x & _mask);
+        }
+
+        /// y returns the row of the pixel with the given state index.
+        std::size_t y(std::size_t index) const {
+            if (_shift == 0) {
+                return index / _width;
+            }
+            return ((index >> (_shift * 2)) / _tiles_per_row << _shift) | ((index >> _shift) & _mask);
+        }
+
+        /// segment_end returns the end of the run of contiguous state pixels starting at x in a row, bounded by x_end.
+        std::size_t segment_end(std::size_t x, std::size_t x_end) const {
+            if (_shift == 0) {
+                return x_end;
+            }
+            return std::min(x_end, (x | _mask) + 1);
+        }
+
+        /// copy_row writes the pixels [x_begin, x_end) of row y to a row-major buffer.
+        /// Each pixel is made of channels values. A tiled row is copied one tile segment at a time.
+        template <typename Value>
+        void copy_row(
+            const Value* state,
+            Value* row,
+            std::size_t channels,
+            std::size_t y,
+            std::size_t x_begin,
+            std::size_t x_end) const {
+            if (_shift == 0) {
+                const auto source = state + (y * _width + x_begin) * channels;
+                std::copy(source, source + (x_end - x_begin) * channels, row);
+                return;
+            }
+            for (auto x = x_begin; x < x_end;) {
+                const auto end = segment_end(x, x_end);
+                const auto source = state + index(x, y) * channels;
+                row = std::copy(source, source + (end - x) * channels, row);
+                x = end;
+            }
+        }
+
+        /// assign_row writes the given row-major pixels to row y of the state.
+        /// Each pixel is made of channels values.
+        template <typename Value>
+        void assign_row(const Value* row, Value* state, std::size_t channels, std::size_t y) const {
+            if (_shift == 0) {
+                std::copy(row, row + _width * channels, state + y * _width * channels);
+                return;
+            }
+            for (std::size_t x = 0; x < _width;) {
+                const auto end = segment_end(x, _width);
+                std::copy(row + x * channels, row + end * channels, state + index(x, y) * channels);
+                x = end;
+            }
+        }
+
+        protected:
+        const std::size_t _width;
+        const std::size_t _height;
+        std::size_t _shift;
+        std::size_t _mask;
+        std::size_t _tiles_per_row;
+        std::size_t _size;
+    };
+}
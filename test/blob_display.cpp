@@ -2,6 +2,7 @@
 #include "../source/background_cleaner.hpp"
 #include <QtGui/QGuiApplication>
 #include <QtQml/QQmlApplicationEngine>
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <random>
@@ -16,6 +17,7 @@ struct blob {
 };
 
 int main(int argc, char* argv[]) {
+    chameleon::render_scheduler::configure_opengl();
     QGuiApplication app(argc, argv);
     qmlRegisterType<chameleon::background_cleaner>("Chameleon", 1, 0, "BackgroundCleaner");
     qmlRegisterType<chameleon::blob_display>("Chameleon", 1, 0, "BlobDisplay");
@@ -29,14 +31,6 @@ int main(int argc, char* argv[]) {
             visible: true
             width: 320
             height: 240
-            Timer {
-                interval: 20
-                running: true
-                repeat: true
-                onTriggered: {
-                    blob_display.trigger_draw();
-                }
-            }
             BackgroundCleaner {
                 width: window.width
                 height: window.height
@@ -79,19 +73,18 @@ int main(int argc, char* argv[]) {
         }
         while (running.load(std::memory_order_relaxed)) {
             for (std::size_t index = 0; index < 10; ++index) {
-                for (std::size_t id = 0; id < 3; ++id) {
-                    blob_display->update(
-                        id,
-                        blob{static_cast<float>(102 + 50 * id),
-                             120,
-                             std::pow(
-                                 20 * (std::cos(2 * static_cast<float>(M_PI) * (t - id * 1e6f / 3) / 1e6f) + 1.5f),
-                                 2.0f),
-                             0,
-                             std::pow(
-                                 20 * (std::sin(2 * static_cast<float>(M_PI) * (t - id * 1e6f / 3) / 1e6f) + 1.5f),
-                                 2.0f)});
+                std::array<blob, 3> blobs;
+                for (std::size_t id = 0; id < blobs.size(); ++id) {
+                    blobs[id] = blob{
+                        static_cast<float>(102 + 50 * id),
+                        120,
+                        std::pow(
+                            20 * (std::cos(2 * static_cast<float>(M_PI) * (t - id * 1e6f / 3) / 1e6f) + 1.5f), 2.0f),
+                        0,
+                        std::pow(
+                            20 * (std::sin(2 * static_cast<float>(M_PI) * (t - id * 1e6f / 3) / 1e6f) + 1.5f), 2.0f)};
                 }
+                blob_display->update_all(blobs.begin(), blobs.end());
                 t += 2000;
             }
             std::this_thread::sleep_until(time_reference + std::chrono::microseconds(t));
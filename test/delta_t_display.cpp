@@ -14,6 +14,7 @@ struct event {
 };
 
 int main(int argc, char* argv[]) {
+    chameleon::render_scheduler::configure_opengl();
     QGuiApplication app(argc, argv);
     qmlRegisterType<chameleon::background_cleaner>("Chameleon", 1, 0, "BackgroundCleaner");
     qmlRegisterType<chameleon::delta_t_display>("Chameleon", 1, 0, "DeltaTDisplay");
@@ -27,14 +28,6 @@ int main(int argc, char* argv[]) {
             visible: true
             width: 320
             height: 240
-            Timer {
-                interval: 20
-                running: true
-                repeat: true
-                onTriggered: {
-                    delta_t_display.trigger_draw();
-                }
-            }
             BackgroundCleaner {
                 width: window.width
                 height: window.height
@@ -1,11 +1,9 @@
 #include "../source/dvs_display.hpp"
 #include "../source/background_cleaner.hpp"
+#include "../source/event_player.hpp"
 #include <QtGui/QGuiApplication>
 #include <QtQml/QQmlApplicationEngine>
-#include <atomic>
-#include <chrono>
 #include <random>
-#include <thread>
 
 struct event {
     uint64_t t;
@@ -15,6 +13,7 @@ struct event {
 };
 
 int main(int argc, char* argv[]) {
+    chameleon::render_scheduler::configure_opengl();
     QGuiApplication app(argc, argv);
     qmlRegisterType<chameleon::background_cleaner>("Chameleon", 1, 0, "BackgroundCleaner");
     qmlRegisterType<chameleon::dvs_display>("Chameleon", 1, 0, "ChangeDetectionDisplay");
@@ -28,14 +27,6 @@ int main(int argc, char* argv[]) {
             visible: true
             width: 320
             height: 240
-            Timer {
-                interval: 20
-                running: true
-                repeat: true
-                onTriggered: {
-                    dvs_display.trigger_draw();
-                }
-            }
             BackgroundCleaner {
                 width: window.width
                 height: window.height
@@ -62,16 +53,14 @@ int main(int argc, char* argv[]) {
         window->setFormat(format);
     }
     auto dvs_display = window->findChild<chameleon::dvs_display*>("dvs_display");
-    std::atomic_bool running(true);
-    std::thread loop([&]() {
-        std::random_device random_device;
-        std::mt19937 engine(random_device());
-        std::normal_distribution<double> distribution{200, 30};
-        std::uint64_t t = 0;
-        const auto time_reference = std::chrono::high_resolution_clock::now();
-        while (running.load(std::memory_order_relaxed)) {
+    std::random_device random_device;
+    std::mt19937 engine(random_device());
+    std::normal_distribution<double> distribution{200, 30};
+    std::uint64_t t = 0;
+    chameleon::event_player<event> player(
+        [&](std::vector<event>& events) {
             for (std::size_t index = 0; index < 1000; ++index) {
-                dvs_display->push(event{
+                events.push_back(event{
                     t,
                     static_cast<uint16_t>(
                         static_cast<uint64_t>(
@@ -85,11 +74,13 @@ int main(int argc, char* argv[]) {
                 });
                 t += 20;
             }
-            std::this_thread::sleep_until(time_reference + std::chrono::microseconds(t));
-        }
-    });
+            return true;
+        },
+        1.0);
+    player.add_display(*dvs_display);
+    player.set_frame_clock(chameleon::render_scheduler::of(window));
+    player.start();
     const auto error = app.exec();
-    running.store(false, std::memory_order_relaxed);
-    loop.join();
+    player.stop();
     return error;
 }
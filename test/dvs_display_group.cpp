@@ -0,0 +1,92 @@
+#include "../source/dvs_display_group.hpp"
+#include "../source/dvs_display.hpp"
+#include <QtGui/QGuiApplication>
+#include <QtQml/QQmlApplicationEngine>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+
+struct event {
+    uint64_t t;
+    uint16_t x;
+    uint16_t y;
+    bool is_increase;
+};
+
+int main(int argc, char* argv[]) {
+    chameleon::render_scheduler::configure_opengl();
+    QGuiApplication app(argc, argv);
+    qmlRegisterType<chameleon::dvs_display_group>("Chameleon", 1, 0, "DvsDisplayGroup");
+    qmlRegisterType<chameleon::dvs_display>("Chameleon", 1, 0, "ChangeDetectionDisplay");
+    QQmlApplicationEngine application_engine;
+    application_engine.loadData(R""(
+        import QtQuick 2.7
+        import QtQuick.Window 2.2
+        import Chameleon 1.0
+        Window {
+            id: window
+            visible: true
+            width: 1216
+            height: 960
+            DvsDisplayGroup {
+                width: window.width
+                height: window.height
+                color: "#888888"
+                Grid {
+                    columns: 4
+                    Repeater {
+                        model: 16
+                        ChangeDetectionDisplay {
+                            objectName: "display_" + index
+                            canvas_size: "304x240"
+                            width: window.width / 4
+                            height: window.height / 4
+                            idle_color: "#00888888"
+                            decay: 1e5
+                        }
+                    }
+                }
+            }
+        }
+    )"");
+    auto window = qobject_cast<QQuickWindow*>(application_engine.rootObjects().first());
+    {
+        QSurfaceFormat format;
+        format.setDepthBufferSize(24);
+        format.setStencilBufferSize(8);
+        format.setVersion(3, 3);
+        format.setProfile(QSurfaceFormat::CoreProfile);
+        window->setFormat(format);
+    }
+
+    // the sixteen displays are drawn by a single instanced call
+    std::array<chameleon::dvs_display*, 16> displays;
+    for (std::size_t index = 0; index < displays.size(); ++index) {
+        displays[index] =
+            window->findChild<chameleon::dvs_display*>(QString::fromStdString("display_" + std::to_string(index)));
+    }
+    std::atomic_bool running(true);
+    std::thread loop([&]() {
+        std::random_device random_device;
+        std::mt19937 engine(random_device());
+        std::uniform_int_distribution<uint16_t> x_distribution(0, 303);
+        std::uniform_int_distribution<uint16_t> y_distribution(0, 239);
+        std::uint64_t t = 0;
+        const auto time_reference = std::chrono::high_resolution_clock::now();
+        while (running.load(std::memory_order_relaxed)) {
+            for (std::size_t index = 0; index < 1000; ++index) {
+                displays[index % displays.size()]->push(
+                    event{t, x_distribution(engine), y_distribution(engine), index % 2 == 0});
+                t += 1;
+            }
+            std::this_thread::sleep_until(time_reference + std::chrono::microseconds(t));
+        }
+    });
+    const auto error = app.exec();
+    running.store(false, std::memory_order_relaxed);
+    loop.join();
+    return error;
+}
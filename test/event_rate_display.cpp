@@ -0,0 +1,84 @@
+#include "../source/event_rate_display.hpp"
+#include "../source/background_cleaner.hpp"
+#include "../source/event_player.hpp"
+#include <QtGui/QGuiApplication>
+#include <QtQml/QQmlApplicationEngine>
+#include <random>
+
+struct event {
+    uint64_t t;
+    uint16_t x;
+    uint16_t y;
+};
+
+int main(int argc, char* argv[]) {
+    chameleon::render_scheduler::configure_opengl();
+    QGuiApplication app(argc, argv);
+    qmlRegisterType<chameleon::background_cleaner>("Chameleon", 1, 0, "BackgroundCleaner");
+    qmlRegisterType<chameleon::event_rate_display>("Chameleon", 1, 0, "EventRateDisplay");
+    QQmlApplicationEngine application_engine;
+    application_engine.loadData(R""(
+        import QtQuick 2.7
+        import QtQuick.Window 2.2
+        import Chameleon 1.0
+        Window {
+            id: window
+            visible: true
+            width: 320
+            height: 240
+            BackgroundCleaner {
+                width: window.width
+                height: window.height
+            }
+            EventRateDisplay {
+                id: event_rate_display
+                objectName: "event_rate_display"
+                canvas_size: "320x240"
+                width: window.width
+                height: window.height
+                time_window: 200000
+                bins: 20
+                colormap: EventRateDisplay.Hot
+            }
+        }
+    )"");
+    auto window = qobject_cast<QQuickWindow*>(application_engine.rootObjects().first());
+    {
+        QSurfaceFormat format;
+        format.setDepthBufferSize(24);
+        format.setStencilBufferSize(8);
+        format.setVersion(3, 3);
+        format.setProfile(QSurfaceFormat::CoreProfile);
+        window->setFormat(format);
+    }
+    auto event_rate_display = window->findChild<chameleon::event_rate_display*>("event_rate_display");
+    std::random_device random_device;
+    std::mt19937 engine(random_device());
+    std::normal_distribution<double> distribution{200, 30};
+    std::uint64_t t = 0;
+    chameleon::event_player<event> player(
+        [&](std::vector<event>& events) {
+            for (std::size_t index = 0; index < 1000; ++index) {
+                events.push_back(event{
+                    t,
+                    static_cast<uint16_t>(
+                        static_cast<uint64_t>(
+                            320.0 * (static_cast<double>(t % 5000000) / 5000000.0) + distribution(engine) + 1)
+                        % 320),
+                    static_cast<uint16_t>(
+                        static_cast<uint64_t>(
+                            240.0 * (static_cast<double>(t % 5000000) / 5000000.0) + distribution(engine) + 1)
+                        % 240),
+                });
+                t += 20;
+            }
+            return true;
+        },
+        1.0);
+    player.add_display(*event_rate_display);
+    player.set_frame_clock(chameleon::render_scheduler::of(window));
+    player.start();
+    const auto error = app.exec();
+    player.stop();
+    return error;
+}
@@ -0,0 +1,106 @@
+#include "../source/event_surface.hpp"
+#include "../source/background_cleaner.hpp"
+#include <QtGui/QGuiApplication>
+#include <QtQml/QQmlApplicationEngine>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+struct event {
+    uint64_t t;
+    uint16_t x;
+    uint16_t y;
+    bool is_increase;
+};
+
+int main(int argc, char* argv[]) {
+    chameleon::render_scheduler::configure_opengl();
+    QGuiApplication app(argc, argv);
+    qmlRegisterType<chameleon::background_cleaner>("Chameleon", 1, 0, "BackgroundCleaner");
+    qmlRegisterType<chameleon::event_surface>("Chameleon", 1, 0, "EventSurface");
+    qmlRegisterType<chameleon::event_surface_display>("Chameleon", 1, 0, "EventSurfaceDisplay");
+    QQmlApplicationEngine application_engine;
+    application_engine.loadData(R""(
+        import QtQuick 2.7
+        import QtQuick.Layouts 1.1
+        import QtQuick.Window 2.2
+        import Chameleon 1.0
+        Window {
+            id: window
+            visible: true
+            width: 640
+            height: 240
+            BackgroundCleaner {
+                width: window.width
+                height: window.height
+                color: "#888888"
+            }
+            EventSurface {
+                id: event_surface
+                objectName: "event_surface"
+                canvas_size: "320x240"
+            }
+            RowLayout {
+                width: window.width
+                height: window.height
+                spacing: 0
+                EventSurfaceDisplay {
+                    surface: event_surface
+                    style: EventSurfaceDisplay.ChangeDetection
+                    idle_color: "#00888888"
+                    decay: 1e6
+                    Layout.fillWidth: true
+                    Layout.fillHeight: true
+                }
+                EventSurfaceDisplay {
+                    surface: event_surface
+                    style: EventSurfaceDisplay.DeltaT
+                    colormap: EventSurfaceDisplay.Hot
+                    Layout.fillWidth: true
+                    Layout.fillHeight: true
+                }
+            }
+        }
+    )"");
+    auto window = qobject_cast<QQuickWindow*>(application_engine.rootObjects().first());
+    {
+        QSurfaceFormat format;
+        format.setDepthBufferSize(24);
+        format.setStencilBufferSize(8);
+        format.setVersion(3, 3);
+        format.setProfile(QSurfaceFormat::CoreProfile);
+        window->setFormat(format);
+    }
+    auto event_surface = window->findChild<chameleon::event_surface*>("event_surface");
+    std::atomic_bool running(true);
+    std::thread loop([&]() {
+        std::random_device random_device;
+        std::mt19937 engine(random_device());
+        std::normal_distribution<double> distribution{200, 30};
+        std::uint64_t t = 0;
+        const auto time_reference = std::chrono::high_resolution_clock::now();
+        while (running.load(std::memory_order_relaxed)) {
+            for (std::size_t index = 0; index < 1000; ++index) {
+                event_surface->push(event{
+                    t,
+                    static_cast<uint16_t>(
+                        static_cast<uint64_t>(
+                            320.0 * (static_cast<double>(t % 5000000) / 5000000.0) + distribution(engine) + 1)
+                        % 320),
+                    static_cast<uint16_t>(
+                        static_cast<uint64_t>(
+                            240.0 * (static_cast<double>(t % 5000000) / 5000000.0) + distribution(engine) + 1)
+                        % 240),
+                    engine() < std::numeric_limits<uint_fast32_t>::max() / 2,
+                });
+                t += 20;
+            }
+            std::this_thread::sleep_until(time_reference + std::chrono::microseconds(t));
+        }
+    });
+    const auto error = app.exec();
+    running.store(false, std::memory_order_relaxed);
+    loop.join();
+    return error;
+}
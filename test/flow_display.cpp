@@ -16,6 +16,7 @@ struct event {
 };
 
 int main(int argc, char* argv[]) {
+    chameleon::render_scheduler::configure_opengl();
     QGuiApplication app(argc, argv);
     qmlRegisterType<chameleon::background_cleaner>("Chameleon", 1, 0, "BackgroundCleaner");
     qmlRegisterType<chameleon::flow_display>("Chameleon", 1, 0, "FlowDisplay");
@@ -29,14 +30,6 @@ int main(int argc, char* argv[]) {
             visible: true
             width: 320
             height: 240
-            Timer {
-                interval: 20
-                running: true
-                repeat: true
-                onTriggered: {
-                    flow_display.trigger_draw();
-                }
-            }
             BackgroundCleaner {
                 width: window.width
                 height: window.height
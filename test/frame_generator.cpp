@@ -14,6 +14,7 @@ struct event {
 };
 
 int main(int argc, char* argv[]) {
+    chameleon::render_scheduler::configure_opengl();
     QGuiApplication app(argc, argv);
     qmlRegisterType<chameleon::grey_display>("Chameleon", 1, 0, "GreyDisplay");
     qmlRegisterType<chameleon::frame_generator>("Chameleon", 1, 0, "FrameGenerator");
@@ -74,7 +75,7 @@ int main(int argc, char* argv[]) {
         while (running.load(std::memory_order_relaxed)) {
             for (std::size_t index = 0; index < 1000; ++index) {
                 if (t >= 100000 * frame_index) {
-                    frame_generator->save_frame_to(std::to_string(frame_index % 5) + ".png");
+                    frame_generator->save_frame_to_async(std::to_string(frame_index % 5) + ".png");
                     ++frame_index;
                 }
                 grey_display->push(
@@ -0,0 +1,78 @@
+#include "../source/headless_renderer.hpp"
+#include "../source/dvs_display.hpp"
+#include "../source/frame_generator.hpp"
+#include <QtGui/QGuiApplication>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+struct event {
+    uint64_t t;
+    uint16_t x;
+    uint16_t y;
+    bool is_increase;
+};
+
+int main(int argc, char* argv[]) {
+    chameleon::render_scheduler::configure_opengl();
+    QGuiApplication app(argc, argv);
+    qmlRegisterType<chameleon::dvs_display>("Chameleon", 1, 0, "ChangeDetectionDisplay");
+    qmlRegisterType<chameleon::frame_generator>("Chameleon", 1, 0, "FrameGenerator");
+    std::vector<event> events;
+    {
+        std::random_device random_device;
+        std::mt19937 engine(random_device());
+        std::normal_distribution<double> distribution{0, 10};
+        std::uniform_real_distribution<float> polarity_distribution;
+        for (uint64_t t = 0; t < 10000000; t += 5) {
+            const auto angle = static_cast<double>(t) / 1000000.0 * 2.0 * 3.14159265358979323846;
+            events.push_back(
+                event{t,
+                      static_cast<uint16_t>(
+                          static_cast<uint64_t>(160.0 + 100.0 * std::cos(angle) + distribution(engine)) % 320),
+                      static_cast<uint16_t>(
+                          static_cast<uint64_t>(120.0 + 100.0 * std::sin(angle) + distribution(engine)) % 240),
+                      polarity_distribution(engine) < 0.5f});
+        }
+    }
+    chameleon::headless_renderer headless_renderer(QSize(320, 240));
+    headless_renderer.load(R""(
+        import QtQuick 2.7
+        import Chameleon 1.0
+        Item {
+            ChangeDetectionDisplay {
+                id: dvs_display
+                objectName: "dvs_display"
+                canvas_size: "320x240"
+                width: parent.width
+                height: parent.height
+            }
+            FrameGenerator {
+                id: frame_generator
+                objectName: "frame_generator"
+                width: parent.width
+                height: parent.height
+                workers: 4
+            }
+        }
+    )"");
+    auto dvs_display = headless_renderer.root()->findChild<chameleon::dvs_display*>("dvs_display");
+    auto frame_generator = headless_renderer.root()->findChild<chameleon::frame_generator*>("frame_generator");
+    std::size_t frame_index = 0;
+    const auto time_reference = std::chrono::high_resolution_clock::now();
+    headless_renderer.replay(
+        events.begin(),
+        events.end(),
+        20000,
+        [&](std::vector<event>::iterator begin, std::vector<event>::iterator end) { dvs_display->push(begin, end); },
+        [&](uint64_t) {
+            frame_generator->save_frame_to_async(std::to_string(frame_index) + ".png");
+            ++frame_index;
+        });
+    const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - time_reference);
+    std::cout << frame_index << " frames (" << events.back().t / 1000000 << " s of events) rendered in "
+              << duration.count() << " ms" << std::endl;
+    return 0;
+}
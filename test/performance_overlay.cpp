@@ -0,0 +1,96 @@
+#include "../source/performance_overlay.hpp"
+#include "../source/background_cleaner.hpp"
+#include "../source/dvs_display.hpp"
+#include <QtGui/QGuiApplication>
+#include <QtQml/QQmlApplicationEngine>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+struct event {
+    uint64_t t;
+    uint16_t x;
+    uint16_t y;
+    bool is_increase;
+};
+
+int main(int argc, char* argv[]) {
+    chameleon::render_scheduler::configure_opengl();
+    QGuiApplication app(argc, argv);
+    qmlRegisterType<chameleon::background_cleaner>("Chameleon", 1, 0, "BackgroundCleaner");
+    qmlRegisterType<chameleon::dvs_display>("Chameleon", 1, 0, "ChangeDetectionDisplay");
+    qmlRegisterType<chameleon::performance_overlay>("Chameleon", 1, 0, "PerformanceOverlay");
+    QQmlApplicationEngine application_engine;
+    application_engine.loadData(R""(
+        import QtQuick 2.7
+        import QtQuick.Window 2.2
+        import Chameleon 1.0
+        Window {
+            id: window
+            visible: true
+            width: 640
+            height: 480
+            BackgroundCleaner {
+                width: window.width
+                height: window.height
+                color: "#888888"
+            }
+            ChangeDetectionDisplay {
+                id: change_detection_display
+                objectName: "change_detection_display"
+                canvas_size: "640x480"
+                width: window.width
+                height: window.height
+                idle_color: "#00888888"
+                decay: 1e5
+            }
+            PerformanceOverlay {
+                x: 10
+                y: 10
+                width: 300
+                height: 120
+                display: change_detection_display
+                color: "#ffffff"
+            }
+            Text {
+                anchors.bottom: parent.bottom
+                anchors.margins: 10
+                x: 10
+                color: "#ffffff"
+                text: "GPU: " + change_detection_display.gpu_duration.toFixed(1) + " us"
+            }
+        }
+    )"");
+    auto window = qobject_cast<QQuickWindow*>(application_engine.rootObjects().first());
+    {
+        QSurfaceFormat format;
+        format.setDepthBufferSize(24);
+        format.setStencilBufferSize(8);
+        format.setVersion(3, 3);
+        format.setProfile(QSurfaceFormat::CoreProfile);
+        window->setFormat(format);
+    }
+    auto change_detection_display = window->findChild<chameleon::dvs_display*>("change_detection_display");
+    std::atomic_bool running(true);
+    std::thread loop([&]() {
+        std::random_device random_device;
+        std::mt19937 engine(random_device());
+        std::uniform_int_distribution<uint16_t> x_distribution(0, 639);
+        std::uniform_int_distribution<uint16_t> y_distribution(0, 479);
+        std::uint64_t t = 0;
+        const auto time_reference = std::chrono::high_resolution_clock::now();
+        while (running.load(std::memory_order_relaxed)) {
+            for (std::size_t index = 0; index < 1000; ++index) {
+                change_detection_display->push(
+                    event{t, x_distribution(engine), y_distribution(engine), index % 2 == 0});
+                t += 1;
+            }
+            std::this_thread::sleep_until(time_reference + std::chrono::microseconds(t));
+        }
+    });
+    const auto error = app.exec();
+    running.store(false, std::memory_order_relaxed);
+    loop.join();
+    return error;
+}
@@ -0,0 +1,108 @@
+#include "../source/render_scheduler.hpp"
+#include "../source/background_cleaner.hpp"
+#include "../source/dvs_display.hpp"
+#include <QtGui/QGuiApplication>
+#include <QtQml/QQmlApplicationEngine>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+
+struct event {
+    uint64_t t;
+    uint16_t x;
+    uint16_t y;
+    bool is_increase;
+};
+
+int main(int argc, char* argv[]) {
+    chameleon::render_scheduler::configure_opengl();
+    QGuiApplication app(argc, argv);
+    qmlRegisterType<chameleon::background_cleaner>("Chameleon", 1, 0, "BackgroundCleaner");
+    qmlRegisterType<chameleon::dvs_display>("Chameleon", 1, 0, "ChangeDetectionDisplay");
+    QQmlApplicationEngine application_engine;
+    application_engine.loadData(R""(
+        import QtQuick 2.7
+        import QtQuick.Window 2.2
+        import Chameleon 1.0
+        Window {
+            id: window
+            visible: true
+            width: 640
+            height: 240
+            BackgroundCleaner {
+                width: window.width
+                height: window.height
+                color: "#888888"
+            }
+            Row {
+                ChangeDetectionDisplay {
+                    objectName: "left_display"
+                    canvas_size: "320x240"
+                    width: window.width / 2
+                    height: window.height
+                    idle_color: "#00888888"
+                    decay: 1e5
+                }
+                ChangeDetectionDisplay {
+                    objectName: "right_display"
+                    canvas_size: "320x240"
+                    width: window.width / 2
+                    height: window.height
+                    idle_color: "#00888888"
+                    decay: 1e5
+                }
+            }
+        }
+    )"");
+    auto window = qobject_cast<QQuickWindow*>(application_engine.rootObjects().first());
+    {
+        QSurfaceFormat format;
+        format.setDepthBufferSize(24);
+        format.setStencilBufferSize(8);
+        format.setVersion(3, 3);
+        format.setProfile(QSurfaceFormat::CoreProfile);
+        window->setFormat(format);
+    }
+
+    // both displays share the window's scheduler, the frames are counted to show the coalescing and the idle periods
+    chameleon::render_scheduler::of(window)->set_maximum_fps(30);
+    std::atomic<std::size_t> frames(0);
+    QObject::connect(
+        window, &QQuickWindow::frameSwapped, [&]() { frames.fetch_add(1, std::memory_order_relaxed); });
+    auto left_display = window->findChild<chameleon::dvs_display*>("left_display");
+    auto right_display = window->findChild<chameleon::dvs_display*>("right_display");
+    std::atomic_bool running(true);
+    std::thread loop([&]() {
+        std::random_device random_device;
+        std::mt19937 engine(random_device());
+        std::uniform_int_distribution<uint16_t> x_distribution(0, 319);
+        std::uniform_int_distribution<uint16_t> y_distribution(0, 239);
+        std::uint64_t t = 0;
+        const auto time_reference = std::chrono::high_resolution_clock::now();
+        while (running.load(std::memory_order_relaxed)) {
+            // events are produced during one second out of three
+            if ((t / 1000000) % 3 == 0) {
+                for (std::size_t index = 0; index < 100; ++index) {
+                    const auto generated_event =
+                        event{t, x_distribution(engine), y_distribution(engine), index % 2 == 0};
+                    left_display->push(generated_event);
+                    right_display->push(generated_event);
+                    t += 10;
+                }
+            } else {
+                t += 1000;
+            }
+            if (t % 1000000 < 1000) {
+                std::cout << (t / 1000000) << " s: " << frames.exchange(0, std::memory_order_relaxed) << " frames"
+                          << std::endl;
+            }
+            std::this_thread::sleep_until(time_reference + std::chrono::microseconds(t));
+        }
+    });
+    const auto error = app.exec();
+    running.store(false, std::memory_order_relaxed);
+    loop.join();
+    return error;
+}